@@ -62,6 +62,60 @@ public:
   ) =0;
 
 
+  /*!
+    \brief
+    calcLap() for the same basis on several centers at once.  Row c of
+    r is the distance to center c, in the form of calcLap(), and the
+    functions of center c are filled starting at row c*nfunc() of symvals.
+  */
+  virtual void calcLapCenters(const Array2 <doublevar> & r,
+                              int ncenters,
+                              Array2 <T> & symvals) {
+    int nf=nfunc();
+    for(int c=0; c< ncenters; c++) {
+      Array1 <doublevar> rc(r.GetDim(1), r.v+c*r.step1);
+      calcLap(rc, symvals, c*nf);
+    }
+  }
+
+  /*!
+    \brief
+    For radial functions (isRadial()): the value of each function at
+    n distances, as f[i*n+k] for function i at r[k].  Zero past the
+    cutoff.
+  */
+  virtual void calcRadialVal(int n, const doublevar * r, T * f) {
+    int nf=nfunc();
+    Array1 <doublevar> R(5);
+    Array1 <T> val(nf);
+    for(int k=0; k< n; k++) {
+      R(0)=r[k]; R(1)=r[k]*r[k]; R(2)=r[k]; R(3)=0; R(4)=0;
+      calcVal(R, val);
+      for(int i=0; i< nf; i++) f[i*n+k]=val(i);
+    }
+  }
+
+  /*!
+    \brief
+    For radial functions: the value, \f$ \frac{1}{r}\frac{df}{dr} \f$,
+    and Laplacian of each function at n distances, as f[(3*i+c)*n+k]
+    for function i at r[k], c=0,1,2.  Zero past the cutoff.
+  */
+  virtual void calcRadialLap(int n, const doublevar * r, T * f) {
+    int nf=nfunc();
+    Array1 <doublevar> R(5);
+    Array2 <T> lap(nf,5);
+    for(int k=0; k< n; k++) {
+      R(0)=r[k]; R(1)=r[k]*r[k]; R(2)=r[k]; R(3)=0; R(4)=0;
+      calcLap(R, lap);
+      for(int i=0; i< nf; i++) {
+        f[3*i*n+k]=lap(i,0);
+        f[(3*i+1)*n+k]=lap(i,1)/r[k];
+        f[(3*i+2)*n+k]=lap(i,4);
+      }
+    }
+  }
+
   virtual void calcHessian(const Array1 <doublevar> & r,
 			   Array2 <T> & symvals,
 			   //!< (func, [val,grad,d2f/dx2,d2f/dy2,d2f/dz2
@@ -107,6 +161,20 @@ public:
   */
   virtual doublevar cutoff(int )=0;
 
+  /*!
+    \brief
+    A distance past which |f| < tol in every direction for function n,
+    or 0 if that holds everywhere.  By default only the cutoff is known.
+  */
+  virtual doublevar boundRadius(int n, doublevar tol) { return cutoff(n); }
+
+  /*!
+    \brief
+    Return one if every function depends only on the distance, so
+    that it can be tabulated in r.
+  */
+  virtual int isRadial() { return 0; }
+
   /*!
     \brief
     Show some summary information for the output file.  Return
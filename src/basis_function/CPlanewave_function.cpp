@@ -53,6 +53,7 @@ int CPlanewave_function::read(
       counter++;
     }
   }
+  phases.init(g_vector);
   //cout << "done " << endl;
   return 0;
 }
@@ -98,16 +99,13 @@ void CPlanewave_function::calcVal(const Array1 <doublevar> & r,
                                  Array1 <dcomplex> & symvals,
                                  const int startfill)
 {
-  const dcomplex I(0.0,1.0);
   //cout << "calcVal " << endl;
   assert(r.GetDim(0) >= 5);
   assert(symvals.GetDim(0) >= nmax+startfill);
-  int index=startfill;
-  doublevar gdotr;
-  for(int i=0; i< nmax; i++) {
-    gdotr=g_vector(i,0)*r(2)+g_vector(i,1)*r(3)+g_vector(i,2)*r(4);
-    symvals(index++)=exp(I*gdotr);
-  }
+  const doublevar * cosgr, * singr;
+  phases.eval(r.v+2, cosgr, singr);
+  for(int j=0; j< nmax; j++) 
+    symvals(startfill+phases.order(j))=dcomplex(cosgr[j],singr[j]);
   //cout << "done" << endl;
 }
 
@@ -123,13 +121,14 @@ void CPlanewave_function::calcLap(
   assert(symvals.GetDim(0) >= nmax+startfill);
   assert(symvals.GetDim(1) >= 5);
 
-  int index=startfill;
-  doublevar gdotr;
+  const doublevar * cosgr, * singr;
+  phases.eval(r.v+2, cosgr, singr);
   doublevar gsquared;
   dcomplex t_exp;
-  for(int fn=0; fn< nmax; fn++) {
-    gdotr=g_vector(fn,0)*r(2)+g_vector(fn,1)*r(3)+g_vector(fn,2)*r(4);
-    t_exp=exp(I*gdotr);
+  for(int j=0; j< nmax; j++) {
+    int fn=phases.order(j);
+    int index=startfill+fn;
+    t_exp=dcomplex(cosgr[j],singr[j]);
 
     //Should probably store this one..
     gsquared=g_vector(fn,0)*g_vector(fn,0)
@@ -51,6 +51,7 @@ int Cosine_function::read(
       counter++;
     }
   }
+  phases.init(g_vector);
   return 0;
 }
 
@@ -102,6 +103,14 @@ void Cosine_function::calcVal(const Array1 <doublevar> & r,
   //cout << "calcVal " << endl;
   assert(r.GetDim(0) >= 5);
   assert(symvals.GetDim(0) >= nmax+startfill);
+  //with the recursion, the sines come for free
+  if(phases.onLattice()) { 
+    const doublevar * cosgr, * singr;
+    phases.eval(r.v+2, cosgr, singr);
+    for(int j=0; j< nmax; j++) 
+      symvals(startfill+phases.order(j))=cosgr[j];
+    return;
+  }
   int index=startfill;
   doublevar gdotr, t_cos;
   for(int i=0; i< nmax; i++) {
@@ -123,17 +132,14 @@ void Cosine_function::calcLap(
   assert(symvals.GetDim(0) >= nmax+startfill);
   assert(symvals.GetDim(1) >= 5);
 
-  int index=startfill;
-  doublevar gdotr, t_cos, t_sin;
-  for(int fn=0; fn< nmax; fn++) {
-    gdotr=g_vector(fn,0)*r(2)+g_vector(fn,1)*r(3)+g_vector(fn,2)*r(4);
-
-#ifdef __USE_GNU
-    sincos(gdotr, &t_sin, &t_cos);
-#else
-    t_cos=cos(gdotr);
-    t_sin=sin(gdotr);
-#endif
+  const doublevar * cosgr, * singr;
+  phases.eval(r.v+2, cosgr, singr);
+  doublevar t_cos, t_sin;
+  for(int j=0; j< nmax; j++) {
+    int fn=phases.order(j);
+    int index=startfill+fn;
+    t_cos=cosgr[j];
+    t_sin=singr[j];
     symvals(index, 0)=t_cos;
     for(int i=1; i< 4; i++) {
       symvals(index, i)=-g_vector(fn, i-1)*t_sin;
@@ -157,21 +163,18 @@ void Cosine_function::calcHessian(
   assert(symvals.GetDim(0) >= nmax+startfill);
   assert(symvals.GetDim(1) >= 10);
 
-  int index=startfill;
-  doublevar gdotr, t_cos, t_sin;
+  const doublevar * cosgr, * singr;
+  phases.eval(r.v+2, cosgr, singr);
+  doublevar t_cos, t_sin;
   doublevar gx, gy, gz;
-  for(int fn=0; fn< nmax; fn++) {
+  for(int j=0; j< nmax; j++) {
+    int fn=phases.order(j);
+    int index=startfill+fn;
     gx=g_vector(fn, 0);
     gy=g_vector(fn, 1);
     gz=g_vector(fn, 2);
-    gdotr=gx*r(2)+gy*r(3)+gz*r(4);
-
-#ifdef __USE_GNU
-    sincos(gdotr, &t_sin, &t_cos);
-#else
-    t_cos=cos(gdotr);
-    t_sin=sin(gdotr);
-#endif
+    t_cos=cosgr[j];
+    t_sin=singr[j];
    
     symvals(index, 0)=t_cos;
     for(int i=1; i< 4; i++) {
@@ -103,8 +103,27 @@ private:
   doublevar customspacing;
 
   Array1 <Spline_fitter> splines;
+  Shared_tables shared_tables; //!< holds the spline tables with -share_tables
 
+  bool common_grid;
+  //!< whether all splines have the same spacing, so the interval is found once
+
+  //Layout of each shell for the kernels in Cubic_spline_calc.cpp
+  Array1 <int> shell_kernel;
+  //!< 2*L for a shell of Cartesian monomials, 2*L+1 for combinations of them
+  Array1 <int> term_start;
+  //!< function f is made of the terms term_start(f)..term_start(f+1)-1
+  Array1 <int> term_monomial;
+  //!< the monomial of each term, in the order of the kernels
+  Array1 <doublevar> term_coeff;
+  //!< the coefficient of each term
+
+  Array1 < Array1 <doublevar> > spline_bound;
+  //!< Spline_fitter::boundTable() of each spline, made by the first boundRadius()
+
+  void assign_shell_terms();
   void findCutoffs();
+  void lapOneCenter(const doublevar * r, doublevar * out, int stride);
 
   /*!
     Read the spline fit points.  
@@ -137,6 +156,7 @@ public:
 
   int nfunc();
   doublevar cutoff(int);
+  doublevar boundRadius(int n, doublevar tol);
   virtual string label()
   {
     return atomname;
@@ -159,6 +179,8 @@ public:
     const int startfill=0
   );
 
+  virtual void calcLapCenters(const Array2 <doublevar> & r, int ncenters,
+                              Array2 <doublevar> & symvals);
 
   virtual void calcHessian(const Array1 <doublevar> & r,
 			   Array2 <doublevar> & symvals,
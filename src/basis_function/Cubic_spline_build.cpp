@@ -237,13 +237,14 @@ int Cubic_spline::readspline(vector <string> & words) {
   }
   //cout << "maximum support " << max_support <<endl;
   
-  
+  //only the writer fits the tables; findCutoffs() pads them to at most
+  //max_support, which they have room for
   for(int s=0; s< nsplines; s++) {
-    splines(s).readspline(splinefits[s], enforce_cusp, cusp/double(symmetry_lvalue(symmetry(s))+1));
-    if(requested_cutoff > 0) { 
-      splines(s).enforceCutoff(requested_cutoff);
-    }
+    splines(s).readspline(splinefits[s], enforce_cusp, 
+                          cusp/double(symmetry_lvalue(symmetry(s))+1),
+                          requested_cutoff, max_support, shared_tables);
   }
+  shared_tables.sync();
 
   findCutoffs();
   return nfunc();
@@ -317,6 +318,26 @@ doublevar Cubic_spline::cutoff(int n){
   return rcut(n);
 }
 
+/*!
+Each function is a polynomial P of degree L times the spline, and a
+monomial of degree L is at most r^L, so |P| is at most the sum of the
+sizes of its coefficients times r^L.
+*/
+doublevar Cubic_spline::boundRadius(int n, doublevar tol) { 
+  assert(n<nfunctions);
+  if(spline_bound.GetDim(0)!=nsplines) { 
+    spline_bound.Resize(nsplines);
+    for(int s=0; s< nsplines; s++) 
+      splines(s).boundTable(symmetry_lvalue(symmetry(s)), spline_bound(s));
+  }
+  int s=0, f=n;
+  while(f >= nfuncspline(s)) f-=nfuncspline(s++);
+  doublevar poly=0;
+  for(int t=term_start(n); t< term_start(n+1); t++) poly+=fabs(term_coeff(t));
+  if(poly==0) return 0;
+  return min(rcut(n), splines(s).boundRadius(spline_bound(s), tol/poly));
+}
+
 
 void Cubic_spline::findCutoffs()
 {
@@ -371,6 +392,11 @@ void Cubic_spline::findCutoffs()
   for(int i=0; i< nsplines; i++) { 
     splines(i).pad(threshold);
   }
+
+  common_grid=true;
+  for(int i=0; i< nsplines; i++) {
+    if(!splines(0).match(splines(i))) common_grid=false;
+  }
 }
 //-------------------------------------------------------
 
@@ -627,8 +653,10 @@ int Cubic_spline::readbasis(vector <string> & words,unsigned int & pos,
     cout << "jjjjjjj " << endl;
     */
     
-    splines(funcNum).splinefit(x,y,yp1, ypn);
+    //every spline is on the same grid, so none of them is padded
+    splines(funcNum).splinefit(x,y,yp1, ypn, 0.0, shared_tables);
   }
+  shared_tables.sync();
   nfunctions=nfunc();
 
 
@@ -774,6 +802,107 @@ void Cubic_spline::assign_indiv_symmetries() {
         
     }
   }
+  assign_shell_terms();
+}
+
+//-------------------------------------------------------
+
+/*!
+Write each function as a combination of the Cartesian monomials of its
+shell, for the kernels in Cubic_spline_calc.cpp.  The spherical functions
+are not normalized; they are the same polynomials as the GAMESS, CRYSTAL,
+and SIESTA orderings in assign_indiv_symmetries() refer to.
+*/
+void Cubic_spline::assign_shell_terms() {
+  //symmetry, coefficient, powers of x, y, z
+  struct Poly_term { int sym; doublevar c; int i, j, k; };
+  static const Poly_term poly_terms[]={
+    {isym_S,1, 0,0,0},
+    {isym_Px,1, 1,0,0}, {isym_Py,1, 0,1,0}, {isym_Pz,1, 0,0,1},
+    {isym_Dxx,1, 2,0,0}, {isym_Dyy,1, 0,2,0}, {isym_Dzz,1, 0,0,2},
+    {isym_Dxy,1, 1,1,0}, {isym_Dxz,1, 1,0,1}, {isym_Dyz,1, 0,1,1},
+    {isym_Dz2r2,2, 0,0,2}, {isym_Dz2r2,-1, 2,0,0}, {isym_Dz2r2,-1, 0,2,0},
+    {isym_Dx2y2,1, 2,0,0}, {isym_Dx2y2,-1, 0,2,0},
+    {isym_Fxxx,1, 3,0,0}, {isym_Fyyy,1, 0,3,0}, {isym_Fzzz,1, 0,0,3},
+    {isym_Fxxy,1, 2,1,0}, {isym_Fxxz,1, 2,0,1}, {isym_Fyyx,1, 1,2,0},
+    {isym_Fyyz,1, 0,2,1}, {isym_Fzzx,1, 1,0,2}, {isym_Fzzy,1, 0,1,2},
+    {isym_Fxyz,1, 1,1,1},
+    //y(3xx-yy)
+    {isym_Fm3,3, 2,1,0}, {isym_Fm3,-1, 0,3,0},
+    //y(4zz-xx-yy)
+    {isym_Fm1,4, 0,1,2}, {isym_Fm1,-1, 2,1,0}, {isym_Fm1,-1, 0,3,0},
+    //z(2zz-3xx-3yy)
+    {isym_F0,2, 0,0,3}, {isym_F0,-3, 2,0,1}, {isym_F0,-3, 0,2,1},
+    //x(4zz-xx-yy)
+    {isym_Fp1,4, 1,0,2}, {isym_Fp1,-1, 3,0,0}, {isym_Fp1,-1, 1,2,0},
+    //z(xx-yy)
+    {isym_Fp2,1, 2,0,1}, {isym_Fp2,-1, 0,2,1},
+    //x(xx+yy)
+    {isym_Fp3,1, 3,0,0}, {isym_Fp3,1, 1,2,0},
+    //x(xx-3yy)
+    {isym_Fp3mod,1, 3,0,0}, {isym_Fp3mod,-3, 1,2,0},
+    {isym_Gxxxx,1, 4,0,0}, {isym_Gyyyy,1, 0,4,0}, {isym_Gzzzz,1, 0,0,4},
+    {isym_Gxxxy,1, 3,1,0}, {isym_Gxxxz,1, 3,0,1}, {isym_Gyyyx,1, 1,3,0},
+    {isym_Gyyyz,1, 0,3,1}, {isym_Gzzzx,1, 1,0,3}, {isym_Gzzzy,1, 0,1,3},
+    {isym_Gxxyy,1, 2,2,0}, {isym_Gxxzz,1, 2,0,2}, {isym_Gyyzz,1, 0,2,2},
+    {isym_Gxxyz,1, 2,1,1}, {isym_Gyyxz,1, 1,2,1}, {isym_Gzzxy,1, 1,1,2},
+    //35z^4-30z^2r^2+3r^4
+    {isym_G0,8, 0,0,4}, {isym_G0,3, 4,0,0}, {isym_G0,3, 0,4,0},
+    {isym_G0,6, 2,2,0}, {isym_G0,-24, 2,0,2}, {isym_G0,-24, 0,2,2},
+    //xz(7zz-3rr)
+    {isym_G1,4, 1,0,3}, {isym_G1,-3, 3,0,1}, {isym_G1,-3, 1,2,1},
+    //yz(7zz-3rr)
+    {isym_G2,4, 0,1,3}, {isym_G2,-3, 2,1,1}, {isym_G2,-3, 0,3,1},
+    //(xx-yy)(7zz-rr)
+    {isym_G3,6, 2,0,2}, {isym_G3,-6, 0,2,2}, {isym_G3,-1, 4,0,0},
+    {isym_G3,1, 0,4,0},
+    //xy(7zz-rr)
+    {isym_G4,6, 1,1,2}, {isym_G4,-1, 3,1,0}, {isym_G4,-1, 1,3,0},
+    //xz(xx-3yy)
+    {isym_G5,1, 3,0,1}, {isym_G5,-3, 1,2,1},
+    //yz(3xx-yy)
+    {isym_G6,3, 2,1,1}, {isym_G6,-1, 0,3,1},
+    //(xx-3yy)xx-(3xx-yy)yy
+    {isym_G7,1, 4,0,0}, {isym_G7,-6, 2,2,0}, {isym_G7,1, 0,4,0},
+    //xy(xx-yy)
+    {isym_G8,1, 3,1,0}, {isym_G8,-1, 1,3,0}
+  };
+  const int nterms=sizeof(poly_terms)/sizeof(Poly_term);
+
+  shell_kernel.Resize(nsplines);
+  term_start.Resize(nfunctions+1);
+  vector <int> mono;
+  vector <doublevar> coeff;
+  int totf=0;
+  for(int i=0; i< nsplines; i++) {
+    int L=symmetry_lvalue(symmetry(i));
+    bool cartesian=true;
+    for(int f=0; f< nfuncspline(i); f++) {
+      term_start(totf)=mono.size();
+      for(int t=0; t< nterms; t++) {
+        const Poly_term & p=poly_terms[t];
+        if(p.sym!=indiv_symmetry(totf)) continue;
+        assert(p.i+p.j+p.k==L);
+        //position in the kernels' order: x power decreasing, then y power
+        int m=0;
+        for(int a=L; a > p.i; a--) m+=L-a+1;
+        m+=L-p.i-p.j;
+        mono.push_back(m);
+        coeff.push_back(p.c);
+        if(p.c!=1.0) cartesian=false;
+      }
+      if(int(mono.size())-term_start(totf)!=1) cartesian=false;
+      totf++;
+    }
+    shell_kernel(i)=2*L+(cartesian?0:1);
+  }
+  term_start(nfunctions)=mono.size();
+  term_monomial.Resize(mono.size());
+  term_coeff.Resize(coeff.size());
+  for(unsigned int t=0; t< mono.size(); t++) {
+    term_monomial(t)=mono[t];
+    term_coeff(t)=coeff[t];
+  }
 }
 
 
@@ -154,3 +154,39 @@ void Cutoff_cusp::calcLap(
 }
 
 //------------------------------------------------------------------------
+
+void Cutoff_cusp::calcRadialVal(int n, const doublevar * r, doublevar * f) {
+  for(int k=0; k< n; k++) {
+    doublevar inside= r[k] < rcut ? 1.0 : 0.0;
+    doublevar zz=min(r[k], rcut)*rcutinv;
+    doublevar zz2=zz*zz;
+    doublevar pp=zz-zz2+zz*zz2/3;
+    doublevar pade=1./(1+gamma*pp);
+    f[k]=inside*(cusp*rcut*(pp*pade-pade0));
+  }
+}
+
+//------------------------------------------------------------------------
+
+void Cutoff_cusp::calcRadialLap(int n, const doublevar * r, doublevar * f) {
+  doublevar * val=f, * grad=f+n, * lap=f+2*n;
+  for(int k=0; k< n; k++) {
+    doublevar inside= r[k] < rcut ? 1.0 : 0.0;
+    doublevar zz=min(r[k], rcut)*rcutinv;
+    doublevar zz2=zz*zz;
+    doublevar pp=zz-zz2+zz*zz2/3;
+    doublevar pade=1./(1+gamma*pp);
+    doublevar pade2=pade*pade;
+    doublevar ppd=1.-2.*zz+zz2;
+    doublevar ppdd=-2.+2.*zz;
+    doublevar dadr=ppd*pade2/r[k];
+    doublevar dadr2=ppdd*pade2*rcutinv
+                    -2.*gamma*ppd*ppd*pade2*pade*rcutinv
+                    +2.*dadr;
+    val[k]=inside*(cusp*rcut*(pp*pade-pade0));
+    grad[k]=inside*(cusp*dadr);
+    lap[k]=inside*(cusp*dadr2);
+  }
+}
+
+//------------------------------------------------------------------------
@@ -53,6 +53,7 @@ public:
   {
     return rcut;
   }
+  int isRadial() { return 1; }
 
   int showinfo(string & indent, ostream & os);
   int writeinput(string &, ostream &);
@@ -50,6 +50,9 @@ int Gaussian_function::read(
   }
   rcut_start=rcut-cut_smooth;
 
+  if(!readvalue(words, pos=startpos, tolerance, "TOLERANCE")) {
+    tolerance=0;
+  }
 
   nmax=alphatxt.size();
   alpha.Resize(nmax);
@@ -60,11 +63,27 @@ int Gaussian_function::read(
       error("Alpha must be greater than zero in Gaussian function.");
     }
   }
+  setupShells();
 
   //cout << "done " << endl;
   return 0;
 }
 
+/*!
+  Each alpha is a shell with one primitive, with the normalization
+  folded into the coefficient.
+*/
+void Gaussian_function::setupShells() {
+  shells.clear();
+  vector <doublevar> a(1), c(1), n(1, 0.0);
+  for(int i=0; i< nmax; i++) {
+    a[0]=alpha(i);
+    c[0]=sqrt(alpha(i)/pi);
+    shells.addShell(a, c, n);
+  }
+  shells.setup(tolerance);
+}
+
 void Gaussian_function::getVarParms(Array1 <doublevar> & parms) {
   //cout << "getVarParms " << endl;
   parms.Resize(nmax);
@@ -81,6 +100,7 @@ void Gaussian_function::setVarParms(Array1 <doublevar> & parms) {
   for(int i=0; i< nmax; i++) {
     alpha(i)=exp(parms(i));
   }
+  setupShells();
   //cout << "done" << endl;
 }
 
@@ -96,6 +116,8 @@ int Gaussian_function::showinfo(string & indent, ostream & os)
   os << indent << "Alpha ";
   for(int i=0; i< nmax; i++) os << alpha(i) << "  ";
   os << endl;
+  if(tolerance > 0)
+    os << indent << "Screened to " << tolerance << endl;
   return 1;
 }
 
@@ -105,6 +127,8 @@ int Gaussian_function::writeinput(string & indent, ostream & os)
   os << indent << "GAUSSIAN\n";
   os << indent << "CUTOFF " << rcut << endl;
   os << indent << "SMOOTHING " << cut_smooth << endl;
+  if(tolerance > 0)
+    os << indent << "TOLERANCE " << tolerance << endl;
   os << indent << "ALPHA  { ";
   for(int i=0; i< nmax; i++) {
     os << alpha(i) << "   ";
@@ -120,98 +144,79 @@ void Gaussian_function::calcVal(const Array1 <doublevar> & r,
                                 Array1 <doublevar> & symvals,
                                 const int startfill)
 {
-  //cout << "calcVal " << endl;
-  int index=startfill;
-
+  assert(symvals.GetDim(0) >= nmax+startfill);
+  doublevar * out=symvals.v+startfill;
   if(r(0) > rcut) {
-    for(int i=0; i< nmax; i++) {
-      symvals(index++) = 0;
-    }
+    for(int i=0; i< nmax; i++) out[i]=0;
+    return;
   }
-  else if(r(0) > rcut_start) {
+  shells.val(r(0), r(1), out);
+  if(r(0) > rcut_start) {
+    doublevar z=(r(0)-rcut_start)/cut_smooth; //cut_smooth=SMOOTHING rcut_start=CUTOFF-SMOOTHING
+    doublevar f=1-z*z*z*(6*z*z-15*z+10);
+    for(int i=0; i< nmax; i++) out[i]*=f;
+  }
+}
+
+//------------------------------------------------------------------------
+
+void Gaussian_function::lapOneCenter(const doublevar * r, doublevar * out,
+                                     int stride) {
+  if(r[0] > rcut) {
     for(int i=0; i< nmax; i++) {
-      doublevar norm=sqrt(alpha(i)/pi);
-      doublevar z=(r(0)-rcut_start)/cut_smooth; //cut_smooth=SMOOTHING rcut_start=CUTOFF-SMOOTHING
-      symvals(index++) = norm*exp(-alpha(i)*r(1))*(1-z*z*z*(6*z*z-15*z+10));
+      for(int d=0; d< 5; d++) out[i*stride+d]=0;
     }
+    return;
   }
-  else {
-    for(int i=0; i< nmax; i++)
-    {
-      doublevar norm=sqrt(alpha(i)/pi);
-      symvals(index++)=norm*exp(-alpha(i)*r(1));
-    }
+
+  if(r[0] <= rcut_start) {
+    shells.lap(r, out, stride);
+    return;
   }
-  //cout << "done" << endl;
 
+  //value, (1/r) d/dr, and Laplacian of each Gaussian
+  shells.radialLap(r[0], r[1], out, stride);
+
+  //find cutoff function
+  doublevar z=(r[0]-rcut_start)/cut_smooth;
+  doublevar f=(1-z*z*z*(6*z*z-15*z+10));
+  doublevar dfdr=z*z*30*(2*z-z*z-1)/(cut_smooth*r[0]);
+  doublevar d2fdr2=z*(180*z-120*z*z-60)/(cut_smooth*cut_smooth);
+  for(int i=0; i< nmax; i++) {
+    doublevar * row=out+i*stride;
+    doublevar exponent=row[0], dadr=row[1], d2adr2=row[2];
+    row[0]=f*exponent;
+    doublevar r_derivative=f*dadr+exponent*dfdr;
+    for(int j=1; j<4; j++) row[j]=r_derivative*r[j+1];
+    row[4]=f*d2adr2+2*dadr*dfdr*r[1]+exponent*d2fdr2+2*r_derivative;
+  }
 }
 
+//------------------------------------------------------------------------
+
 void Gaussian_function::calcLap(
   const Array1 <doublevar> & r,
   Array2 <doublevar> & symvals,
   const int startfill
 )
 {
-  //cout << "calcLap " << endl;
-  int index=startfill;
-  doublevar exponent, dadr, d2adr2;
-  if(r(0) > rcut) {
-    for(int i=0; i< nmax; i++) {
-      for(int d=0; d< 5; d++) {
-        symvals(index,d)=0;
-      }
-      index++;
-    }
-  }
-  else if(r(0) > rcut_start) {
-    doublevar f, dfdr, d2fdr2; //cutoff function
-    for(int i=0; i< nmax; i++) {
-      doublevar norm=sqrt(alpha(i)/pi);
-      exponent=exp(-alpha(i)*r(1));
-      dadr=-2*alpha(i)*exponent;
-      d2adr2=(4*alpha(i)*alpha(i)*r(1)-6*alpha(i))*exponent;
-
-      //find cutoff function
-      doublevar z=(r(0)-rcut_start)/cut_smooth;
-      f=(1-z*z*z*(6*z*z-15*z+10));
-      dfdr=z*z*30*(2*z-z*z-1)/(cut_smooth*r(0));
-      d2fdr2=z*(180*z-120*z*z-60)/(cut_smooth*cut_smooth);
-
-      symvals(index,0)=norm*f*exponent;
-      //doublevar dotproduct=0;
-      doublevar r_derivative=f*dadr+exponent*dfdr;
-      for(int j=1; j<4; j++) {
-        symvals(index,j)=norm*(r_derivative)*r(j+1);
-        //dotproduct+=dadr*dfdr*r(j+1)*r(j+1);
-      }
-      symvals(index,4)=norm*(f*d2adr2+2*dadr*dfdr*r(1)+exponent*d2fdr2+2*r_derivative);
-
-
-      index++;
-    }
-  }
-  else {
-    for(int i=0; i< nmax; i++)
-    {
-      doublevar norm=sqrt(alpha(i)/pi);
-      exponent=exp(-alpha(i)*r(1));
-      symvals(index,0)=norm*exponent;
-
-      dadr=-2*alpha(i)*exponent;
-
-      d2adr2=(4*alpha(i)*alpha(i)*r(1)-6*alpha(i))*exponent;
+  assert(symvals.GetDim(0) >= nmax+startfill);
+  assert(symvals.GetDim(1) >= 5);
+  lapOneCenter(r.v, symvals.v+startfill*symvals.step1, symvals.step1);
+}
 
+//------------------------------------------------------------------------
 
-      for(int j=1; j<4; j++)
-      {
-        symvals(index,j)=norm*dadr*r(j+1);
-      }
-      symvals(index,4)=norm*d2adr2;
-      index++;
-    }
+void Gaussian_function::calcLapCenters(const Array2 <doublevar> & r,
+                                       int ncenters,
+                                       Array2 <doublevar> & symvals) {
+  assert(r.GetDim(1) >= 5);
+  assert(symvals.GetDim(0) >= ncenters*nmax);
+  assert(symvals.GetDim(1) >= 5);
+  const int stride=symvals.step1;
+  for(int c=0; c< ncenters; c++) {
+    lapOneCenter(r.v+c*r.step1, symvals.v+c*nmax*stride, stride);
   }
-
-  //cout << "done" << endl;
 }
 
 //------------------------------------------------------------------------
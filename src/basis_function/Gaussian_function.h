@@ -22,9 +22,11 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define GAUSSIAN_FUNCTION_H_INCLUDED
 
 #include "Basis_function.h"
+#include "Gaussian_shells.h"
 
 /*!
-
+Normalized s Gaussians \f$ \sqrt{\alpha/\pi} e^{-\alpha r^2} \f$, one for
+each alpha, smoothly cut off at CUTOFF.
 */
 class Gaussian_function: public Basis_function
 {
@@ -53,10 +55,11 @@ public:
   {
     return centername;
   }
-  doublevar cutoff(int )
+  doublevar cutoff(int n)
   {
-    return rcut;
+    return min(rcut, shells.radius(n));
   }
+  int isRadial() { return 1; }
 
   int showinfo(string & indent, ostream & os);
   int writeinput(string &, ostream &);
@@ -73,6 +76,9 @@ public:
     const int startfill=0
   );
 
+  virtual void calcLapCenters(const Array2 <doublevar> & r, int ncenters,
+                              Array2 <doublevar> & symvals);
+
   virtual void getVarParms(Array1 <doublevar> & parms);
   virtual void setVarParms(Array1 <doublevar> & parms);
   virtual int nparms() {
@@ -80,11 +86,15 @@ public:
   }
 
 private:
+  void setupShells();
+  void lapOneCenter(const doublevar * r, doublevar * out, int stride);
 
   doublevar rcut;
   doublevar rcut_start; //Start of the cutoff function
   doublevar cut_smooth; //Smoothing for cutoff
   Array1 <doublevar> alpha;
+  doublevar tolerance; //!< screening tolerance for the shells
+  Gaussian_shells shells; //!< the normalized functions
   int nmax;
   string centername;
 };
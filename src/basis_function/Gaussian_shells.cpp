@@ -0,0 +1,319 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Gaussian_shells.h"
+#include <algorithm>
+
+void Gaussian_shells::clear(doublevar maxexp) {
+  in_alpha.clear();
+  in_coeff.clear();
+  in_rpow.clear();
+  nshell=0;
+  nprim=0;
+  maxexponent=maxexp;
+}
+
+//----------------------------------------------------------------------
+
+void Gaussian_shells::addShell(const vector <doublevar> & a,
+                               const vector <doublevar> & c,
+                               const vector <doublevar> & n) {
+  assert(a.size()==c.size() && a.size()==n.size());
+  in_alpha.push_back(a);
+  in_coeff.push_back(c);
+  in_rpow.push_back(n);
+  nshell++;
+  nprim+=a.size();
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  The largest of the value, the length of the gradient, and the
+  Laplacian that shell place i could have at r, taking every primitive
+  to add with the same sign.
+*/
+doublevar Gaussian_shells::bound(int i, doublevar r) {
+  doublevar r2=r*r;
+  doublevar v=0, g=0, l=0;
+  for(int p=shell_start(i); p< shell_start(i+1); p++) {
+    doublevar n=rpow(p), a=alpha(p);
+    doublevar e=fabs(coeff(p))*exp(-min(a*r2, maxexponent));
+    doublevar rn=pow(r, n);
+    v+=rn*e;
+    g+=rn*e*fabs(n-2*a*r2)/r;
+    l+=rn*e*(fabs(n*(n+1))+2*a*fabs(2*n+3)*r2+4*a*a*r2*r2)/r2;
+  }
+  return max(v, max(g, l));
+}
+
+//----------------------------------------------------------------------
+
+//! Orders shell places by decreasing radius
+struct Radius_order {
+  const vector <doublevar> * radius;
+  bool operator()(int a, int b) const {
+    if((*radius)[a]!=(*radius)[b]) return (*radius)[a] > (*radius)[b];
+    return a < b;
+  }
+};
+
+void Gaussian_shells::setup(doublevar tol) {
+  //First lay out the primitives in the order added to find the radii
+  shell_start.Resize(nshell+1);
+  alpha.Resize(nprim);
+  coeff.Resize(nprim);
+  rpow.Resize(nprim);
+  int p=0;
+  for(int s=0; s< nshell; s++) {
+    shell_start(s)=p;
+    for(unsigned int j=0; j< in_alpha[s].size(); j++) {
+      alpha(p)=in_alpha[s][j];
+      coeff(p)=in_coeff[s][j];
+      rpow(p)=in_rpow[s][j];
+      p++;
+    }
+  }
+  shell_start(nshell)=nprim;
+
+  vector <doublevar> radii(nshell, 1e99);
+  if(tol > 0) {
+    for(int s=0; s< nshell; s++) {
+      //start past the maxima of the primitives, then walk out
+      doublevar r=1e-3;
+      for(int q=shell_start(s); q< shell_start(s+1); q++)
+        r=max(r, sqrt((fabs(rpow(q))+4)/(2*alpha(q))));
+      int step=0;
+      while(bound(s, r) > tol && step < 1000) {
+        r*=1.02;
+        step++;
+      }
+      if(step < 1000) radii[s]=r;
+    }
+  }
+
+  vector <int> sorted(nshell);
+  for(int s=0; s< nshell; s++) sorted[s]=s;
+  Radius_order cmp;
+  cmp.radius=&radii;
+  sort(sorted.begin(), sorted.end(), cmp);
+
+  //Now lay them out by decreasing radius
+  place.Resize(nshell);
+  shell_index.Resize(nshell);
+  shell_radius.Resize(nshell);
+  grad_coeff.Resize(nprim);
+  lap_coeff2.Resize(nprim);
+  lap_coeff0.Resize(nprim);
+  ipow.Resize(nprim);
+  integer_powers=1;
+  no_powers=1;
+  powlo=0;
+  powhi=0;
+  p=0;
+  for(int i=0; i< nshell; i++) {
+    int s=sorted[i];
+    place(s)=i;
+    shell_index(i)=s;
+    shell_radius(i)=radii[s];
+    shell_start(i)=p;
+    for(unsigned int j=0; j< in_alpha[s].size(); j++) {
+      doublevar a=in_alpha[s][j], c=in_coeff[s][j], n=in_rpow[s][j];
+      alpha(p)=a;
+      coeff(p)=c;
+      rpow(p)=n;
+      grad_coeff(p)=-2*a*c;
+      lap_coeff2(p)=4*a*a*c;
+      lap_coeff0(p)=6*a*c;
+      if(n!=0) no_powers=0;
+      if(n!=floor(n) || fabs(n) > 64) integer_powers=0;
+      else {
+        powlo=min(powlo, int(n)-2);
+        powhi=max(powhi, int(n));
+      }
+      p++;
+    }
+  }
+  shell_start(nshell)=nprim;
+  if(integer_powers) {
+    for(int q=0; q< nprim; q++) ipow(q)=int(rpow(q))-powlo;
+  }
+
+  thread_exp.Resize(qmc_max_threads());
+  for(int t=0; t< thread_exp.GetDim(0); t++)
+    thread_exp(t).Resize(max(nprim+powhi-powlo+1, 1));
+}
+
+//----------------------------------------------------------------------
+
+inline int Gaussian_shells::activeShells(doublevar r) {
+  int n=nshell;
+  while(n > 0 && r > shell_radius(n-1)) n--;
+  return n;
+}
+
+/*!
+  The exponentials of the first np primitives into ex, and if needed
+  the table of powers of r, with pw[k]=r^(k+powlo).
+*/
+inline void Gaussian_shells::evalExp(doublevar r, doublevar r2, int np,
+                                     doublevar * ex, doublevar * & pw) {
+  const doublevar * a=alpha.v;
+  const doublevar maxexp=maxexponent;
+  for(int p=0; p< np; p++)
+    ex[p]=exp(-min(a[p]*r2, maxexp));
+
+  pw=ex+nprim;
+  if(no_powers || !integer_powers) return;
+  int zero=-powlo;
+  pw[zero]=1.0;
+  for(int k=zero+1; k<= powhi-powlo; k++) pw[k]=pw[k-1]*r;
+  doublevar inv=1.0/r;
+  for(int k=zero-1; k >= 0; k--) pw[k]=pw[k+1]*inv;
+}
+
+//----------------------------------------------------------------------
+
+void Gaussian_shells::val(doublevar r, doublevar r2, doublevar * f) {
+  int nactive=activeShells(r);
+  doublevar * ex=thread_exp(qmc_thread_num()).v;
+  doublevar * pw;
+  evalExp(r, r2, shell_start(nactive), ex, pw);
+
+  const doublevar * c=coeff.v;
+  for(int i=0; i< nactive; i++) {
+    int end=shell_start(i+1);
+    doublevar v=0;
+    if(no_powers) {
+      for(int p=shell_start(i); p< end; p++) v+=c[p]*ex[p];
+    }
+    else if(integer_powers) {
+      for(int p=shell_start(i); p< end; p++) v+=c[p]*pw[ipow(p)]*ex[p];
+    }
+    else {
+      for(int p=shell_start(i); p< end; p++) v+=c[p]*pow(r, rpow(p))*ex[p];
+    }
+    f[shell_index(i)]=v;
+  }
+  for(int i=nactive; i< nshell; i++) f[shell_index(i)]=0;
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  The radial value, (1/r) d/dr, and Laplacian of the shell at place i,
+  from the exponentials and powers of evalExp().
+*/
+inline void Gaussian_shells::shellLap(int i, doublevar r, doublevar r2,
+                                      const doublevar * ex,
+                                      const doublevar * pw,
+                                      doublevar & v, doublevar & g,
+                                      doublevar & l) {
+  v=g=l=0;
+  int end=shell_start(i+1);
+  if(no_powers) {
+    for(int p=shell_start(i); p< end; p++) {
+      v+=coeff(p)*ex[p];
+      g+=grad_coeff(p)*ex[p];
+      l+=(lap_coeff2(p)*r2-lap_coeff0(p))*ex[p];
+    }
+  }
+  else {
+    for(int p=shell_start(i); p< end; p++) {
+      doublevar n=rpow(p), a=alpha(p);
+      doublevar rn, rn2;
+      if(integer_powers) {
+        rn=pw[ipow(p)];
+        rn2=pw[ipow(p)-2];
+      }
+      else {
+        rn=pow(r, n);
+        rn2=rn/r2;
+      }
+      doublevar ce=coeff(p)*ex[p];
+      v+=ce*rn;
+      g+=ce*rn2*(n-2*a*r2);
+      l+=ce*rn2*(n*(n+1)-2*a*(2*n+3)*r2+4*a*a*r2*r2);
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Gaussian_shells::radialLap(doublevar r, doublevar r2, doublevar * f,
+                                int stride) {
+  int nactive=activeShells(r);
+  doublevar * ex=thread_exp(qmc_thread_num()).v;
+  doublevar * pw;
+  evalExp(r, r2, shell_start(nactive), ex, pw);
+
+  for(int i=0; i< nactive; i++) {
+    doublevar * row=f+shell_index(i)*stride;
+    shellLap(i, r, r2, ex, pw, row[0], row[1], row[2]);
+  }
+  for(int i=nactive; i< nshell; i++) {
+    doublevar * row=f+shell_index(i)*stride;
+    row[0]=row[1]=row[2]=0;
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Gaussian_shells::lap(const doublevar * r, doublevar * f, int stride) {
+  int nactive=activeShells(r[0]);
+  doublevar * ex=thread_exp(qmc_thread_num()).v;
+  doublevar * pw;
+  const doublevar r2=r[1], x=r[2], y=r[3], z=r[4];
+  evalExp(r[0], r2, shell_start(nactive), ex, pw);
+
+  if(no_powers && nprim==nshell) {
+    //one primitive per shell, as for uncontracted Gaussians
+    const doublevar * c=coeff.v, * gc=grad_coeff.v;
+    const doublevar * lc2=lap_coeff2.v, * lc0=lap_coeff0.v;
+    for(int i=0; i< nactive; i++) {
+      doublevar * row=f+shell_index(i)*stride;
+      doublevar e=ex[i];
+      doublevar g=gc[i]*e;
+      row[0]=c[i]*e;
+      row[1]=g*x;
+      row[2]=g*y;
+      row[3]=g*z;
+      row[4]=(lc2[i]*r2-lc0[i])*e;
+    }
+  }
+  else {
+    for(int i=0; i< nactive; i++) {
+      doublevar * row=f+shell_index(i)*stride;
+      doublevar v, g, l;
+      shellLap(i, r[0], r2, ex, pw, v, g, l);
+      row[0]=v;
+      row[1]=g*x;
+      row[2]=g*y;
+      row[3]=g*z;
+      row[4]=l;
+    }
+  }
+  for(int i=nactive; i< nshell; i++) {
+    doublevar * row=f+shell_index(i)*stride;
+    for(int d=0; d< 5; d++) row[d]=0;
+  }
+}
+
+//----------------------------------------------------------------------
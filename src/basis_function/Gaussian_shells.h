@@ -0,0 +1,116 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef GAUSSIAN_SHELLS_H_INCLUDED
+#define GAUSSIAN_SHELLS_H_INCLUDED
+
+#include "Qmc_std.h"
+
+/*!
+\brief
+The radial parts of a set of contracted Gaussian shells,
+\f$ f_s(r)=\sum_p c_p r^{n_p} e^{-\alpha_p r^2} \f$, for the Gaussian
+basis functions.
+
+The shells are kept in order of decreasing screening radius, so the
+shells in range of a point and their primitives are a prefix of the
+arrays, and the exponentials of all of them are one loop with no
+branches.  Integer powers of r come from a table built by
+multiplication instead of pow().
+*/
+class Gaussian_shells {
+public:
+  Gaussian_shells() { nshell=0; nprim=0; integer_powers=1; no_powers=1;
+    maxexponent=1e99; }
+
+  /*!
+    Start a new set.  Exponents are clamped at maxexp, so that
+    \f$ e^{-\alpha r^2} \ge e^{-maxexp} \f$.
+   */
+  void clear(doublevar maxexp=1e99);
+
+  //! Append a shell with the given primitives
+  void addShell(const vector <doublevar> & alpha,
+                const vector <doublevar> & coeff,
+                const vector <doublevar> & rpow);
+
+  /*!
+    Finish the set after the shells are added.  A shell is zero beyond
+    the radius where its value, gradient, and Laplacian are all below
+    tol; tol=0 never screens.
+   */
+  void setup(doublevar tol);
+
+  int nShells() { return nshell; }
+
+  //! The screening radius of shell s, in the order it was added
+  doublevar radius(int s) { return shell_radius(place(s)); }
+
+  /*!
+    f[s] for each shell, at r and r2=r*r.  f must have nShells() places.
+   */
+  void val(doublevar r, doublevar r2, doublevar * f);
+
+  /*!
+    The value, gradient, and Laplacian of each shell as
+    f[s*stride+[0 1 2 3 4]], at r in the form r, r^2, x, y, z.
+   */
+  void lap(const doublevar * r, doublevar * f, int stride);
+
+  /*!
+    f, \f$ \frac{1}{r}\frac{df}{dr} \f$, and \f$ \nabla^2 f \f$ for each
+    shell, as f[s*stride+[0 1 2]].
+   */
+  void radialLap(doublevar r, doublevar r2, doublevar * f, int stride);
+
+private:
+  int activeShells(doublevar r);
+  void evalExp(doublevar r, doublevar r2, int np, doublevar * ex,
+               doublevar * & pw);
+  void shellLap(int i, doublevar r, doublevar r2, const doublevar * ex,
+                const doublevar * pw, doublevar & v, doublevar & g,
+                doublevar & l);
+  doublevar bound(int s, doublevar r);
+
+  int nshell, nprim;
+  int integer_powers; //!< all n_p are integers, from the table
+  int no_powers;      //!< all n_p are zero
+  int powlo, powhi;   //!< range of the table, from lowest n_p-2
+  doublevar maxexponent;
+
+  //shells and primitives in the order they were added, before setup
+  vector < vector <doublevar> > in_alpha, in_coeff, in_rpow;
+
+  //After setup, in order of decreasing radius
+  Array1 <int> place;        //!< place of the shell added s-th
+  Array1 <int> shell_index;  //!< the shell at place i
+  Array1 <int> shell_start;  //!< primitives of place i are shell_start(i) to shell_start(i+1)-1
+  Array1 <doublevar> shell_radius;
+  Array1 <doublevar> alpha, coeff, rpow;
+  Array1 <int> ipow;         //!< n_p-powlo, for the table
+  //!per primitive: -2 alpha c, 4 alpha^2 c, and 6 alpha c
+  Array1 <doublevar> grad_coeff, lap_coeff2, lap_coeff0;
+
+  //!Scratch for each thread: the exponentials and table of powers
+  Array1 < Array1 <doublevar> > thread_exp;
+};
+
+#endif //GAUSSIAN_SHELLS_H_INCLUDED
+//--------------------------------------------------------------------------
@@ -78,6 +78,11 @@ public:
   {
     return 1e99;
   }
+  int isRadial() {
+    for(int i=0; i< nmax; i++)
+      if(symmetry(i)!=0) return 0;
+    return 1;
+  }
 
   int showinfo(string & indent, ostream & os);
   int writeinput(string &, ostream &);
@@ -0,0 +1,245 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Lattice_phases.h"
+#include <algorithm>
+
+//! Orders the g's by their integer coordinates
+struct Lattice_order {
+  const Array2 <int> * n;
+  bool operator()(int a, int b) const {
+    for(int d=0; d< 3; d++) {
+      if((*n)(a,d)!=(*n)(b,d)) return (*n)(a,d) < (*n)(b,d);
+    }
+    return a < b;
+  }
+};
+
+static doublevar length3(const doublevar * a) {
+  return sqrt(a[0]*a[0]+a[1]*a[1]+a[2]*a[2]);
+}
+
+static void cross3(const doublevar * a, const doublevar * b, doublevar * c) {
+  c[0]=a[1]*b[2]-a[2]*b[1];
+  c[1]=a[2]*b[0]-a[0]*b[2];
+  c[2]=a[0]*b[1]-a[1]*b[0];
+}
+
+//----------------------------------------------------------------------
+
+int Lattice_phases::init(const Array2 <doublevar> & g) {
+  nmax=g.GetDim(0);
+  assert(g.GetDim(1)==3);
+  use_lattice=0;
+  order.Resize(nmax);
+  for(int i=0; i< nmax; i++) order(i)=i;
+  gvec=g;
+  thread_vals.Resize(qmc_max_threads());
+  for(int t=0; t< thread_vals.GetDim(0); t++)
+    thread_vals(t).Resize(max(2*nmax,1));
+
+  //with only a few g's, the recursion doesn't pay
+  if(nmax < 4) return 0;
+
+  doublevar gmax=0;
+  for(int i=0; i< nmax; i++) gmax=max(gmax, length3(&g(i,0)));
+  if(gmax==0) return 0;
+
+  //Take the shortest three independent g's as the lattice vectors
+  const doublevar eps=1e-6;
+  vector < pair <doublevar, int> > bylength;
+  for(int i=0; i< nmax; i++) {
+    doublevar len=length3(&g(i,0));
+    if(len > eps*gmax) bylength.push_back(pair<doublevar,int>(len,i));
+  }
+  sort(bylength.begin(), bylength.end());
+  b.Resize(3,3);
+  int nb=0;
+  for(unsigned int k=0; k< bylength.size() && nb < 3; k++) {
+    const doublevar * v=&g(bylength[k].second,0);
+    doublevar len=bylength[k].first;
+    int independent=0;
+    if(nb==0) independent=1;
+    else if(nb==1) {
+      doublevar c[3];
+      cross3(&b(0,0), v, c);
+      independent=length3(c) > eps*length3(&b(0,0))*len;
+    }
+    else {
+      doublevar c[3];
+      cross3(&b(0,0), &b(1,0), c);
+      doublevar det=c[0]*v[0]+c[1]*v[1]+c[2]*v[2];
+      independent=fabs(det) > eps*length3(c)*len;
+    }
+    if(independent) {
+      for(int d=0; d< 3; d++) b(nb,d)=v[d];
+      nb++;
+    }
+  }
+  //If the g's are in a plane or on a line, fill in directions that
+  //they all have zero coordinates along
+  if(nb==1) {
+    doublevar axis[3]={0,0,0};
+    int small=0;
+    for(int d=1; d< 3; d++) if(fabs(b(0,d)) < fabs(b(0,small))) small=d;
+    axis[small]=1.0;
+    cross3(&b(0,0), axis, &b(1,0));
+    nb++;
+  }
+  if(nb==2) {
+    cross3(&b(0,0), &b(1,0), &b(2,0));
+    nb++;
+  }
+
+  //The coordinates: g=sum_i n_i b_i, so n=(B^T)^-1 g with B(i,d)=b(i,d)
+  doublevar c0[3], c1[3], c2[3];
+  cross3(&b(1,0), &b(2,0), c0);
+  cross3(&b(2,0), &b(0,0), c1);
+  cross3(&b(0,0), &b(1,0), c2);
+  doublevar vol=b(0,0)*c0[0]+b(0,1)*c0[1]+b(0,2)*c0[2];
+  Array2 <int> n(nmax,3);
+  lo.Resize(3);
+  width.Resize(3);
+  Array1 <int> hi(3);
+  lo=0;
+  hi=0;
+  for(int i=0; i< nmax; i++) {
+    const doublevar * v=&g(i,0);
+    doublevar x[3];
+    x[0]=(c0[0]*v[0]+c0[1]*v[1]+c0[2]*v[2])/vol;
+    x[1]=(c1[0]*v[0]+c1[1]*v[1]+c1[2]*v[2])/vol;
+    x[2]=(c2[0]*v[0]+c2[1]*v[1]+c2[2]*v[2])/vol;
+    doublevar res[3]={v[0], v[1], v[2]};
+    for(int a=0; a< 3; a++) {
+      n(i,a)=int(floor(x[a]+0.5));
+      for(int d=0; d< 3; d++) res[d]-=n(i,a)*b(a,d);
+      lo(a)=min(lo(a), n(i,a));
+      hi(a)=max(hi(a), n(i,a));
+    }
+    if(length3(res) > 1e-10*gmax) return 0;
+  }
+  for(int a=0; a< 3; a++) {
+    width(a)=hi(a)-lo(a)+1;
+    if(width(a) > 4096) return 0;
+  }
+
+  //Sort the g's into rows of the same n0 and n1
+  vector <int> places(nmax);
+  for(int i=0; i< nmax; i++) places[i]=i;
+  Lattice_order cmp;
+  cmp.n=&n;
+  sort(places.begin(), places.end(), cmp);
+
+  vector <int> starts;
+  n2.Resize(nmax);
+  for(int j=0; j< nmax; j++) {
+    int i=places[j];
+    order(j)=i;
+    for(int d=0; d< 3; d++) gvec(j,d)=g(i,d);
+    n2(j)=n(i,2)-lo(2);
+    if(j==0 || n(i,0)!=n(places[j-1],0) || n(i,1)!=n(places[j-1],1))
+      starts.push_back(j);
+  }
+  int nrows=starts.size();
+  row_start.Resize(nrows+1);
+  row_n.Resize(nrows,2);
+  for(int r=0; r< nrows; r++) {
+    row_start(r)=starts[r];
+    row_n(r,0)=n(places[starts[r]],0)-lo(0);
+    row_n(r,1)=n(places[starts[r]],1)-lo(1);
+  }
+  row_start(nrows)=nmax;
+
+  thread_pow.Resize(qmc_max_threads());
+  for(int t=0; t< thread_pow.GetDim(0); t++)
+    thread_pow(t).Resize(2*(width(0)+width(1)+width(2)));
+  use_lattice=1;
+  return 1;
+}
+
+//----------------------------------------------------------------------
+
+void Lattice_phases::eval(const doublevar * r, const doublevar * & c,
+                          const doublevar * & s) {
+  int t=qmc_thread_num();
+  doublevar * cv=thread_vals(t).v;
+  doublevar * sv=cv+nmax;
+  c=cv;
+  s=sv;
+  doublevar t_cos, t_sin;
+  if(!use_lattice) {
+    for(int j=0; j< nmax; j++) {
+      doublevar gdotr=gvec(j,0)*r[0]+gvec(j,1)*r[1]+gvec(j,2)*r[2];
+#ifdef __USE_GNU
+      sincos(gdotr, &t_sin, &t_cos);
+#else
+      t_cos=cos(gdotr);
+      t_sin=sin(gdotr);
+#endif
+      cv[j]=t_cos;
+      sv[j]=t_sin;
+    }
+    return;
+  }
+
+  //(cos, sin) of n b.r for each axis, at 2*(n-lo)
+  doublevar * axis[3];
+  doublevar * p=thread_pow(t).v;
+  for(int d=0; d< 3; d++) {
+    axis[d]=p;
+    p+=2*width(d);
+    doublevar bdotr=b(d,0)*r[0]+b(d,1)*r[1]+b(d,2)*r[2];
+#ifdef __USE_GNU
+    sincos(bdotr, &t_sin, &t_cos);
+#else
+    t_cos=cos(bdotr);
+    t_sin=sin(bdotr);
+#endif
+    doublevar * a=axis[d];
+    int zero=-lo(d);
+    a[2*zero]=1.0;
+    a[2*zero+1]=0.0;
+    for(int k=zero+1; k< width(d); k++) {
+      a[2*k]=a[2*k-2]*t_cos-a[2*k-1]*t_sin;
+      a[2*k+1]=a[2*k-2]*t_sin+a[2*k-1]*t_cos;
+    }
+    for(int k=zero-1; k >= 0; k--) {
+      a[2*k]=a[2*k+2]*t_cos+a[2*k+3]*t_sin;
+      a[2*k+1]=a[2*k+3]*t_cos-a[2*k+2]*t_sin;
+    }
+  }
+
+  const doublevar * a2=axis[2];
+  int nrows=row_start.GetDim(0)-1;
+  for(int row=0; row< nrows; row++) {
+    const doublevar * a0=axis[0]+2*row_n(row,0);
+    const doublevar * a1=axis[1]+2*row_n(row,1);
+    doublevar fr=a0[0]*a1[0]-a0[1]*a1[1];
+    doublevar fi=a0[0]*a1[1]+a0[1]*a1[0];
+    int end=row_start(row+1);
+    for(int j=row_start(row); j< end; j++) {
+      const doublevar * z=a2+2*n2(j);
+      cv[j]=fr*z[0]-fi*z[1];
+      sv[j]=fr*z[1]+fi*z[0];
+    }
+  }
+}
+
+//----------------------------------------------------------------------
@@ -0,0 +1,76 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef LATTICE_PHASES_H_INCLUDED
+#define LATTICE_PHASES_H_INCLUDED
+
+#include "Qmc_std.h"
+
+/*!
+\brief
+cos(g.r) and sin(g.r) for a set of g vectors, for the plane-wave
+basis functions.
+
+If every g is an integer combination \f$ g=\sum_i n_i b_i \f$ of three
+vectors, as for the reciprocal lattice vectors in a HEG or crystal
+calculation, then \f$ e^{ig.r}=\prod_i (e^{ib_i.r})^{n_i} \f$.  The powers
+along each axis are built by recursion from one sincos each, and the g's
+are ordered by \f$(n_0,n_1,n_2)\f$, so that each row with the same
+\f$(n_0,n_1)\f$ is a contiguous run of complex multiplications.
+Otherwise every g gets its own sincos.
+*/
+class Lattice_phases {
+public:
+  Lattice_phases() { nmax=0; use_lattice=0; }
+
+  /*!
+    Set up for the g vectors g(i,[x y z]).  Returns 1 if they are on a
+    lattice, so that the recursion is used.
+   */
+  int init(const Array2 <doublevar> & g);
+
+  int onLattice() { return use_lattice; }
+
+  /*!
+    Evaluate at r (x,y,z).  The results are c[j]=cos(g.r) and
+    s[j]=sin(g.r) for g number order(j); they stay valid until the
+    next call on the same thread.
+   */
+  void eval(const doublevar * r, const doublevar * & c, const doublevar * & s);
+
+  Array1 <int> order; //!< the g number at each place
+
+private:
+  int nmax;
+  int use_lattice;
+  Array2 <doublevar> gvec; //!< (place, [x y z]), in the order of order
+  Array2 <doublevar> b;    //!< (axis, [x y z]): the lattice vectors
+  Array1 <int> lo, width;  //!< range of the integer coordinate on each axis
+  Array1 <int> row_start;  //!< places row_start(r) to row_start(r+1)-1 share n0 and n1
+  Array2 <int> row_n;      //!< (row, 2): n0-lo(0) and n1-lo(1) of each row
+  Array1 <int> n2;         //!< n2-lo(2) of each place
+
+  //!Scratch for each thread: the powers along each axis and the results
+  Array1 < Array1 <doublevar> > thread_pow;
+  Array1 < Array1 <doublevar> > thread_vals;
+};
+
+#endif //LATTICE_PHASES_H_INCLUDED
+//--------------------------------------------------------------------------
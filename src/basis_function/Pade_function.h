@@ -57,6 +57,7 @@ public:
   {
     return 1e99;
   }
+  int isRadial() { return 1; }
 
   int showinfo(string & indent, ostream & os);
   int writeinput(string &, ostream &);
@@ -53,6 +53,7 @@ int Planewave_function::read(
       counter++;
     }
   }
+  phases.init(g_vector);
   //cout << "done " << endl;
   return 0;
 }
@@ -103,18 +104,12 @@ void Planewave_function::calcVal(const Array1 <doublevar> & r,
   //cout << "calcVal " << endl;
   assert(r.GetDim(0) >= 5);
   assert(symvals.GetDim(0) >= nmax*2+startfill);
-  int index=startfill;
-  doublevar gdotr, t_cos, t_sin;
-  for(int i=0; i< nmax; i++) {
-    gdotr=g_vector(i,0)*r(2)+g_vector(i,1)*r(3)+g_vector(i,2)*r(4);
-#ifdef __USE_GNU
-    sincos(gdotr, &t_sin, &t_cos);
-#else
-    t_cos=cos(gdotr);
-    t_sin=sin(gdotr);
-#endif
-    symvals(index++)=t_cos;
-    symvals(index++)=t_sin;
+  const doublevar * t_cos, * t_sin;
+  phases.eval(r.v+2, t_cos, t_sin);
+  for(int j=0; j< nmax; j++) {
+    int index=startfill+2*phases.order(j);
+    symvals(index)=t_cos[j];
+    symvals(index+1)=t_sin[j];
   }
   //cout << "done" << endl;
 }
@@ -130,22 +125,20 @@ void Planewave_function::calcLap(
   assert(symvals.GetDim(0) >= nmax*2+startfill);
   assert(symvals.GetDim(1) >= 5);
 
-  int index=startfill;
-  doublevar gdotr, t_cos, t_sin;
+  const doublevar * cosgr, * singr;
+  phases.eval(r.v+2, cosgr, singr);
+  doublevar t_cos, t_sin;
   doublevar gsquared;
-  for(int fn=0; fn< nmax; fn++) {
-    gdotr=g_vector(fn,0)*r(2)+g_vector(fn,1)*r(3)+g_vector(fn,2)*r(4);
+  for(int j=0; j< nmax; j++) {
+    int fn=phases.order(j);
+    int index=startfill+2*fn;
+    t_cos=cosgr[j];
+    t_sin=singr[j];
 
     //Should probably store this one..
     gsquared=g_vector(fn,0)*g_vector(fn,0)
              +g_vector(fn,1)*g_vector(fn,1)
              +g_vector(fn,2)*g_vector(fn,2);
-#ifdef __USE_GNU
-    sincos(gdotr, &t_sin, &t_cos);
-#else
-    t_cos=cos(gdotr);
-    t_sin=sin(gdotr);
-#endif
     //cos function
     symvals(index, 0)=t_cos;
     for(int i=1; i< 4; i++) {
@@ -178,22 +171,19 @@ void Planewave_function::calcHessian(
   assert(symvals.GetDim(0) >= nmax*2+startfill);
   assert(symvals.GetDim(1) >= 10);
 
-  int index=startfill;
-  doublevar gdotr, t_cos, t_sin;
+  const doublevar * cosgr, * singr;
+  phases.eval(r.v+2, cosgr, singr);
+  doublevar t_cos, t_sin;
   doublevar gx, gy, gz;
   //  doublevar gsquared;
-  for(int fn=0; fn< nmax; fn++) {
+  for(int j=0; j< nmax; j++) {
+    int fn=phases.order(j);
+    int index=startfill+2*fn;
     gx=g_vector(fn, 0);
     gy=g_vector(fn, 1);
     gz=g_vector(fn, 2);
-    gdotr=gx*r(2)+gy*r(3)+gz*r(4);
-
-#ifdef __USE_GNU
-    sincos(gdotr, &t_sin, &t_cos);
-#else
-    t_cos=cos(gdotr);
-    t_sin=sin(gdotr);
-#endif
+    t_cos=cosgr[j];
+    t_sin=singr[j];
     
     //cos function
     symvals(index, 0)=t_cos;
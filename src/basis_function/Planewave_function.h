@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define PLANEWAVE_FUNCTION_H_INCLUDED
 
 #include "Basis_function.h"
+#include "Lattice_phases.h"
 
 /*!
 
@@ -91,6 +92,7 @@ public:
 private:
 
   Array2 <doublevar> g_vector;
+  Lattice_phases phases; //!< cos(g.r) and sin(g.r)
   int nmax;
   string centername;
 };
@@ -237,3 +237,46 @@ void Poly_pade_function::calcLap(
 }
 
 //------------------------------------------------------------------------
+
+void Poly_pade_function::calcRadialVal(int n, const doublevar * r,
+                                       doublevar * f) {
+  for(int i=0; i< nmax; i++) {
+    doublevar b=beta(i);
+    doublevar * val=f+i*n;
+    for(int k=0; k< n; k++) {
+      doublevar inside= r[k] < rcut ? 1.0 : 0.0;
+      doublevar zz=min(r[k], rcut)/rcut;
+      doublevar zz2=zz*zz;
+      doublevar zpp=zz2*(6.-8.*zz+3.*zz2);
+      val[k]=inside*((1-zpp)*(1./(1+b*zpp)));
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+
+void Poly_pade_function::calcRadialLap(int n, const doublevar * r,
+                                       doublevar * f) {
+  for(int i=0; i< nmax; i++) {
+    doublevar b=beta(i);
+    doublevar * val=f+3*i*n, * grad=val+n, * lap=val+2*n;
+    for(int k=0; k< n; k++) {
+      doublevar inside= r[k] < rcut ? 1.0 : 0.0;
+      doublevar zz=min(r[k], rcut)/rcut;
+      doublevar zz2=zz*zz;
+      doublevar zpp=zz2*(6.-8.*zz+3.*zz2);
+      doublevar zppd=12.*zz*(1.-2.*zz+zz2);
+      doublevar zppdd2=6.-24.*zz+18*zz2;
+      doublevar zpade=1./(1+b*zpp);
+      doublevar zpade2=zpade*zpade;
+      doublevar crsd=-zppd*zpade2*(b+1)/(r[k]*rcut);
+      doublevar crsdd2=-zpade2*(zppdd2-b*zppd*zppd*zpade)
+                       *(b+1)/(rcut*rcut);
+      val[k]=inside*((1-zpp)*zpade);
+      grad[k]=inside*crsd;
+      lap[k]=inside*(2*(crsdd2+crsd));
+    }
+  }
+}
+
+//------------------------------------------------------------------------
@@ -53,6 +53,9 @@ public:
   {
     return rcut;
   }
+  int isRadial() { return 1; }
+  void calcRadialVal(int n, const doublevar * r, doublevar * f);
+  void calcRadialLap(int n, const doublevar * r, doublevar * f);
 
   int showinfo(string & indent, ostream & os);
   int writeinput(string &, ostream &);
@@ -80,6 +80,10 @@ int Rgaussian_function::read(
     error("Try OLDQMC in RGAUSSIAN.");
   }
 
+  if(!readvalue(words, pos=startpos, tolerance, "TOLERANCE")) {
+    tolerance=0;
+  }
+
   gaussexp.Resize(maxL,  maxExpansion);
   gausscoeff.Resize(maxL, maxExpansion);
   radiusexp.Resize(maxL, maxExpansion);
@@ -103,9 +107,24 @@ int Rgaussian_function::read(
       radiusexp(l, e) = radtemp[l][e];
     }
   }
+  setupShells();
   return 1;
 }
 
+void Rgaussian_function::setupShells() {
+  shells.clear(60.0);
+  for(int l=0; l< nmax; l++) {
+    vector <doublevar> a, c, n;
+    for(int e=0; e< numExpansion(l); e++) {
+      a.push_back(gaussexp(l,e));
+      c.push_back(gausscoeff(l,e));
+      n.push_back(radiusexp(l,e));
+    }
+    shells.addShell(a, c, n);
+  }
+  shells.setup(tolerance);
+}
+
 void Rgaussian_function::getVarParms(Array1 <doublevar> & parms) {
   //cout << "getVarParms " << endl;
   parms.Resize(nparms());
@@ -129,6 +148,7 @@ void Rgaussian_function::setVarParms(Array1 <doublevar> & parms) {
       //gausscoeff(l,e)=parms(count++);
     }
   }
+  setupShells();
 }
 
 int Rgaussian_function::nfunc()
@@ -150,6 +170,8 @@ int Rgaussian_function::showinfo(string & indent, ostream & os)
          << setw(10) << gaussexp(i,j) << endl;
     }
   }
+  if(tolerance > 0)
+    os << indent << "Screened to " << tolerance << endl;
   return 1;
 }
 
@@ -171,6 +193,8 @@ int Rgaussian_function::writeinput(string & indent, ostream & os)
     }
   }
   os << indent << "}\n";
+  if(tolerance > 0)
+    os << indent << "TOLERANCE " << tolerance << endl;
   return 1;
 }
 
@@ -181,68 +205,36 @@ void Rgaussian_function::calcVal(const Array1 <doublevar> & r,
                                  Array1 <doublevar> & symvals,
                                  const int startfill)
 {
-  //cout << "Rgaussian::calcVal " << endl;
   assert(symvals.GetDim(0) >= nmax+startfill);
   assert(r.GetDim(0) >= 5);
-  doublevar exponent;
-  //cout << "v_l for l=" << l << "   atom=" << at << endl;
-  int index=startfill;
-
-  for(int i=0; i< nmax; i++) {
-    doublevar v_l=0;
-    for(int j=0; j< numExpansion(i); j++) {
-      exponent=gaussexp(i, j)*r(1);
-      exponent=min(exponent,(doublevar) 60.0);
-      v_l+= gausscoeff(i, j)
-            *pow(r(0), radiusexp(i, j) )
-            *exp(-exponent);
-    }
-    symvals(index++) = v_l;
-  }
+  shells.val(r(0), r(1), symvals.v+startfill);
 }
 
+//------------------------------------------------------------------------
+
 void Rgaussian_function::calcLap(
   const Array1 <doublevar> & r,
   Array2 <doublevar> & symvals,
   const int startfill){
 
   assert(symvals.GetDim(0) >= nmax+startfill);
+  assert(symvals.GetDim(1) >= 5);
   assert(r.GetDim(0) >= 5);
-  doublevar exponent;
-  //cout << "v_l for l=" << l << "   atom=" << at << endl;
-  int index=startfill;
-
-  for(int i=0; i< nmax; i++) {
-    doublevar v_l=0, dv_l=0, d2v_l=0;
+  shells.lap(r.v, symvals.v+startfill*symvals.step1, symvals.step1);
+}
 
-    for(int j=0; j< numExpansion(i); j++) {
-      exponent=gaussexp(i, j)*r(1);
-      exponent=min(exponent,(doublevar) 60.0);
-      exponent=exp(-exponent);
-      doublevar n=radiusexp(i,j);
-      v_l+= gausscoeff(i, j)
-            *pow(r(0),n )
-            *exponent;
-      dv_l+=gausscoeff(i,j)*exponent*pow(r(0), n-1)*( n
-                                                      -2*r(1)*gaussexp(i,j));
-
-      //note that the laplacian is untested..
-      d2v_l+=gausscoeff(i,j)*pow(r(0), n-2)*( n*(n-1)-2*gaussexp(i,j)*n*r(1)
-                                              -2*(n+1)*gaussexp(i,j)*r(1)
-                                              +4*gaussexp(i,j)*gaussexp(i,j)
-                                              *r(1)*r(1))*exponent;
+//------------------------------------------------------------------------
 
-    }
-    dv_l/=r(0);
-
-    symvals(index,0) = v_l;
-    symvals(index,1) = dv_l*r(2);
-    symvals(index,2) = dv_l*r(3);
-    symvals(index,3) = dv_l*r(4);
-    symvals(index,4) = d2v_l+2*dv_l;
-    index++;
+void Rgaussian_function::calcLapCenters(const Array2 <doublevar> & r,
+                                        int ncenters,
+                                        Array2 <doublevar> & symvals) {
+  assert(r.GetDim(1) >= 5);
+  assert(symvals.GetDim(0) >= ncenters*nmax);
+  assert(symvals.GetDim(1) >= 5);
+  const int stride=symvals.step1;
+  for(int c=0; c< ncenters; c++) {
+    shells.lap(r.v+c*r.step1, symvals.v+c*nmax*stride, stride);
   }
-  
 }
 
 //------------------------------------------------------------------------
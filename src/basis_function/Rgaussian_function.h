@@ -22,10 +22,11 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define RGAUSSIAN_FUNCTION_H_INCLUDED
 
 #include "Basis_function.h"
+#include "Gaussian_shells.h"
 
 /*!
- 
-
+Contractions \f$ \sum_j c_j r^{n_j} e^{-\alpha_j r^2} \f$, one for each
+expansion in the OLDQMC section.
 */
 class Rgaussian_function: public Basis_function
 {
@@ -54,10 +55,11 @@ public:
   {
     return centername;
   }
-  doublevar cutoff(int )
+  doublevar cutoff(int n)
   {
-    return rcut;
+    return min(rcut, shells.radius(n));
   }
+  int isRadial() { return 1; }
 
   int showinfo(string & indent, ostream & os);
   int writeinput(string &, ostream &);
@@ -74,6 +76,9 @@ public:
     const int startfill=0
   );
 
+  virtual void calcLapCenters(const Array2 <doublevar> & r, int ncenters,
+                              Array2 <doublevar> & symvals);
+
   virtual void getVarParms(Array1 <doublevar> & parms);
   virtual void setVarParms(Array1 <doublevar> & parms);
   virtual int nparms() {
@@ -86,12 +91,15 @@ public:
   }
 
 private:
+  void setupShells();
 
   doublevar rcut;
   Array2 <doublevar> gaussexp;
   Array2 <doublevar> gausscoeff;
   Array2 <doublevar> radiusexp;
   Array1 <int> numExpansion;
+  doublevar tolerance; //!< screening tolerance for the shells
+  Gaussian_shells shells; //!< one shell for each expansion
   int nmax;
   string centername;
 };
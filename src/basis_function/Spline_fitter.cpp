@@ -51,15 +51,14 @@ invspacing=1.0/spacing;
 
 //ignore the first 'word' and spline to a file in form x y x y, etc
 //assumes that the x's are evenly spaced and in order.
-int Spline_fitter::readspline(vector <string> & words, bool enforce_cusp, doublevar cusp) {
+int Spline_fitter::readspline(vector <string> & words, bool enforce_cusp, doublevar cusp,
+                              doublevar cut, doublevar maxthresh, Shared_tables & shared) {
 
   int n=(words.size()-1)/2;
   if(n < 4) {
     error("Not enough points to fit a spline.");
   }
 
-  coeff.Resize( n, 4);
-
   //cout << "fitting spline " << s << endl;
   Array1 <doublevar> x(n), y(n);
   //cout << "number of points I expect: " << 2*n+1 << " number found " <<words.size()
@@ -103,8 +102,17 @@ int Spline_fitter::readspline(vector <string> & words, bool enforce_cusp, double
   }
   //if(lndr< -9) yp1=-10.0*(y(0))/1.0;
   //else yp1=-10.0*(y(0))/2.0;
+
+  //the same as fitting and then calling enforceCutoff(), which refits
+  //the values on the evenly spaced grid
+  if(cut > 0) { 
+    for(int i=0; i< n; i++) x(i)=i*spacing;
+    smoothCutoff(x,y,cut);
+    yp1=(y(1)-y(0))/spacing;
+    ypn=(y(n-1) - y(n-2) ) /spacing;
+  }
   
-  splinefit(x, y, yp1, ypn);
+  splinefit(x, y, yp1, ypn, maxthresh, shared);
 
   return 1;
 }
@@ -128,6 +136,17 @@ void Spline_fitter::enforceCutoff(doublevar cut) {
     x(i)=i*spacing;
     y(i)=coeff(i,0);
   }
+  smoothCutoff(x,y,cut);
+  doublevar yp1=(y(1)-y(0))/spacing;
+  doublevar ypn=(y(n-1) - y(n-2) ) /spacing;
+  splinefit(x,y,yp1, ypn);
+}
+
+//----------------------------------------------------------------------
+
+void Spline_fitter::smoothCutoff(Array1 <doublevar> & x, Array1 <doublevar> & y,
+                                 doublevar cut) { 
+  int n=x.GetDim(0);
   const double smooth=1.2;
   const double cutmax=cut-1e-6;
   const double cutmin=cutmax-smooth;
@@ -142,9 +161,6 @@ void Spline_fitter::enforceCutoff(doublevar cut) {
       }
     }
   }
-  doublevar yp1=(y(1)-y(0))/spacing;
-  doublevar ypn=(y(n-1) - y(n-2) ) /spacing;
-  splinefit(x,y,yp1, ypn);
 }
 
 //----------------------------------------------------------------------
@@ -187,6 +203,15 @@ void Spline_fitter::pad(doublevar thresh) {
   if(threshold >= thresh) return;
   int n=coeff.GetDim(0);
   int nnew=int((thresh-threshold)*invspacing)+1;
+  if(!coeff.b) { 
+    //a shared table, which the writer already padded with zeros
+    if((n+nnew)*4 > coeff.mSize) 
+      error("Spline_fitter::pad: no room to pad the shared table to ", thresh);
+    coeff.dim[0]=n+nnew;
+    coeff.size=(n+nnew)*4;
+    threshold=thresh;
+    return;
+  }
   //cout << "resizing from "<< n << " to " <<  n+nnew << endl;
   Array2 <doublevar> c(n+nnew,4);
   for(int i=0; i< n; i++) { 
@@ -205,6 +230,22 @@ void Spline_fitter::pad(doublevar thresh) {
 
 //----------------------------------------------------------------------
 
+void Spline_fitter::boundTable(int L, Array1 <doublevar> & b) { 
+  int n=coeff.GetDim(0);
+  const doublevar h=spacing;
+  b.Resize(n+1);
+  b(n)=0.0;
+  for(int i=n-1; i >= 0; i--) { 
+    doublevar m=fabs(coeff(i,0))+h*(fabs(coeff(i,1))
+                 +h*(fabs(coeff(i,2))+h*fabs(coeff(i,3))));
+    doublevar rL=1.0;
+    for(int l=0; l< L; l++) rL*=(i+1)*h;
+    b(i)=max(b(i+1), m*rL);
+  }
+}
+
+//----------------------------------------------------------------------
+
 void Spline_fitter::splinefit(Array1 <doublevar>& x, Array1 <doublevar>& y,
                              double yp1, double ypn)
 {
@@ -214,7 +255,33 @@ void Spline_fitter::splinefit(Array1 <doublevar>& x, Array1 <doublevar>& y,
 
   int n=x.GetDim(0);
   coeff.Resize(n,4);
+  setGrid(x);
+  fitTable(x,y,yp1,ypn);
+}
+
+//----------------------------------------------------------------------
+
+void Spline_fitter::splinefit(Array1 <doublevar>& x, Array1 <doublevar>& y,
+                              double yp1, double ypn, 
+                              doublevar maxthresh, Shared_tables & shared) { 
+  assert(x.GetDim(0)==y.GetDim(0));
+  int n=x.GetDim(0);
+  setGrid(x);
+  //the rows pad() adds, with one to spare for the rounding of the grids
+  int nroom=n;
+  if(maxthresh > threshold) nroom+=int((maxthresh-threshold)*invspacing)+2;
+  shared.allocate(coeff, nroom, 4);
+  coeff.dim[0]=n;
+  coeff.size=n*4;
+  if(!Shared_tables::writer()) return;
+  for(int i=n*4; i< nroom*4; i++) coeff.v[i]=0.0;
+  fitTable(x,y,yp1,ypn);
+}
+
+//----------------------------------------------------------------------
 
+void Spline_fitter::setGrid(Array1 <doublevar> & x) { 
+  int n=x.GetDim(0);
   spacing=x(1)-x(0);
   //M.B. I think tha the right threshold
   //should be the last point of the supplied grid, not 
@@ -222,6 +289,13 @@ void Spline_fitter::splinefit(Array1 <doublevar>& x, Array1 <doublevar>& y,
   threshold=x(n-1); //+spacing; 
 
   invspacing=1.0/spacing;
+}
+
+//----------------------------------------------------------------------
+
+void Spline_fitter::fitTable(Array1 <doublevar>& x, Array1 <doublevar>& y,
+                             double yp1, double ypn) { 
+  int n=x.GetDim(0);
   Array1 <doublevar> y2(n), u(n);
   doublevar sig, p, qn, un, hi;
 
@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define SPLINE_FITTER_H_INCLUDED
 
 #include "Qmc_std.h"
+#include "Shared_tables.h"
 
 class Spline_fitter {
  public:
@@ -38,6 +39,16 @@ class Spline_fitter {
     //!< df/dx at x_n, with n=number of points
      );
 
+  /*!
+    As splinefit(), with the table in memory from shared and room to
+    pad() out to maxthresh.  Every process sets up the grid, but only
+    Shared_tables::writer() computes the table; the others may read it
+    after shared.sync().  The table must not change afterwards.
+   */
+  void splinefit(Array1 <doublevar>& x, Array1 <doublevar>& y,
+                 double yp1, double ypn, 
+                 doublevar maxthresh, Shared_tables & shared);
+
   //Modify the spline so that the function goes smoothly to 
   //zero at 'cut'
   void enforceCutoff(doublevar cut);
@@ -77,7 +88,9 @@ class Spline_fitter {
     f2dir=2*coeff(i,2)+6*height*coeff(i,3);    
   }
 
-  int readspline(vector <string> & words, bool enforce_cusp, doublevar cusp);
+  //! Fit the points in words, going to zero at cut if cut > 0, with the table in shared (see splinefit())
+  int readspline(vector <string> & words, bool enforce_cusp, doublevar cusp,
+                 doublevar cut, doublevar maxthresh, Shared_tables & shared);
   int writeinput(string & indent, ostream & os); 
 
 
@@ -102,7 +115,28 @@ class Spline_fitter {
   //if we already have support past thresh, does nothing.
   void pad(doublevar thresh);
 
+  /*!
+    b(i) bounds |f(r)| r^L for all r past interval i, from the size of
+    each cubic over its interval
+   */
+  void boundTable(int L, Array1 <doublevar> & b);
+
+  //! The smallest grid point past which b from boundTable() is below tol
+  doublevar boundRadius(const Array1 <doublevar> & b, doublevar tol) { 
+    int lo=0, hi=b.GetDim(0)-1; //b is nonincreasing, and b(hi)=0
+    while(lo < hi) { 
+      int mid=(lo+hi)/2;
+      if(b(mid) < tol) hi=mid;
+      else lo=mid+1;
+    }
+    return lo*spacing;
+  }
+
  private:
+  void setGrid(Array1 <doublevar> & x);
+  void fitTable(Array1 <doublevar> & x, Array1 <doublevar> & y,
+                double yp1, double ypn);
+  void smoothCutoff(Array1 <doublevar> & x, Array1 <doublevar> & y, doublevar cut);
     doublevar invspacing; //1/spacing, so we can do multiplications instead of divisions.
   doublevar spacing;
   doublevar threshold;
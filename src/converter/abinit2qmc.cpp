@@ -925,7 +925,7 @@ void Abinit_converter::write_slater(string filename) {
     slater.orbtype="ORBITALS";
   else 
     slater.orbtype="CORBITALS";
-  slater.mo_matrix_type="EINSPLINE_MO";
+  slater.mo_matrix_type="BSPLINE_MO";
   slater.print_wavefunction(os);
 
 }
@@ -0,0 +1,17 @@
+######################################################################
+# Compiler definitions for Linux systems
+#  all compiler specific information should be declared here
+#  Shared-memory build: set NTHREADS in the DMC section to use it.
+CXX:=g++
+
+CXXFLAGS := -O3  \
+   -funroll-loops -ffast-math -fopenmp \
+  $(INCLUDEPATH) -fomit-frame-pointer
+
+
+DEBUG:= -Wall -DNO_RANGE_CHECKING -DNDEBUG    -DDEBUG_WRITE
+LDFLAGS:= -fopenmp
+
+######################################################################
+# This is the invokation to generate dependencies
+DEPENDMAKER:=g++ -MM  $(INCLUDEPATH)
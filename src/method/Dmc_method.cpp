@@ -129,12 +129,29 @@ void Dmc_method::read(vector <string> words,
     avg_words.push_back(tmp_dens);
   }
   
-  vector <string> dynamics_words;
+  dynamics_words.clear();
   if(!readsection(words, pos=0, dynamics_words, "DYNAMICS") ) 
     dynamics_words.push_back("SPLIT");
 
   low_io=0;
   if(haskeyword(words, pos=0,"LOW_IO")) low_io=1;
+
+  if(!readvalue(words, pos=0, nthreads, "NTHREADS"))
+    nthreads=1;
+  if(nthreads < 1) 
+    error("NTHREADS must be at least 1");
+  if(nthreads > qmc_max_threads()) { 
+    single_write(cout, "NTHREADS is larger than the number of available threads; using ",
+                 qmc_max_threads(), "\n");
+    nthreads=qmc_max_threads();
+  }
+  if(nthreads > 1 && (dens_words.size() > 0 || nldens_words.size() > 0))
+    error("DENSITY and NONLOCAL_DENSITY are not supported with NTHREADS > 1");
+
+  if(!readvalue(words, pos=0, crowd, "CROWD"))
+    crowd=1;
+  if(crowd < 1) 
+    error("CROWD must be at least 1");
   
   allocate(dynamics_words, dyngen);
   dyngen->enforceNodes(1);
@@ -215,6 +232,43 @@ int Dmc_method::allocateIntermediateVariables(System * sys,
     allocate(avg_words[i], sys, wfdata, average_var(i));
   }
   
+  //Thread 0 works on the objects above; the rest get their own copies.
+  //The Wavefunction_data, System, and Pseudopotential stay shared.
+  thread.Resize(nthreads);
+  thread(0).sample=sample;
+  thread(0).wf=wf;
+  thread(0).dyngen=dyngen;
+  thread(0).average_var.Resize(average_var.GetDim(0));
+  for(int i=0; i< average_var.GetDim(0); i++)
+    thread(0).average_var(i)=average_var(i);
+  for(int t=1; t< nthreads; t++) { 
+    wfdata->generateWavefunction(thread(t).wf);
+    sys->generateSample(thread(t).sample);
+    thread(t).sample->attachObserver(thread(t).wf);
+    allocate(dynamics_words, thread(t).dyngen);
+    thread(t).dyngen->enforceNodes(1);
+    thread(t).average_var.Resize(avg_words.size());
+    thread(t).average_var=NULL;
+    for(int i=0; i< thread(t).average_var.GetDim(0); i++) 
+      allocate(avg_words[i], sys, wfdata, thread(t).average_var(i));
+  }
+  if(nthreads > 1) 
+    walker_trace.Resize(nconfig, feedback_interval);
+
+  for(int t=0; t< nthreads; t++) { 
+    thread(t).crowd_sample.Resize(crowd);
+    thread(t).crowd_wf.Resize(crowd);
+    thread(t).crowd_dinfo.Resize(crowd);
+    thread(t).crowd_sample(0)=thread(t).sample;
+    thread(t).crowd_wf(0)=thread(t).wf;
+    for(int c=1; c< crowd; c++) { 
+      thread(t).crowd_wf(c)=NULL;
+      wfdata->generateWavefunction(thread(t).crowd_wf(c));
+      sys->generateSample(thread(t).crowd_sample(c));
+      thread(t).crowd_sample(c)->attachObserver(thread(t).crowd_wf(c));
+    }
+  }
+
 
   return 1;
 }
@@ -235,6 +289,10 @@ int Dmc_method::showinfo(ostream & os)
   os << "Blocks: " <<                        nblock    << endl;
   os << "Steps per block: " <<               nstep     << endl;
   os << "Timestep: " <<                      timestep  << endl;
+  if(nthreads > 1) 
+    os << "Threads per process: " <<         nthreads  << endl;
+  if(crowd > 1) 
+    os << "Walkers per crowd: " <<           crowd     << endl;
   if(tmoves) 
     os << "T-moves turned on" << endl;
   if(tmoves_sizeconsistent)
@@ -374,95 +432,48 @@ void Dmc_method::runWithVariables(Properties_manager & prop,
     for(int step=0; step < nstep; ) {
       int npsteps=min(feedback_interval, nstep-step);
 
-      Dynamics_info dinfo;
-      doublevar acsum=0;
-      doublevar deltar2=0;
-      Array1 <doublevar> epos(3);
-      
-      doublevar avg_acceptance=0;
-      
-      for(int walker=0; walker < nconfig; walker++) {
-        pts(walker).config_pos.restorePos(sample);
-        wf->updateLap(wfdata, sample);
-	//------Do several steps without branching
-        for(int p=0; p < npsteps; p++) {
-          pseudo->randomize();
-          
-          for(int e=0; e< nelectrons; e++) {
-            int acc;
-            acc=dyngen->sample(e, sample, wf, wfdata, guidingwf,
-                               dinfo, timestep);
-            
-            if(dinfo.accepted) 
-              deltar2+=dinfo.diffusion_rate/(nconfig*nelectrons*npsteps);
-            if(dinfo.accepted) {               
-              pts(walker).age(e)=0;
-            }
-            else { 
-              pts(walker).age(e)++;
-            }
-            avg_acceptance+=dinfo.acceptance/(nconfig*nelectrons*npsteps);
-            
-            if(acc>0) acsum++;
-          }
-          totpoints++;
-          Properties_point pt;
-          if(tmoves or tmoves_sizeconsistent) {  //------------------T-moves
-            doTmove(pt,pseudo,sys,wfdata,wf,sample,guidingwf);
-          } ///---------------------------------done with the T-moves
-          else {
-            mygather.gatherData(pt, pseudo, sys, wfdata, wf, 
-                                sample, guidingwf);
-          }
-          Dmc_history new_hist;
-          new_hist.main_en=pts(walker).prop.energy(0);
-          pts(walker).past_energies.push_front(new_hist);
-          deque<Dmc_history> & past(pts(walker).past_energies);
-          if(past.size() > nhist) 
-            past.erase(past.begin()+nhist, past.end());
-          
-          pts(walker).prop=pt;
-          if(!pure_dmc) { 
-            pts(walker).weight*=getWeight(pts(walker),teff,etrial);
-            //Introduce potentially a small bias to avoid instability.
-            if(pts(walker).weight>max_poss_weight) pts(walker).weight=max_poss_weight;
-          }
-          else
-            pts(walker).weight=getWeightPURE_DMC(pts(walker),teff,etrial);
-          
-          if(pts(walker).ignore_walker) {
-            pts(walker).ignore_walker=0;
-            pts(walker).weight=1;
-            pts(walker).prop.count=0;
-          }
-          pts(walker).prop.weight=pts(walker).weight;
-          //This is somewhat inaccurate..will need to change it later
-          //For the moment, the autocorrelation will be slightly
-          //underestimated
-          pts(walker).prop.parent=walker;
-          pts(walker).prop.nchildren=1;
-          pts(walker).prop.children(0)=walker;
-          pts(walker).prop.avgrets.Resize(1,average_var.GetDim(0));
-          for(int i=0; i< average_var.GetDim(0); i++) { 
-            average_var(i)->randomize(wfdata,wf,sys,sample);
-            average_var(i)->evaluate(wfdata, wf, sys, pseudo, sample, pts(walker).prop.avgrets(0,i));
-          }
-          prop.insertPoint(step+p, walker, pts(walker).prop);
-          for(int i=0; i< densplt.GetDim(0); i++)
-            densplt(i)->accumulate(sample,pts(walker).prop.weight(0));
-          for(int i=0; i< nldensplt.GetDim(0); i++)
-            nldensplt(i)->accumulate(sample,pts(walker).prop.weight(0),
-                                     wfdata,wf);
-          
-          
-          //MB: making the history of prop.avgrets for forward walking
-          if(max_fw_length){
-            forwardWalking(walker, step+p,prop_fw);
-          }//if FW
-          
+      for(int t=0; t< nthreads; t++) { 
+        thread(t).acsum=0;
+        thread(t).totpoints=0;
+      }
+
+      if(nthreads==1) { 
+        propagateWalkers(0, nconfig, step, npsteps, teff, thread(0), 
+                         pseudo, sys, wfdata, &prop, prop_fw);
+      }
+#ifdef _OPENMP
+      else { 
+        //Each thread gets a fixed slice of the walkers.  Every walker
+        //draws from its own stream, so the trajectories don't depend
+        //on which thread moves them.
+#pragma omp parallel num_threads(nthreads)
+        {
+          int t=omp_get_thread_num();
+          int wstart=(nconfig*t)/nthreads;
+          int wend=(nconfig*(t+1))/nthreads;
+          propagateWalkers(wstart, wend, step, npsteps, teff, thread(t),
+                           pseudo, sys, wfdata, NULL, prop_fw);
         }
 
-        pts(walker).config_pos.savePos(sample);
+        //Accumulate in walker order, exactly as the serial loop does.
+        for(int walker=0; walker < nconfig; walker++) { 
+          for(int p=0; p < npsteps; p++) { 
+            pts(walker).prop=walker_trace(walker,p);
+            prop.insertPoint(step+p, walker, pts(walker).prop);
+            if(max_fw_length)
+              forwardWalking(walker, step+p, prop_fw);
+          }
+        }
+        for(int t=1; t< nthreads; t++) { 
+          dyngen->addStats(thread(t).dyngen);
+          thread(t).dyngen->resetStats();
+        }
+      }
+#endif
+      doublevar acsum=0;
+      for(int t=0; t< nthreads; t++) { 
+        acsum+=thread(t).acsum;
+        totpoints+=thread(t).totpoints;
       }
       //---Finished moving all walkers
 
@@ -568,6 +579,162 @@ void Dmc_method::runWithVariables(Properties_manager & prop,
   deallocateIntermediateVariables();
 }
 
+//----------------------------------------------------------------------
+
+/*!
+Move walkers wstart..wend-1, a crowd at a time.
+ */
+void Dmc_method::propagateWalkers(int wstart, int wend, int step, int npsteps, 
+                                  doublevar teff, Dmc_thread & th, 
+                                  Pseudopotential * pseudo, System * sys,
+                                  Wavefunction_data * wfdata, Properties_manager * prop,
+                                  Array1 <Properties_manager> & prop_fw) {
+  int ncrowd=th.crowd_sample.GetDim(0);
+  for(int walker=wstart; walker < wend; walker+=ncrowd) 
+    propagateCrowd(walker, min(ncrowd, wend-walker), step, npsteps, teff, th, 
+                   pseudo, sys, wfdata, prop, prop_fw);
+}
+
+//----------------------------------------------------------------------
+
+/*!
+Move walkers wstart..wstart+nw-1 through npsteps steps without branching, 
+using only the objects in th.  The walkers go through each electron move
+together, but every random number a walker uses comes from its own stream 
+in the same order as if it were moved alone.  If prop is given, the points 
+are accumulated immediately (serial run); otherwise they are left in 
+walker_trace for the master thread to accumulate in order.
+ */
+void Dmc_method::propagateCrowd(int wstart, int nw, int step, int npsteps, 
+                                doublevar teff, Dmc_thread & th, 
+                                Pseudopotential * pseudo, System * sys,
+                                Wavefunction_data * wfdata, Properties_manager * prop,
+                                Array1 <Properties_manager> & prop_fw) {
+  Array1 <Average_generator *> & average_var(th.average_var);
+
+  Array1 <Sample_point *> samples(nw);
+  Array1 <Wavefunction *> wfs(nw);
+  Array1 <Dynamics_info> & dinfo(th.crowd_dinfo);
+  Array1 <Random_stream *> streams(nw);
+  Array1 <int> acc(nw);
+  //the quadrature rotation of each walker for this step
+  Array2 <doublevar> rotation(nw, 9);
+  Array1 <doublevar> x(3), y(3), z(3);
+
+  for(int c=0; c< nw; c++) { 
+    int walker=wstart+c;
+    samples(c)=th.crowd_sample(c);
+    wfs(c)=th.crowd_wf(c);
+    streams(c)=&pts(walker).stream;
+    pts(walker).config_pos.restorePos(samples(c));
+    wfs(c)->updateLap(wfdata, samples(c));
+  }
+
+  //------Do several steps without branching
+  for(int p=0; p < npsteps; p++) {
+    for(int c=0; c< nw; c++) { 
+      rng.setStream(streams(c));
+      generate_random_rotation(x,y,z);
+      for(int d=0; d< 3; d++) { 
+        rotation(c,d)=x(d);
+        rotation(c,3+d)=y(d);
+        rotation(c,6+d)=z(d);
+      }
+    }
+    
+    for(int e=0; e< nelectrons; e++) {
+      th.dyngen->sampleCrowd(e, samples, wfs, wfdata, guidingwf,
+                             dinfo, timestep, streams, acc);
+      
+      for(int c=0; c< nw; c++) { 
+        if(dinfo(c).accepted) {               
+          pts(wstart+c).age(e)=0;
+        }
+        else { 
+          pts(wstart+c).age(e)++;
+        }
+        if(acc(c)>0) th.acsum++;
+      }
+    }
+
+    for(int c=0; c< nw; c++) { 
+      int walker=wstart+c;
+      Sample_point * sample=samples(c);
+      Wavefunction * wf=wfs(c);
+      rng.setStream(streams(c));
+      for(int d=0; d< 3; d++) { 
+        x(d)=rotation(c,d);
+        y(d)=rotation(c,3+d);
+        z(d)=rotation(c,6+d);
+      }
+      pseudo->rotateQuadrature(x,y,z);
+
+      th.totpoints++;
+      Properties_point pt;
+      if(tmoves or tmoves_sizeconsistent) {  //------------------T-moves
+        doTmove(pt,pseudo,sys,wfdata,wf,sample,guidingwf);
+      } ///---------------------------------done with the T-moves
+      else {
+        mygather.gatherData(pt, pseudo, sys, wfdata, wf, 
+                            sample, guidingwf);
+      }
+      Dmc_history new_hist;
+      new_hist.main_en=pts(walker).prop.energy(0);
+      pts(walker).past_energies.push_front(new_hist);
+      deque<Dmc_history> & past(pts(walker).past_energies);
+      if(past.size() > nhist) 
+        past.erase(past.begin()+nhist, past.end());
+      
+      pts(walker).prop=pt;
+      if(!pure_dmc) { 
+        pts(walker).weight*=getWeight(pts(walker),teff,etrial);
+        //Introduce potentially a small bias to avoid instability.
+        if(pts(walker).weight>max_poss_weight) pts(walker).weight=max_poss_weight;
+      }
+      else
+        pts(walker).weight=getWeightPURE_DMC(pts(walker),teff,etrial);
+      
+      if(pts(walker).ignore_walker) {
+        pts(walker).ignore_walker=0;
+        pts(walker).weight=1;
+        pts(walker).prop.count=0;
+      }
+      pts(walker).prop.weight=pts(walker).weight;
+      //This is somewhat inaccurate..will need to change it later
+      //For the moment, the autocorrelation will be slightly
+      //underestimated
+      pts(walker).prop.parent=walker;
+      pts(walker).prop.nchildren=1;
+      pts(walker).prop.children(0)=walker;
+      pts(walker).prop.avgrets.Resize(1,average_var.GetDim(0));
+      for(int i=0; i< average_var.GetDim(0); i++) { 
+        average_var(i)->randomize(wfdata,wf,sys,sample);
+        average_var(i)->evaluate(wfdata, wf, sys, pseudo, sample, pts(walker).prop.avgrets(0,i));
+      }
+      if(prop==NULL) { 
+        walker_trace(walker,p)=pts(walker).prop;
+        continue;
+      }
+      prop->insertPoint(step+p, walker, pts(walker).prop);
+      for(int i=0; i< densplt.GetDim(0); i++)
+        densplt(i)->accumulate(sample,pts(walker).prop.weight(0));
+      for(int i=0; i< nldensplt.GetDim(0); i++)
+        nldensplt(i)->accumulate(sample,pts(walker).prop.weight(0),
+                                 wfdata,wf);
+      
+      
+      //MB: making the history of prop.avgrets for forward walking
+      if(max_fw_length){
+        forwardWalking(walker, step+p,prop_fw);
+      }//if FW
+    }
+  }
+
+  for(int c=0; c< nw; c++) 
+    pts(wstart+c).config_pos.savePos(samples(c));
+  rng.setStream(NULL);
+}
+
 
 //----------------------------------------------------------------------
 
@@ -651,11 +818,26 @@ void Dmc_method::restorecheckpoint(string & filename, System * sys,
     error("Not enough configurations in ", filename);
   }
 
+  //Walkers that didn't come with a stream get one keyed by their 
+  //position in the configuration file, so a configuration gets the 
+  //same stream whatever the number of processes.
+  uint64_t streamseed=0;
+  if(mpi_info.node==0) { 
+    streamseed=uint64_t(rng.ulec()*4294967296.0);
+    streamseed=(streamseed << 32) | uint64_t(rng.ulec()*4294967296.0);
+  }
+#ifdef USE_MPI
+  MPI_Bcast(&streamseed, sizeof(uint64_t), MPI_BYTE, 0, MPI_Comm_grp);
+#endif
   for(int walker=0; walker < nconfig; walker++) {
+    if(!pts(walker).stream.isSeeded()) 
+      pts(walker).stream.seed(streamseed, uint64_t(config_file_index(walker)));
+    rng.setStream(&pts(walker).stream);
     pts(walker).config_pos.restorePos(sample);
     mygather.gatherData(pts(walker).prop, pseudo, sys,
                         wfdata, wf, sample,
                         guidingwf);
+    rng.setStream(NULL);
     pts(walker).age.Resize(sys->nelectrons(0)+sys->nelectrons(1));
     pts(walker).age=0;
   }
@@ -845,19 +1027,29 @@ struct Queue_element {
 
 struct weight_obj {
   double w;
+  double r; //!< the walker's own random number; breaks ties in w
   int i;
 };
 
 bool operator<(const weight_obj & a,const weight_obj & b) {
+  if(a.w==b.w) return a.r < b.r;
   return a.w < b.w;
 }
-void match_walkers(Array1<double> & weights, Array1 <int> & branch) {
+
+/*!
+rands holds one uniform number per walker, drawn from that walker's
+stream, so the branching doesn't depend on the order of the walkers
+or on how many processes there are.
+*/
+void match_walkers(Array1<double> & weights, Array1 <double> & rands,
+                   Array1 <int> & branch) {
   const double split_threshold=1.8;
   branch=-1;
   int totwalkers=weights.GetDim(0);
   Array1<weight_obj> walkers(totwalkers);
   for(int i=0; i< totwalkers; i++) {
     walkers(i).w=weights(i);
+    walkers(i).r=rands(i);
     walkers(i).i=i;
   }
   sort(walkers.v,walkers.v+totwalkers);
@@ -867,7 +1059,7 @@ void match_walkers(Array1<double> & weights, Array1 <int> & branch) {
     int w=walkers(i).i;
     int smallest=walkers(currsmallest).i;
     double weight1=weights(w)/(weights(w)+weights(smallest));
-    if(weight1+rng.ulec() >= 1.0) { 
+    if(weight1+rands(w) >= 1.0) { 
       branch(w)=2;
       branch(smallest)=0;
       weights(w)+=weights(smallest);
@@ -893,13 +1085,19 @@ int Dmc_method::calcBranch() {
   int totwalkers=mpi_info.nprocs*nconfig;
   Array1 <doublevar> weights(totwalkers);
   Array1 <doublevar> my_weights(nconfig);
+  Array1 <doublevar> rands(totwalkers);
+  Array1 <doublevar> my_rands(nconfig);
   
-  for(int walker=0; walker < nconfig; walker++)
+  for(int walker=0; walker < nconfig; walker++) { 
     my_weights(walker)=pts(walker).weight;
+    my_rands(walker)=pts(walker).stream.ulec();
+  }
 #ifdef USE_MPI
   MPI_Allgather(my_weights.v,nconfig, MPI_DOUBLE, weights.v,nconfig,MPI_DOUBLE, MPI_Comm_grp);
+  MPI_Allgather(my_rands.v,nconfig, MPI_DOUBLE, rands.v,nconfig,MPI_DOUBLE, MPI_Comm_grp);
 #else
   weights=my_weights;
+  rands=my_rands;
 #endif
   Array1 <int> my_branch(nconfig);
   Array1 <int> nwalkers(mpi_info.nprocs);
@@ -916,7 +1114,7 @@ int Dmc_method::calcBranch() {
     branch=-1;
 
     long int time_a=clock();
-    match_walkers(weights,branch);
+    match_walkers(weights,rands,branch);
     long int time_b=clock();
     single_write(cout,"matching: ",double(time_b-time_a)/CLOCKS_PER_SEC,"\n");
     for(int w=0; w< totwalkers; w++) {
@@ -1003,6 +1201,8 @@ int Dmc_method::calcBranch() {
       //cout << mpi_info.node << ": copying " << curr << " to " << curr_copy << " branch " << my_branch(curr) << endl;
       my_branch(curr)--;
       pts(curr_copy)=savepts(curr);
+      //the next copy of this walker must not repeat its random numbers
+      savepts(curr).stream.spawn();
       //pts(curr_copy).weight=1;
       curr_copy++;
     }
@@ -1024,6 +1224,7 @@ int Dmc_method::calcBranch() {
         //cout << mpi_info.node << ":curr " << curr << " my_branch " << my_branch(curr) << endl;
         //cout << mpi_info.node << ":sending " << queue_pos->from_node << " to " << queue_pos->to_node << endl;
         savepts(curr).mpiSend(queue_pos->to_node);
+        savepts(curr).stream.spawn();
         queue_pos++;
       }
       else curr++;
@@ -1073,6 +1274,7 @@ void Dmc_point::mpiSend(int node) {
 
   MPI_Send(&weight,1,MPI_DOUBLE,node,0,MPI_Comm_grp);
   MPI_Send(&ignore_walker,1, MPI_INT,node,0,MPI_Comm_grp);
+  stream.mpiSend(node);
 
   int nelectrons=age.GetDim(0);
   MPI_Send(&nelectrons,1, MPI_INT,node,0,MPI_Comm_grp);
@@ -1109,6 +1311,7 @@ void Dmc_point::mpiReceive(int node) {
 
   MPI_Recv(&weight,1,MPI_DOUBLE,node,0,MPI_Comm_grp, &status);
   MPI_Recv(&ignore_walker,1,MPI_INT,node,0,MPI_Comm_grp, &status);
+  stream.mpiReceive(node);
       
   int nelectrons;
   MPI_Recv(&nelectrons,1,MPI_INT,node,0,MPI_Comm_grp,&status);
@@ -1125,6 +1328,7 @@ void Dmc_point::write(ostream & os) {
   //prop.write(indent,os);
   os << "weight " << weight<< endl;
   os << "sign " << sign << endl;
+  if(stream.isSeeded()) stream.write(os);
   /*
   for(deque<Dmc_history>::iterator i=past_energies.begin(); 
       i!=past_energies.end(); i++) { 
@@ -1156,6 +1360,11 @@ void Dmc_point::read(istream & is) {
   //prop.read(is);
   is >> dum >> weight;
   is >> dum >> sign;
+  //older files don't have a random stream
+  filepos=is.tellg();
+  is >> dum;
+  is.seekg(filepos);
+  if(dum=="rng_stream") stream.read(is);
   //ignoring the past stuff for the moment..
 }
 
@@ -32,6 +32,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "System.h"
 #include "Split_sample.h"
 #include "Properties.h"
+#include "ulec.h"
 #include <deque>
 
 class Program_options;
@@ -67,6 +68,7 @@ struct Dmc_point {
   int ignore_walker;
   int sign;
   Config_save_point config_pos;  
+  Random_stream stream; //!< all random numbers used to move this walker
   Array1 <doublevar> age;  //!< age of each electron
   Dmc_point() { 
     weight=1;
@@ -82,6 +84,32 @@ struct Dmc_point {
 };
 
 
+/*!
+Everything a thread needs to move its share of the walkers.  Thread 0
+uses the method's own objects; the others get private copies generated
+from the shared System and Wavefunction_data.  The thread moves up to 
+crowd_sample.GetDim(0) walkers at once; crowd member 0 is sample/wf.
+*/
+struct Dmc_thread { 
+  Sample_point * sample;
+  Wavefunction * wf;
+  Dynamics_generator * dyngen;
+  Array1 <Average_generator *> average_var;
+  Array1 <Sample_point *> crowd_sample;
+  Array1 <Wavefunction *> crowd_wf;
+  Array1 <Dynamics_info> crowd_dinfo;
+  doublevar acsum;  //!< number of accepted moves in this feedback interval
+  int totpoints;
+  Dmc_thread() { 
+    sample=NULL;
+    wf=NULL;
+    dyngen=NULL;
+    acsum=0;
+    totpoints=0;
+  }
+};
+
+
 class Dmc_method : public Qmc_avg_method
 {
 public:
@@ -147,6 +175,20 @@ public:
       if(average_var(i)) delete average_var(i);
       average_var(i)=NULL;
     }
+    for(int t=0; t< thread.GetDim(0); t++) { 
+      for(int c=1; c< thread(t).crowd_sample.GetDim(0); c++) { 
+        if(thread(t).crowd_sample(c)) delete thread(t).crowd_sample(c);
+        deallocate(thread(t).crowd_wf(c));
+      }
+    }
+    for(int t=1; t< thread.GetDim(0); t++) { 
+      if(thread(t).sample) delete thread(t).sample;
+      deallocate(thread(t).wf);
+      if(thread(t).dyngen) delete thread(t).dyngen;
+      for(int i=0; i< thread(t).average_var.GetDim(0); i++) 
+        if(thread(t).average_var(i)) delete thread(t).average_var(i);
+    }
+    thread.Resize(0);
   }
 
   //-----------Helper functions
@@ -154,6 +196,14 @@ public:
   void restorecheckpoint(string & filename, System * sys,
 			 Wavefunction_data * wfdata,Pseudopotential * pseudo);
   void forwardWalking(int walker, int step, Array1<Properties_manager> & prop_fw);
+  void propagateWalkers(int wstart, int wend, int step, int npsteps, doublevar teff,
+                        Dmc_thread & th, Pseudopotential * pseudo, System * sys,
+                        Wavefunction_data * wfdata, Properties_manager * prop,
+                        Array1 <Properties_manager> & prop_fw);
+  void propagateCrowd(int wstart, int nw, int step, int npsteps, doublevar teff,
+                      Dmc_thread & th, Pseudopotential * pseudo, System * sys,
+                      Wavefunction_data * wfdata, Properties_manager * prop,
+                      Array1 <Properties_manager> & prop_fw);
   void doTmove(Properties_point & pt,Pseudopotential * pseudo, System * sys,
                Wavefunction_data * wfdata, Wavefunction * wf, Sample_point * sample,
                Guiding_function * guideingwf);
@@ -195,6 +245,9 @@ public:
   doublevar max_poss_weight;
   int max_fw_length; //!maximum length for forward walking time
   int pure_dmc; //turn on SHDMC mode (pure diffusion for the length of nhist)
+  int nthreads; //!< number of shared-memory threads moving walkers
+  int crowd; //!< number of walkers a thread moves together
+  vector <string> dynamics_words;
 
   //---Control variables and state
   int have_allocated_variables;
@@ -212,6 +265,8 @@ public:
   Wavefunction_data * mywfdata;
 
   Array1 <Dmc_point> pts;
+  Array1 <Dmc_thread> thread;
+  Array2 <Properties_point> walker_trace; //!< (walker, step) points buffered by the threads
 
   Array1 < Local_density_accumulator *> densplt;
   vector <vector <string> > dens_words;
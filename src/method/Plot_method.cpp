@@ -124,10 +124,15 @@ void Plot_method::read(vector <string> words,
   cout<<endl;
 
 
+  //Each process plots its own orbitals, so the lists differ between
+  //processes and can't go in the node-shared tables.
+  int share_tables=global_options::share_tables;
+  global_options::share_tables=0;
   if(!use_complex)
     mymomat->buildLists(orblist_pernode);
   else
     cmymomat->buildLists(orblist_pernode);
+  global_options::share_tables=share_tables;
 
   mywalker=NULL;
   sysprop->generateSample(mywalker);
@@ -92,7 +92,7 @@ doublevar Split_sampler::transition_prob(int point1, int point2,
                                          doublevar timestep, 
                                          drift_type dtype) {
   doublevar prob=0;
-  static Array1 <doublevar> drift(3);
+  Array1 <doublevar> drift(3);
   //cout << "transition probability" << endl;
 
   drift=trace(point1).drift;
@@ -295,6 +295,27 @@ doublevar Dynamics_generator::greenFunction(Sample_point * sample, Wavefunction
 }
 
 
+//----------------------------------------------------------------------
+
+void Dynamics_generator::sampleCrowd(int e,
+                                     Array1 <Sample_point *> & samples,
+                                     Array1 <Wavefunction *> & wfs,
+                                     Wavefunction_data * wfdata,
+                                     Guiding_function * guidingwf,
+                                     Array1 <Dynamics_info> & info,
+                                     doublevar & efftimestep,
+                                     Array1 <Random_stream *> & streams,
+                                     Array1 <int> & acc) {
+  int nw=samples.GetDim(0);
+  acc.Resize(nw);
+  for(int w=0; w< nw; w++) { 
+    rng.setStream(streams(w));
+    acc(w)=sample(e, samples(w), wfs(w), wfdata, guidingwf, info(w), 
+                  efftimestep);
+  }
+}
+
+
 //----------------------------------------------------------------------
 /*!
 From x to y in the trace
@@ -392,8 +413,15 @@ int Split_sampler::split_driver(int e,
 
   if(depth > recursion_depth_) return 0;
 
-  static Array1 <doublevar> c_olddrift(3);
-  static Array1 <doublevar> c_newdrift(3);
+  split_move(e, sample, depth);
+  return split_evaluate(e, sample, wf, wfdata, guidingwf, depth, 
+                        info, efftimestep);
+}
+
+//----------------------------------------------------------------------
+
+void Split_sampler::split_move(int e, Sample_point * sample, int depth) { 
+  Array1 <doublevar> c_olddrift(3);
   
   c_olddrift=trace(0).drift;  
   limDrift(c_olddrift, timesteps(depth), dtype);
@@ -414,15 +442,35 @@ int Split_sampler::split_driver(int e,
 
   }
 
+  sample->translateElectron(e, trace(depth).translation);
+  trace(depth).sign=sample->overallSign();
+}
+
+//----------------------------------------------------------------------
+
+int Split_sampler::split_evaluate(int e,
+                                  Sample_point * sample,
+                                  Wavefunction * wf, 
+                                  Wavefunction_data * wfdata,
+                                  Guiding_function * guidingwf,
+                                  int depth,
+                                  Dynamics_info & info,
+                                  doublevar & efftimestep) {
+  Array1 <doublevar> c_olddrift(3);
+  c_olddrift=trace(0).drift;  
+  limDrift(c_olddrift, timesteps(depth), dtype);
+
+  int ndim=sample->ndim();
+
   doublevar diffusion_rate=0;
   for(int d=0; d< ndim; d++) 
     diffusion_rate+=trace(depth).gauss(d)*timesteps(depth)*trace(depth).gauss(d);;
   
-  
-  sample->translateElectron(e, trace(depth).translation);
-  trace(depth).sign=sample->overallSign();
-  
-  if(wfdata->supports(laplacian_update) ) {
+  int proposal=wfdata->supports(move_proposal);
+  if(proposal) { 
+    wf->proposeMove(wfdata, sample, e, trace(depth).lap);
+  }
+  else if(wfdata->supports(laplacian_update) ) {
     wf->updateLap(wfdata, sample);
     wf->getLap(wfdata, e, trace(depth).lap);
   }
@@ -460,14 +508,16 @@ int Split_sampler::split_driver(int e,
   
   if (acc+rng.ulec() > 1.0) {
     info.accepted=1;
+    if(proposal) wf->acceptMove(wfdata, sample, e);
     return depth;
   }
   else {
     info.accepted=0;
     
-    static Array1 <doublevar> rev(3,0.0);
+    Array1 <doublevar> rev(3,0.0);
     for(int d=0; d< 3; d++) rev(d)=-trace(depth).translation(d);
     sample->translateElectron(e,rev);
+    if(proposal) wf->rejectMove(wfdata, sample, e);
 
     depth++;
     
@@ -480,19 +530,22 @@ int Split_sampler::split_driver(int e,
 
 //----------------------------------------------------------------------
 
-int Split_sampler::sample(int e,
-                          Sample_point * sample, 
-                          Wavefunction * wf, 
-                          Wavefunction_data * wfdata,
-                          Guiding_function * guidingwf,
-                          Dynamics_info & info,
-                          doublevar & efftimestep) {
-
-  if(! wfStore.isInitialized())
-    wfStore.initialize(sample, wf);
+void Split_sampler::start_sample(int e,
+                                 Sample_point * sample, 
+                                 Wavefunction * wf, 
+                                 Wavefunction_data * wfdata,
+                                 Guiding_function * guidingwf,
+                                 doublevar & efftimestep,
+                                 Storage_container & store) {
+  if(! store.isInitialized())
+    store.initialize(sample, wf);
   
   wf->updateLap(wfdata, sample);
-  wfStore.saveUpdate(sample, wf, e);
+  //with move proposals, the wave function keeps its own state until
+  //the move is accepted, so we only need to save the electron
+  int proposal=wfdata->supports(move_proposal);
+  if(proposal) store.saveUpdate(sample, e);
+  else store.saveUpdate(sample, wf, e);
   trace.Resize(recursion_depth_+1);
 
   for(int i=0; i < recursion_depth_+1; i++) {
@@ -514,12 +567,15 @@ int Split_sampler::sample(int e,
   trace(depth).sign=sample->overallSign();
 
   guidingwf->getLap(trace(depth).lap, trace(depth).drift);
-  depth++;
+}
 
-  
-  int acc=split_driver(e, sample, wf, wfdata, guidingwf, depth,  
-                      info, efftimestep);
+//----------------------------------------------------------------------
 
+void Split_sampler::finish_sample(int e, int acc,
+                                  Sample_point * sample, 
+                                  Wavefunction * wf, 
+                                  Wavefunction_data * wfdata,
+                                  Storage_container & store) {
   if(acc > 0) {
     acceptances(acc-1)++;
     for(int i=0; i< acc; i++) {
@@ -533,12 +589,79 @@ int Split_sampler::sample(int e,
   }
 
   if(!acc) {
-    wfStore.restoreUpdate(sample, wf, e);
+    if(wfdata->supports(move_proposal)) store.restoreUpdate(sample, e);
+    else store.restoreUpdate(sample, wf, e);
   }
+}
+
+//----------------------------------------------------------------------
+
+int Split_sampler::sample(int e,
+                          Sample_point * sample, 
+                          Wavefunction * wf, 
+                          Wavefunction_data * wfdata,
+                          Guiding_function * guidingwf,
+                          Dynamics_info & info,
+                          doublevar & efftimestep) {
+
+  start_sample(e, sample, wf, wfdata, guidingwf, efftimestep, wfStore);
+  
+  int acc=split_driver(e, sample, wf, wfdata, guidingwf, 1,  
+                      info, efftimestep);
+
+  finish_sample(e, acc, sample, wf, wfdata, wfStore);
   //cout << "-----------split done" << endl;
   return acc;
 }
 
+//----------------------------------------------------------------------
+
+void Split_sampler::sampleCrowd(int e,
+                                Array1 <Sample_point *> & samples,
+                                Array1 <Wavefunction *> & wfs,
+                                Wavefunction_data * wfdata,
+                                Guiding_function * guidingwf,
+                                Array1 <Dynamics_info> & info,
+                                doublevar & efftimestep,
+                                Array1 <Random_stream *> & streams,
+                                Array1 <int> & acc) {
+  int nw=samples.GetDim(0);
+  if(nw < 2 || recursion_depth_ != 1 || !wfdata->supports(move_proposal)) { 
+    Dynamics_generator::sampleCrowd(e, samples, wfs, wfdata, guidingwf, 
+                                    info, efftimestep, streams, acc);
+    return;
+  }
+
+  //Every walker needs its own storage, since the Sample_storage holds 
+  //the walker's distance rows.
+  if(crowd_store.GetDim(0) < nw) { 
+    crowd_store.Resize(nw);
+    crowd_trace.Resize(nw);
+  }
+  acc.Resize(nw);
+  
+  //move the electron of every walker..
+  for(int w=0; w< nw; w++) { 
+    rng.setStream(streams(w));
+    start_sample(e, samples(w), wfs(w), wfdata, guidingwf, efftimestep, 
+                 crowd_store(w));
+    split_move(e, samples(w), 1);
+    crowd_trace(w)=trace;
+  }
+  
+  //..evaluate the orbitals for all the new positions at once..
+  wfs(0)->prepareCrowdMove(wfdata, wfs, samples, e);
+
+  //..and then accept or reject each one as sample() would
+  for(int w=0; w< nw; w++) { 
+    rng.setStream(streams(w));
+    trace=crowd_trace(w);
+    acc(w)=split_evaluate(e, samples(w), wfs(w), wfdata, guidingwf, 1, 
+                          info(w), efftimestep);
+    finish_sample(e, acc(w), samples(w), wfs(w), wfdata, crowd_store(w));
+  }
+}
+
 
 //----------------------------------------------------------------------
 
@@ -563,6 +686,16 @@ void Split_sampler::resetStats() {
   acceptances=0;
   tries=0;
 }
+
+void Split_sampler::addStats(Dynamics_generator * other) {
+  Split_sampler * o=dynamic_cast<Split_sampler *>(other);
+  if(o==NULL) error("Split_sampler::addStats: mismatched dynamics type");
+  assert(o->recursion_depth_==recursion_depth_);
+  for(int i=0; i< recursion_depth_; i++) {
+    acceptances(i)+=o->acceptances(i);
+    tries(i)+=o->tries(i);
+  }
+}
 //----------------------------------------------------------------------
 //######################################################################
 
@@ -575,6 +708,13 @@ void UNR_sampler::resetStats() {
   tries=0;
 }
 
+void UNR_sampler::addStats(Dynamics_generator * other) { 
+  UNR_sampler * o=dynamic_cast<UNR_sampler *>(other);
+  if(o==NULL) error("UNR_sampler::addStats: mismatched dynamics type");
+  acceptance+=o->acceptance;
+  tries+=o->tries;
+}
+
 
 void UNR_sampler::getDriftEtc(Point & pt, Sample_point * sample,
 			      doublevar tstep, int e,
@@ -739,8 +879,14 @@ int UNR_sampler::sample(int e, Sample_point * sample,
   Array1 <doublevar> translate(3);
   for(int d=0; d< 3; d++) translate(d)=p2.pos(d)-p1.pos(d);
   sample->translateElectron(e,translate);
-  wf->updateLap(wfdata, sample);
-  wf->getLap(wfdata, e, p2.lap);
+  int proposal=wfdata->supports(move_proposal);
+  if(proposal) { 
+    wf->proposeMove(wfdata, sample, e, p2.lap);
+  }
+  else { 
+    wf->updateLap(wfdata, sample);
+    wf->getLap(wfdata, e, p2.lap);
+  }
   p2.sign=sample->overallSign();
   guidewf->getLap(p2.lap, p2.drift);
 
@@ -783,10 +929,12 @@ int UNR_sampler::sample(int e, Sample_point * sample,
   if(acc+rng.ulec()>1.0) { 
     info.accepted=1;
     acceptance++;
+    if(proposal) wf->acceptMove(wfdata, sample, e);
     return 1;
   }
   else { 
     sample->setElectronPos(e,p1.pos);
+    if(proposal) wf->rejectMove(wfdata, sample, e);
     info.accepted=0;
     return 0;
   }
@@ -839,6 +987,17 @@ void SRK_dmc::read(vector <string> & words) {
 
 }
 
+//----------------------------------------------------------------------
+
+void SRK_dmc::addStats(Dynamics_generator * other) {
+  SRK_dmc * o=dynamic_cast<SRK_dmc *>(other);
+  if(o==NULL) error("SRK_dmc::addStats: mismatched dynamics type");
+  acceptances+=o->acceptances;
+  tries+=o->tries;
+  retries+=o->retries;
+  nbottom+=o->nbottom;
+}
+
 
 
 
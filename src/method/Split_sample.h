@@ -27,6 +27,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "System.h"
 #include "Sample_point.h"
 #include "Guiding_function.h"
+#include "ulec.h"
 struct Point {
   Array1 <doublevar> drift; //!< total drift(deterministic move)
   Array1 <doublevar> pos;
@@ -81,6 +82,22 @@ class Dynamics_generator {
                      doublevar & efftimestep
                      )=0;
 
+  /*!
+    Move electron e of every walker in a crowd.  Walker w draws its 
+    random numbers from streams(w), and gets in acc(w) and info(w) what
+    sample() would return, so the trajectories don't depend on how the
+    walkers are grouped.  The default moves them one after another.
+   */
+  virtual void sampleCrowd(int e,
+                           Array1 <Sample_point *> & samples,
+                           Array1 <Wavefunction *> & wfs,
+                           Wavefunction_data * wfdata,
+                           Guiding_function * guidewf,
+                           Array1 <Dynamics_info> & info,
+                           doublevar & efftimestep,
+                           Array1 <Random_stream *> & streams,
+                           Array1 <int> & acc);
+
 
   //returns the acceptance ratio                                  
   virtual doublevar greenFunction(Sample_point * sample, Wavefunction * wf,
@@ -97,6 +114,8 @@ class Dynamics_generator {
   virtual int showinfo(string & indent, ostream & os)=0;
   virtual void showStats(ostream & os)=0;
   virtual  void resetStats()=0;
+  //! Add the acceptance statistics of another generator of the same type
+  virtual void addStats(Dynamics_generator * other)=0;
 
 
   virtual ~Dynamics_generator() {}
@@ -177,6 +196,21 @@ class Split_sampler:public Dynamics_generator {
                    Dynamics_info & info,
                    doublevar & efftimestep);
 
+  /*!
+    With move proposals and no splitting, first moves electron e of every
+    walker, then lets the wave functions share the orbital evaluation 
+    (Wavefunction::prepareCrowdMove()), then accepts or rejects each.
+   */
+  void sampleCrowd(int e,
+                   Array1 <Sample_point *> & samples,
+                   Array1 <Wavefunction *> & wfs,
+                   Wavefunction_data * wfdata,
+                   Guiding_function * guidewf,
+                   Array1 <Dynamics_info> & info,
+                   doublevar & efftimestep,
+                   Array1 <Random_stream *> & streams,
+                   Array1 <int> & acc);
+
   //virtual doublevar greenFunction(Sample_point * sample, Wavefunction * wf,
   //                   Wavefunction_data * wfdata, Guiding_function * guidewf,
   //                           int e,
@@ -187,11 +221,24 @@ class Split_sampler:public Dynamics_generator {
   
   void showStats(ostream & os);
   void resetStats();
+  void addStats(Dynamics_generator * other);
  private:
  
   doublevar transition_prob(int point1, int point2,
                             doublevar timestep, 
                             drift_type dtype);
+
+  //The pieces of sample() and split_driver(), so sampleCrowd() can
+  //interleave the walkers
+  void start_sample(int e, Sample_point * sample, Wavefunction * wf,
+                    Wavefunction_data * wfdata, Guiding_function * guidewf,
+                    doublevar & efftimestep, Storage_container & store);
+  void split_move(int e, Sample_point * sample, int depth);
+  int split_evaluate(int e, Sample_point * sample, Wavefunction * wf,
+                     Wavefunction_data * wfdata, Guiding_function * guidewf,
+                     int depth, Dynamics_info & info, doublevar & efftimestep);
+  void finish_sample(int e, int acc, Sample_point * sample, Wavefunction * wf,
+                     Wavefunction_data * wfdata, Storage_container & store);
   
   drift_type dtype;
   Array1 <Point> trace;
@@ -204,6 +251,8 @@ class Split_sampler:public Dynamics_generator {
 
   string indent; //for debugging..
   Storage_container wfStore;
+  Array1 <Storage_container> crowd_store; //!< one per walker of a crowd
+  Array1 < Array1 <Point> > crowd_trace;
 };
 
 
@@ -253,6 +302,7 @@ class UNR_sampler:public Dynamics_generator {
 
   void showStats(ostream & os);
   void resetStats();
+  void addStats(Dynamics_generator * other);
  private:
   doublevar acceptance;
   long int tries;
@@ -298,6 +348,7 @@ class SRK_dmc:public Dynamics_generator {
       acceptances=0; tries=0;
       retries=0; nbottom=0;
     }
+    void addStats(Dynamics_generator * other);
   private:
     int rk_step(int e, Sample_point * sample, 
         Wavefunction * wf,Wavefunction_data * wfdata, 
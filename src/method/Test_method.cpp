@@ -23,6 +23,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Program_options.h"
 #include "System.h"
 #include "Basis_function.h"
+#include "Jastrow2_wf.h"
 void Test_method::read(vector <string> words,
                        unsigned int & pos,
                        Program_options & options)
@@ -69,6 +70,22 @@ void Test_method::read(vector <string> words,
     backflow.init(sysprop,occupation,backtxt);
   }
   
+  test_allocations=haskeyword(words, pos=0, "ALLOCATION_TEST");
+
+  vector <string> threadtxt;
+  test_threads=0;
+  if(readsection(words, pos=0, threadtxt, "THREAD_TEST")) { 
+    test_threads=1;
+    if(!readvalue(threadtxt, pos=0, thread_nthreads, "NTHREADS"))
+      thread_nthreads=4;
+    if(!readvalue(threadtxt, pos=0, thread_nconfig, "NCONFIG"))
+      thread_nconfig=32;
+    if(!readvalue(threadtxt, pos=0, thread_nstep, "NSTEP"))
+      thread_nstep=20;
+    if(thread_nthreads < 2)
+      error("THREAD_TEST needs NTHREADS of at least 2");
+  }
+
   if(haskeyword(words, pos=0, "PLOT_EE_CUSP"))
     plot_cusp=1;
   else
@@ -93,6 +110,23 @@ void Test_method::read(vector <string> words,
     testhessian=0;
   }
 
+  vector <string> prectxt;
+  wfdata_full=NULL;
+  test_precision=0;
+  if(readsection(words, pos=0, prectxt, "PRECISION_TEST")) { 
+    test_precision=1;
+    if(!readvalue(prectxt, pos=0, precision_nconfig, "NCONFIG"))
+      precision_nconfig=100;
+    vector <string> fulltxt;
+    for(unsigned int i=0; i< options.twftext[0].size(); i++) { 
+      if(!caseless_eq(options.twftext[0][i],"SINGLE_PRECISION"))
+        fulltxt.push_back(options.twftext[0][i]);
+    }
+    if(fulltxt.size()==options.twftext[0].size())
+      error("PRECISION_TEST needs SINGLE_PRECISION somewhere in the trial function");
+    allocate(fulltxt, sysprop, wfdata_full);
+  }
+
   cout << "done setup " << endl;
 }
 
@@ -108,6 +142,8 @@ int Test_method::showinfo(ostream & os)
 
 #include "Split_sample.h"
 #include "Guiding_function.h"
+#include "Generate_sample.h"
+#include "Properties_gather.h"
 
 
 void check_numbers(doublevar num1,doublevar num2, ostream & os,
@@ -289,6 +325,18 @@ void Test_method::run(Program_options & options, ostream & output)
   if(test_backflow) { 
     testBackflow();
   }
+
+  if(test_precision) { 
+    testPrecision();
+  }
+
+  if(test_allocations) { 
+    testAllocations(mywf, sample);
+  }
+
+  if(test_threads) { 
+    testThreads();
+  }
   
 
   delete mywf; mywf=NULL;
@@ -614,3 +662,239 @@ void Test_method::testBackflow() {
 }
 
 //------------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+
+/*!
+Sample configurations from the trial function, which keeps some of its
+coefficients in single precision, and evaluate the local energy there
+with it and with the same function in full precision.  Both evaluations
+of a configuration draw the same random numbers for the nonlocal
+integration, so the difference is only that of the precision.
+*/
+void Test_method::testPrecision() { 
+  cout <<"#######################################################\n";
+  cout <<" Single versus full precision on " << precision_nconfig 
+       << " configurations" << endl;
+  cout <<"#######################################################\n";
+  Wavefunction * wf=NULL, * wf_full=NULL;
+  Sample_point * sample=NULL, * sample_full=NULL;
+  wfdata->generateWavefunction(wf);
+  wfdata_full->generateWavefunction(wf_full);
+  sysprop->generateSample(sample);
+  sysprop->generateSample(sample_full);
+  sample->attachObserver(wf);
+  sample_full->attachObserver(wf_full);
+
+  Vmc_sum_squares guide;
+  Array1 <Config_save_point> configs;
+  generate_sample(sample, wf, wfdata, &guide, precision_nconfig, configs);
+
+  Properties_gather mygather;
+  Properties_point pt, pt_full;
+  doublevar avg=0, avg2=0, avg_full=0, avg2_full=0;
+  doublevar diff=0, diff2=0, maxdiff=0;
+  uint64_t seed=uint64_t(rng.ulec()*4294967296.0);
+  Random_stream stream;
+  for(int c=0; c< precision_nconfig; c++) { 
+    configs(c).restorePos(sample);
+    configs(c).restorePos(sample_full);
+    stream.seed(seed, c);
+    rng.setStream(&stream);
+    mygather.gatherData(pt, psp, sysprop, wfdata, wf, sample, &guide);
+    stream.seed(seed, c);
+    mygather.gatherData(pt_full, psp, sysprop, wfdata_full, wf_full, 
+                        sample_full, &guide);
+    rng.setStream(NULL);
+    doublevar en=pt.energy(0), en_full=pt_full.energy(0);
+    avg+=en; avg2+=en*en;
+    avg_full+=en_full; avg2_full+=en_full*en_full;
+    diff+=en-en_full; diff2+=(en-en_full)*(en-en_full);
+    if(fabs(en-en_full) > maxdiff) maxdiff=fabs(en-en_full);
+  }
+  doublevar n=precision_nconfig;
+  avg/=n; avg2/=n; avg_full/=n; avg2_full/=n; diff/=n; diff2/=n;
+  doublevar var=avg2-avg*avg, var_full=avg2_full-avg_full*avg_full;
+  cout << "energy    single " << avg << " full " << avg_full 
+       << " difference " << avg-avg_full << " +/- " 
+       << sqrt(max(diff2-diff*diff,0.0)/n) << endl;
+  cout << "variance  single " << var << " full " << var_full 
+       << " difference " << var-var_full << endl;
+  cout << "largest difference in the local energy " << maxdiff << endl;
+
+  delete wf; delete wf_full;
+  delete sample; delete sample_full;
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  Count the arrays allocated by the wave function while it updates for
+  a moved electron, after a first pass to let it size its workspaces.
+  Also count the electron-ion basis evaluations for Jastrow groups that
+  have their one-body term in SPLINE tables, which should need none.
+  Only builds without NDEBUG keep count.
+*/
+void Test_method::testAllocations(Wavefunction * mywf, Sample_point * sample) {
+  cout <<"#######################################################\n";
+  cout <<" Allocations in the wave function updates" << endl;
+  cout <<"#######################################################\n";
+#ifdef NDEBUG
+  cout << "Allocations are only counted in builds without -DNDEBUG" << endl;
+#else
+  Array1 <doublevar> epos(3), new_epos(3);
+  Wf_return lap(mywf->nfunc(), 5), val(mywf->nfunc(), 2);
+  int virtual_moves_ok=wfdata->supports(virtual_moves);
+  Array2 <doublevar> virtual_pos(3,3);
+  Array1 <Wf_return> virtual_vals;
+  mywf->updateLap(wfdata, sample);
+  long int nlap=0, nval=0, nvirtual=0;
+  long int spline_start=spline_eibasis_rows;
+  for(int pass=0; pass< 2; pass++) { 
+    for(int e=0; e< nelectrons; e++) { 
+      sample->getElectronPos(e, epos);
+      new_epos=epos;
+      new_epos(0)+=0.01;
+      sample->setElectronPos(e, new_epos);
+      long int start=array_allocations;
+      mywf->updateLap(wfdata, sample);
+      mywf->getLap(wfdata, e, lap);
+      if(pass) nlap+=array_allocations-start;
+
+      sample->setElectronPos(e, epos);
+      start=array_allocations;
+      mywf->updateVal(wfdata, sample);
+      mywf->getVal(wfdata, e, val);
+      if(pass) nval+=array_allocations-start;
+
+      if(virtual_moves_ok) { 
+        for(int p=0; p< 3; p++) 
+          for(int d=0; d< 3; d++) 
+            virtual_pos(p,d)=epos(d)+(p==d ? 0.1 : 0.0);
+        start=array_allocations;
+        mywf->evalVirtualMoves(wfdata, sample, e, virtual_pos, virtual_vals);
+        if(pass) nvirtual+=array_allocations-start;
+      }
+    }
+  }
+  long int nspline=spline_eibasis_rows-spline_start;
+  cout << "updateLap: " << nlap << " allocations for " << nelectrons 
+       << " moves   " << (nlap ? "FAILED" : "OK") << endl;
+  cout << "updateVal: " << nval << " allocations for " << nelectrons 
+       << " moves   " << (nval ? "FAILED" : "OK") << endl;
+  if(virtual_moves_ok) 
+    cout << "evalVirtualMoves: " << nvirtual << " allocations for " << nelectrons 
+         << " electrons   " << (nvirtual ? "FAILED" : "OK") << endl;
+  cout << "SPLINE one-body groups: " << nspline 
+       << " electron-ion basis evaluations   " << (nspline ? "FAILED" : "OK") << endl;
+#endif
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  Walk the same walkers with one thread and with thread_nthreads, the way
+  DMC does with NTHREADS, and compare their local energies.  Each walker
+  draws from its own stream, so the two must agree to the last bit;
+  scratch shared between the threads shows up as a difference.
+*/
+void Test_method::testThreads() { 
+  cout <<"#######################################################\n";
+  cout <<" " << thread_nconfig << " walkers on " << thread_nthreads 
+       << " threads against one thread" << endl;
+  cout <<"#######################################################\n";
+#ifndef _OPENMP
+  cout << "THREAD_TEST needs a build with OpenMP" << endl;
+#else
+  int nthreads=thread_nthreads;
+  Array1 <Wavefunction *> wf(nthreads);
+  Array1 <Sample_point *> sample(nthreads);
+  for(int t=0; t< nthreads; t++) { 
+    wf(t)=NULL; sample(t)=NULL;
+    wfdata->generateWavefunction(wf(t));
+    sysprop->generateSample(sample(t));
+    sample(t)->attachObserver(wf(t));
+  }
+  Vmc_sum_squares guide;
+  Array1 <Config_save_point> configs;
+  generate_sample(sample(0), wf(0), wfdata, &guide, thread_nconfig, configs);
+  uint64_t seed=uint64_t(rng.ulec()*4294967296.0);
+
+  Array1 <doublevar> serial(thread_nconfig), threaded(thread_nconfig);
+  for(int w=0; w< thread_nconfig; w++) 
+    serial(w)=threadWalk(wf(0), sample(0), configs(w), seed, w);
+#pragma omp parallel num_threads(nthreads)
+  { 
+    int t=omp_get_thread_num();
+    int wstart=(thread_nconfig*t)/nthreads;
+    int wend=(thread_nconfig*(t+1))/nthreads;
+    for(int w=wstart; w< wend; w++)
+      threaded(w)=threadWalk(wf(t), sample(t), configs(w), seed, w);
+  }
+
+  int ndiff=0;
+  doublevar en_serial=0, en_threaded=0, maxdiff=0;
+  for(int w=0; w< thread_nconfig; w++) { 
+    if(serial(w)!=threaded(w)) ndiff++;
+    maxdiff=max(maxdiff, fabs(serial(w)-threaded(w)));
+    en_serial+=serial(w)/thread_nconfig;
+    en_threaded+=threaded(w)/thread_nconfig;
+  }
+  cout << "energy    serial " << en_serial << " threaded " << en_threaded 
+       << endl;
+  cout << "largest difference in the local energy " << maxdiff << endl;
+  cout << ndiff << " of " << thread_nconfig << " walkers differ   " 
+       << (ndiff ? "FAILED" : "OK") << endl;
+  
+  for(int t=0; t< nthreads; t++) { 
+    delete wf(t);
+    delete sample(t);
+  }
+#endif
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  Metropolis moves for one walker from start, with every random number
+  from the walker's own stream, then its local energy.
+*/
+doublevar Test_method::threadWalk(Wavefunction * wf, Sample_point * sample,
+                                  Config_save_point & start, uint64_t seed, 
+                                  int walker) { 
+  Random_stream stream;
+  stream.seed(seed, walker);
+  rng.setStream(&stream);
+  start.restorePos(sample);
+  wf->notify(all_electrons_move, 0);
+  wf->updateVal(wfdata, sample);
+
+  Storage_container store;
+  store.initialize(sample, wf);
+  Wf_return oldval(wf->nfunc(), 2), newval(wf->nfunc(), 2);
+  Array1 <doublevar> pos(3);
+  const doublevar step=0.5;
+  for(int s=0; s< thread_nstep; s++) { 
+    for(int e=0; e< nelectrons; e++) { 
+      wf->getVal(wfdata, e, oldval);
+      store.saveUpdate(sample, wf, e);
+      sample->getElectronPos(e, pos);
+      for(int d=0; d< 3; d++) pos(d)+=step*rng.gasdev();
+      sample->setElectronPos(e, pos);
+      wf->updateVal(wfdata, sample);
+      wf->getVal(wfdata, e, newval);
+      doublevar ratio=exp(2*(newval.amp(0,0)-oldval.amp(0,0)));
+      if(rng.ulec() > ratio)
+        store.restoreUpdate(sample, wf, e);
+    }
+  }
+
+  Properties_gather mygather;
+  Properties_point pt;
+  Vmc_sum_squares guide;
+  mygather.gatherData(pt, psp, sysprop, wfdata, wf, sample, &guide);
+  rng.setStream(NULL);
+  return pt.energy(0);
+}
+
+//----------------------------------------------------------------------
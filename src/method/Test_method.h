@@ -49,6 +49,7 @@ public:
   {
 
     deallocate(wfdata);
+    deallocate(wfdata_full);
     if(sysprop) delete sysprop;
   }
 
@@ -57,12 +58,19 @@ public:
   void testBackflow();
   void plotCusp(Wavefunction * mywf, Sample_point * sample);
   void testParmDeriv(Wavefunction * mywf, Sample_point * sample);
+  void testPrecision();
+  void testAllocations(Wavefunction * mywf, Sample_point * sample);
+  void testThreads();
+  doublevar threadWalk(Wavefunction * wf, Sample_point * sample,
+                       Config_save_point & start, uint64_t seed, int walker);
   int nelectrons; //!< Number of electrons
   string wfoutputfile;
   System * sysprop;
   string readconfig;
 
   Wavefunction_data * wfdata;
+  //! The trial function with SINGLE_PRECISION removed, for PRECISION_TEST
+  Wavefunction_data * wfdata_full;
   Pseudopotential * psp;
   Basis_function * basis;
 
@@ -73,6 +81,13 @@ public:
   int testhessian;
   int nparms_start;
   int nparms_end;
+  int test_precision;
+  int precision_nconfig;
+  int test_allocations;
+  int test_threads;
+  int thread_nthreads;
+  int thread_nconfig;
+  int thread_nstep;
 };
 
 #endif //TEST_METHOD_H_INCLUDED
@@ -0,0 +1,309 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Bspline_3d.h"
+
+/*!
+Solve \f$(x_{m-1}+4x_m+x_{m+1})/6=d_m\f$ with periodic indices for the
+n values d[0], d[s], d[2s],..; the solution replaces d.  This is the
+cyclic tridiagonal algorithm of Numerical Recipes (Sherman-Morrison
+on top of the Thomas algorithm).
+*/
+static void solve_periodic(int n, doublevar * d, int s,
+                           Array1 <doublevar> & work) {
+  const doublevar a=1.0/6.0, b=4.0/6.0;
+  const doublevar gamma=-b;
+  work.Resize(4*n);
+  doublevar * bb=work.v, * gam=work.v+n, * x=work.v+2*n, * z=work.v+3*n;
+  for(int j=0; j< n; j++) bb[j]=b;
+  bb[0]=b-gamma;
+  bb[n-1]=b-a*a/gamma;
+
+  //x solves the tridiagonal part with d, z with (gamma,0,...,0,a)
+  doublevar bet=bb[0];
+  x[0]=d[0]/bet;
+  z[0]=gamma/bet;
+  for(int j=1; j< n; j++) {
+    gam[j]=a/bet;
+    bet=bb[j]-a*gam[j];
+    doublevar u=(j==n-1)?a:0.0;
+    x[j]=(d[j*s]-a*x[j-1])/bet;
+    z[j]=(u-a*z[j-1])/bet;
+  }
+  for(int j=n-2; j>=0; j--) {
+    x[j]-=gam[j+1]*x[j+1];
+    z[j]-=gam[j+1]*z[j+1];
+  }
+  doublevar fact=(x[0]+a*x[n-1]/gamma)/(1.0+z[0]+a*z[n-1]/gamma);
+  for(int j=0; j< n; j++)
+    d[j*s]=x[j]-fact*z[j];
+}
+
+//----------------------------------------------------------------------
+
+void Bspline_3d::init(const Array1 <int> & npoints, int width_,
+                      int single_precision, Shared_tables & shared) {
+  assert(npoints.GetDim(0)==3);
+  n=npoints;
+  for(int d=0; d< 3; d++) {
+    if(n(d) < 4)
+      error("B-spline grids need at least 4 points in each direction");
+  }
+  width=width_;
+  single=single_precision;
+  //keep each row of coefficients aligned to 32 bytes
+  int align=single?8:4;
+  stride=(width+align-1)/align*align;
+  int ntot=(n(0)+3)*(n(1)+3)*(n(2)+3)*stride;
+  if(single) {
+    coef.clear();
+    shared.allocate(coef_single, ntot);
+    if(Shared_tables::writer()) coef_single=0.0;
+  }
+  else {
+    coef_single.clear();
+    shared.allocate(coef, ntot);
+    if(Shared_tables::writer()) coef=0.0;
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Bspline_3d::fillPadding(int col, const Array3 <doublevar> & c) {
+  assert(col < width);
+  for(int px=0; px < n(0)+3; px++) {
+    int i=(px-1+n(0))%n(0);
+    for(int py=0; py < n(1)+3; py++) {
+      int j=(py-1+n(1))%n(1);
+      for(int pz=0; pz < n(2)+3; pz++) {
+        int k=(pz-1+n(2))%n(2);
+        int off=pointOffset(px,py,pz)+col;
+        if(single) coef_single(off)=c(i,j,k);
+        else coef(off)=c(i,j,k);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Bspline_3d::setValues(int col, const doublevar * data) {
+  if(!Shared_tables::writer()) return;
+  Array3 <doublevar> c(n(0),n(1),n(2));
+  int ntot=n(0)*n(1)*n(2);
+  for(int i=0; i< ntot; i++) c.v[i]=data[i];
+
+  Array1 <doublevar> work;
+  for(int i=0; i< n(0); i++)
+    for(int j=0; j< n(1); j++)
+      solve_periodic(n(2), &c(i,j,0), 1, work);
+  for(int i=0; i< n(0); i++)
+    for(int k=0; k< n(2); k++)
+      solve_periodic(n(1), &c(i,0,k), n(2), work);
+  for(int j=0; j< n(1); j++)
+    for(int k=0; k< n(2); k++)
+      solve_periodic(n(0), &c(0,j,k), n(1)*n(2), work);
+
+  fillPadding(col, c);
+}
+
+//----------------------------------------------------------------------
+
+void Bspline_3d::setCoefficients(int col, const doublevar * coeff) {
+  if(!Shared_tables::writer()) return;
+  Array3 <doublevar> c(n(0),n(1),n(2));
+  int ntot=n(0)*n(1)*n(2);
+  for(int i=0; i< ntot; i++) c.v[i]=coeff[i];
+  fillPadding(col, c);
+}
+
+//----------------------------------------------------------------------
+
+void Bspline_3d::getCoefficients(int col, doublevar * coeff) {
+  int count=0;
+  for(int i=0; i< n(0); i++) {
+    for(int j=0; j< n(1); j++) {
+      for(int k=0; k< n(2); k++) {
+        int off=pointOffset(i+1,j+1,k+1)+col;
+        coeff[count++]=single?coef_single(off):coef(off);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+/*!
+The 64 coefficient rows that contribute at u, and the basis function
+values and u-derivatives along each direction.
+*/
+void Bspline_3d::locate(const doublevar * u, int * offset, doublevar a[3][4],
+                        doublevar da[3][4], doublevar d2a[3][4]) {
+  int base[3];
+  for(int d=0; d< 3; d++) {
+    doublevar x=u[d]*n(d);
+    doublevar fl=floor(x);
+    doublevar t=x-fl;
+    int i=int(fl)%n(d);
+    if(i < 0) i+=n(d);
+    base[d]=i;
+    doublevar t2=t*t, t3=t2*t, mt=1.0-t;
+    a[d][0]=mt*mt*mt/6.0;
+    a[d][1]=(3.0*t3-6.0*t2+4.0)/6.0;
+    a[d][2]=(-3.0*t3+3.0*t2+3.0*t+1.0)/6.0;
+    a[d][3]=t3/6.0;
+    doublevar s=n(d);
+    da[d][0]=-0.5*mt*mt*s;
+    da[d][1]=(1.5*t2-2.0*t)*s;
+    da[d][2]=(-1.5*t2+t+0.5)*s;
+    da[d][3]=0.5*t2*s;
+    doublevar s2=s*s;
+    d2a[d][0]=mt*s2;
+    d2a[d][1]=(3.0*t-2.0)*s2;
+    d2a[d][2]=(1.0-3.0*t)*s2;
+    d2a[d][3]=t*s2;
+  }
+  int p=0;
+  for(int i=0; i< 4; i++)
+    for(int j=0; j< 4; j++)
+      for(int k=0; k< 4; k++)
+        offset[p++]=pointOffset(base[0]+i, base[1]+j, base[2]+k);
+}
+
+//----------------------------------------------------------------------
+
+template <class S> void Bspline_3d::accumulate_rows(const S * c,
+                                                    const int * offset,
+                                                    int nq,
+                                                    const doublevar * w,
+                                                    doublevar * out) {
+  for(int i=0; i< nq*width; i++) out[i]=0.0;
+  for(int p=0; p< 64; p++) {
+    const S * row=c+offset[p];
+    const doublevar * wp=w+p*nq;
+    for(int q=0; q< nq; q++) {
+      const doublevar wq=wp[q];
+      doublevar * o=out+q*width;
+      for(int k=0; k< width; k++)
+        o[k]+=wq*row[k];
+    }
+  }
+}
+
+void Bspline_3d::accumulate(const int * offset, int nq, const doublevar * w,
+                            doublevar * out) {
+  if(single) accumulate_rows(coef_single.v, offset, nq, w, out);
+  else accumulate_rows(coef.v, offset, nq, w, out);
+}
+
+//----------------------------------------------------------------------
+
+void Bspline_3d::val(const doublevar * u, doublevar * vals) {
+  int offset[64];
+  doublevar a[3][4], da[3][4], d2a[3][4];
+  doublevar w[64];
+  locate(u, offset, a, da, d2a);
+  int p=0;
+  for(int i=0; i< 4; i++)
+    for(int j=0; j< 4; j++)
+      for(int k=0; k< 4; k++)
+        w[p++]=a[0][i]*a[1][j]*a[2][k];
+  accumulate(offset, 1, w, vals);
+}
+
+//----------------------------------------------------------------------
+
+/*!
+The weights of one grid point in terms of r: value, gradient, and the
+Hessian (xx,yy,zz,xy,xz,yz), from the u-derivatives of the basis product.
+*/
+static void cartesian_weights(doublevar ax, doublevar ay, doublevar az,
+                              doublevar dx, doublevar dy, doublevar dz,
+                              doublevar d2x, doublevar d2y, doublevar d2z,
+                              const Array2 <doublevar> & L,
+                              doublevar * w) {
+  doublevar gu[3], hu[3][3];
+  gu[0]=dx*ay*az; gu[1]=ax*dy*az; gu[2]=ax*ay*dz;
+  hu[0][0]=d2x*ay*az; hu[1][1]=ax*d2y*az; hu[2][2]=ax*ay*d2z;
+  hu[0][1]=hu[1][0]=dx*dy*az;
+  hu[0][2]=hu[2][0]=dx*ay*dz;
+  hu[1][2]=hu[2][1]=ax*dy*dz;
+  w[0]=ax*ay*az;
+  for(int r=0; r< 3; r++)
+    w[1+r]=L(r,0)*gu[0]+L(r,1)*gu[1]+L(r,2)*gu[2];
+  //H_r(a,b)=sum_cd L(a,c) L(b,d) H_u(c,d)
+  const int pa[6]={0,1,2,0,0,1}, pb[6]={0,1,2,1,2,2};
+  for(int h=0; h< 6; h++) {
+    doublevar sum=0;
+    for(int c=0; c< 3; c++) {
+      doublevar lb=L(pb[h],0)*hu[c][0]+L(pb[h],1)*hu[c][1]+L(pb[h],2)*hu[c][2];
+      sum+=L(pa[h],c)*lb;
+    }
+    w[4+h]=sum;
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Bspline_3d::vgl(const doublevar * u, const Array2 <doublevar> & L,
+                     doublevar * out) {
+  int offset[64];
+  doublevar a[3][4], da[3][4], d2a[3][4];
+  doublevar w[64*5], h[10];
+  locate(u, offset, a, da, d2a);
+  int p=0;
+  for(int i=0; i< 4; i++) {
+    for(int j=0; j< 4; j++) {
+      for(int k=0; k< 4; k++) {
+        cartesian_weights(a[0][i], a[1][j], a[2][k], da[0][i], da[1][j],
+                          da[2][k], d2a[0][i], d2a[1][j], d2a[2][k], L, h);
+        doublevar * wp=w+5*p;
+        wp[0]=h[0]; wp[1]=h[1]; wp[2]=h[2]; wp[3]=h[3];
+        wp[4]=h[4]+h[5]+h[6];
+        p++;
+      }
+    }
+  }
+  accumulate(offset, 5, w, out);
+}
+
+//----------------------------------------------------------------------
+
+void Bspline_3d::vgh(const doublevar * u, const Array2 <doublevar> & L,
+                     doublevar * out) {
+  int offset[64];
+  doublevar a[3][4], da[3][4], d2a[3][4];
+  doublevar w[64*10];
+  locate(u, offset, a, da, d2a);
+  int p=0;
+  for(int i=0; i< 4; i++) {
+    for(int j=0; j< 4; j++) {
+      for(int k=0; k< 4; k++) {
+        cartesian_weights(a[0][i], a[1][j], a[2][k], da[0][i], da[1][j],
+                          da[2][k], d2a[0][i], d2a[1][j], d2a[2][k], L,
+                          w+10*p);
+        p++;
+      }
+    }
+  }
+  accumulate(offset, 10, w, out);
+}
+
+//----------------------------------------------------------------------
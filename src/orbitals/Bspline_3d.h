@@ -0,0 +1,106 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef BSPLINE_3D_H_INCLUDED
+#define BSPLINE_3D_H_INCLUDED
+
+#include "Qmc_std.h"
+#include "Shared_tables.h"
+
+/*!
+\brief
+A set of periodic tricubic B-splines on the unit cube, all on the same grid.
+
+The functions are given by their values on an n(0) x n(1) x n(2) grid
+at \f$u_d=i/n_d\f$.  Each of the width columns is a separate real function
+(a complex orbital takes two).  The coefficients are stored with the
+column innermost, so evaluating every column at one point reads 64
+contiguous rows of coefficients and the loop over columns vectorizes.
+The grid is padded by three points in each direction so that no
+wrapping is needed at evaluation time.
+
+Optionally the coefficients are kept in single precision; the sums are
+always done in double precision.  The coefficients are allocated from a
+Shared_tables, so with -share_tables only one process per node fills
+them; the owner must call its sync() once all columns are set.
+*/
+class Bspline_3d {
+public:
+  Bspline_3d() { width=stride=0; single=0; }
+
+  /*!
+    Set up for width columns on an npoints grid.
+   */
+  void init(const Array1 <int> & npoints, int width_, int single_precision,
+            Shared_tables & shared);
+
+  /*!
+    Set column col from its values on the grid, ordered with z fastest
+    (data[(i*n(1)+j)*n(2)+k]).
+   */
+  void setValues(int col, const doublevar * data);
+
+  //! The interpolation coefficients of column col, in the order of setValues().
+  void getCoefficients(int col, doublevar * coeff);
+  void setCoefficients(int col, const doublevar * coeff);
+
+  int ncols() { return width; }
+  int ncoeff() { return n(0)*n(1)*n(2); }
+  int singlePrecision() { return single; }
+
+  //! Values at u (fractional coordinates): vals(col)
+  void val(const doublevar * u, doublevar * vals);
+
+  /*!
+    Value, gradient, and Laplacian of every column.  The gradient and
+    Laplacian are with respect to r, where \f$u_d=\sum_a r_a L_{ad}\f$
+    (L is the inverse of the lattice vectors).  out is (5, width):
+    value, x, y, z, Laplacian.
+   */
+  void vgl(const doublevar * u, const Array2 <doublevar> & L, doublevar * out);
+
+  /*!
+    Value, gradient, and Hessian with respect to r.  out is (10,width):
+    value, x,y,z, xx,yy,zz, xy,xz,yz.
+   */
+  void vgh(const doublevar * u, const Array2 <doublevar> & L, doublevar * out);
+
+private:
+  void locate(const doublevar * u, int * offset, doublevar a[3][4],
+              doublevar da[3][4], doublevar d2a[3][4]);
+  void accumulate(const int * offset, int nq, const doublevar * w, doublevar * out);
+  template <class S> void accumulate_rows(const S * c, const int * offset,
+                                          int nq, const doublevar * w,
+                                          doublevar * out);
+  void fillPadding(int col, const Array3 <doublevar> & coeff);
+  int pointOffset(int px, int py, int pz) {
+    return ((px*(n(1)+3)+py)*(n(2)+3)+pz)*stride;
+  }
+
+  Array1 <int> n;
+  int width;
+  int stride; //!< width rounded up for alignment
+  int single;
+  Array1 <doublevar> coef;   //!< padded coefficients (double precision)
+  Array1 <float> coef_single; //!< padded coefficients (SINGLE_PRECISION)
+};
+
+#endif //BSPLINE_3D_H_INCLUDED
+//----------------------------------------------------------------------
@@ -23,6 +23,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Basis_function.h"
 #include "CBasis_function.h"
 #include "Sample_point.h"
+#include <algorithm>
 
 //----------------------------------------------------------------------
 
@@ -89,6 +90,7 @@ void Center_set::read(vector <string> & words, unsigned int pos,
 
   if(usingsampcenters) {
     sys->getEquivalentCenters(equiv_centers, ncenters_atom, centers_displacement);
+    if(!sys->getCenterPos(position)) position.Resize(0,0);
   }
   else {
     equiv_centers.Resize(ncenters,1);
@@ -102,13 +104,36 @@ void Center_set::read(vector <string> & words, unsigned int pos,
   }
 
 
-  edist.Resize(nelectrons,ncenters, 5);
+  edist.Resize(qmc_max_threads());
+  for(int t=0; t< edist.GetDim(0); t++)
+    edist(t).Resize(nelectrons,ncenters, 5);
   nbasis.Resize(ncenters);
   nbasis=0;
 }
 
 //------------------------------------------------------------
 
+void Center_set::setKpoint(const Array1 <doublevar> & kpoint) {
+  int ndim=centers_displacement.GetDim(1);
+  assert(kpoint.GetDim(0) >= ndim);
+  if(kpoint_phase.GetDim(0)==ncenters && phase_kpoint.GetDim(0)==ndim) {
+    int same=1;
+    for(int d=0; d< ndim; d++)
+      if(phase_kpoint(d)!=kpoint(d)) same=0;
+    if(same) return;
+  }
+  phase_kpoint.Resize(ndim);
+  for(int d=0; d< ndim; d++) phase_kpoint(d)=kpoint(d);
+  kpoint_phase.Resize(ncenters);
+  for(int cen=0; cen< ncenters; cen++) {
+    doublevar dot=0;
+    for(int d=0; d< ndim; d++) dot+=centers_displacement(cen,d)*kpoint(d);
+    kpoint_phase(cen)=dcomplex(cos(dot*pi), sin(dot*pi));
+  }
+}
+
+//------------------------------------------------------------
+
 void Center_set::assignBasis(Array1 <Basis_function *> basisfunc)
 {
   int totbasis=basisfunc.GetDim(0);
@@ -166,33 +191,129 @@ void Center_set::assignBasis(Array1 <CBasis_function *> basisfunc)
 }
 
 
+//------------------------------------------------------------
+
+/*!
+The cells are at least as large as the largest range, so the centers
+within range of a point are in its cell or the neighboring ones.  The
+grid covers the centers only; for periodic systems the centers include
+the images of the atoms around the simulation cell, so no wrapping is
+needed.
+*/
+void Center_set::buildCellList(const Array1 <doublevar> & range_) {
+  assert(range_.GetDim(0)==ncenters);
+  use_cells=0;
+  if(usingatoms || position.GetDim(0)!=ncenters || ncenters==0) return;
+  range=range_;
+  doublevar maxrange=0;
+  for(int c=0; c< ncenters; c++)
+    if(range(c) > maxrange) maxrange=range(c);
+  if(maxrange <= 0) return;
+
+  //keep the grid reasonable for widely spread centers
+  const int max_cells=64;
+  cell_origin.Resize(3);
+  cell_size.Resize(3);
+  ncells.Resize(3);
+  for(int d=0; d< 3; d++) {
+    doublevar lo=position(0,d), hi=position(0,d);
+    for(int c=1; c< ncenters; c++) {
+      lo=min(lo, position(c,d));
+      hi=max(hi, position(c,d));
+    }
+    cell_origin(d)=lo;
+    ncells(d)=max(1, min(max_cells, int((hi-lo)/maxrange)));
+    cell_size(d)=max(maxrange, (hi-lo)/ncells(d));
+  }
+
+  int ntot=ncells(0)*ncells(1)*ncells(2);
+  Array1 <int> center_cell(ncenters);
+  cell_start.Resize(ntot+1);
+  cell_start=0;
+  for(int c=0; c< ncenters; c++) {
+    int cell=0;
+    for(int d=0; d< 3; d++) {
+      int i=int((position(c,d)-cell_origin(d))/cell_size(d));
+      cell=cell*ncells(d)+min(i, ncells(d)-1);
+    }
+    center_cell(c)=cell;
+    cell_start(cell+1)++;
+  }
+  for(int cell=0; cell< ntot; cell++) cell_start(cell+1)+=cell_start(cell);
+  //fill in increasing order of center within each cell
+  Array1 <int> fill(ntot);
+  for(int cell=0; cell< ntot; cell++) fill(cell)=cell_start(cell);
+  cell_centers.Resize(ncenters);
+  for(int c=0; c< ncenters; c++)
+    cell_centers(fill(center_cell(c))++)=c;
+
+  int nelectrons=edist(0).GetDim(0);
+  near_list.Resize(qmc_max_threads());
+  near_count.Resize(qmc_max_threads());
+  for(int t=0; t< near_list.GetDim(0); t++) {
+    near_list(t).Resize(nelectrons, ncenters);
+    near_count(t).Resize(nelectrons);
+    near_count(t)=0;
+  }
+  use_cells=1;
+}
+
 //------------------------------------------------------------
 
 void Center_set::updateDistance(int e, Sample_point * sample)
 {
-  if(usingatoms)
-  {
-    Array1 <doublevar> R(5);
-    sample->updateEIDist();
-    for(int i=0; i< ncenters; i++ )
-    {
-      sample->getEIDist(e, i, R);
-      for(int d=0; d< 5; d++)
-      {
-        edist(e,i,d)=R(d);
+  Array3 <doublevar> & dist=edist(qmc_thread_num());
+  if(use_cells) {
+    Array1 <doublevar> r(3);
+    sample->getElectronPos(e, r);
+    int lo[3], hi[3];
+    for(int d=0; d< 3; d++) {
+      doublevar x=(r(d)-cell_origin(d))/cell_size(d);
+      x=max(-2.0, min(x, ncells(d)+1.0));
+      int i=int(floor(x));
+      lo[d]=max(i-1, 0);
+      hi[d]=min(i+1, ncells(d)-1);
+    }
+    int * near=&near_list(qmc_thread_num())(e,0);
+    int nn=0;
+    for(int i=lo[0]; i<= hi[0]; i++) {
+      for(int j=lo[1]; j<= hi[1]; j++) {
+        for(int k=lo[2]; k<= hi[2]; k++) {
+          int cell=(i*ncells(1)+j)*ncells(2)+k;
+          for(int m=cell_start(cell); m< cell_start(cell+1); m++) {
+            int c=cell_centers(m);
+            dist(e,c,1)=0;
+            for(int d=0; d< 3; d++) {
+              dist(e,c,d+2)=r(d)-position(c,d);
+              dist(e,c,1)+=dist(e,c,d+2)*dist(e,c,d+2);
+            }
+            dist(e,c,0)=sqrt(dist(e,c,1));
+            if(dist(e,c,0) < range(c)) near[nn++]=c;
+          }
+        }
       }
     }
+    std::sort(near, near+nn);
+    near_count(qmc_thread_num())(e)=nn;
   }
-  else if(usingsampcenters) {
-    Array1 <doublevar> R(5);
-    sample->updateECDist();
+  else if(usingatoms || usingsampcenters)
+  {
+    Distance_row row;
+    if(usingatoms) {
+      sample->updateEIDist();
+      sample->getEIRow(e, row);
+    }
+    else {
+      sample->updateECDist();
+      sample->getECRow(e, row);
+    }
     for(int i=0; i< ncenters; i++ )
     {
-      sample->getECDist(e, i, R);
-      for(int d=0; d< 5; d++)
-      {
-        edist(e,i,d)=R(d);
-      }
+      dist(e,i,0)=row.r[i];
+      dist(e,i,1)=row.r2[i];
+      dist(e,i,2)=row.dx[i];
+      dist(e,i,3)=row.dy[i];
+      dist(e,i,4)=row.dz[i];
     }
   }
   else
@@ -201,17 +322,17 @@ void Center_set::updateDistance(int e, Sample_point * sample)
     sample->getElectronPos(e, r);
     for(int i=0; i< ncenters; i++)
     {
-      edist(e,i,1)=0;
+      dist(e,i,1)=0;
       for(int d=0; d< 3; d++)
       {
-        edist(e,i,d+2)=r(d)-position(i,d);
-	//cout << "positions " << position(i,d) << " dist " << edist(e,i,d+2) <<  endl;
-        edist(e,i,1)+=edist(e,i,d+2)*edist(e,i,d+2);
+        dist(e,i,d+2)=r(d)-position(i,d);
+	//cout << "positions " << position(i,d) << " dist " << dist(e,i,d+2) <<  endl;
+        dist(e,i,1)+=dist(e,i,d+2)*dist(e,i,d+2);
       }
     }
     for(int i=0; i< ncenters; i++)
     {
-      edist(e,i,0)=sqrt(edist(e,i,1));
+      dist(e,i,0)=sqrt(dist(e,i,1));
     }
 
   }
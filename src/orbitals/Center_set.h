@@ -59,7 +59,7 @@ public:
   //!< Number of basis functions on each particle
 
   Center_set()
-  { usingatoms=0;}
+  { usingatoms=0; use_cells=0; }
 
   void read(vector <string> & words, unsigned int pos,
             System * sys);
@@ -70,16 +70,49 @@ public:
   void getDistance(const int e, const int cent,
                    Array1 <doublevar> & distance)
   {
-    assert(e< edist.GetDim(0));
+    Array3 <doublevar> & ed=edist(qmc_thread_num());
+    assert(e< ed.GetDim(0));
     assert(cent < ncenters);
     assert(distance.GetDim(0) >=5);
     for(int d=0; d< 5; d++)
     {
-      distance(d)=edist(e,cent,d);
+      distance(d)=ed(e,cent,d);
     }
   }
 
 
+  /*!
+    Screen the centers with a cell list.  After updateDistance(e,..),
+    nnear(e) and nearCenter(e,k) list, in increasing order, only the
+    centers that are closer to electron e than range(center), and only
+    their distances are updated.  This needs the positions of the
+    centers, so it works with READ and with USEGLOBAL on periodic
+    systems, whose images of the atoms are separate centers; otherwise
+    every center is listed.  The centers must not move afterwards.
+  */
+  void buildCellList(const Array1 <doublevar> & range);
+
+  int nnear(const int e) {
+    if(!use_cells) return ncenters;
+    return near_count(qmc_thread_num())(e);
+  }
+  int nearCenter(const int e, const int k) {
+    if(!use_cells) return k;
+    return near_list(qmc_thread_num())(e,k);
+  }
+
+  /*!
+    Set the k-point of the orbitals, in the units of System::kpoint().
+    The phases of the centers are computed here, and again only if the
+    k-point changes.
+  */
+  void setKpoint(const Array1 <doublevar> & kpoint);
+
+  //! \f$ e^{i\pi k \cdot d} \f$ for the displacement d of center cen
+  dcomplex kpointPhase(const int cen) {
+    return kpoint_phase(cen);
+  }
+
   void writeinput(string &, ostream & );
 
   void Resize(int mdim, int mpar)
@@ -128,7 +161,20 @@ private:
   int usingatoms;
   int usingsampcenters;
   Array2 <doublevar> position;
-  Array3 <doublevar> edist;
+  Array1 < Array3 <doublevar> > edist; //!< (thread)(e,center,[r,r^2,x,y,z])
+  Array1 <doublevar> phase_kpoint; //!< the k-point of kpoint_phase
+  Array1 <dcomplex> kpoint_phase; //!< phase of each center at phase_kpoint
+
+  //Cell list; see buildCellList()
+  int use_cells;
+  Array1 <doublevar> range; //!< screening distance of each center
+  Array1 <doublevar> cell_origin; //!< corner of the cell grid
+  Array1 <doublevar> cell_size;
+  Array1 <int> ncells; //!< number of cells in each direction
+  Array1 <int> cell_start; //!< centers in cell c are cell_centers(cell_start(c)..cell_start(c+1)-1)
+  Array1 <int> cell_centers;
+  Array1 < Array2 <int> > near_list; //!< (thread)(e, k) centers within range
+  Array1 < Array1 <int> > near_count; //!< (thread)(e)
   
   vector <string> labels;
 
@@ -26,48 +26,61 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "qmc_io.h"
 #include "MO_1d.h"
 #include "MO_matrix_blas.h"
+#include "MO_matrix_block.h"
 #include "MO_matrix_basfunc.h"
 #include "MO_matrix_Cbasfunc.h"
-#include "MO_matrix_einspline.h"
+#include "MO_matrix_bspline.h"
 #include <algorithm>
 
 int allocate(vector <string> & words, System * sys, MO_matrix *& moptr) {
   assert(moptr==NULL);
 
-  if(caseless_eq(words[0],"CUTOFF_MO"))
-    moptr=new MO_matrix_cutoff<doublevar>;
+  unsigned int pos=0;
+  int single_precision=haskeyword(words,pos,"SINGLE_PRECISION");
+  if(caseless_eq(words[0],"CUTOFF_MO")) { 
+    if(single_precision) moptr=new MO_matrix_cutoff<doublevar,float>;
+    else moptr=new MO_matrix_cutoff<doublevar>;
+  }
   else if(caseless_eq(words[0],"STANDARD_MO"))
     moptr=new MO_matrix_standard;
   else if(caseless_eq(words[0],"BLAS_MO"))
     moptr=new MO_matrix_blas;
+  else if(caseless_eq(words[0],"BLOCK_MO"))
+    moptr=new MO_matrix_block;
   else if(caseless_eq(words[0],"BASFUNC_MO"))
     moptr=new MO_matrix_basfunc;
-  else if(caseless_eq(words[0],"EINSPLINE_MO"))
-    moptr=new MO_matrix_einspline<doublevar>;
+  else if(caseless_eq(words[0],"BSPLINE_MO") 
+          || caseless_eq(words[0],"EINSPLINE_MO"))
+    moptr=new MO_matrix_bspline<doublevar>;
   
   else {
     error("Didn't  understand ",words[0]);
   }
 
-  unsigned int pos=0;
+  pos=0;
   moptr->read(words,pos, sys);
   return 1;
 }
 
 int allocate(vector <string> & words, System * sys, 
              Complex_MO_matrix *& moptr) {
+  unsigned int pos=0;
+  int single_precision=haskeyword(words,pos,"SINGLE_PRECISION");
   if(caseless_eq(words[0],"MO_1D"))
     moptr=new MO_1d;
   else if(caseless_eq(words[0],"CBASFUNC_MO"))
     moptr=new MO_matrix_Cbasfunc;
-  else if(caseless_eq(words[0],"CUTOFF_MO"))
-    moptr=new MO_matrix_cutoff<dcomplex>;
-  else if(caseless_eq(words[0],"EINSPLINE_MO"))
-    moptr=new MO_matrix_einspline<dcomplex>;
+  else if(caseless_eq(words[0],"CUTOFF_MO")) { 
+    if(single_precision) moptr=new MO_matrix_cutoff<dcomplex, complex<float> >;
+    else moptr=new MO_matrix_cutoff<dcomplex>;
+  }
+  else if(caseless_eq(words[0],"BSPLINE_MO") 
+          || caseless_eq(words[0],"EINSPLINE_MO"))
+    moptr=new MO_matrix_bspline<dcomplex>;
   else 
     error("Unknown complex MO: ", words[0]);
 
-  unsigned int pos=0;
+  pos=0;
   moptr->read(words, pos, sys);
   return 1;
 }
@@ -25,6 +25,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Qmc_std.h"
 #include "Basis_function.h"
 #include "Center_set.h"
+#include "Shared_tables.h"
 #include <algorithm> 
 
 class System;
@@ -70,6 +71,9 @@ protected:
   string oldsofile;
 
   Array1 <doublevar> kpoint; //!< the k-point of the orbitals in fractional units(1 0 0) is X, etc..
+
+  //! Node-shared storage for the coefficient tables (with -share_tables)
+  Shared_tables shared_tables;
 public:
 
   /*!
@@ -154,6 +158,30 @@ public:
     error("this MO_matrix doesn't support Hessians");
   }
 
+  /*!
+    For localized orbitals: the orbitals (places in the list) that can be
+    nonzero at the position of the last updateVal(), updateLap(), or 
+    updateHessian() on this thread.  All the others were exactly zero.
+    Returns how many there are, or -1 if any orbital can be nonzero.
+   */
+  virtual int nonzeroOrbitals(Array1 <int> & nonzero) { 
+    return -1;
+  }
+
+  /*!
+    updateLap() for electron e of each of a crowd of walkers, into 
+    *newvals(w).  The default does them one at a time; implementations
+    can instead contract the basis values of all the walkers with the
+    coefficients at once, as a matrix-matrix product.
+   */
+  virtual void updateLapCrowd(Array1 <Sample_point *> & samples,
+                              int e,
+                              int listnum,
+                              Array1 <Array2 <T> *> & newvals) { 
+    for(int w=0; w< samples.GetDim(0); w++) 
+      updateLap(samples(w), e, listnum, *newvals(w));
+  }
+
   Templated_MO_matrix()
   {}
 
@@ -208,15 +236,22 @@ inline void overloaded_broadcast(Array1 <dcomplex> & v) {
 }
 #endif
 
+/*!
+  Read the orbital file on node 0 and broadcast it to the group.  With
+  broadcast=0 the calling process reads the file itself and nothing is
+  communicated; the MO matrices do that on the writer of their
+  Shared_tables, so the other processes never hold the coefficients.
+*/
 template <class T> int readorb(istream & input, Center_set & centers, 
                                   int nmo, int maxbasis, Array1 <doublevar> & kpoint,
-                                  Array3 <int> & coeffmat, Array1 <T> & coeff) {
+                                  Array3 <int> & coeffmat, Array1 <T> & coeff,
+                                  int broadcast=1) {
   int nmo_read=0;
   int maxlabel=0; 
   coeffmat.clear(); //important to do this so that we know exactly how big the array v will be
                     //This enables us to use relatively fast Bcast() operations.
   coeff.clear();
-  if(mpi_info.node==0) { 
+  if(!broadcast || mpi_info.node==0) { 
     string dummy;
     vector <int> mo,center,basis,label;
     while(true) { 
@@ -274,6 +309,7 @@ template <class T> int readorb(istream & input, Center_set & centers,
     }
   }
 #ifdef USE_MPI
+  if(!broadcast) return nmo_read;
   MPI_Bcast(&nmo_read,1,MPI_INT,0,MPI_Comm_grp);
   MPI_Bcast(&maxlabel,1,MPI_INT,0,MPI_Comm_grp);
   int coeffmatsize;
@@ -304,6 +340,20 @@ template <> inline  dcomplex eval_kpoint_fac<dcomplex>(doublevar & dot) {
   return exp(dcomplex(0.0,1.0)*dot*pi);
 }
 
+//The same, from the phases that Center_set keeps for its centers
+template <class T> inline T center_kpoint_fac(Center_set & centers, int cen) {
+  error("Not a general class.");
+}
+
+template <> inline doublevar center_kpoint_fac<doublevar>(Center_set & centers,
+                                                          int cen) {
+  return real(centers.kpointPhase(cen));
+}
+template <> inline dcomplex center_kpoint_fac<dcomplex>(Center_set & centers,
+                                                        int cen) {
+  return centers.kpointPhase(cen);
+}
+
 template <class T> inline void eval_kpoint_deriv(Array1 <doublevar> & kpoint,
     doublevar kr,
     T & val, Array1 <T> & grad, Array2 <T> & hess)  { 
@@ -399,6 +449,7 @@ template<class T> inline void Templated_MO_matrix<T>::read(vector <string> & wor
 
   unsigned int newpos=0;
   centers.read(centertext, newpos, sys);
+  centers.setKpoint(kpoint);
   centers.assignBasis(basis);
 
   //cout << "number of centers " << centers.size() << endl;
@@ -29,8 +29,6 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 void MO_matrix_Cbasfunc::init() {
 
-  const dcomplex I(0.0,1.0);
-  
   single_write(cout, "Basis function MO (complex)\n");
   
   //Determine where to cut off the basis functions
@@ -114,12 +112,8 @@ void MO_matrix_Cbasfunc::init() {
     for(int c=0; c < centers.ncenters_atom(ion); c++) {
       int cen2=centers.equiv_centers(ion, c);
       
-      doublevar dot=0;
-      for(int d=0; d<3; d++) 
-	dot+=centers.centers_displacement(cen2,d)*kpoint(d);
-
-      //kptfac(cen2)=cos(dot*pi);
-      kptfac(cen2)=exp(I*dot*pi);
+      kptfac(cen2)=magnification_factor
+        *center_kpoint_fac<dcomplex>(centers, cen2);
 
       ao=0; //# of basis func on each center
       for(int n=0; n < centers.nbasis(cen2); n++) {
@@ -136,15 +130,15 @@ void MO_matrix_Cbasfunc::init() {
     }
   }
 
-  // for(int ion=0;ion<centermax;ion++)
-  //cout << "kptfac " <<  kptfac(ion) << "  displacement " 
-  // << centers.centers_displacement(ion,0) << "   "
-  // << endl;            
-
-
-
   // cout << "orb file processing finished.\n";
 
+  int nthread=qmc_max_threads();
+  thread_basisvals.Resize(nthread);
+  thread_basisvals1d.Resize(nthread);
+  for(int t=0; t< nthread; t++) {
+    thread_basisvals(t).Resize(totbasis,5);
+    thread_basisvals1d(t).Resize(totbasis);
+  }
 }
 
 
@@ -153,13 +147,45 @@ void MO_matrix_Cbasfunc::init() {
 
 void MO_matrix_Cbasfunc::buildLists(Array1 < Array1 <int> > & occupations) {
   int numlists=occupations.GetDim(0);
+  int centermax=centers.size();
   moLists.Resize(numlists);
+  center_start.Resize(numlists);
+  entry_mo.Resize(numlists);
+  entry_func.Resize(numlists);
   for(int lis=0; lis < numlists; lis++) {
     int nmo_list=occupations(lis).GetDim(0);
     moLists(lis).Resize(nmo_list);
     for(int mo=0; mo < nmo_list; mo++) {
       moLists(lis)(mo)=occupations(lis)(mo);
     }
+
+    //Each orbital is a function on the images of one atom, so it
+    //has an entry on each of those centers
+    center_start(lis).Resize(centermax+1);
+    center_start(lis)=0;
+    for(int m=0; m < nmo_list; m++) {
+      int mo=moLists(lis)(m);
+      for(int cen2=0; cen2 < centermax; cen2++)
+        if(basisMO(mo,cen2) > -1) center_start(lis)(cen2+1)++;
+    }
+    for(int cen2=0; cen2 < centermax; cen2++)
+      center_start(lis)(cen2+1)+=center_start(lis)(cen2);
+    int nentries=center_start(lis)(centermax);
+    entry_mo(lis).Resize(max(nentries,1));
+    entry_func(lis).Resize(max(nentries,1));
+    Array1 <int> fill(centermax);
+    for(int cen2=0; cen2 < centermax; cen2++)
+      fill(cen2)=center_start(lis)(cen2);
+    for(int m=0; m < nmo_list; m++) {
+      int mo=moLists(lis)(m);
+      for(int cen2=0; cen2 < centermax; cen2++) {
+        if(basisMO(mo,cen2) > -1) {
+          entry_mo(lis)(fill(cen2))=m;
+          entry_func(lis)(fill(cen2))=basisMO(mo,cen2);
+          fill(cen2)++;
+        }
+      }
+    }
   }
 }
 
@@ -274,6 +300,7 @@ void MO_matrix_Cbasfunc::read(vector <string> & words,
 
   unsigned int newpos=0;
   centers.read(centertext, newpos, sys);
+  centers.setKpoint(kpoint);
   centers.assignBasis(basis);
 
   //cout << "number of centers " << centers.size() << endl;
@@ -307,60 +334,67 @@ void MO_matrix_Cbasfunc::read(vector <string> & words,
 
 //------------------------------------------------------------------------
 
-void MO_matrix_Cbasfunc::updateVal(Sample_point * sample, int e,
-                                   int listnum,
-                                   //!< which list to use
-                                   Array2 <dcomplex> & newvals
-                                   //!< The return: in form (MO, val)
-) {
-
-  Array1 <dcomplex> basisvals(totbasis);
+/*!
+  Evaluate the basis functions of each center in range, then add them
+  to the orbitals that are made of them, each times the phase kptfac of
+  its center: ncol=1 for values and 5 for the Laplacian.
+*/
+void MO_matrix_Cbasfunc::update(Sample_point * sample, int e, int listnum,
+                                int ncol, Array2 <dcomplex> & newvals) {
+  assert(newvals.GetDim(1) >= ncol);
+  int thread=qmc_thread_num();
+  Array2 <dcomplex> & basisvals(thread_basisvals(thread));
+  Array1 <dcomplex> & basisvals1d(thread_basisvals1d(thread));
   centers.updateDistance(e, sample);
   CBasis_function * tempbasis;
   Array1 <doublevar> R(5);
   int currfunc=0;
   newvals=0;
-  // some problem with Array.h and this shorthand, going back to
-  // explicit loop
-  //basisvals=0;
-  for(int i=0; i<totbasis; i++) basisvals(i)=0;
-  int nmo_list=moLists(listnum).GetDim(0);
 
-  // store values of basis functions on all centers in basisvals;
-  // ---
+  const int * start=center_start(listnum).v;
+  const int * emo=entry_mo(listnum).v;
+  const int * efunc=entry_func(listnum).v;
+
   // don't be fooled, centers.nbasis(ion) is NOT a number of
   // individual basis functions on an ion, it is something like
   // a number of sets of functions, correspondingly, the
   // tempbasis->nfunc() returns number of ALL "planewaves" on the
   // ion, for instance;
-  // ---
-  // it might happen that I do not need all basis functions, e.g.
-  // spin-ups use some and spin-downs use some others, 
-  // calcVal calculates them all, however
- 
   for(int ion=0; ion < centers.equiv_centers.GetDim(0); ion++) {
     for(int c=0; c < centers.ncenters_atom(ion); c++) {
       int cen2=centers.equiv_centers(ion, c);
       centers.getDistance(e, cen2, R);
+      int inrange=0;
       for(int n=0; n < centers.nbasis(cen2); n++) {
-	int b=centers.basis(cen2,n);
-	tempbasis=basis(b);
-	if(R(0) <obj_cutoff(b)) {
-	  tempbasis->calcVal(R, basisvals, currfunc);
-	  currfunc+=tempbasis->nfunc();
-	  for(int m=0; m < nmo_list; m++) {
-	    int mo=moLists(listnum)(m);
-	    if(eq_centers(mo)==ion){
-	       int basfunc=basisMO(mo,cen2);
-	       assert(basfunc<currfunc+1);
-	       if(R(0) < cutoff(basfunc)){
-		 newvals(m,0)+=magnification_factor*basisvals(basfunc)*kptfac(cen2);
-	       }
-	    }
-	  }
-	}
-	else 
-	  currfunc+=tempbasis->nfunc();
+        int b=centers.basis(cen2,n);
+        tempbasis=basis(b);
+        if(R(0) < obj_cutoff(b)) {
+          if(ncol==1) tempbasis->calcVal(R, basisvals1d, currfunc);
+          else tempbasis->calcLap(R, basisvals, currfunc);
+          inrange=1;
+        }
+        currfunc+=tempbasis->nfunc();
+      }
+      if(!inrange) continue;
+
+      //functions beyond their cutoff were not evaluated
+      const dcomplex fac=kptfac(cen2);
+      if(ncol==1) {
+        for(int k=start[cen2]; k < start[cen2+1]; k++) {
+          int f=efunc[k];
+          if(R(0) < cutoff(f))
+            newvals(emo[k],0)+=fac*basisvals1d(f);
+        }
+      }
+      else {
+        for(int k=start[cen2]; k < start[cen2+1]; k++) {
+          int f=efunc[k];
+          if(R(0) < cutoff(f)) {
+            dcomplex * out=newvals.v+emo[k]*newvals.GetDim(1);
+            const dcomplex * in=basisvals.v+f*basisvals.GetDim(1);
+            for(int d=0; d < ncol; d++) out[d]+=fac*in[d];
+          }
+        }
       }
     }
   }
@@ -368,6 +402,17 @@ void MO_matrix_Cbasfunc::updateVal(Sample_point * sample, int e,
 
 //------------------------------------------------------------------------
 
+void MO_matrix_Cbasfunc::updateVal(Sample_point * sample, int e,
+                                   int listnum,
+                                   //!< which list to use
+                                   Array2 <dcomplex> & newvals
+                                   //!< The return: in form (MO, val)
+) {
+  update(sample, e, listnum, 1, newvals);
+}
+
+//------------------------------------------------------------------------
+
 
 void MO_matrix_Cbasfunc::updateLap(Sample_point * sample, int e,
 				  int listnum,
@@ -375,57 +420,7 @@ void MO_matrix_Cbasfunc::updateLap(Sample_point * sample, int e,
 				  Array2 <dcomplex> & newvals
 				  //!< The return: in form (MO, [val, grad, lap])
 ) {
-  // exactly the same structure as updateVal above, only assigns
-  // 5 values (function, 3 gradient components, laplacian) instead
-  // of just one
-  Array2 <dcomplex> basisvals(totbasis,5);
-  centers.updateDistance(e, sample);
-  CBasis_function * tempbasis;
-  Array1 <doublevar> R(5);
-  int currfunc=0;
-  newvals=0;
-  basisvals=0;
-  int nmo_list=moLists(listnum).GetDim(0);
-
-  for(int ion=0; ion < centers.equiv_centers.GetDim(0); ion++) {
-    for(int c=0; c < centers.ncenters_atom(ion); c++) {
-      int cen2=centers.equiv_centers(ion, c);
-      centers.getDistance(e, cen2, R);
-      for(int n=0; n < centers.nbasis(cen2); n++) {
-	int b=centers.basis(cen2,n);
-	tempbasis=basis(b);
-	if(R(0)< obj_cutoff(b)) {
-	  tempbasis->calcLap(R, basisvals, currfunc);
-	  currfunc+=tempbasis->nfunc();
-	  
-	  //test of basis laplacian
-	  //cout << "MO_matrix_Cbasfunc::updateLap" << endl;
-	  //for (int i=0; i<totbasis; i++) {
-	  //  cout << -0.5*basisvals(i,4)/basisvals(i,0) << endl;
-	  //}
-
-	  for(int m=0; m < nmo_list; m++) {
-	    int mo=moLists(listnum)(m);
-	    if(eq_centers(mo)==ion){
-	      int basfunc=basisMO(mo,cen2);
-	      assert(basfunc<currfunc+1);
-	      if(R(0) < cutoff(basfunc)){
-		for (int d=0; d < 5; d++) {
-		  newvals(m,d)+=magnification_factor*basisvals(basfunc,d)*kptfac(cen2);
-		}
-	      }
-	    }
-	  
-	    //cout << -0.5*newvals(m,4)/newvals(m,0) << endl;
-	  
-	  }	  
-	}
-	else{
-	  currfunc+=tempbasis->nfunc();
-	}
-      }
-    }
-  }
+  update(sample, e, listnum, 5, newvals);
 }
 
 //--------------------------------------------------------------------------
@@ -68,8 +68,19 @@ private:
   /*!< \brief
     phase factor multiplying basis functions associated with
     a given center, N.B. equivalent centers differ by integer
-    multiple of a lattice vector
+    multiple of a lattice vector; includes the MAGNIFY factor
   */
+  Array1 < Array1 <int> > center_start, entry_mo, entry_func;
+  /*!< \brief
+    for each list, the orbitals that are functions on center cen2 are
+    entry_mo (place in the list) and entry_func (basis function) from
+    center_start(cen2) to center_start(cen2+1)-1
+  */
+  Array1 < Array2 <dcomplex> > thread_basisvals; //!< scratch for each thread
+  Array1 < Array1 <dcomplex> > thread_basisvals1d;
+
+  void update(Sample_point * sample, int e, int listnum, int ncol,
+              Array2 <dcomplex> & newvals);
   
   Array1 <doublevar> obj_cutoff; //!< cutoff for each basis object
   Array1 <doublevar> cutoff;     //!< cutoff for individual basis functions
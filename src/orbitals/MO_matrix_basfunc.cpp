@@ -112,11 +112,8 @@ void MO_matrix_basfunc::init() {
     for(int c=0; c < centers.ncenters_atom(ion); c++) {
       int cen2=centers.equiv_centers(ion, c);
       
-      doublevar dot=0;
-      for(int d=0; d<3; d++) 
-	dot+=centers.centers_displacement(cen2,d)*kpoint(d);
-
-      kptfac(cen2)=cos(dot*pi);
+      kptfac(cen2)=magnification_factor
+        *center_kpoint_fac<doublevar>(centers, cen2);
 
       ao=0; //# of basis func on each center
       for(int n=0; n < centers.nbasis(cen2); n++) {
@@ -133,15 +130,15 @@ void MO_matrix_basfunc::init() {
     }
   }
 
-  // for(int ion=0;ion<centermax;ion++)
-  //cout << "kptfac " <<  kptfac(ion) << "  displacement " 
-  // << centers.centers_displacement(ion,0) << "   "
-  // << endl;            
-
-
-
   // cout << "orb file processing finished.\n";
 
+  int nthread=qmc_max_threads();
+  thread_basisvals.Resize(nthread);
+  thread_basisvals1d.Resize(nthread);
+  for(int t=0; t< nthread; t++) {
+    thread_basisvals(t).Resize(totbasis,10);
+    thread_basisvals1d(t).Resize(totbasis);
+  }
 }
 
 
@@ -150,13 +147,45 @@ void MO_matrix_basfunc::init() {
 
 void MO_matrix_basfunc::buildLists(Array1 < Array1 <int> > & occupations) {
   int numlists=occupations.GetDim(0);
+  int centermax=centers.size();
   moLists.Resize(numlists);
+  center_start.Resize(numlists);
+  entry_mo.Resize(numlists);
+  entry_func.Resize(numlists);
   for(int lis=0; lis < numlists; lis++) {
     int nmo_list=occupations(lis).GetDim(0);
     moLists(lis).Resize(nmo_list);
     for(int mo=0; mo < nmo_list; mo++) {
       moLists(lis)(mo)=occupations(lis)(mo);
     }
+
+    //Each orbital is a function on the images of one atom, so it
+    //has an entry on each of those centers
+    center_start(lis).Resize(centermax+1);
+    center_start(lis)=0;
+    for(int m=0; m < nmo_list; m++) {
+      int mo=moLists(lis)(m);
+      for(int cen2=0; cen2 < centermax; cen2++)
+        if(basisMO(mo,cen2) > -1) center_start(lis)(cen2+1)++;
+    }
+    for(int cen2=0; cen2 < centermax; cen2++)
+      center_start(lis)(cen2+1)+=center_start(lis)(cen2);
+    int nentries=center_start(lis)(centermax);
+    entry_mo(lis).Resize(max(nentries,1));
+    entry_func(lis).Resize(max(nentries,1));
+    Array1 <int> fill(centermax);
+    for(int cen2=0; cen2 < centermax; cen2++)
+      fill(cen2)=center_start(lis)(cen2);
+    for(int m=0; m < nmo_list; m++) {
+      int mo=moLists(lis)(m);
+      for(int cen2=0; cen2 < centermax; cen2++) {
+        if(basisMO(mo,cen2) > -1) {
+          entry_mo(lis)(fill(cen2))=m;
+          entry_func(lis)(fill(cen2))=basisMO(mo,cen2);
+          fill(cen2)++;
+        }
+      }
+    }
   }
 }
 
@@ -206,57 +235,69 @@ int MO_matrix_basfunc::writeinput(string & indent, ostream & os)
 
 //------------------------------------------------------------------------
 
-void MO_matrix_basfunc::updateVal(Sample_point * sample, int e,
-                                   int listnum,
-                                   //!< which list to use
-                                   Array2 <doublevar> & newvals
-                                   //!< The return: in form (MO, val)
-) {
-
-  Array1 <doublevar> basisvals(totbasis);
+/*!
+  Evaluate the basis functions of each center in range, then add them
+  to the orbitals that are made of them, each times kptfac of its
+  center: ncol=1 for values, 5 for the Laplacian, 10 for the Hessian.
+*/
+void MO_matrix_basfunc::update(Sample_point * sample, int e, int listnum,
+                               int ncol, Array2 <doublevar> & newvals) {
+  assert(e < sample->electronSize());
+  assert(newvals.GetDim(1) >= ncol);
+  int thread=qmc_thread_num();
+  Array2 <doublevar> & basisvals(thread_basisvals(thread));
+  Array1 <doublevar> & basisvals1d(thread_basisvals1d(thread));
   centers.updateDistance(e, sample);
   Basis_function * tempbasis;
   Array1 <doublevar> R(5);
   int currfunc=0;
   newvals=0;
-  basisvals=0;
-  int nmo_list=moLists(listnum).GetDim(0);
 
-  // store values of basis functions on all centers in basisvals;
-  // ---
+  const int * start=center_start(listnum).v;
+  const int * emo=entry_mo(listnum).v;
+  const int * efunc=entry_func(listnum).v;
+
   // don't be fooled, centers.nbasis(ion) is NOT a number of
   // individual basis functions on an ion, it is something like
   // a number of sets of functions, correspondingly, the
   // tempbasis->nfunc() returns number of ALL "planewaves" on the
   // ion, for instance;
-  // ---
-  // it might happen that I do not need all basis functions, e.g.
-  // spin-ups use some and spin-downs use some others, 
-  // calcVal calculates them all, however
- 
   for(int ion=0; ion < centers.equiv_centers.GetDim(0); ion++) {
     for(int c=0; c < centers.ncenters_atom(ion); c++) {
       int cen2=centers.equiv_centers(ion, c);
       centers.getDistance(e, cen2, R);
+      int inrange=0;
       for(int n=0; n < centers.nbasis(cen2); n++) {
-	int b=centers.basis(cen2,n);
-	tempbasis=basis(b);
-	if(R(0) <obj_cutoff(b)) {
-	  tempbasis->calcVal(R, basisvals, currfunc);
-	  currfunc+=tempbasis->nfunc();
-	  for(int m=0; m < nmo_list; m++) {
-	    int mo=moLists(listnum)(m);
-	    if(eq_centers(mo)==ion){
-	       int basfunc=basisMO(mo,cen2);
-	       assert(basfunc<currfunc+1);
-	       if(R(0) < cutoff(basfunc)){
-		 newvals(m,0)+=magnification_factor*basisvals(basfunc)*kptfac(cen2);
-	       }
-	    }
-	  }
-	}
-	else 
-	  currfunc+=tempbasis->nfunc();
+        int b=centers.basis(cen2,n);
+        tempbasis=basis(b);
+        if(R(0) < obj_cutoff(b)) {
+          if(ncol==1) tempbasis->calcVal(R, basisvals1d, currfunc);
+          else if(ncol==5) tempbasis->calcLap(R, basisvals, currfunc);
+          else tempbasis->calcHessian(R, basisvals, currfunc);
+          inrange=1;
+        }
+        currfunc+=tempbasis->nfunc();
+      }
+      if(!inrange) continue;
+
+      //functions beyond their cutoff were not evaluated
+      const doublevar fac=kptfac(cen2);
+      if(ncol==1) {
+        for(int k=start[cen2]; k < start[cen2+1]; k++) {
+          int f=efunc[k];
+          if(R(0) < cutoff(f))
+            newvals(emo[k],0)+=fac*basisvals1d(f);
+        }
+      }
+      else {
+        for(int k=start[cen2]; k < start[cen2+1]; k++) {
+          int f=efunc[k];
+          if(R(0) < cutoff(f)) {
+            doublevar * out=newvals.v+emo[k]*newvals.GetDim(1);
+            const doublevar * in=basisvals.v+f*basisvals.GetDim(1);
+            for(int d=0; d < ncol; d++) out[d]+=fac*in[d];
+          }
+        }
       }
     }
   }
@@ -264,6 +305,16 @@ void MO_matrix_basfunc::updateVal(Sample_point * sample, int e,
 
 //------------------------------------------------------------------------
 
+void MO_matrix_basfunc::updateVal(Sample_point * sample, int e,
+                                   int listnum,
+                                   //!< which list to use
+                                   Array2 <doublevar> & newvals
+                                   //!< The return: in form (MO, val)
+) {
+  update(sample, e, listnum, 1, newvals);
+}
+
+//------------------------------------------------------------------------
 
 void MO_matrix_basfunc::updateLap(Sample_point * sample, int e,
 				  int listnum,
@@ -271,104 +322,21 @@ void MO_matrix_basfunc::updateLap(Sample_point * sample, int e,
 				  Array2 <doublevar> & newvals
 				  //!< The return: in form (MO, [val, grad, lap])
 ) {
-  // exactly the same structure as updateVal above, only assigns
-  // 5 values (function, 3 gradient components, laplacian) instead
-  // of just one
-  Array2 <doublevar> basisvals(totbasis,5);
-  centers.updateDistance(e, sample);
-  Basis_function * tempbasis;
-  Array1 <doublevar> R(5);
-  int currfunc=0;
-  newvals=0;
-  basisvals=0;
-  int nmo_list=moLists(listnum).GetDim(0);
-
-  for(int ion=0; ion < centers.equiv_centers.GetDim(0); ion++) {
-    for(int c=0; c < centers.ncenters_atom(ion); c++) {
-      int cen2=centers.equiv_centers(ion, c);
-      centers.getDistance(e, cen2, R);
-      for(int n=0; n < centers.nbasis(cen2); n++) {
-	int b=centers.basis(cen2,n);
-	tempbasis=basis(b);
-	if(R(0)< obj_cutoff(b)) {
-	  tempbasis->calcLap(R, basisvals, currfunc);
-	  currfunc+=tempbasis->nfunc();
-	  
-	  for(int m=0; m < nmo_list; m++) {
-	    int mo=moLists(listnum)(m);
-	    if(eq_centers(mo)==ion){
-	      int basfunc=basisMO(mo,cen2);
-	      assert(basfunc<currfunc+1);
-	      if(R(0) < cutoff(basfunc)){
-		for (int d=0; d < 5; d++) {
-		  newvals(m,d)+=magnification_factor*basisvals(basfunc,d)*kptfac(cen2);
-		} 
-	      }
-	    }
-	  }
-	  
-	}
-	else{
-	  currfunc+=tempbasis->nfunc();
-	}
-      }
-    }
-  }
+  update(sample, e, listnum, 5, newvals);
 }
 
 //--------------------------------------------------------------------------
 
-
 void MO_matrix_basfunc::updateHessian(
   Sample_point * sample,
   int e,
   int listnum,
-  //const Array1 <int> & occupation,
   //!<A list of the MO's to evaluate
   Array2 <doublevar> & newvals
   //!< The return: in form (MO, [val, grad, dxx,dyy,...])
 )
 {
-
-  assert(e < sample->electronSize());
   assert(newvals.GetDim(1)==10);
-  // exactly the same structure as updateVal above, only assigns
-  // 5 values (function, 3 gradient components, laplacian) instead
-  // of just one
-  Array2 <doublevar> basisvals(totbasis,10);
-  centers.updateDistance(e, sample);
-  Basis_function * tempbasis;
-  Array1 <doublevar> R(5);
-  int currfunc=0;
-  newvals=0;
-  basisvals=0;
-  int nmo_list=moLists(listnum).GetDim(0);
-
-
-  for(int ion=0; ion < centers.equiv_centers.GetDim(0); ion++) {
-    for(int c=0; c < centers.ncenters_atom(ion); c++) {
-      int cen2=centers.equiv_centers(ion, c);
-      centers.getDistance(e, cen2, R);
-      for(int n=0; n < centers.nbasis(cen2); n++) {
-	int b=centers.basis(cen2,n);
-	tempbasis=basis(b);
-	if(R(0)< obj_cutoff(b)) {
-	  tempbasis->calcHessian(R, basisvals, currfunc);
-	}
-	currfunc+=tempbasis->nfunc();
-      }
-      for(int m=0; m < nmo_list; m++) {
-	int mo=moLists(listnum)(m);
-	if(eq_centers(mo)==ion){
-	  int basfunc=basisMO(mo,cen2);
-	  if(R(0) < cutoff(basfunc)){
-	    for (int d=0; d < 10; d++) {
-	      newvals(m,d)+=magnification_factor*basisvals(basfunc,d)*kptfac(cen2);
-	    }
-	  }
-	}
-      }
-    }
-  }
+  update(sample, e, listnum, 10, newvals);
 }
 //--------------------------------------------------------------------------
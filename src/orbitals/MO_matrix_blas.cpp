@@ -26,14 +26,21 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 struct MOBLAS_CalcObjVal { 
   doublevar * moplace;
+  float * moplace_single;
   doublevar sval;
 };
 
 struct MOBLAS_CalcObjLap { 
   doublevar * moplace;
+  float * moplace_single;
   doublevar sval[5];
 };
 
+//! y+=a*x with x in single precision; there is no mixed-precision BLAS call
+inline void axpy_single(int n, doublevar a, const float * x, doublevar * y) { 
+  for(int i=0; i< n; i++) y[i]+=a*x[i];
+}
+
 
 
 inline void output_array(Array2 <doublevar> & arr) {
@@ -88,57 +95,66 @@ void MO_matrix_blas::init() {
   for(int b=0; b< basis.GetDim(0); b++) {
     nfunctions(b)=basis(b)->nfunc();
   }
-  
 
-  moCoeff.Resize(totbasis, nmo);
+  //Only the centers within reach of one of their basis objects are visited
+  center_func.Resize(centers.size());
+  Array1 <doublevar> center_range(centers.size());
+  int nf=0;
+  for(int ion=0; ion< centers.size(); ion++) {
+    center_func(ion)=nf;
+    center_range(ion)=0;
+    for(int n=0; n< centers.nbasis(ion); n++) {
+      int b=centers.basis(ion,n);
+      center_range(ion)=max(center_range(ion), obj_cutoff(b));
+      nf+=nfunctions(b);
+    }
+  }
+  centers.buildCellList(center_range);
+  
 
+  //Only the writer reads the orbital file and fills the table; with
+  //-share_tables the other processes on the node never hold it
+  if(single_precision) shared_tables.allocate(moCoeff_single, totbasis, nmo);
+  else shared_tables.allocate(moCoeff, totbasis, nmo);
 
-  ifstream ORB(orbfile.c_str());
-  if(!ORB) error("couldn't find orb file ", orbfile);
+  if(Shared_tables::writer()) {
+    ifstream ORB(orbfile.c_str());
+    if(!ORB) error("couldn't find orb file ", orbfile);
 
-  Array3 <int> coeffmat;
-  Array1 <doublevar> coeff;
-  readorb(ORB,centers, nmo, maxbasis, kpoint,coeffmat, coeff);
-  string in;
-  ORB.close();
+    Array3 <int> coeffmat;
+    Array1 <doublevar> coeff;
+    readorb(ORB,centers, nmo, maxbasis, kpoint,coeffmat, coeff,
+            !Shared_tables::active());
+    ORB.close();
 
-  //Find the cutoffs
+    //Find the cutoffs
 
-  int totfunc=0;
+    int totfunc=0;
 
-  for(int ion=0; ion<centers.size(); ion++) {
-    int f=0;
-    doublevar dot=0;
-    for(int d=0; d<3; d++) dot+=centers.centers_displacement(ion,d)*kpoint(d);
-    
-    //cout << "kptfac " << cos(dot*pi) << "  displacement " 
-    //    << centers.centers_displacement(ion,0) << "   "
-    //    << endl;            
-    doublevar kptfac=cos(dot*pi);
+    for(int ion=0; ion<centers.size(); ion++) {
+      int f=0;
+      doublevar kptfac=center_kpoint_fac<doublevar>(centers, ion);
         
-    for(int n=0; n< centers.nbasis(ion); n++) {
-
-      int fnum=centers.basis(ion,n);
-      int imax=basis(fnum)->nfunc();
+      for(int n=0; n< centers.nbasis(ion); n++) {
 
-      for(int i=0; i<imax; i++){ 
-        for(int mo=0; mo<nmo; mo++) {	   
-
-          if(coeffmat(mo,ion, f) == -1) {
-            moCoeff(totfunc,mo)=0.0;
-            //cout << "missing MO pointer: mo# " << mo << " ion # " << ion
-            //<< " function on ion: " << f << endl;
-            //error("In the orb file, there is a missing pointer. It might "
-            //      "be a badly structured file.");
-          }
-          else moCoeff(totfunc, mo)=magnification_factor*kptfac*coeff(coeffmat(mo,ion,f));
-        }//mo
-        f++;  //keep a total of functions on center
-        totfunc++;
-      } //i
-    } //n
-  }  //ion
+        int fnum=centers.basis(ion,n);
+        int imax=basis(fnum)->nfunc();
 
+        for(int i=0; i<imax; i++){ 
+          for(int mo=0; mo<nmo; mo++) {	   
+            doublevar c=0.0;
+            if(coeffmat(mo,ion, f) != -1) 
+              c=magnification_factor*kptfac*coeff(coeffmat(mo,ion,f));
+            if(single_precision) moCoeff_single(totfunc,mo)=c;
+            else moCoeff(totfunc, mo)=c;
+          }//mo
+          f++;  //keep a total of functions on center
+          totfunc++;
+        } //i
+      } //n
+    }  //ion
+  }
+  shared_tables.sync();
 
   //output_array(moCoeff);
 
@@ -186,10 +202,34 @@ void MO_matrix_blas::writeorb(ostream & os, Array2 <doublevar> & rotation, Array
 void MO_matrix_blas::buildLists(Array1 < Array1 <int> > & occupations)
 {
   int numlists=occupations.GetDim(0);
+  //the lists from an earlier call may be views of shared memory
+  for(int lis=0; lis < moCoeff_list.GetDim(0); lis++) 
+    moCoeff_list(lis).clear();
+  for(int lis=0; lis < moCoeff_list_single.GetDim(0); lis++) 
+    moCoeff_list_single(lis).clear();
+  list_tables.clear();
+  //only the writer copies the coefficients of each list
+  const int fill=Shared_tables::writer();
+  if(single_precision) { 
+    moCoeff_list_single.Resize(numlists);
+    for(int lis=0; lis < numlists; lis++) {
+      int nmo_list=occupations(lis).GetDim(0);
+      list_tables.allocate(moCoeff_list_single(lis), totbasis, nmo_list);
+      if(!fill) continue;
+      for(int i=0; i < nmo_list; i++)  {
+        int mo=occupations(lis)(i);
+        for(int bas=0; bas < totbasis; bas++) 
+          moCoeff_list_single(lis)(bas,i)=moCoeff_single(bas,mo);
+      }
+    }
+    list_tables.sync();
+    return;
+  }
   moCoeff_list.Resize(numlists);
   for(int lis=0; lis < numlists; lis++) {
     int nmo_list=occupations(lis).GetDim(0);
-    moCoeff_list(lis).Resize(totbasis, nmo_list);
+    list_tables.allocate(moCoeff_list(lis), totbasis, nmo_list);
+    if(!fill) continue;
     for(int i=0; i < nmo_list; i++)  {
       int mo=occupations(lis)(i);
       for(int bas=0; bas < totbasis; bas++) {
@@ -197,6 +237,7 @@ void MO_matrix_blas::buildLists(Array1 < Array1 <int> > & occupations)
       }
     }
   }
+  list_tables.sync();
 }
 
 
@@ -206,6 +247,8 @@ int MO_matrix_blas::showinfo(ostream & os)
 {
   os << "Blas MO " << endl;
   os << "Number of molecular orbitals: " << nmo << endl;
+  if(single_precision) 
+    os << "Coefficients stored in single precision" << endl;
   string indent="  ";
   os << "Basis functions: \n";
   for(int i=0; i< basis.GetDim(0); i++)
@@ -221,6 +264,8 @@ int MO_matrix_blas::writeinput(string & indent, ostream & os)
   os << indent << "NMO " << nmo << endl;
   os << indent << "ORBFILE " << orbfile << endl;
   os << indent << "MAGNIFY " << magnification_factor << endl;
+  if(single_precision) 
+    os << indent << "SINGLE_PRECISION" << endl;
   string indent2=indent+"  ";
   for(int i=0; i< basis.GetDim(0); i++)
   {
@@ -240,30 +285,39 @@ void MO_matrix_blas::updateVal(Sample_point * sample,
                                int e, int listnum, Array2 <doublevar> & newvals) {
 
 #ifdef USE_BLAS
-  int centermax=centers.size();
 
   assert(e < sample->electronSize());
   assert(newvals.GetDim(1) >=1);
 
 
   Array1 <doublevar> R(5);
-  static Array1 <doublevar> symmvals_temp(maxbasis);
-  static Array1 <doublevar> newvals_T;
-  Array2 <doublevar> & moCoefftmp(moCoeff_list(listnum));
-  int totbasis=moCoefftmp.GetDim(0);
-  int nmo_list=moCoefftmp.GetDim(1);
+  Array1 <doublevar> symmvals_temp(maxbasis);
+  Array1 <doublevar> newvals_T;
+  doublevar * moCoeffv=NULL;
+  float * moCoeffv_single=NULL;
+  int nmo_list;
+  if(single_precision) { 
+    moCoeffv_single=moCoeff_list_single(listnum).v;
+    nmo_list=moCoeff_list_single(listnum).GetDim(1);
+  }
+  else { 
+    moCoeffv=moCoeff_list(listnum).v;
+    nmo_list=moCoeff_list(listnum).GetDim(1);
+  }
   newvals_T.Resize(nmo_list);
   newvals_T=0.0;
 
   int b;
-  int totfunc=0;
   
   centers.updateDistance(e, sample);
   
-  static Array1 <MOBLAS_CalcObjVal> calcobjs(totbasis);
+  Array1 <MOBLAS_CalcObjVal> calcobjs(totbasis);
   int ncalcobj=0;
 
-  for(int ion=0; ion < centermax; ion++)  {
+  int nnear=centers.nnear(e);
+  for(int k=0; k < nnear; k++)  {
+    int ion=centers.nearCenter(e,k);
+    int totfunc=center_func(ion);
     centers.getDistance(e, ion, R);
     for(int n=0; n< centers.nbasis(ion); n++) {
       b=centers.basis(ion, n);
@@ -277,7 +331,10 @@ void MO_matrix_blas::updateVal(Sample_point * sample,
             //            moCoefftmp.v+totfunc*nmo_list,1,
             //            newvals_T.v,1);
             calcobjs(ncalcobj).sval=symmvals_temp(i);
-            calcobjs(ncalcobj).moplace=moCoefftmp.v+totfunc*nmo_list;
+            if(single_precision) 
+              calcobjs(ncalcobj).moplace_single=moCoeffv_single+totfunc*nmo_list;
+            else
+              calcobjs(ncalcobj).moplace=moCoeffv+totfunc*nmo_list;
             ncalcobj++;
           }
           totfunc++;
@@ -290,8 +347,14 @@ void MO_matrix_blas::updateVal(Sample_point * sample,
   }
 
 
-  for(int i=0; i< ncalcobj; i++) { 
-    cblas_daxpy(nmo_list,calcobjs(i).sval,calcobjs(i).moplace,1,newvals_T.v,1);
+  if(single_precision) { 
+    for(int i=0; i< ncalcobj; i++) 
+      axpy_single(nmo_list,calcobjs(i).sval,calcobjs(i).moplace_single,newvals_T.v);
+  }
+  else { 
+    for(int i=0; i< ncalcobj; i++) { 
+      cblas_daxpy(nmo_list,calcobjs(i).sval,calcobjs(i).moplace,1,newvals_T.v,1);
+    }
   }
 
 
@@ -321,31 +384,40 @@ void MO_matrix_blas::updateLap(
   Array2 <doublevar> & newvals) {
 
 #ifdef USE_BLAS
-  int centermax=centers.size();
 
   assert(e < sample->electronSize());
   assert(newvals.GetDim(1) >=5);
 
 
   Array1 <doublevar> R(5);
-  static Array2 <doublevar> symmvals_temp(maxbasis,5);
-  static Array2 <doublevar> newvals_T;
-  Array2 <doublevar> & moCoefftmp(moCoeff_list(listnum));
-  int totbasis=moCoefftmp.GetDim(0);
-  int nmo_list=moCoefftmp.GetDim(1);
+  Array2 <doublevar> symmvals_temp(maxbasis,5);
+  Array2 <doublevar> newvals_T;
+  doublevar * moCoeffv=NULL;
+  float * moCoeffv_single=NULL;
+  int nmo_list;
+  if(single_precision) { 
+    moCoeffv_single=moCoeff_list_single(listnum).v;
+    nmo_list=moCoeff_list_single(listnum).GetDim(1);
+  }
+  else { 
+    moCoeffv=moCoeff_list(listnum).v;
+    nmo_list=moCoeff_list(listnum).GetDim(1);
+  }
   newvals_T.Resize(5, nmo_list);
   newvals_T=0.0;
 
   int b;
-  int totfunc=0;
   
   centers.updateDistance(e, sample);
 
-  static Array1 <MOBLAS_CalcObjLap> calcobjs(totbasis);
+  Array1 <MOBLAS_CalcObjLap> calcobjs(totbasis);
   int ncalcobj=0;
   
 
-  for(int ion=0; ion < centermax; ion++)  {
+  int nnear=centers.nnear(e);
+  for(int k=0; k < nnear; k++)  {
+    int ion=centers.nearCenter(e,k);
+    int totfunc=center_func(ion);
     centers.getDistance(e, ion, R);
     for(int n=0; n< centers.nbasis(ion); n++) {
       b=centers.basis(ion, n);
@@ -354,7 +426,10 @@ void MO_matrix_blas::updateLap(
         int imax=nfunctions(b);
         for(int i=0; i< imax; i++) {
           if(R(0) < cutoff(totfunc)) {
-            calcobjs(ncalcobj).moplace=moCoefftmp.v+totfunc*nmo_list;
+            if(single_precision) 
+              calcobjs(ncalcobj).moplace_single=moCoeffv_single+totfunc*nmo_list;
+            else
+              calcobjs(ncalcobj).moplace=moCoeffv+totfunc*nmo_list;
             
             for(int j=0; j< 5; j++) {
               calcobjs(ncalcobj).sval[j]=symmvals_temp(i,j);
@@ -374,6 +449,12 @@ void MO_matrix_blas::updateLap(
   }
 
   for(int i=0; i< ncalcobj; i++) { 
+    if(single_precision) { 
+      for(int j=0; j< 5; j++) 
+        axpy_single(nmo_list,calcobjs(i).sval[j],calcobjs(i).moplace_single,
+            newvals_T.v+j*nmo_list);
+      continue;
+    }
     for(int j=0; j< 5; j++) { 
       cblas_daxpy(nmo_list,calcobjs(i).sval[j],calcobjs(i).moplace,1,
           newvals_T.v+j*nmo_list,1);
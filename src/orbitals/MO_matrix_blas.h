@@ -40,10 +40,16 @@ private:
 
   Array1 <Array2 <doublevar> > moCoeff_list;
   Array2 <doublevar> moCoeff;
+  //! With SINGLE_PRECISION the coefficients are kept only in these
+  int single_precision;
+  Array1 <Array2 <float> > moCoeff_list_single;
+  Array2 <float> moCoeff_single;
+  Shared_tables list_tables; //!< holds the moCoeff_list tables
 
   Array1 <doublevar> obj_cutoff; //!< cutoff for each basis object
   Array1 <doublevar> cutoff;  //!< Cutoff for individual basis functions
   Array1 <int> nfunctions; //!< number of functions in each basis
+  Array1 <int> center_func; //!< index of the first function on each center
 
 public:
 
@@ -68,7 +74,11 @@ public:
   virtual int writeinput(string &, ostream &);
 
 
-  //virtual void read(vector <string> & words, unsigned int & startpos, System * sys);
+  virtual void read(vector <string> & words, unsigned int & startpos, System * sys) {
+    unsigned int pos=startpos;
+    single_precision=haskeyword(words,pos,"SINGLE_PRECISION");
+    Templated_MO_matrix<doublevar>::read(words, startpos, sys);
+  }
 
   //! Takes an ORB file and inserts all the coefficients.
   //virtual int readorb(istream &);
@@ -121,7 +131,7 @@ public:
   );
 
   MO_matrix_blas()
-  {}
+  { single_precision=0; }
 
 };
 
@@ -0,0 +1,581 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Qmc_std.h"
+#include "MO_matrix_block.h"
+#include "Sample_point.h"
+#include "qmc_io.h"
+
+void MO_matrix_block::init() {
+
+  //Determine where to cut off the basis functions
+  cutoff.Resize(totbasis);
+  int basiscounter=0;
+  for(int i=0; i< centers.size(); i++) {
+    for(int j=0; j< centers.nbasis(i); j++) {
+      Basis_function* tempbasis=basis(centers.basis(i,j));
+      for(int n=0; n< tempbasis->nfunc(); n++) {
+        cutoff(basiscounter)=tempbasis->cutoff(n);
+        basiscounter++;
+      }
+    }
+  }
+
+  obj_cutoff.Resize(basis.GetDim(0));
+  nfunctions.Resize(basis.GetDim(0));
+  for(int b=0; b< basis.GetDim(0); b++) {
+    int nf=basis(b)->nfunc();
+    doublevar maxcut=basis(b)->cutoff(0);
+    for(int n=1; n< nf; n++) {
+      doublevar cut=basis(b)->cutoff(n);
+      if(cut > maxcut) maxcut=cut;
+    }
+    obj_cutoff(b)=maxcut;
+    nfunctions(b)=nf;
+  }
+
+  //Only the centers within reach of one of their basis objects are visited
+  center_func.Resize(centers.size());
+  center_nfunc.Resize(centers.size());
+  center_range.Resize(centers.size());
+  int nf=0;
+  for(int ion=0; ion< centers.size(); ion++) {
+    center_func(ion)=nf;
+    center_range(ion)=0;
+    for(int n=0; n< centers.nbasis(ion); n++) {
+      int b=centers.basis(ion,n);
+      center_range(ion)=max(center_range(ion), obj_cutoff(b));
+      nf+=nfunctions(b);
+    }
+    center_nfunc(ion)=nf-center_func(ion);
+  }
+  centers.buildCellList(center_range);
+
+  //Only the writer reads the orbital file and fills the table; with
+  //-share_tables the other processes on the node never hold it
+  shared_tables.allocate(moCoeff, totbasis, nmo);
+  if(Shared_tables::writer()) {
+    ifstream ORB(orbfile.c_str());
+    if(!ORB) error("couldn't find orb file ", orbfile);
+
+    Array3 <int> coeffmat;
+    Array1 <doublevar> coeff;
+    readorb(ORB,centers, nmo, maxbasis, kpoint,coeffmat, coeff,
+            !Shared_tables::active());
+    ORB.close();
+
+    //The same coefficients that CUTOFF_MO keeps; the rest are exactly zero
+    const doublevar threshold=1e-12;
+    int totfunc=0;
+    for(int ion=0; ion<centers.size(); ion++) {
+      int f=0;
+      doublevar kptfac=center_kpoint_fac<doublevar>(centers, ion);
+
+      for(int n=0; n< centers.nbasis(ion); n++) {
+        int fnum=centers.basis(ion,n);
+        int imax=basis(fnum)->nfunc();
+        for(int i=0; i<imax; i++){
+          for(int mo=0; mo<nmo; mo++) {
+            doublevar c=0.0;
+            if(coeffmat(mo,ion, f) != -1) c=coeff(coeffmat(mo,ion,f));
+            if(fabs(c) > threshold)
+              moCoeff(totfunc, mo)=kptfac*magnification_factor*c;
+            else moCoeff(totfunc, mo)=0.0;
+          }
+          f++;
+          totfunc++;
+        }
+      }
+    }
+  }
+  shared_tables.sync();
+
+  int nthread=qmc_max_threads();
+  thread_x.Resize(nthread);
+  thread_y.Resize(nthread);
+  thread_symmvals.Resize(nthread);
+  thread_symmvals1d.Resize(nthread);
+  thread_crowdbasis.Resize(nthread);
+  thread_crowdactive.Resize(nthread);
+  for(int t=0; t< nthread; t++) {
+    thread_x(t).Resize(maxbasis,10);
+    thread_symmvals(t).Resize(maxbasis,10);
+    thread_symmvals1d(t).Resize(maxbasis);
+  }
+
+  int nbasisobj=basis.GetDim(0);
+  Array1 <int> ncenters_basis(nbasisobj);
+  ncenters_basis=0;
+  for(int ion=0; ion< centers.size(); ion++)
+    for(int n=0; n< centers.nbasis(ion); n++)
+      ncenters_basis(centers.basis(ion,n))++;
+  thread_batchdist.Resize(nthread);
+  thread_batchvals.Resize(nthread);
+  thread_batchcount.Resize(nthread);
+  for(int t=0; t< nthread; t++) {
+    thread_batchdist(t).Resize(nbasisobj);
+    thread_batchvals(t).Resize(nbasisobj);
+    thread_batchcount(t).Resize(nbasisobj);
+    for(int b=0; b< nbasisobj; b++) {
+      thread_batchdist(t)(b).Resize(max(ncenters_basis(b),1),5);
+      thread_batchvals(t)(b).Resize(max(ncenters_basis(b)*nfunctions(b),1),5);
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+void MO_matrix_block::writeorb(ostream & os, Array2 <doublevar> & rotation,
+                               Array1 <int>  &moList) {
+  int nmo_write=moList.GetDim(0);
+  assert(rotation.GetDim(0)==nmo_write);
+  assert(rotation.GetDim(1)==nmo_write);
+  os.precision(15);
+  int counter=0;
+  for(int m=0; m < nmo_write; m++) {
+    for(int ion=0; ion<centers.size(); ion++) {
+      int f=0;
+      for(int n=0; n< centers.nbasis(ion); n++) {
+        int fnum=centers.basis(ion,n);
+        int imax=basis(fnum)->nfunc();
+        for(int i=0; i<imax; i++) {
+          os << m+1 << "  "   << f+1 << "   " << ion+1 << "   " << counter+1 << endl;
+          f++;
+          counter++;
+        }
+      }
+    }
+  }
+  os << "COEFFICIENTS\n";
+  ifstream orbin(orbfile.c_str());
+  rotate_orb(orbin, os, rotation, moList, totbasis);
+  orbin.close();
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  Each center's block of a list covers the orbitals from the first to
+  the last one with a nonzero coefficient on the center.  It is stored
+  densely if enough of it is nonzero; otherwise only the nonzero
+  coefficients of each function are kept.
+*/
+void MO_matrix_block::buildLists(Array1 < Array1 <int> > & occupations) {
+  int numlists=occupations.GetDim(0);
+  int ncenters=centers.size();
+  //the lists from an earlier call may be views of shared memory
+  for(int lis=0; lis < block_coeff.GetDim(0); lis++) {
+    block_coeff(lis).clear();
+    sparse_mo(lis).clear();
+    sparse_coeff(lis).clear();
+  }
+  list_tables.clear();
+  list_nmo.Resize(numlists);
+  block_lo.Resize(numlists);
+  block_width.Resize(numlists);
+  block_start.Resize(numlists);
+  block_coeff.Resize(numlists);
+  sparse_start.Resize(numlists);
+  sparse_mo.Resize(numlists);
+  sparse_coeff.Resize(numlists);
+  ndense_blocks.Resize(numlists);
+  nsparse_blocks.Resize(numlists);
+  int maxlist=1;
+  for(int lis=0; lis < numlists; lis++) {
+    Array1 <int> & occ(occupations(lis));
+    int nmo_list=occ.GetDim(0);
+    list_nmo(lis)=nmo_list;
+    maxlist=max(maxlist, nmo_list);
+    block_lo(lis).Resize(ncenters);
+    block_width(lis).Resize(ncenters);
+    block_start(lis).Resize(ncenters);
+    sparse_start(lis).Resize(totbasis+1);
+    ndense_blocks(lis)=0;
+    nsparse_blocks(lis)=0;
+    //Every process lays out the blocks from the shared moCoeff...
+    int ndense=0, nsparse=0;
+    for(int ion=0; ion< ncenters; ion++) {
+      int f0=center_func(ion), nf=center_nfunc(ion);
+      int lo=nmo_list, hi=-1;
+      doublevar nnz=0;
+      for(int f=f0; f< f0+nf; f++) {
+        for(int i=0; i< nmo_list; i++) {
+          if(moCoeff(f,occ(i))!=0.0) {
+            nnz++;
+            lo=min(lo,i);
+            hi=max(hi,i);
+          }
+        }
+      }
+      int width=(hi >= lo)?hi-lo+1:0;
+      block_lo(lis)(ion)=(width > 0)?lo:0;
+      block_width(lis)(ion)=width;
+      block_start(lis)(ion)=-1;
+      if(width > 0 && nnz >= dense_fraction*nf*width) {
+        block_start(lis)(ion)=ndense;
+        ndense+=nf*width;
+        ndense_blocks(lis)++;
+      }
+      else if(width > 0) nsparse_blocks(lis)++;
+      for(int f=f0; f< f0+nf; f++) {
+        sparse_start(lis)(f)=nsparse;
+        if(width==0 || block_start(lis)(ion) >= 0) continue;
+        for(int i=lo; i<= hi; i++)
+          if(moCoeff(f,occ(i))!=0.0) nsparse++;
+      }
+    }
+    sparse_start(lis)(totbasis)=nsparse;
+
+    //...and only the writer copies the coefficients into them
+    list_tables.allocate(block_coeff(lis), max(ndense,1));
+    list_tables.allocate(sparse_mo(lis), max(nsparse,1));
+    list_tables.allocate(sparse_coeff(lis), max(nsparse,1));
+    if(!Shared_tables::writer()) continue;
+    for(int ion=0; ion< ncenters; ion++) {
+      int f0=center_func(ion), nf=center_nfunc(ion);
+      int lo=block_lo(lis)(ion), width=block_width(lis)(ion);
+      int start=block_start(lis)(ion);
+      for(int f=f0; f< f0+nf; f++) {
+        int s=sparse_start(lis)(f);
+        for(int i=lo; i< lo+width; i++) {
+          doublevar c=moCoeff(f,occ(i));
+          if(start >= 0) block_coeff(lis)(start+(f-f0)*width+i-lo)=c;
+          else if(c!=0.0) {
+            sparse_mo(lis)(s)=i;
+            sparse_coeff(lis)(s)=c;
+            s++;
+          }
+        }
+      }
+    }
+  }
+  list_tables.sync();
+  for(int t=0; t< thread_y.GetDim(0); t++)
+    thread_y(t).Resize(10*maxlist);
+}
+
+//----------------------------------------------------------------------
+
+int MO_matrix_block::showinfo(ostream & os) {
+  os << "Block MO " << endl;
+  os << "Number of molecular orbitals: " << nmo << endl;
+  os << "Center blocks stored densely above " << dense_fraction
+     << " filling" << endl;
+  for(int lis=0; lis< ndense_blocks.GetDim(0); lis++)
+    os << "List " << lis << ": " << ndense_blocks(lis) << " dense and "
+       << nsparse_blocks(lis) << " sparse center blocks" << endl;
+  if(Shared_tables::active())
+    os << "Tables shared on the node: "
+       << (shared_tables.sharedBytes()+list_tables.sharedBytes())/1024.0/1024.0
+       << " MB" << endl;
+  string indent="  ";
+  os << "Basis functions: \n";
+  for(int i=0; i< basis.GetDim(0); i++) {
+    basis(i)->showinfo(indent, os);
+  }
+  return 1;
+}
+
+int MO_matrix_block::writeinput(string & indent, ostream & os) {
+  os << indent << "BLOCK_MO" << endl;
+  os << indent << "NMO " << nmo << endl;
+  os << indent << "ORBFILE " << orbfile << endl;
+  os << indent << "MAGNIFY " << magnification_factor << endl;
+  os << indent << "DENSE_FRACTION " << dense_fraction << endl;
+  string indent2=indent+"  ";
+  for(int i=0; i< basis.GetDim(0); i++) {
+    os << indent << "BASIS { " << endl;
+    basis(i)->writeinput(indent2, os);
+    os << indent << "}" << endl;
+  }
+  os << indent << "CENTERS { " << endl;
+  centers.writeinput(indent2, os);
+  os << indent << "}" << endl;
+  return 1;
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  y(j, orbital)+=sum_f x(f,j) c(f, orbital) for j < ncol, over the
+  functions f of center ion.  x has a row of ldx for each function and y a
+  row of ldy for each component.
+*/
+void MO_matrix_block::addBlock(int listnum, int ion, const doublevar * x,
+                               int ldx, int ncol, doublevar * y, int ldy) {
+  int width=block_width(listnum)(ion);
+  if(width==0) return;
+  int nf=center_nfunc(ion);
+  int start=block_start(listnum)(ion);
+  if(start >= 0) {
+    int lo=block_lo(listnum)(ion);
+    const doublevar * c=block_coeff(listnum).v+start;
+#ifdef USE_BLAS
+    if(ncol==1)
+      cblas_dgemv(CblasRowMajor,CblasTrans,nf,width,1.0,c,width,
+                  x,ldx,1.0,y+lo,1);
+    else
+      cblas_dgemm(CblasRowMajor,CblasTrans,CblasNoTrans,ncol,width,nf,
+                  1.0,x,ldx,c,width,1.0,y+lo,ldy);
+#else
+    for(int f=0; f< nf; f++) {
+      const doublevar * cf=c+f*width;
+      const doublevar * xf=x+f*ldx;
+      for(int j=0; j< ncol; j++) {
+        doublevar a=xf[j];
+        if(a==0.0) continue;
+        doublevar * yj=y+j*ldy+lo;
+        for(int m=0; m< width; m++) yj[m]+=a*cf[m];
+      }
+    }
+#endif
+  }
+  else {
+    const int * fstart=sparse_start(listnum).v+center_func(ion);
+    const int * mo=sparse_mo(listnum).v;
+    const doublevar * c=sparse_coeff(listnum).v;
+    for(int f=0; f< nf; f++) {
+      const doublevar * xf=x+f*ldx;
+      for(int p=fstart[f]; p< fstart[f+1]; p++) {
+        doublevar * ym=y+mo[p];
+        for(int j=0; j< ncol; j++) ym[j*ldy]+=c[p]*xf[j];
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  updateVal() (ncol=1) and updateHessian() (ncol=10)
+*/
+void MO_matrix_block::update(Sample_point * sample, int e, int listnum,
+                             int ncol, Array2 <doublevar> & newvals) {
+  assert(e < sample->electronSize());
+  assert(newvals.GetDim(1) >= ncol);
+  int t=qmc_thread_num();
+  Array2 <doublevar> & x(thread_x(t));
+  Array2 <doublevar> & symmvals(thread_symmvals(t));
+  Array1 <doublevar> & symmvals1d(thread_symmvals1d(t));
+  int nmo_list=list_nmo(listnum);
+  doublevar * y=thread_y(t).v;
+  for(int i=0; i< ncol*nmo_list; i++) y[i]=0.0;
+  int ldx=x.step1;
+  Array1 <doublevar> R(5);
+
+  centers.updateDistance(e, sample);
+  int nnear=centers.nnear(e);
+  for(int k=0; k < nnear; k++) {
+    int ion=centers.nearCenter(e,k);
+    if(block_width(listnum)(ion)==0) continue;
+    centers.getDistance(e, ion, R);
+    if(R(0) >= center_range(ion)) continue;
+    int totfunc=center_func(ion);
+    doublevar * xf=x.v;
+    for(int n=0; n< centers.nbasis(ion); n++) {
+      int b=centers.basis(ion,n);
+      int imax=nfunctions(b);
+      int inrange=R(0) < obj_cutoff(b);
+      if(inrange) {
+        if(ncol==1) basis(b)->calcVal(R, symmvals1d);
+        else basis(b)->calcHessian(R, symmvals);
+      }
+      for(int i=0; i< imax; i++) {
+        if(inrange && R(0) < cutoff(totfunc)) {
+          if(ncol==1) xf[0]=symmvals1d(i);
+          else for(int j=0; j< ncol; j++) xf[j]=symmvals(i,j);
+        }
+        else for(int j=0; j< ncol; j++) xf[j]=0.0;
+        xf+=ldx;
+        totfunc++;
+      }
+    }
+    addBlock(listnum, ion, x.v, ldx, ncol, y, nmo_list);
+  }
+
+  for(int m=0; m< nmo_list; m++)
+    for(int j=0; j< ncol; j++)
+      newvals(m,j)=y[j*nmo_list+m];
+}
+
+//----------------------------------------------------------------------
+
+void MO_matrix_block::updateVal(Sample_point * sample, int e, int listnum,
+                                Array2 <doublevar> & newvals) {
+  update(sample, e, listnum, 1, newvals);
+}
+
+void MO_matrix_block::updateHessian(Sample_point * sample, int e, int listnum,
+                                    Array2 <doublevar> & newvals) {
+  assert(newvals.GetDim(1)==10);
+  update(sample, e, listnum, 10, newvals);
+}
+
+//----------------------------------------------------------------------
+
+void MO_matrix_block::updateLap(Sample_point * sample, int e, int listnum,
+                                Array2 <doublevar> & newvals) {
+  assert(e < sample->electronSize());
+  assert(newvals.GetDim(1) >= 5);
+  int t=qmc_thread_num();
+  Array1 < Array2 <doublevar> > & batchdist(thread_batchdist(t));
+  Array1 < Array2 <doublevar> > & batchvals(thread_batchvals(t));
+  Array1 <int> & batchcount(thread_batchcount(t));
+  Array2 <doublevar> & x(thread_x(t));
+  int nmo_list=list_nmo(listnum);
+  doublevar * y=thread_y(t).v;
+  for(int i=0; i< 5*nmo_list; i++) y[i]=0.0;
+  int ldx=x.step1;
+  Array1 <doublevar> R(5);
+
+  //Gather the centers within range of each basis object, so that each
+  //basis evaluates all of its centers in one call.
+  centers.updateDistance(e, sample);
+  int nbasisobj=basis.GetDim(0);
+  for(int b=0; b< nbasisobj; b++) batchcount(b)=0;
+  int nnear=centers.nnear(e);
+  for(int k=0; k < nnear; k++) {
+    int ion=centers.nearCenter(e,k);
+    if(block_width(listnum)(ion)==0) continue;
+    centers.getDistance(e, ion, R);
+    for(int n=0; n< centers.nbasis(ion); n++) {
+      int b=centers.basis(ion, n);
+      if(R(0) < obj_cutoff(b)) {
+        doublevar * row=batchdist(b).v+batchcount(b)*batchdist(b).step1;
+        for(int d=0; d< 5; d++) row[d]=R(d);
+        batchcount(b)++;
+      }
+    }
+  }
+  for(int b=0; b< nbasisobj; b++) {
+    if(batchcount(b) > 0)
+      basis(b)->calcLapCenters(batchdist(b), batchcount(b), batchvals(b));
+    batchcount(b)=0;
+  }
+
+  for(int k=0; k < nnear; k++) {
+    int ion=centers.nearCenter(e,k);
+    if(block_width(listnum)(ion)==0) continue;
+    centers.getDistance(e, ion, R);
+    if(R(0) >= center_range(ion)) continue;
+    int totfunc=center_func(ion);
+    doublevar * xf=x.v;
+    for(int n=0; n< centers.nbasis(ion); n++) {
+      int b=centers.basis(ion, n);
+      int imax=nfunctions(b);
+      const doublevar * symmvals=NULL;
+      int stride=batchvals(b).step1;
+      //the centers were gathered in this same order
+      if(R(0) < obj_cutoff(b))
+        symmvals=batchvals(b).v+(batchcount(b)++)*imax*stride;
+      for(int i=0; i< imax; i++) {
+        if(symmvals && R(0) < cutoff(totfunc))
+          for(int j=0; j< 5; j++) xf[j]=symmvals[i*stride+j];
+        else
+          for(int j=0; j< 5; j++) xf[j]=0.0;
+        xf+=ldx;
+        totfunc++;
+      }
+    }
+    addBlock(listnum, ion, x.v, ldx, 5, y, nmo_list);
+  }
+
+  for(int m=0; m< nmo_list; m++)
+    for(int j=0; j< 5; j++)
+      newvals(m,j)=y[j*nmo_list+m];
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  The basis values of all the walkers are gathered into one table, with
+  zeros where a walker is out of range, and then each center's block is
+  applied to all of them at once, so a dense block is one matrix-matrix
+  product for the whole crowd.
+*/
+void MO_matrix_block::updateLapCrowd(Array1 <Sample_point *> & samples,
+                                     int e, int listnum,
+                                     Array1 <Array2 <doublevar> *> & newvals) {
+  int nw=samples.GetDim(0);
+  int t=qmc_thread_num();
+  Array2 <doublevar> & symmvals(thread_symmvals(t));
+  Array2 <doublevar> & bval(thread_crowdbasis(t));
+  Array1 <int> & active(thread_crowdactive(t));
+  int nmo_list=list_nmo(listnum);
+  int width=5*nw;
+  int symmvals_stride=symmvals.step1;
+  Array1 <doublevar> R(5);
+
+  bval.Resize(totbasis, width);
+  active.Resize(centers.size());
+  active=0;
+  for(int w=0; w< nw; w++) {
+    assert(e < samples(w)->electronSize());
+    centers.updateDistance(e, samples(w));
+    int nnear=centers.nnear(e);
+    for(int k=0; k < nnear; k++) {
+      int ion=centers.nearCenter(e,k);
+      if(block_width(listnum)(ion)==0) continue;
+      centers.getDistance(e, ion, R);
+      if(R(0) >= center_range(ion)) continue;
+      int totfunc=center_func(ion);
+      if(!active(ion)) {
+        doublevar * bv=bval.v+totfunc*width;
+        for(int i=0; i< center_nfunc(ion)*width; i++) bv[i]=0.0;
+        active(ion)=1;
+      }
+      for(int n=0; n< centers.nbasis(ion); n++) {
+        int b=centers.basis(ion, n);
+        int imax=nfunctions(b);
+        if(R(0) < obj_cutoff(b)) {
+          basis(b)->calcLap(R, symmvals);
+          for(int i=0; i< imax; i++) {
+            if(R(0) < cutoff(totfunc+i)) {
+              doublevar * bv=bval.v+(totfunc+i)*width;
+              for(int j=0; j< 5; j++)
+                bv[j*nw+w]=symmvals.v[i*symmvals_stride+j];
+            }
+          }
+        }
+        totfunc+=imax;
+      }
+    }
+  }
+
+  Array1 <doublevar> & ybuf(thread_y(t));
+  ybuf.Resize(width*nmo_list);
+  doublevar * y=ybuf.v;
+  for(int i=0; i< width*nmo_list; i++) y[i]=0.0;
+  for(int ion=0; ion< centers.size(); ion++) {
+    if(active(ion))
+      addBlock(listnum, ion, bval.v+center_func(ion)*width, width, width,
+               y, nmo_list);
+  }
+
+  for(int w=0; w< nw; w++) {
+    Array2 <doublevar> & nv(*newvals(w));
+    assert(nv.GetDim(1) >= 5);
+    for(int m=0; m< nmo_list; m++)
+      for(int j=0; j< 5; j++)
+        nv(m,j)=y[(j*nw+w)*nmo_list+m];
+  }
+}
+
+//----------------------------------------------------------------------
@@ -0,0 +1,155 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef MO_MATRIX_BLOCK_H_INCLUDED
+#define MO_MATRIX_BLOCK_H_INCLUDED
+
+#include "Array.h"
+#include "Qmc_std.h"
+#include "Basis_function.h"
+#include "Center_set.h"
+#include "MO_matrix.h"
+
+class System;
+class Sample_point;
+//----------------------------------------------------------------------------
+
+/*!
+\brief
+Evaluates orbitals center by center.  The values of the basis functions
+on a center are gathered into a small matrix (function, [val grad lap])
+and multiplied by that center's block of the coefficients, so the
+inner loops run over contiguous orbitals instead of scattered lists.
+
+For each list, each center's block is stored densely, over the range of
+orbitals it has coefficients for, if at least DENSE_FRACTION of that
+block is nonzero, and otherwise as a list of (orbital, coefficient) for
+each function.  With USE_BLAS the dense blocks are done with dgemv and
+dgemm, and updateLapCrowd() does all the walkers of a crowd in one
+dgemm per center.
+*/
+class MO_matrix_block: public MO_matrix
+{
+protected:
+  void init();
+private:
+  Array2 <doublevar> moCoeff; //!< (function, MO)
+  doublevar dense_fraction;
+
+  Array1 <doublevar> obj_cutoff; //!< cutoff for each basis object
+  Array1 <doublevar> cutoff;  //!< Cutoff for individual basis functions
+  Array1 <int> nfunctions; //!< number of functions in each basis
+  Array1 <int> center_func; //!< index of the first function on each center
+  Array1 <int> center_nfunc; //!< number of functions on each center
+  Array1 <doublevar> center_range; //!< largest cutoff of the functions on each center
+  Array1 <int> list_nmo; //!< number of orbitals in each list
+
+  //!For each list and center: the first orbital of the block and the
+  //!number of orbitals in it (0 if the center has no coefficients),
+  //!and for a dense block, where it starts in block_coeff; -1 if sparse
+  Array1 < Array1 <int> > block_lo, block_width, block_start;
+  Array1 < Array1 <doublevar> > block_coeff; //!< (function, orbital) for each dense block
+  //!The sparse blocks: the entries of function f are
+  //!sparse_start(f) to sparse_start(f+1)-1
+  Array1 < Array1 <int> > sparse_start;
+  Array1 < Array1 <int> > sparse_mo;
+  Array1 < Array1 <doublevar> > sparse_coeff;
+  Array1 <int> ndense_blocks, nsparse_blocks;
+  Shared_tables list_tables; //!< holds block_coeff, sparse_mo, and sparse_coeff
+
+  //Scratch for each thread: the basis values on a center (function, component),
+  //the sums ([component], orbital), and the basis values of each basis object
+  Array1 < Array2 <doublevar> > thread_x;
+  Array1 < Array1 <doublevar> > thread_y;
+  Array1 < Array2 <doublevar> > thread_symmvals;
+  Array1 < Array1 <doublevar> > thread_symmvals1d;
+  //updateLap() scratch for each basis object: the distances to the centers
+  //that use it, their basis values, and the number of centers in range
+  Array1 < Array1 < Array2 <doublevar> > > thread_batchdist;
+  Array1 < Array1 < Array2 <doublevar> > > thread_batchvals;
+  Array1 < Array1 <int> > thread_batchcount;
+  //updateLapCrowd() scratch: basis values (function, [val grad lap] x walker)
+  //and whether any walker is in range of each center
+  Array1 < Array2 <doublevar> > thread_crowdbasis;
+  Array1 < Array1 <int> > thread_crowdactive;
+
+  void addBlock(int listnum, int ion, const doublevar * x, int ldx,
+                int ncol, doublevar * y, int ldy);
+  void update(Sample_point * sample, int e, int listnum, int ncol,
+              Array2 <doublevar> & newvals);
+
+public:
+
+  virtual void buildLists(Array1 <Array1 <int> > & occupations);
+
+  virtual int showinfo(ostream & os);
+
+  virtual int writeinput(string &, ostream &);
+
+  virtual void read(vector <string> & words, unsigned int & startpos, System * sys) {
+    unsigned int pos=startpos;
+    if(!readvalue(words, pos, dense_fraction, "DENSE_FRACTION"))
+      dense_fraction=0.25;
+    Templated_MO_matrix<doublevar>::read(words, startpos, sys);
+  }
+
+  virtual void writeorb(ostream &, Array2 <doublevar> & rotation, Array1 <int> &);
+
+  virtual void updateVal(
+    Sample_point * sample,
+    int e,
+    //!< electron number
+    int listnum,
+    Array2 <doublevar> & newvals
+    //!< The return: in form (MO)
+  );
+
+  virtual void updateLap(
+    Sample_point * sample,
+    int e,
+    //!< electron number
+    int listnum,
+    //!< Choose the list that was built in buildLists
+    Array2 <doublevar> & newvals
+    //!< The return: in form (MO, [value gradient lap])
+  );
+
+  virtual void updateHessian(Sample_point * sample,
+			     int e,
+			     int listnum,
+			     Array2 <doublevar> & newvals
+			     //!< in form (MO, [value gradient, dxx,dyy,dzz,dxy,dxz,dyz])
+			     );
+
+  virtual void updateLapCrowd(Array1 <Sample_point *> & samples,
+                              int e,
+                              int listnum,
+                              Array1 <Array2 <doublevar> *> & newvals);
+
+  MO_matrix_block()
+  { dense_fraction=0.25; }
+
+};
+
+
+
+#endif // MO_MATRIX_BLOCK_H_INCLUDED
+
+//--------------------------------------------------------------------------
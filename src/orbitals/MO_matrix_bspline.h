@@ -0,0 +1,465 @@
+/*
+
+Copyright (C) 2011 Lucas K. Wagner (based on work by Michal Bajdich)
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef MO_MATRIX_BSPLINE_H_INCLUDED
+#define MO_MATRIX_BSPLINE_H_INCLUDED
+
+#include "MO_matrix.h"
+#include "Bspline_3d.h"
+#include "Sample_point.h"
+
+//A complex orbital is stored as two real spline columns.
+template <class T> inline int bspline_ncomp() { return 1; }
+template <> inline int bspline_ncomp<dcomplex>() { return 2; }
+
+inline void bspline_get(const doublevar * p, doublevar & v) { v=p[0]; }
+inline void bspline_get(const doublevar * p, dcomplex & v) {
+  v=dcomplex(p[0],p[1]);
+}
+
+//! The k-point factor \f$f(\theta)\f$ and \f$df/d\theta\f$
+inline void bspline_phase(doublevar theta, doublevar & f, doublevar & fp) {
+  f=cos(theta);
+  fp=-sin(theta);
+}
+inline void bspline_phase(doublevar theta, dcomplex & f, dcomplex & fp) {
+  f=exp(dcomplex(0.0,theta));
+  fp=dcomplex(0.0,1.0)*f;
+}
+
+
+/*!
+\brief
+Periodic orbitals tabulated on a grid in the simulation cell, as
+tricubic B-splines (Bspline_3d).
+
+The orbital is \f$ \phi({\bf r}) = u({\bf r}) f(\pi {\bf k}\cdot{\bf r}) \f$,
+where u is periodic and f is \f$e^{i\theta}\f$ (complex) or
+\f$\cos\theta\f$ (real).  Each orbital list gets its own spline table
+with its orbitals in order, so one evaluation gives all the orbitals of
+the list; identical lists (such as the up and down lists of an
+unpolarized calculation) share a table.  The orbital file is the one
+written by abinit2qmc.
+ */
+template <class T> class MO_matrix_bspline:public Templated_MO_matrix<T> {
+protected:
+  void init() { }
+  using Templated_MO_matrix<T>::nmo;
+  using Templated_MO_matrix<T>::orbfile;
+  using Templated_MO_matrix<T>::magnification_factor;
+  using Templated_MO_matrix<T>::shared_tables;
+private:
+  Array1 <Bspline_3d> spline;
+  Array1 <int> list_spline; //!< the spline table of each list
+  Array2 <doublevar> latvec; //lattice vectors for the cell on which the function is defined
+  Array2 <doublevar> latvecinv;
+  Array1 <int> npoints;
+  Array1 <doublevar> resolution;
+  Array2 <doublevar> orb_kpoint; //!< k-point of each orbital, times pi
+  int gamma_only;
+  int single_precision;
+  Array1 <Array1 <int> > occ;
+  Array1 <Array1 <doublevar> > thread_out; //!< kernel output, one per thread
+
+  void fractional(Sample_point * sample, int e, Array1 <doublevar> & pos,
+                  doublevar * u);
+  void getMoSlot(int mo, int & s, int & col);
+public:
+  virtual void buildLists(Array1 <Array1 <int> > & occupations);
+  virtual void read(vector <string> & words, unsigned int & startpos,
+                    System * sys);
+  virtual int showinfo(ostream & os);
+  virtual int writeinput(string &, ostream &);
+  virtual void writeorb(ostream &, Array2 <doublevar> & rotation, Array1 <int> & tmp) { }
+  /*!
+    The B-spline coefficients of each orbital are its MO coefficients,
+    (nmo, number of grid points).
+   */
+  virtual void getMoCoeff(Array2 <T> & coeff);
+  virtual void setMoCoeff(Array2 <T> & coeff);
+  virtual int nMoCoeff() {
+    return nmo*npoints(0)*npoints(1)*npoints(2);
+  }
+  virtual void updateVal(Sample_point *,int e,int listnum,Array2<T>&);
+  virtual void updateLap(Sample_point *,int e, int listnum, Array2<T>&);
+  virtual void updateHessian(Sample_point * sample,
+			     int e, int listnum,Array2<T>&);
+
+  MO_matrix_bspline() { gamma_only=1; single_precision=0; }
+};
+
+
+#include "qmc_io.h"
+#include "MatrixAlgebra.h"
+
+
+//----------------------------------------------------------------------
+template <class T> void MO_matrix_bspline<T>::buildLists(Array1 <Array1 <int> > & occupations) {
+  int nlists=occupations.GetDim(0);
+  occ=occupations;
+  int ncomp=bspline_ncomp<T>();
+
+  //one table per distinct list
+  list_spline.Resize(nlists);
+  int nsplines=0;
+  for(int s=0; s< nlists; s++) {
+    list_spline(s)=-1;
+    for(int s2=0; s2 < s; s2++) {
+      if(occupations(s2).GetDim(0)!=occupations(s).GetDim(0)) continue;
+      int same=1;
+      for(int i=0; i< occupations(s).GetDim(0); i++)
+        if(occupations(s2)(i)!=occupations(s)(i)) same=0;
+      if(same) { list_spline(s)=list_spline(s2); break; }
+    }
+    if(list_spline(s)==-1) list_spline(s)=nsplines++;
+  }
+  spline.Resize(nsplines);
+  int maxwidth=0;
+  for(int s=0; s< nlists; s++) {
+    int width=ncomp*occupations(s).GetDim(0);
+    if(spline(list_spline(s)).ncols()==0)
+      spline(list_spline(s)).init(npoints, width, single_precision, shared_tables);
+    maxwidth=max(maxwidth,width);
+  }
+  thread_out.Resize(qmc_max_threads());
+  for(int t=0; t< thread_out.GetDim(0); t++)
+    thread_out(t).Resize(10*maxwidth);
+
+  ifstream is;
+  if(mpi_info.node==0) {
+    is.open(orbfile.c_str());
+    if(!is) error("Couldn't open ",orbfile);
+    string dummy;
+    is >> dummy;
+    while(dummy != "orbitals") is>>dummy;
+    is.ignore(180,'\n');
+  }
+  int ngridpts=npoints(0)*npoints(1)*npoints(2);
+  Array1 <T> orb_data(ngridpts);
+  Array1 <doublevar> part(ngridpts);
+  Array1 <int> done(nsplines);
+
+  for(int mo=0; mo < nmo; mo++) {
+    if(mpi_info.node==0) {
+      is.read((char*)(orb_data.v),sizeof(T)*ngridpts);
+      if(!is) error("Unexpected end of ",orbfile, " while reading the orbitals");
+    }
+#ifdef USE_MPI
+    MPI_Bcast(orb_data.v,ngridpts*ncomp,MPI_DOUBLE,0,MPI_Comm_grp);
+#endif
+    done=0;
+    for(int s=0; s< nlists; s++) {
+      int sp=list_spline(s);
+      if(done(sp)) continue;
+      done(sp)=1;
+      for(int i=0; i < occupations(s).GetDim(0); i++) {
+        if(occupations(s)(i)!=mo) continue;
+        for(int c=0; c< ncomp; c++) {
+          const doublevar * p=((const doublevar *) orb_data.v)+c;
+          for(int j=0; j< ngridpts; j++)
+            part(j)=magnification_factor*p[ncomp*j];
+          spline(sp).setValues(ncomp*i+c,part.v);
+        }
+      }
+    }
+  }
+  shared_tables.sync();
+}
+//----------------------------------------------------------------------
+
+template <class T> void MO_matrix_bspline<T>::read(vector <string> & words, unsigned int & startpos, System * sys) {
+  unsigned int pos=startpos;
+  int ndim=3;
+  if(!readvalue(words,pos=startpos,orbfile,"ORBFILE"))
+    error("Need keyword ORBFILE..");
+  if(!readvalue(words,pos=startpos,magnification_factor,"MAGNIFY"))
+    magnification_factor=1.0;
+  single_precision=haskeyword(words,pos=startpos,"SINGLE_PRECISION");
+  //Should probably just make node0 read this and send to others over MPI..
+  ifstream is(orbfile.c_str());
+  if(!is) error("Couldn't open ",orbfile);
+  string dummy;
+  is.ignore(180,'\n'); //header
+  is >> dummy;  //nmo
+  int nmo_file;
+  is >> nmo_file;
+  nmo=nmo_file;
+  is.ignore(180,'\n'); //clear nmo line
+  is.ignore(180,'\n'); //K-point line
+  Array2 <doublevar> tmp_kpt(nmo_file,ndim);
+  for(int i=0; i< nmo_file; i++) {
+    for(int d=0; d< ndim; d++)  {
+      is >> tmp_kpt(i,d);
+    }
+  }
+  is.ignore(180,'\n');
+
+  is.ignore(180,'\n');
+  latvec.Resize(ndim,ndim);
+  for(int i=0; i< ndim; i++) {
+    for(int j=0; j< ndim; j++) {
+      is >> latvec(i,j);
+    }
+  }
+  latvecinv.Resize(ndim,ndim);
+  InvertMatrix(latvec,latvecinv,ndim);
+
+  orb_kpoint.Resize(nmo_file,ndim);
+  orb_kpoint=0.0;
+  gamma_only=1;
+  for(int i=0; i< nmo_file; i++) {
+    for(int d1=0; d1 < ndim; d1++) {
+      for(int d2=0; d2 < ndim; d2++) {
+        orb_kpoint(i,d2)+=pi*tmp_kpt(i,d1)*latvecinv(d2,d1);
+      }
+    }
+    for(int d=0; d< ndim; d++)
+      if(fabs(orb_kpoint(i,d)) > 1e-12) gamma_only=0;
+  }
+  is >> dummy;
+  resolution.Resize(ndim);
+  for(int i=0; i< ndim; i++) is >> resolution(i);
+  is >> dummy;
+  npoints.Resize(ndim);
+  for(int i=0; i< ndim; i++) is >> npoints(i);
+  if(!is) error("Couldn't read the header of ",orbfile);
+  is.close();
+}
+//----------------------------------------------------------------------
+
+template <class T> int MO_matrix_bspline<T>::showinfo(ostream & os) {
+  os << "Tricubic B-spline orbitals" << endl;
+  os << "NMO " << nmo << endl;
+  os << "ORBFILE " << orbfile << endl;
+  os << "grid " << npoints(0) << " x " << npoints(1) << " x " << npoints(2) << endl;
+  doublevar mem=0;
+  for(int s=0; s< spline.GetDim(0); s++)
+    mem+=doublevar(spline(s).ncols())*(npoints(0)+3)*(npoints(1)+3)*(npoints(2)+3)
+         *(single_precision?sizeof(float):sizeof(doublevar));
+  os << "spline tables: " << spline.GetDim(0) << " using "
+     << mem/1024.0/1024.0 << " MB";
+  if(single_precision) os << " (single precision)";
+  if(Shared_tables::active()) os << " per node";
+  os << endl;
+  return 1;
+
+}
+//----------------------------------------------------------------------
+
+template <class T>int MO_matrix_bspline<T>::writeinput(string & indent, ostream &os ) {
+  os << indent << "BSPLINE_MO" << endl;
+  os<< indent << "NMO " << nmo << endl;
+  os<< indent << "ORBFILE " << orbfile << endl;
+  if(magnification_factor != 1.0)
+    os << indent << "MAGNIFY " << magnification_factor << endl;
+  if(single_precision)
+    os << indent << "SINGLE_PRECISION" << endl;
+  return 1;
+}
+
+//----------------------------------------------------------------------
+
+template <class T> void MO_matrix_bspline<T>::fractional(Sample_point * sample,
+    int e, Array1 <doublevar> & pos, doublevar * u) {
+  sample->getElectronPos(e,pos);
+  for(int d=0; d< 3; d++) {
+    u[d]=0;
+    for(int d1=0; d1 < 3; d1++)
+      u[d]+=pos(d1)*latvecinv(d1,d);
+    u[d]-=floor(u[d]);
+  }
+}
+
+//----------------------------------------------------------------------
+
+template <class T> void MO_matrix_bspline<T>::getMoSlot(int mo, int & s, int & col) {
+  for(int l=0; l< occ.GetDim(0); l++) {
+    for(int i=0; i< occ(l).GetDim(0); i++) {
+      if(occ(l)(i)==mo) {
+        s=list_spline(l);
+        col=bspline_ncomp<T>()*i;
+        return;
+      }
+    }
+  }
+  s=-1; col=-1;
+}
+
+//----------------------------------------------------------------------
+
+template <class T> void MO_matrix_bspline<T>::getMoCoeff(Array2 <T> & coeff) {
+  int ngridpts=npoints(0)*npoints(1)*npoints(2);
+  int ncomp=bspline_ncomp<T>();
+  coeff.Resize(nmo,ngridpts);
+  coeff=T(0.0);
+  Array2 <doublevar> c(ncomp,ngridpts);
+  Array1 <doublevar> p(ncomp);
+  for(int mo=0; mo < nmo; mo++) {
+    int s,col;
+    getMoSlot(mo,s,col);
+    if(s < 0) continue;
+    for(int i=0; i< ncomp; i++)
+      spline(s).getCoefficients(col+i,c.v+i*ngridpts);
+    for(int j=0; j< ngridpts; j++) {
+      for(int i=0; i< ncomp; i++) p(i)=c(i,j);
+      bspline_get(p.v,coeff(mo,j));
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+template <class T> void MO_matrix_bspline<T>::setMoCoeff(Array2 <T> & coeff) {
+  int ngridpts=npoints(0)*npoints(1)*npoints(2);
+  int ncomp=bspline_ncomp<T>();
+  assert(coeff.GetDim(0)==nmo && coeff.GetDim(1)==ngridpts);
+  Array1 <doublevar> c(ngridpts);
+  for(int l=0; l< occ.GetDim(0); l++) {
+    //shared tables only need to be set once
+    int first=1;
+    for(int l2=0; l2 < l; l2++)
+      if(list_spline(l2)==list_spline(l)) first=0;
+    if(!first) continue;
+    for(int i=0; i< occ(l).GetDim(0); i++) {
+      for(int part=0; part < ncomp; part++) {
+        for(int j=0; j< ngridpts; j++)
+          c(j)=((const doublevar *) &coeff(occ(l)(i),j))[part];
+        spline(list_spline(l)).setCoefficients(ncomp*i+part,c.v);
+      }
+    }
+  }
+  shared_tables.sync();
+}
+
+//----------------------------------------------------------------------
+
+template <class T> void MO_matrix_bspline<T>::updateVal(Sample_point * sample,
+    int e, int listnum, Array2 <T> & newvals) {
+  Array1 <doublevar> pos(3);
+  doublevar u[3];
+  fractional(sample,e,pos,u);
+  Bspline_3d & sp(spline(list_spline(listnum)));
+  doublevar * out=thread_out(qmc_thread_num()).v;
+  sp.val(u,out);
+
+  int ncomp=bspline_ncomp<T>();
+  int n=occ(listnum).GetDim(0);
+  for(int i=0; i< n; i++)  {
+    bspline_get(out+ncomp*i,newvals(i,0));
+  }
+  if(!gamma_only) {
+    for(int i=0; i< n; i++)  {
+      int mo=occ(listnum)(i);
+      doublevar kr=0;
+      for(int d=0; d< 3; d++)
+        kr+=orb_kpoint(mo,d)*pos(d);
+      T f,fp;
+      bspline_phase(kr,f,fp);
+      newvals(i,0)*=f;
+    }
+  }
+}
+//----------------------------------------------------------------------
+
+template <class T> void MO_matrix_bspline<T>::updateLap(Sample_point * sample,
+    int e,int listnum,Array2 <T> & newvals) {
+  Array1 <doublevar> pos(3);
+  doublevar u[3];
+  fractional(sample,e,pos,u);
+  Bspline_3d & sp(spline(list_spline(listnum)));
+  doublevar * out=thread_out(qmc_thread_num()).v;
+  sp.vgl(u,latvecinv,out);
+
+  int ncomp=bspline_ncomp<T>();
+  int width=sp.ncols();
+  int n=occ(listnum).GetDim(0);
+  for(int i=0; i< n; i++) {
+    for(int q=0; q< 5; q++)
+      bspline_get(out+q*width+ncomp*i,newvals(i,q));
+  }
+  if(!gamma_only) {
+    for(int i=0; i< n; i++) {
+      int mo=occ(listnum)(i);
+      doublevar kr=0, k2=0;
+      for(int d=0; d< 3; d++) {
+        kr+=orb_kpoint(mo,d)*pos(d);
+        k2+=orb_kpoint(mo,d)*orb_kpoint(mo,d);
+      }
+      T f,fp;
+      bspline_phase(kr,f,fp);
+      T val=newvals(i,0);
+      T kgrad=T(0.0);
+      for(int d=0; d< 3; d++) {
+        kgrad+=orb_kpoint(mo,d)*newvals(i,d+1);
+        newvals(i,d+1)=f*newvals(i,d+1)+fp*orb_kpoint(mo,d)*val;
+      }
+      newvals(i,4)=f*newvals(i,4)+doublevar(2.0)*fp*kgrad-k2*f*val;
+      newvals(i,0)=f*val;
+    }
+  }
+}
+
+
+//----------------------------------------------------------------------
+
+template <class T> void MO_matrix_bspline<T>::updateHessian(Sample_point * sample,
+    int e,int listnum,Array2 <T> & newvals) {
+  Array1 <doublevar> pos(3);
+  doublevar u[3];
+  fractional(sample,e,pos,u);
+  Bspline_3d & sp(spline(list_spline(listnum)));
+  doublevar * out=thread_out(qmc_thread_num()).v;
+  sp.vgh(u,latvecinv,out);
+
+  int ncomp=bspline_ncomp<T>();
+  int width=sp.ncols();
+  int n=occ(listnum).GetDim(0);
+  for(int i=0; i< n; i++) {
+    for(int q=0; q< 10; q++)
+      bspline_get(out+q*width+ncomp*i,newvals(i,q));
+  }
+  if(!gamma_only) {
+    //the Hessian elements in newvals order: xx,yy,zz,xy,xz,yz
+    const int ha[6]={0,1,2,0,0,1}, hb[6]={0,1,2,1,2,2};
+    for(int i=0; i< n; i++) {
+      int mo=occ(listnum)(i);
+      doublevar kr=0;
+      for(int d=0; d< 3; d++)
+        kr+=orb_kpoint(mo,d)*pos(d);
+      T f,fp;
+      bspline_phase(kr,f,fp);
+      T val=newvals(i,0);
+      T grad[3];
+      for(int d=0; d< 3; d++) grad[d]=newvals(i,d+1);
+      for(int h=0; h< 6; h++) {
+        doublevar ka=orb_kpoint(mo,ha[h]), kb=orb_kpoint(mo,hb[h]);
+        newvals(i,4+h)=f*newvals(i,4+h)+fp*(ka*grad[hb[h]]+kb*grad[ha[h]])
+                       -ka*kb*f*val;
+      }
+      for(int d=0; d< 3; d++)
+        newvals(i,d+1)=f*grad[d]+fp*orb_kpoint(mo,d)*val;
+      newvals(i,0)=f*val;
+    }
+  }
+}
+//----------------------------------------------------------------------
+
+
+#endif //MO_MATRIX_BSPLINE_H_INCLUDED
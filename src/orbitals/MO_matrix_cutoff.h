@@ -26,12 +26,32 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Basis_function.h"
 #include "Center_set.h"
 #include "MO_matrix.h"
+#include <climits>
 
 class System;
 class Sample_point;
 //----------------------------------------------------------------------------
 
-template <class T> class MO_matrix_cutoff: public Templated_MO_matrix <T> {
+/*!
+\brief
+Evaluates orbitals as sparse sums of basis functions, skipping the
+functions beyond their cutoff.  C is the type in which the coefficients
+are stored; with SINGLE_PRECISION it is float (complex<float>), which halves
+the memory and bandwidth of the coefficient tables, while the sums are
+still done in T.
+
+With LOCALIZED, each orbital's support is taken as the union of spheres
+around the centers it has coefficients on, each with the largest cutoff
+of those functions.  Every update then also finds the orbitals whose
+support contains the electron, which nonzeroOrbitals() returns, so that
+Slat_wf can work with the sparse rows of the Slater matrix.
+
+LOCALIZED_TOLERANCE tol also drops each coefficient c whose function is
+below tol/|c| everywhere, and shrinks each sphere to the distance past
+which c times the function is below tol (Basis_function::boundRadius()),
+so orbitals with long tails of small coefficients stay sparse.
+*/
+template <class T, class C=T> class MO_matrix_cutoff: public Templated_MO_matrix <T> {
 protected:
   void init();
   using Templated_MO_matrix<T>::centers;
@@ -42,6 +62,7 @@ protected:
   using Templated_MO_matrix<T>::totbasis;
   using Templated_MO_matrix<T>::maxbasis;
   using Templated_MO_matrix<T>::kpoint;
+  using Templated_MO_matrix<T>::shared_tables;
 
 private:
   //Center_set centers;
@@ -52,22 +73,52 @@ private:
  // doublevar magnification_factor;
   //string orbfile;
   Array2 <int> mofill;
-  Array2 <T> moCoeff2;
+  Array2 <C> moCoeff2;
   Array1 <int> nbasis;
 
   Array1 <doublevar> obj_cutoff; //!< cutoff for each basis object
   Array1 <doublevar> cutoff;  //!< Cutoff for individual basis functions
   Array1 <int> nfunctions; //!< number of functions in each basis
+  Array1 <int> center_func; //!< index of the first function on each center
+  Array1 <doublevar> center_range; //!< largest cutoff of the functions on each center
+
+  int localized; //!< whether to find the nonzero orbitals (LOCALIZED)
+  doublevar localized_tolerance; //!< LOCALIZED_TOLERANCE, or 0 to keep every coefficient
+  //!For each list, the orbitals with support on each center, 
+  //!center_orb(center_orb_start(ion)..center_orb_start(ion+1)-1), 
+  //!and the radius of that support
+  Array1 < Array1 <int> > center_orb_start;
+  Array1 < Array1 <int> > center_orb;
+  Array1 < Array1 <doublevar> > center_orb_radius;
   //Array1 <int> basismo;
   //Array2 <doublevar> moCoeff;
   //Array2 <int> basisfill;
 
   Array1 < Array2 <int> > basisfill_list;
-  Array1 < Array2 <T> > moCoeff_list;
+  Array1 < Array2 <C> > moCoeff_list;
   Array1 < Array1 <int> > basismo_list;
-
- Array1 <doublevar> symmvals_temp1d;
- Array2 <doublevar> symmvals_temp2d;
+  Shared_tables list_tables; //!< holds moCoeff_list and basisfill_list
+
+ //Basis function scratch space, one per thread
+ Array1 < Array1 <doublevar> > thread_symmvals1d;
+ Array1 < Array2 <doublevar> > thread_symmvals2d;
+ //updateLap() scratch for each basis object: the distances to the centers
+ //that use it, their basis values, and the number of centers in range
+ Array1 < Array1 < Array2 <doublevar> > > thread_batchdist;
+ Array1 < Array1 < Array2 <doublevar> > > thread_batchvals;
+ Array1 < Array1 <int> > thread_batchcount;
+ //updateLapCrowd() scratch: basis values (function, [val grad lap] x walker), 
+ //whether each function is used by any walker, and the result (MO, [val grad lap] x walker)
+ Array1 < Array2 <doublevar> > thread_crowdbasis;
+ Array1 < Array1 <int> > thread_crowdactive;
+ Array1 < Array2 <T> > thread_crowdvals;
+ //The nonzero orbitals at the last update, and the marks used to find them
+ Array1 < Array1 <int> > thread_nonzero;
+ Array1 <int> thread_nnonzero;
+ Array1 < Array1 <int> > thread_orbmark;
+ Array1 <int> thread_markcount;
+
+ void findNonzero(int e, int listnum);
 
 
 
@@ -94,7 +145,17 @@ public:
   virtual int writeinput(string &, ostream &);
 
 
-  //virtual void read(vector <string> & words, unsigned int & startpos, System * sys);
+  virtual void read(vector <string> & words, unsigned int & startpos, 
+                    System * sys) { 
+    unsigned int pos=startpos;
+    localized=haskeyword(words, pos, "LOCALIZED");
+    if(readvalue(words, pos=startpos, localized_tolerance, "LOCALIZED_TOLERANCE")) {
+      if(localized_tolerance < 0)
+        error("LOCALIZED_TOLERANCE must not be negative");
+      localized=1;
+    }
+    Templated_MO_matrix<T>::read(words, startpos, sys);
+  }
 
   //! Takes an ORB file and inserts all the coefficients.
   //virtual int readorb(istream &);
@@ -148,8 +209,23 @@ public:
 			     Array2 <T>& newvals
 			     //!< in form ([value gradient, dxx,dyy,dzz,dxy,dxz,dyz], MO)
 			     );
+  virtual void updateLapCrowd(Array1 <Sample_point *> & samples,
+                              int e,
+                              int listnum,
+                              Array1 <Array2 <T> *> & newvals);
+
+  virtual int nonzeroOrbitals(Array1 <int> & nonzero) { 
+    if(!localized) return -1;
+    int t=qmc_thread_num();
+    int n=thread_nnonzero(t);
+    if(n < 0) return -1;
+    if(nonzero.GetDim(0) < n) nonzero.Resize(thread_nonzero(t).GetDim(0));
+    for(int i=0; i< n; i++) nonzero(i)=thread_nonzero(t)(i);
+    return n;
+  }
+
   MO_matrix_cutoff()
-  {}
+  { localized=0; localized_tolerance=0; }
 
 };
 
@@ -162,7 +238,7 @@ public:
 
 
 
-template <class T> void MO_matrix_cutoff<T>::init() {
+template <class T, class C> void MO_matrix_cutoff<T,C>::init() {
 
   
   //Determine where to cut off the basis functions
@@ -201,78 +277,130 @@ template <class T> void MO_matrix_cutoff<T>::init() {
   for(int b=0; b< basis.GetDim(0); b++) {
     nfunctions(b)=basis(b)->nfunc();
   }
+
+  //Only the centers within reach of one of their basis objects are visited
+  center_func.Resize(centers.size());
+  center_range.Resize(centers.size());
+  int nf=0;
+  for(int ion=0; ion< centers.size(); ion++) {
+    center_func(ion)=nf;
+    center_range(ion)=0;
+    for(int n=0; n< centers.nbasis(ion); n++) {
+      int b=centers.basis(ion,n);
+      center_range(ion)=max(center_range(ion), obj_cutoff(b));
+      nf+=nfunctions(b);
+    }
+  }
+  centers.buildCellList(center_range);
   
 
-  nbasis.Resize(nmo);
-  mofill.Resize(nmo, totbasis);
-  moCoeff2.Resize(nmo, totbasis);
+  //Only the writer reads the orbital file and fills the tables; with
+  //-share_tables the other processes on the node never hold them
+  shared_tables.allocate(nbasis, nmo);
+  shared_tables.allocate(mofill, nmo, totbasis);
+  shared_tables.allocate(moCoeff2, nmo, totbasis);
 
-  ifstream ORB(orbfile.c_str());
+  if(Shared_tables::writer()) {
+    ifstream ORB(orbfile.c_str());
 
-  if(!ORB) {
-    error("couldn't find orb file ", orbfile);
-  }
+    if(!ORB) {
+      error("couldn't find orb file ", orbfile);
+    }
 
-  Array3 <int> coeffmat;
-  Array1 <T> coeff;
+    Array3 <int> coeffmat;
+    Array1 <T> coeff;
   
-  readorb(ORB,centers, nmo, maxbasis,kpoint, coeffmat, coeff);
-  string in;
-  ORB.close();
+    readorb(ORB,centers, nmo, maxbasis,kpoint, coeffmat, coeff,
+            !Shared_tables::active());
+    ORB.close();
 
   
-  //Find the cutoffs
+    //Find the cutoffs
 
-  int totfunc=0;
-  nbasis=0;
-  //basismo=0;
-  const doublevar threshold=1e-12;
-  for(int ion=0; ion<centers.size(); ion++)
-  {
-    int f=0;
+    int totfunc=0;
+    nbasis=0;
+    //basismo=0;
+    const doublevar threshold=1e-12;
+    for(int ion=0; ion<centers.size(); ion++)
+    {
+      int f=0;
 
-    doublevar dot=0;
-    for(int d=0; d<3; d++) dot+=centers.centers_displacement(ion,d)*kpoint(d);
+      T kptfac=center_kpoint_fac<T>(centers, ion);
     
-    //T kptfac=T(exp(dcomplex(0,1.0)*dot*pi));
-    T kptfac=eval_kpoint_fac<T>(dot);
-    
-    for(int n=0; n< centers.nbasis(ion); n++) {
+      for(int n=0; n< centers.nbasis(ion); n++) {
       
-      int fnum=centers.basis(ion,n);
-      int imax=basis(fnum)->nfunc();
-
-      for(int i=0; i<imax; i++) { //sum over the symmetries
-        for(int mo=0; mo<nmo; mo++) {      //and the MO's
-          T temp;
-          if(coeffmat(mo,ion, f) == -1) {
-            temp=T(0.0);
-            //cout << "missing MO pointer: mo# " << mo << " ion # " << ion
-            //<< " function on ion: " << f << endl;
-            //error("In the orb file, there is a missing pointer. It might "
-            //      "be a badly structured file.");
-          }
-          else temp=coeff(coeffmat(mo,ion,f));
-          if(abs(temp) > threshold) {
-            mofill(mo, nbasis(mo))=totfunc;
-            moCoeff2(mo, nbasis(mo))=kptfac*magnification_factor*temp;
-            nbasis(mo)++;
-          }
+        int fnum=centers.basis(ion,n);
+        int imax=basis(fnum)->nfunc();
 
-        }//mo
-        f++;  //keep a total of functions on center
-        totfunc++;
-      } //i
-    } //n
-  }  //ion
-  symmvals_temp1d.Resize(maxbasis);
-  symmvals_temp2d.Resize(maxbasis,10);
+        for(int i=0; i<imax; i++) { //sum over the symmetries
+          for(int mo=0; mo<nmo; mo++) {      //and the MO's
+            T temp;
+            if(coeffmat(mo,ion, f) == -1) {
+              temp=T(0.0);
+              //cout << "missing MO pointer: mo# " << mo << " ion # " << ion
+              //<< " function on ion: " << f << endl;
+              //error("In the orb file, there is a missing pointer. It might "
+              //      "be a badly structured file.");
+            }
+            else temp=coeff(coeffmat(mo,ion,f));
+            doublevar size=abs(kptfac*magnification_factor*temp);
+            if(abs(temp) > threshold 
+               && (localized_tolerance <= 0 
+                   || basis(fnum)->boundRadius(i, localized_tolerance/size) > 0)) {
+              mofill(mo, nbasis(mo))=totfunc;
+              moCoeff2(mo, nbasis(mo))=C(kptfac*magnification_factor*temp);
+              nbasis(mo)++;
+            }
 
+          }//mo
+          f++;  //keep a total of functions on center
+          totfunc++;
+        } //i
+      } //n
+    }  //ion
+  }
+  shared_tables.sync();
+
+  thread_symmvals1d.Resize(qmc_max_threads());
+  thread_symmvals2d.Resize(qmc_max_threads());
+  thread_crowdbasis.Resize(qmc_max_threads());
+  thread_crowdactive.Resize(qmc_max_threads());
+  thread_crowdvals.Resize(qmc_max_threads());
+  for(int t=0; t< thread_symmvals1d.GetDim(0); t++) {
+    thread_symmvals1d(t).Resize(maxbasis);
+    thread_symmvals2d(t).Resize(maxbasis,10);
+  }
+
+  int nbasisobj=basis.GetDim(0);
+  Array1 <int> ncenters_basis(nbasisobj);
+  ncenters_basis=0;
+  for(int ion=0; ion< centers.size(); ion++)
+    for(int n=0; n< centers.nbasis(ion); n++)
+      ncenters_basis(centers.basis(ion,n))++;
+  thread_batchdist.Resize(qmc_max_threads());
+  thread_batchvals.Resize(qmc_max_threads());
+  thread_batchcount.Resize(qmc_max_threads());
+  for(int t=0; t< thread_batchdist.GetDim(0); t++) {
+    thread_batchdist(t).Resize(nbasisobj);
+    thread_batchvals(t).Resize(nbasisobj);
+    thread_batchcount(t).Resize(nbasisobj);
+    for(int b=0; b< nbasisobj; b++) {
+      thread_batchdist(t)(b).Resize(max(ncenters_basis(b),1),5);
+      thread_batchvals(t)(b).Resize(max(ncenters_basis(b)*nfunctions(b),1),5);
+    }
+  }
+
+  thread_nonzero.Resize(qmc_max_threads());
+  thread_nnonzero.Resize(qmc_max_threads());
+  thread_orbmark.Resize(qmc_max_threads());
+  thread_markcount.Resize(qmc_max_threads());
+  thread_nnonzero=-1;
+  thread_markcount=0;
 }
 
 //---------------------------------------------------------------------------------------------
 
-template<class T> void MO_matrix_cutoff<T>::writeorb(ostream & os, 
+template <class T, class C> void MO_matrix_cutoff<T,C>::writeorb(ostream & os, 
     Array2 <doublevar> & rotation, Array1 <int>  &moList) {
 
 
@@ -362,16 +490,23 @@ template<class T> void MO_matrix_cutoff<T>::writeorb(ostream & os,
 }
 //---------------------------------------------------------------------
 
-template <class T> void MO_matrix_cutoff<T>::buildLists(Array1 < Array1 <int> > & occupations){
+template <class T, class C> void MO_matrix_cutoff<T,C>::buildLists(Array1 < Array1 <int> > & occupations){
   int numlists=occupations.GetDim(0);
+  //the lists from an earlier call may be views of shared memory
+  for(int lis=0; lis < basisfill_list.GetDim(0); lis++) { 
+    basisfill_list(lis).clear();
+    moCoeff_list(lis).clear();
+  }
+  list_tables.clear();
   basisfill_list.Resize(numlists);
   moCoeff_list.Resize(numlists);
   basismo_list.Resize(numlists);
+  const int fill=Shared_tables::writer();
   for(int lis=0; lis < numlists; lis++)
   {
     int nmo_list=occupations(lis).GetDim(0);
-    basisfill_list(lis).Resize(totbasis, nmo_list);
-    moCoeff_list(lis).Resize(totbasis, nmo_list);
+    list_tables.allocate(basisfill_list(lis), totbasis, nmo_list);
+    list_tables.allocate(moCoeff_list(lis), totbasis, nmo_list);
     basismo_list(lis).Resize(totbasis);
     basismo_list(lis)=0;
     for(int i=0; i < nmo_list; i++)
@@ -382,8 +517,11 @@ template <class T> void MO_matrix_cutoff<T>::buildLists(Array1 < Array1 <int> >
         int func=mofill(mo, bas);
 
         //basisfill_list(lis)(func, basismo_list(lis)(func))=mo;
-        basisfill_list(lis)(func, basismo_list(lis)(func))=i;
-        moCoeff_list(lis)(func, basismo_list(lis)(func))=moCoeff2(mo, bas);
+        //every process needs the counts, but only the writer stores
+        if(fill) { 
+          basisfill_list(lis)(func, basismo_list(lis)(func))=i;
+          moCoeff_list(lis)(func, basismo_list(lis)(func))=moCoeff2(mo, bas);
+        }
         //cout << "basisfill_list " << 2 << "  f  "
         //     << func << "  mo " <<  mo;
         //cout << "  basis coeff " << moCoeff2(mo, bas) << endl;
@@ -393,15 +531,142 @@ template <class T> void MO_matrix_cutoff<T>::buildLists(Array1 < Array1 <int> >
       }
     }
   }
+  list_tables.sync();
+
+  if(localized) { 
+    //the center of each function, and which basis object it comes from
+    Array1 <int> func_center(totbasis), func_basis(totbasis), func_index(totbasis);
+    int f=0;
+    for(int ion=0; ion< centers.size(); ion++) { 
+      for(int j=0; j< centers.nbasis(ion); j++) { 
+        int b=centers.basis(ion,j);
+        for(int n=0; n< basis(b)->nfunc(); n++) { 
+          func_center(f)=ion;
+          func_basis(f)=b;
+          func_index(f)=n;
+          f++;
+        }
+      }
+    }
+    int ncenters=centers.size();
+    int maxlist=1;
+    center_orb_start.Resize(numlists);
+    center_orb.Resize(numlists);
+    center_orb_radius.Resize(numlists);
+    Array1 <doublevar> radius(ncenters);
+    radius=-1.0;
+    for(int lis=0; lis < numlists; lis++) { 
+      int nmo_list=occupations(lis).GetDim(0);
+      maxlist=max(maxlist, nmo_list);
+      vector < vector <int> > orbs(ncenters);
+      vector < vector <doublevar> > radii(ncenters);
+      for(int i=0; i< nmo_list; i++) { 
+        int mo=occupations(lis)(i);
+        for(int bas=0; bas < nbasis(mo); bas++) { 
+          int func=mofill(mo,bas);
+          int ion=func_center(func);
+          doublevar r=cutoff(func);
+          if(localized_tolerance > 0) 
+            r=basis(func_basis(func))->boundRadius(func_index(func),
+                       localized_tolerance/abs(moCoeff2(mo,bas)));
+          radius(ion)=max(radius(ion), r);
+        }
+        for(int bas=0; bas < nbasis(mo); bas++) { 
+          int ion=func_center(mofill(mo,bas));
+          if(radius(ion) >= 0) { 
+            orbs[ion].push_back(i);
+            radii[ion].push_back(radius(ion));
+            radius(ion)=-1.0;
+          }
+        }
+      }
+      center_orb_start(lis).Resize(ncenters+1);
+      int count=0;
+      for(int ion=0; ion< ncenters; ion++) { 
+        center_orb_start(lis)(ion)=count;
+        count+=orbs[ion].size();
+      }
+      center_orb_start(lis)(ncenters)=count;
+      center_orb(lis).Resize(max(count,1));
+      center_orb_radius(lis).Resize(max(count,1));
+      for(int ion=0; ion< ncenters; ion++) { 
+        int start=center_orb_start(lis)(ion);
+        for(unsigned int k=0; k< orbs[ion].size(); k++) { 
+          center_orb(lis)(start+k)=orbs[ion][k];
+          center_orb_radius(lis)(start+k)=radii[ion][k];
+        }
+      }
+    }
+    for(int t=0; t< thread_nonzero.GetDim(0); t++) { 
+      thread_nonzero(t).Resize(maxlist);
+      thread_orbmark(t).Resize(maxlist);
+      thread_orbmark(t)=0;
+      thread_markcount(t)=0;
+      thread_nnonzero(t)=-1;
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+/*!
+The orbitals of list listnum whose support contains electron e; 
+centers.updateDistance() must have been called for e.  An orbital is
+marked with the count of this call the first time it's found, so nothing
+needs to be cleared in between.
+*/
+template <class T, class C> void MO_matrix_cutoff<T,C>::findNonzero(int e, int listnum) { 
+  int t=qmc_thread_num();
+  Array1 <int> & nonzero(thread_nonzero(t));
+  Array1 <int> & mark(thread_orbmark(t));
+  if(thread_markcount(t)==INT_MAX) { 
+    mark=0;
+    thread_markcount(t)=0;
+  }
+  int count=++thread_markcount(t);
+  Array1 <int> & start(center_orb_start(listnum));
+  Array1 <int> & orb(center_orb(listnum));
+  Array1 <doublevar> & radius(center_orb_radius(listnum));
+  Array1 <doublevar> R(5);
+  int n=0;
+  int nnear=centers.nnear(e);
+  for(int k=0; k < nnear; k++) { 
+    int ion=centers.nearCenter(e,k);
+    centers.getDistance(e,ion,R);
+    if(R(0) >= center_range(ion)) continue;
+    for(int j=start(ion); j< start(ion+1); j++) { 
+      int i=orb(j);
+      if(R(0) < radius(j) && mark(i)!=count) { 
+        mark(i)=count;
+        nonzero(n++)=i;
+      }
+    }
+  }
+  thread_nnonzero(t)=n;
 }
 
 
 //----------------------------------------------------------------------
 
-template <class T> int MO_matrix_cutoff<T>::showinfo(ostream & os)
+template <class T, class C> int MO_matrix_cutoff<T,C>::showinfo(ostream & os)
 {
   os << "Cutoff MO " << endl;
   os << "Number of molecular orbitals: " << nmo << endl;
+  if(localized) { 
+    os << "Localized orbitals: only the nonzero orbitals are used" << endl;
+    if(localized_tolerance > 0)
+      os << "Tolerance for the orbital supports: " << localized_tolerance << endl;
+    doublevar nonzero=0;
+    for(int mo=0; mo< nmo; mo++) nonzero+=nbasis(mo);
+    os << "Average nonzero coefficients per orbital: " << nonzero/max(nmo,1)
+       << " of " << totbasis << endl;
+  }
+  if(sizeof(C) < sizeof(T))
+    os << "Coefficients stored in single precision" << endl;
+  if(Shared_tables::active())
+    os << "Tables shared on the node: " 
+       << (shared_tables.sharedBytes()+list_tables.sharedBytes())/1024.0/1024.0
+       << " MB" << endl;
   string indent="  ";
   os << "Basis functions: \n";
   for(int i=0; i< basis.GetDim(0); i++)
@@ -411,7 +676,7 @@ template <class T> int MO_matrix_cutoff<T>::showinfo(ostream & os)
   return 1;
 }
 
-template <class T> int MO_matrix_cutoff<T>::writeinput(string & indent, ostream & os)
+template <class T, class C> int MO_matrix_cutoff<T,C>::writeinput(string & indent, ostream & os)
 {
   os << indent << "CUTOFF_MO" << endl;
   os << indent << "NMO " << nmo << endl;
@@ -419,6 +684,12 @@ template <class T> int MO_matrix_cutoff<T>::writeinput(string & indent, ostream
   //if(oldsofile!="") 
   //  os << indent << "OLDSOFILE " << oldsofile << endl;
   os << indent << "MAGNIFY " << magnification_factor << endl;
+  if(sizeof(C) < sizeof(T))
+    os << indent << "SINGLE_PRECISION" << endl;
+  if(localized)
+    os << indent << "LOCALIZED" << endl;
+  if(localized_tolerance > 0)
+    os << indent << "LOCALIZED_TOLERANCE " << localized_tolerance << endl;
   string indent2=indent+"  ";
   for(int i=0; i< basis.GetDim(0); i++)
   {
@@ -434,17 +705,16 @@ template <class T> int MO_matrix_cutoff<T>::writeinput(string & indent, ostream
 }
 //------------------------------------------------------------------------
 
-template <class T> void MO_matrix_cutoff<T>::updateVal(
+template <class T, class C> void MO_matrix_cutoff<T,C>::updateVal(
   Sample_point * sample,  int e,  int listnum,  Array2 <T> & newvals) {
   //cout << "start updateval " << endl;
-  int centermax=centers.size();
-  static Array1 <doublevar> R(5);
-  //Array1 <doublevar> symmvals_temp(maxbasis);
+  Array1 <doublevar> R(5);
+  Array1 <doublevar> & symmvals_temp1d(thread_symmvals1d(qmc_thread_num()));
 
   //Make references for easier access to the list variables.
   Array1 <int> & basismotmp(basismo_list(listnum));
   Array2 <int> & basisfilltmp(basisfill_list(listnum));
-  Array2 <T> & moCoefftmp(moCoeff_list(listnum));
+  Array2 <C> & moCoefftmp(moCoeff_list(listnum));
   assert(newvals.GetDim(1) >= 1);
 
   newvals=0;
@@ -454,12 +724,15 @@ template <class T> void MO_matrix_cutoff<T>::updateVal(
   T c;
   int mo=0;
   int scalebasis=basisfill_list(listnum).GetDim(1);
-  int totfunc=0;
   int b; //basis
   //cout << "here " << endl;
   centers.updateDistance(e, sample);
+  if(localized) findNonzero(e, listnum);
   //int retscale=newvals.GetDim(1);
-  for(int ion=0; ion < centermax; ion++) {
+  int nnear=centers.nnear(e);
+  for(int k=0; k < nnear; k++) {
+    int ion=centers.nearCenter(e,k);
+    int totfunc=center_func(ion);
     //sample->getECDist(e, ion, R);
     centers.getDistance(e,ion,R);
     for(int n=0; n< centers.nbasis(ion); n++) {
@@ -480,7 +753,7 @@ template <class T> void MO_matrix_cutoff<T>::updateVal(
               mo=basisfilltmp.v[reducedbasis+basmo];
               //cout << "mocoeff (mo=" << mo <<  endl;
               //mo_counter(mo)++;
-              c=moCoefftmp.v[reducedbasis+basmo];
+              c=T(moCoefftmp.v[reducedbasis+basmo]);
 
               newvals(mo, 0)+=c*symmvals_temp1d(i);
               //newvals.v[retscale*mo]+=c*symmvals_temp.v[i];
@@ -501,100 +774,178 @@ template <class T> void MO_matrix_cutoff<T>::updateVal(
 
 //------------------------------------------------------------------------
 
-template <class T>void MO_matrix_cutoff<T>::updateLap( Sample_point * sample,
+template <class T, class C> void MO_matrix_cutoff<T,C>::updateLap( Sample_point * sample,
   int e, int listnum, Array2 <T> & newvals) {
 
-  //cout << "updateLap" << endl;
-  int centermax=centers.size();
-  //int momax=occupation.GetDim(0);
   newvals=0;
-  //assert(momax <= nmo);
   assert(e < sample->electronSize());
   assert(newvals.GetDim(1) >=5);
 
-  // cout << "array " << endl;
   Array1 <doublevar> R(5);
-  // cout << "symvals " << endl;
-   //cout << "arrayref " << endl;
+  int t=qmc_thread_num();
+  Array1 < Array2 <doublevar> > & batchdist(thread_batchdist(t));
+  Array1 < Array2 <doublevar> > & batchvals(thread_batchvals(t));
+  Array1 <int> & batchcount(thread_batchcount(t));
 
   //References to make the code easier to read and slightly faster.
   Array1 <int> & basismotmp(basismo_list(listnum));
   Array2 <int> & basisfilltmp(basisfill_list(listnum));
-  Array2 <T> & moCoefftmp(moCoeff_list(listnum));
+  Array2 <C> & moCoefftmp(moCoeff_list(listnum));
 
-  Basis_function * tempbasis;
+  //Gather the centers within range of each basis object, so that each
+  //basis evaluates all of its centers in one call.
+  centers.updateDistance(e, sample);
+  if(localized) findNonzero(e, listnum);
+  int nbasisobj=basis.GetDim(0);
+  for(int b=0; b< nbasisobj; b++) batchcount(b)=0;
+  int nnear=centers.nnear(e);
+  for(int k=0; k < nnear; k++) {
+    int ion=centers.nearCenter(e,k);
+    centers.getDistance(e, ion, R);
+    for(int n=0; n< centers.nbasis(ion); n++) {
+      int b=centers.basis(ion, n);
+      if(R(0) < obj_cutoff(b)) {
+        doublevar * row=batchdist(b).v+batchcount(b)*batchdist(b).step1;
+        for(int d=0; d< 5; d++) row[d]=R(d);
+        batchcount(b)++;
+      }
+    }
+  }
+  for(int b=0; b< nbasisobj; b++) {
+    if(batchcount(b) > 0)
+      basis(b)->calcLapCenters(batchdist(b), batchcount(b), batchvals(b));
+    batchcount(b)=0;
+  }
 
   T c;
   int scaleval=0, scalesymm=0;
   int mo=0;
   int scalebasis=basisfilltmp.GetDim(1);
-  centers.updateDistance(e, sample);
-  int totfunc=0;
-  int b;
-  int symmvals_stride=symmvals_temp2d.GetDim(1);
-  for(int ion=0; ion < centermax; ion++) {
+  for(int k=0; k < nnear; k++) {
+    int ion=centers.nearCenter(e,k);
+    int totfunc=center_func(ion);
     centers.getDistance(e, ion, R);
     for(int n=0; n< centers.nbasis(ion); n++) {
-      b=centers.basis(ion, n);
-      tempbasis=basis(b);
-      if(R(0) < obj_cutoff(b)) {
-       // cout << "basis " << endl;
-      tempbasis->calcLap(R, symmvals_temp2d);
-
+      int b=centers.basis(ion, n);
       int imax=nfunctions(b);
-      for(int i=0; i< imax; i++) {
-        //cout << "i " << i << endl;
-
-        int reducedbasis=scalebasis*totfunc;
-        scalesymm=i*symmvals_stride;
-        if(R(0) < cutoff(totfunc)) {
-          for(int basmo=0; basmo < basismotmp.v[totfunc]; basmo++) {
-            //mo=basisfill(basis, basmo);
-            //c=moCoeff(basis, basmo);
-
-            mo=basisfilltmp.v[reducedbasis+basmo];
-            c=moCoefftmp.v[reducedbasis+basmo];
-            //cout << c << "   ";
-
-            //mo_counter(mo)++;
+      if(R(0) < obj_cutoff(b)) {
+        //the centers were gathered in this same order
+        int slot=batchcount(b)++;
+        int symmvals_stride=batchvals(b).step1;
+        doublevar * symmvals=batchvals(b).v+slot*imax*symmvals_stride;
+        for(int i=0; i< imax; i++) {
+          int reducedbasis=scalebasis*totfunc;
+          scalesymm=i*symmvals_stride;
+          if(R(0) < cutoff(totfunc)) {
+            for(int basmo=0; basmo < basismotmp.v[totfunc]; basmo++) {
+              mo=basisfilltmp.v[reducedbasis+basmo];
+              c=T(moCoefftmp.v[reducedbasis+basmo]);
+              scaleval=mo*5;
+              for(int j=0; j< 5; j++) {
+                newvals.v[scaleval+j]+=c*symmvals[scalesymm+j];
+              }
+            }
+          }
+          totfunc++;
+        }
+      }
+      else {
+        totfunc+=imax;
+      }
+    }
+  }
+}
 
-            scaleval=mo*5;
-            //cout << "coeff " << c << endl;
-            //cout << "reducedbasis " << reducedbasis << endl;
-            // cout << mo << "   " << basmo << "   " << c << endl;
+//--------------------------------------------------------------------------
 
+/*!
+The basis functions are evaluated walker by walker into one table, and 
+then each coefficient is applied to all the walkers at once, so the 
+coefficients are streamed through once per crowd instead of once per 
+walker.  A function that is cut off for one walker but not another has
+value zero there, so each walker gets exactly what updateLap() gives.
+*/
+template <class T, class C> void MO_matrix_cutoff<T,C>::updateLapCrowd(
+  Array1 <Sample_point *> & samples, int e, int listnum, 
+  Array1 <Array2 <T> *> & newvals) { 
+  int nw=samples.GetDim(0);
+  int t=qmc_thread_num();
+  Array1 <doublevar> R(5);
+  Array2 <doublevar> & symmvals_temp2d(thread_symmvals2d(t));
+  Array2 <doublevar> & bval(thread_crowdbasis(t));
+  Array1 <int> & active(thread_crowdactive(t));
+  Array2 <T> & vals(thread_crowdvals(t));
 
-            for(int j=0; j< 5; j++) {
-              //newvals(mo,j)+=c*symmvals(fn,j);
-              newvals.v[scaleval+j]+=c*symmvals_temp2d.v[scalesymm+j];
-              //cout << "newvals(" << mo << "," << j << ")  " << newvals(mo,j) << endl;
-              //cout << "symmvals(" << j << ")  " << symmvals(fn,j) << endl;
+  Array1 <int> & basismotmp(basismo_list(listnum));
+  Array2 <int> & basisfilltmp(basisfill_list(listnum));
+  Array2 <C> & moCoefftmp(moCoeff_list(listnum));
+  int scalebasis=basisfilltmp.GetDim(1);
+  int symmvals_stride=symmvals_temp2d.GetDim(1);
+  int width=5*nw;
+
+  bval.Resize(totbasis, width);
+  active.Resize(totbasis);
+  active=0;
+  thread_nnonzero(t)=-1;
+  for(int w=0; w< nw; w++) { 
+    assert(e < samples(w)->electronSize());
+    centers.updateDistance(e, samples(w));
+    int nnear=centers.nnear(e);
+    for(int k=0; k < nnear; k++) {
+      int ion=centers.nearCenter(e,k);
+      int totfunc=center_func(ion);
+      centers.getDistance(e, ion, R);
+      for(int n=0; n< centers.nbasis(ion); n++) {
+        int b=centers.basis(ion, n);
+        if(R(0) < obj_cutoff(b)) {
+          basis(b)->calcLap(R, symmvals_temp2d);
+          int imax=nfunctions(b);
+          for(int i=0; i< imax; i++) {
+            if(R(0) < cutoff(totfunc)) {
+              doublevar * bv=bval.v+totfunc*width;
+              if(!active(totfunc)) { 
+                for(int k=0; k< width; k++) bv[k]=0.0;
+                active(totfunc)=1;
+              }
+              for(int j=0; j< 5; j++) 
+                bv[j*nw+w]=symmvals_temp2d.v[i*symmvals_stride+j];
             }
+            totfunc++;
           }
-          //cout << endl;
-
         }
-
-        totfunc++;
+        else totfunc+=nfunctions(b);
       }
     }
-    else {
-      totfunc+=nfunctions(b);
-    }
-    }
   }
 
+  int nmo_list=newvals(0)->GetDim(0);
+  vals.Resize(nmo_list, width);
+  vals=T(0.0);
+  for(int f=0; f< totbasis; f++) { 
+    if(!active(f)) continue;
+    const doublevar * bv=bval.v+f*width;
+    int reducedbasis=scalebasis*f;
+    for(int basmo=0; basmo < basismotmp.v[f]; basmo++) { 
+      int mo=basisfilltmp.v[reducedbasis+basmo];
+      T c=T(moCoefftmp.v[reducedbasis+basmo]);
+      T * v=vals.v+mo*width;
+      for(int k=0; k< width; k++) 
+        v[k]+=c*bv[k];
+    }
+  }
 
-  //n_calls++;
-  
-  //cout << "newvals " << endl;
-  //output_array(newvals);
-
+  for(int w=0; w< nw; w++) { 
+    Array2 <T> & nv(*newvals(w));
+    assert(nv.GetDim(1) >= 5);
+    for(int mo=0; mo < nmo_list; mo++) 
+      for(int j=0; j< 5; j++) 
+        nv(mo,j)=vals(mo,j*nw+w);
+  }
 }
 
 //--------------------------------------------------------------------------
 
-template <class T>void MO_matrix_cutoff<T>::updateHessian(
+template <class T, class C> void MO_matrix_cutoff<T,C>::updateHessian(
   Sample_point * sample,
   int e,
   int listnum,
@@ -605,19 +956,18 @@ template <class T>void MO_matrix_cutoff<T>::updateHessian(
 )
 {
 
-  int centermax=centers.size();
   newvals=0;
   assert(e < sample->electronSize());
   assert(newvals.GetDim(1)==10);
   
 
   Array1 <doublevar> R(5);
- // static Array2 <doublevar> symmvals_temp(maxbasis,10);
+  Array2 <doublevar> & symmvals_temp2d(thread_symmvals2d(qmc_thread_num()));
 
   //References to make the code easier to read and slightly faster.
   Array1 <int> & basismotmp(basismo_list(listnum));
   Array2 <int> & basisfilltmp(basisfill_list(listnum));
-  Array2 <T> & moCoefftmp(moCoeff_list(listnum));
+  Array2 <C> & moCoefftmp(moCoeff_list(listnum));
 
   Basis_function * tempbasis;
 
@@ -626,10 +976,13 @@ template <class T>void MO_matrix_cutoff<T>::updateHessian(
   int mo=0;
   int scalebasis=basisfilltmp.GetDim(1);
   centers.updateDistance(e, sample);
-  int totfunc=0;
+  if(localized) findNonzero(e, listnum);
   int b;
   int symmvals_stride=symmvals_temp2d.GetDim(1);
-  for(int ion=0; ion < centermax; ion++)  {
+  int nnear=centers.nnear(e);
+  for(int k=0; k < nnear; k++)  {
+    int ion=centers.nearCenter(e,k);
+    int totfunc=center_func(ion);
     centers.getDistance(e, ion, R);
     for(int n=0; n< centers.nbasis(ion); n++)  {
       b=centers.basis(ion, n);
@@ -644,7 +997,7 @@ template <class T>void MO_matrix_cutoff<T>::updateHessian(
           if(R(0) < cutoff(totfunc))  {
             for(int basmo=0; basmo < basismotmp.v[totfunc]; basmo++)   {
               mo=basisfilltmp.v[reducedbasis+basmo];
-              c=moCoefftmp.v[reducedbasis+basmo];
+              c=T(moCoefftmp.v[reducedbasis+basmo]);
               scaleval=mo*symmvals_stride;
               for(int j=0; j< 10; j++) {
                 newvals.v[scaleval+j]+=c*symmvals_temp2d.v[scalesymm+j];
@@ -48,13 +48,10 @@ void MO_matrix_standard::init() {
   for(int ion=0; ion<centers.size(); ion++)
   {
     int f=0;
-    doublevar dot=0;
-    for(int d=0; d<3; d++) dot+=centers.centers_displacement(ion,d)*kpoint(d);
-    
-    cout << "kptfac " << cos(dot*pi) << "  displacement " 
+    doublevar kptfac=center_kpoint_fac<doublevar>(centers, ion);
+    cout << "kptfac " << kptfac << "  displacement " 
         << centers.centers_displacement(ion,0) << "   "
         << endl;            
-    doublevar kptfac=cos(dot*pi);
     
     for(int n=0; n< centers.nbasis(ion); n++)
     {
@@ -61,6 +61,25 @@ public:
   ;
 };
 
+#ifndef NDEBUG
+//! Number of arrays allocated so far by this thread.  Only debug builds
+//! keep count; it lets code that shouldn't touch the heap be checked
+//! (see Test_method).
+extern long int array_allocations;
+#ifdef _OPENMP
+#pragma omp threadprivate(array_allocations)
+#endif
+#endif
+
+//! All the Array classes get their storage from here
+template <class T> inline T * array_alloc(int n)
+{
+#ifndef NDEBUG
+  array_allocations++;
+#endif
+  return new T[n];
+}
+
 // Limits is an inline function that checks indices
 inline void Limits(const int n, const int max)
 {
@@ -141,7 +160,7 @@ public:
   }
   
   // Make a copy of the array and copy elements
-  Array1(const Array1& a):size(a.size),mSize(a.mSize), rank(1),v(new T[mSize]),b(a.b) {
+  Array1(const Array1& a):size(a.size),mSize(a.mSize), rank(1),v(array_alloc<T>(mSize)),b(a.b) {
     //cout << "1";
     //cout << "  Copying array1 size="
   //<< size << "mSize=" << mSize << " " << b << endl;
@@ -157,7 +176,7 @@ public:
   }
 
   // Create without initialization
-  Array1(int n):size(n),mSize(n),rank(1),v(new T[n]),b(true)
+  Array1(int n):size(n),mSize(n),rank(1),v(array_alloc<T>(n)),b(true)
   {
     //    cout << "  Array [" << n << "] of size "
     //	 << size << " x " << sizeof(T) << " allocated.\n";
@@ -267,7 +286,7 @@ public:
     {
       if (v)
         delete[] v;
-        v = new T[n];
+        v = array_alloc<T>(n);
 #ifdef NO_EXCEPTIONS
         if(v==NULL) error("Couldn't allocate Array");
 #endif
@@ -289,7 +308,7 @@ public:
       error ("Cannot copy and resize sub-array");
     if (n>mSize)
     {
-      T* vv = new T[n];
+      T* vv = array_alloc<T>(n);
       for(int i=0;i<size;i++)
         vv[i] = v[i];
       if (v)
@@ -309,7 +328,7 @@ public:
       mn=n;
     if (mn>mSize)
     {
-      T* vv = new T[n];
+      T* vv = array_alloc<T>(n);
 #ifdef NO_EXCEPTIONS
         if(vv==NULL) error("Couldn't allocate storage to resize array");
 #endif
@@ -435,7 +454,7 @@ public:
       size(n1*n2),
       mSize(size),
       rank(2),
-      v(new T[size]),
+      v(array_alloc<T>(size)),
       b(true)
   {
    
@@ -565,7 +584,7 @@ public:
     {
       if (v)
         delete[] v;
-      v = new T[nn];
+      v = array_alloc<T>(nn);
 #ifdef NO_EXCEPTIONS
         if(v==NULL) error("Couldn't allocate Array");
 #endif
@@ -588,7 +607,7 @@ public:
     int nn= n1*n2;
     if ((n1!=dim[0]) || (nn>mSize))
     {
-      T* vv=new T[nn];
+      T* vv=array_alloc<T>(nn);
 #ifdef NO_EXCEPTIONS
         if(vv==NULL) error("Couldn't allocate Array");
 #endif
@@ -731,7 +750,7 @@ public:
       step2(n3),
       size(n1*step1),
       rank(3),
-      v(new T[size]),
+      v(array_alloc<T>(size)),
       b(true)
   {
 #ifdef NO_EXCEPTIONS
@@ -842,7 +861,7 @@ public:
       if (v)
         delete[] v;
       size=sizen;
-      v = new T[size];
+      v = array_alloc<T>(size);
 #ifdef NO_EXCEPTIONS
         if(v==NULL) error("Couldn't allocate Array");
 #endif
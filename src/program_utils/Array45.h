@@ -55,7 +55,7 @@ public:
       step3(n4),
       size(n1*step1),
       rank(4),
-      v(new T[size])
+      v(array_alloc<T>(size))
   {
     dim[0] = n1;
     dim[1] = n2;
@@ -147,7 +147,7 @@ public:
       if (v)
         delete[] v;
       size=sizen;
-      v = new T[size];
+      v = array_alloc<T>(size);
     }
     dim[0] = n1;
     dim[1] = n2;
@@ -213,7 +213,7 @@ public:
       step4(n5),
       size(n1*step1),
       rank(5),
-      v(new T[size])
+      v(array_alloc<T>(size))
   {
     dim[0] = n1;
     dim[1] = n2;
@@ -307,7 +307,7 @@ public:
       if (v)
         delete[] v;
       size=sizen;
-      v = new T[size];
+      v = array_alloc<T>(size);
     }
     dim[0] = n1;
     dim[1] = n2;
@@ -134,6 +134,44 @@ template <class T> T InverseGetNewRatio(const Array2 <T> & a1,
    
 }
 
+/*!
+  InverseUpdateColumn() for a new column whose only nonzero elements are
+  newCol(cols(k)), k < ncols, as for localized orbitals.  Finding the 
+  change to the inverse is then O(n*ncols) instead of O(n^2); applying
+  it is still O(n^2).  Returns Det(a_old)/Det(a_new).
+*/
+template <class T> T InverseUpdateColumnSparse(Array2 <T> & a1, 
+     const Array1 <T> & newCol, const Array1 <int> & cols, const int ncols,
+     const int lCol, const int n, Array1 <T> & work) { 
+  work.Resize(2*n);
+  T * tmpColL=work.v;
+  T * prod=work.v+n;
+
+  T f=T(0.0);
+  for(int k=0; k< ncols; k++) 
+    f+=a1(lCol,cols(k))*newCol(cols(k));
+  f=T(-1.0)/f;
+
+  for(int j=0; j< n; j++) { 
+    tmpColL[j]=a1(lCol,j);
+    T p=T(0.0);
+    for(int k=0; k< ncols; k++) 
+      p+=a1(j,cols(k))*newCol(cols(k));
+    prod[j]=p*f;
+  }
+
+  for(int i=0; i< n; i++) { 
+    T p=prod[i];
+    for(int j=0; j< n; j++) 
+      a1(i,j)+=tmpColL[j]*p;
+  }
+
+  f=-f;
+  for(int j=0; j< n; j++) 
+    a1(lCol,j)=f*tmpColL[j];
+  return f;
+}
+
 
 doublevar InverseGetNewRatioRow(const Array2 <doublevar> & a1, const Array1 <doublevar> & newRow,
                              const int lRow, const int n);
@@ -99,6 +99,14 @@ int dgetrs(char trans, int n, int nrhs, double * A, int lda, int * ipiv,
 
 const doublevar TINY=1.0e-20;
 
+//Scratch for the routines below.  Walker threads in DMC call them at the
+//same time, so each thread has its own.
+extern Array2 <doublevar> tmp2;
+extern Array1 <doublevar> tmp11,tmp12;
+extern Array1 <int> itmp1;
+#ifdef _OPENMP
+#pragma omp threadprivate(tmp2,tmp11,tmp12,itmp1)
+#endif
 Array2 <doublevar> tmp2;
 Array1 <doublevar> tmp11,tmp12;
 Array1 <int> itmp1;
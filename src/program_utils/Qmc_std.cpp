@@ -23,10 +23,15 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 namespace global_options {
   int rappture=0;
+  int share_tables=0;
 }
 
 mpi_info_struct mpi_info;
 
+#ifndef NDEBUG
+long int array_allocations=0;
+#endif
+
 #ifdef USE_MPI
 MPI_Comm MPI_Comm_grp;
 #endif
@@ -62,6 +62,29 @@ extern mpi_info_struct mpi_info;
 extern MPI_Comm MPI_Comm_grp;  // communicator for each independent process
 #endif
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//Thread index and maximum number of threads for shared-memory
+//walker parallelism.  Without OpenMP these are always 0 and 1, so
+//per-thread scratch arrays reduce to a single element.
+inline int qmc_thread_num() {
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+inline int qmc_max_threads() {
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
 int parallel_sum(int inp);
 doublevar parallel_sum(doublevar inp);
 dcomplex parallel_sum(dcomplex inp);
@@ -79,6 +102,7 @@ int MPI_Recv(string &, int node);
 
 namespace global_options {
   extern int rappture;
+  extern int share_tables; //!< keep read-only tables once per node (see Shared_tables)
 }
 
 class Program_options;
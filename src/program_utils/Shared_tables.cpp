@@ -0,0 +1,178 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Shared_tables.h"
+#include <cstring>
+
+#if defined(USE_MPI) && MPI_VERSION < 3
+#define SHARED_TABLES_POSIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef USE_MPI
+static MPI_Comm node_comm;
+static int node_rank=0;
+static int node_size=1;
+static int node_comm_set=0;
+#ifdef SHARED_TABLES_POSIX
+static long writer_pid=0;   //!< names the POSIX segments of this node
+static int segment_count=0;
+#else
+static vector <MPI_Win> windows;
+#endif
+
+/*!
+Split the group into the processes on each node.  This is collective,
+and happens on the first call to Shared_tables::active().
+*/
+static void setup_node_comm() {
+  if(node_comm_set) return;
+  node_comm_set=1;
+#ifdef SHARED_TABLES_POSIX
+  //processes with the same host name are on the same node
+  char name[MPI_MAX_PROCESSOR_NAME];
+  int len;
+  memset(name, 0, MPI_MAX_PROCESSOR_NAME);
+  MPI_Get_processor_name(name, &len);
+  Array1 <char> names(MPI_MAX_PROCESSOR_NAME*mpi_info.nprocs);
+  MPI_Allgather(name, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, names.v,
+                MPI_MAX_PROCESSOR_NAME, MPI_CHAR, MPI_Comm_grp);
+  int color=0;
+  while(strncmp(name, names.v+color*MPI_MAX_PROCESSOR_NAME,
+                MPI_MAX_PROCESSOR_NAME))
+    color++;
+  MPI_Comm_split(MPI_Comm_grp, color, mpi_info.node, &node_comm);
+#else
+  MPI_Comm_split_type(MPI_Comm_grp, MPI_COMM_TYPE_SHARED, mpi_info.node,
+                      MPI_INFO_NULL, &node_comm);
+#endif
+  MPI_Comm_rank(node_comm, &node_rank);
+  MPI_Comm_size(node_comm, &node_size);
+#ifdef SHARED_TABLES_POSIX
+  writer_pid=getpid();
+  MPI_Bcast(&writer_pid, 1, MPI_LONG, 0, node_comm);
+#endif
+}
+#endif
+
+//----------------------------------------------------------------------
+
+int Shared_tables::active() {
+#ifdef USE_MPI
+  if(!global_options::share_tables) return 0;
+  setup_node_comm();
+  return node_size > 1;
+#else
+  return 0;
+#endif
+}
+
+int Shared_tables::writer() {
+#ifdef USE_MPI
+  if(!active()) return 1;
+  return node_rank==0;
+#else
+  return 1;
+#endif
+}
+
+//----------------------------------------------------------------------
+
+void * Shared_tables::allocateBytes(size_t bytes) {
+  if(bytes==0) return NULL;
+  Segment s;
+  s.p=NULL;
+  s.bytes=bytes;
+  s.handle=0;
+#ifdef USE_MPI
+#ifdef SHARED_TABLES_POSIX
+  char name[64];
+  sprintf(name, "/qwalk_%ld_%d", writer_pid, segment_count++);
+  int fd=-1;
+  if(node_rank==0) {
+    fd=shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(fd < 0) error("Couldn't create shared memory segment ", name);
+    if(ftruncate(fd, bytes)) error("Couldn't size shared memory segment ", name);
+    s.p=mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  MPI_Barrier(node_comm);
+  if(node_rank!=0) {
+    fd=shm_open(name, O_RDONLY, 0);
+    if(fd < 0) error("Couldn't open shared memory segment ", name);
+    s.p=mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if(s.p==MAP_FAILED) error("Couldn't map shared memory segment ", name);
+  //the name is not needed once everyone has mapped it
+  MPI_Barrier(node_comm);
+  if(node_rank==0) shm_unlink(name);
+#else
+  MPI_Win win;
+  MPI_Win_allocate_shared(node_rank==0?bytes:0, 1, MPI_INFO_NULL,
+                          node_comm, &s.p, &win);
+  if(node_rank!=0) {
+    MPI_Aint size;
+    int disp;
+    MPI_Win_shared_query(win, 0, &size, &disp, &s.p);
+  }
+  s.handle=windows.size();
+  windows.push_back(win);
+#endif
+#endif
+  segments.push_back(s);
+  return s.p;
+}
+
+//----------------------------------------------------------------------
+
+void Shared_tables::sync() {
+#ifdef USE_MPI
+  if(active()) MPI_Barrier(node_comm);
+#endif
+}
+
+//----------------------------------------------------------------------
+
+void Shared_tables::clear() {
+#ifdef USE_MPI
+  for(vector<Segment>::iterator s=segments.begin(); s!=segments.end(); s++) {
+#ifdef SHARED_TABLES_POSIX
+    munmap(s->p, s->bytes);
+#else
+    MPI_Win_free(&windows[s->handle]);
+#endif
+  }
+#endif
+  segments.clear();
+}
+
+//----------------------------------------------------------------------
+
+doublevar Shared_tables::sharedBytes() {
+  doublevar sum=0;
+  for(vector<Segment>::iterator s=segments.begin(); s!=segments.end(); s++)
+    sum+=s->bytes;
+  return sum;
+}
+
+//----------------------------------------------------------------------
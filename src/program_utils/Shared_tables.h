@@ -0,0 +1,99 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef SHARED_TABLES_H_INCLUDED
+#define SHARED_TABLES_H_INCLUDED
+
+#include "Qmc_std.h"
+#include "Array.h"
+
+/*!
+\brief
+Node-level storage for tables that are read-only after setup.
+
+With the -share_tables command line option, one process per node (the
+writer) holds each table and the other processes on the node map the
+same memory, so the orbital coefficients and spline tables are kept
+once per node instead of once per process.  The memory comes from an
+MPI-3 shared window, or from POSIX shared memory with an older MPI.
+Without the option, or without MPI, every process keeps its own copy.
+
+Every call except writer() is collective over the processes of the
+group, so the objects that own tables must be built (and destroyed) in
+the same order on every process.
+*/
+class Shared_tables {
+public:
+  Shared_tables() { }
+  ~Shared_tables() { clear(); }
+
+  //! Whether tables are actually shared between processes
+  static int active();
+
+  //! Whether this process fills the tables (always true when not active)
+  static int writer();
+
+  /*!
+    Make a an array of n elements without filling it.  When active, only
+    writer() may store into it, and the others may read it after sync().
+    Fill it in place: a table built privately first would still cost
+    every process its full size while it's read in.
+   */
+  template <class T> void allocate(Array1 <T> & a, int n) {
+    if(!active()) { a.Resize(n); return; }
+    T * p=(T *) allocateBytes(sizeof(T)*n);
+    a.clear();
+    a.v=p; a.size=a.mSize=n; a.b=false;
+  }
+
+  //! As allocate(a,n), for an n0 by n1 array
+  template <class T> void allocate(Array2 <T> & a, int n0, int n1) {
+    if(!active()) { a.Resize(n0,n1); return; }
+    T * p=(T *) allocateBytes(sizeof(T)*n0*n1);
+    a.clear();
+    a.v=p; a.size=a.mSize=n0*n1; a.b=false;
+    a.dim[0]=n0; a.dim[1]=n1; a.step1=n1;
+  }
+
+  //! Wait until the writer on this node has filled the tables
+  void sync();
+
+  //! Release all the memory; the arrays referring to it are invalid afterwards
+  void clear();
+
+  //! Bytes held by this object in shared memory
+  doublevar sharedBytes();
+
+private:
+  void * allocateBytes(size_t bytes);
+  struct Segment {
+    void * p;
+    size_t bytes;
+    int handle; //!< MPI window or POSIX mapping, see Shared_tables.cpp
+  };
+  vector <Segment> segments;
+
+  //not copyable: the copy would release the segments twice
+  Shared_tables(const Shared_tables &);
+  Shared_tables & operator=(const Shared_tables &);
+};
+
+#endif //SHARED_TABLES_H_INCLUDED
+//----------------------------------------------------------------------
@@ -60,10 +60,14 @@ int main(int argc, char* argv[])
       global_options::rappture=1;
       inputfilestart=i+1;
     }
+    else if(caseless_eq(arg,"-share_tables")) {
+      global_options::share_tables=1;
+      inputfilestart=i+1;
+    }
   }
 
   if ( argc <= inputfilestart )
-    error("usage: ", argv[0], " [-rappture] filename(s)");
+    error("usage: ", argv[0], " [-rappture] [-share_tables] filename(s)");
 
   // No. of indeendent processes in the pack = No. of inputfiles
   int processcount=argc-inputfilestart;
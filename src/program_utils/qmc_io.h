@@ -422,6 +422,14 @@ template <class ConfigType> void write_configurations(string & filename,
     debug_write(cout, "Write took ", difftime(endtime, starttime), " seconds\n");
 }
 
+/*!
+The position in the file of this process's walker i after
+read_configurations(), which deals them out to the processes in turn.
+*/
+inline int config_file_index(int i) { 
+  return i*mpi_info.nprocs+mpi_info.node;
+}
+
 //Reads configurations from the file and gives an array with the configurations 
 //for this 
 template <class ConfigType> void read_configurations(string & filename, 
@@ -465,6 +473,7 @@ template <class ConfigType> void read_configurations(string & filename,
         if(dummy!="{") error("expected { in read_configurations()");
         tmpconf.read(is);
         //Now decide what to do with this configuration
+        //see config_file_index()
         int targetnode=currwalker%mpi_info.nprocs;
         if(targetnode==0) configs(currwalker_node0++)=tmpconf;
         else { 
@@ -26,6 +26,11 @@ Random_generator rng;
 double unif()
 {
   static int ix=1234567;
+#ifdef _OPENMP
+#pragma omp threadprivate(ix)
+#endif
+  //If a walker's stream is active, the random rotations belong to it too.
+  if(rng.getStream()) return rng.ulec();
   int k1=ix/127773;
   ix=16807*(ix-k1*127773)-k1*2836;
   if(ix < 0)
@@ -34,6 +39,51 @@ double unif()
 }
 
 
+//----------------------------------------------------------------------
+
+void Random_stream::write(ostream & os) { 
+  int oldprec=os.precision(17);
+  os << "rng_stream " << key[0] << " " << key[1] << " " << id << " " 
+     << block << " " << pos << " " << iset << " " << gset << endl;
+  os.precision(oldprec);
+}
+
+void Random_stream::read(istream & is) { 
+  string dummy;
+  is >> dummy;
+  if(dummy!="rng_stream") error("expected rng_stream, got ", dummy);
+  is >> key[0] >> key[1] >> id >> block >> pos >> iset >> gset;
+  if(pos < 0 || pos > 4) error("bad position in rng_stream ", pos);
+  if(pos < 4) philox(block-1, buf);
+  seeded=1;
+}
+
+void Random_stream::mpiSend(int node) { 
+#ifdef USE_MPI
+  uint64_t state[5]={key[0],key[1],id,block,uint64_t(pos)};
+  MPI_Send(state,5*sizeof(uint64_t),MPI_BYTE,node,0,MPI_Comm_grp);
+  MPI_Send(&iset,1,MPI_INT,node,0,MPI_Comm_grp);
+  MPI_Send(&gset,1,MPI_DOUBLE,node,0,MPI_Comm_grp);
+  MPI_Send(&seeded,1,MPI_INT,node,0,MPI_Comm_grp);
+#endif
+}
+
+void Random_stream::mpiReceive(int node) { 
+#ifdef USE_MPI
+  MPI_Status status;
+  uint64_t state[5];
+  MPI_Recv(state,5*sizeof(uint64_t),MPI_BYTE,node,0,MPI_Comm_grp,&status);
+  key[0]=uint32_t(state[0]); key[1]=uint32_t(state[1]);
+  id=state[2]; block=state[3]; pos=int(state[4]);
+  MPI_Recv(&iset,1,MPI_INT,node,0,MPI_Comm_grp,&status);
+  MPI_Recv(&gset,1,MPI_DOUBLE,node,0,MPI_Comm_grp,&status);
+  MPI_Recv(&seeded,1,MPI_INT,node,0,MPI_Comm_grp,&status);
+  if(pos < 4) philox(block-1, buf);
+#endif
+}
+
+//----------------------------------------------------------------------
+
 doublevar ranr2exponential() {
   while(1) { 
     doublevar ex=-log(rng.ulec())/.4;
@@ -22,6 +22,127 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define ULEC_H_INCLUDED
 
 #include "Qmc_std.h"
+#include <stdint.h>
+
+
+/*!
+Counter-based random stream (Philox4x32-10; Salmon et al., SC11).  
+Every number is a pure function of (key, stream id, counter), so a 
+walker that carries its own stream produces the same trajectory no
+matter which thread or process moves it, or in what order.
+*/
+class Random_stream
+{
+public:
+  Random_stream()
+  {
+    key[0]=key[1]=0;
+    id=0;
+    block=0;
+    pos=4;
+    iset=0;
+    gset=0;
+    seeded=0;
+  }
+
+  void seed(uint64_t seedval, uint64_t id_)
+  {
+    key[0]=uint32_t(seedval);
+    key[1]=uint32_t(seedval >> 32);
+    id=id_;
+    block=0;
+    pos=4;
+    iset=0;
+    seeded=1;
+  }
+  int isSeeded() { return seeded; }
+  uint64_t getId() { return id; }
+
+  /*!
+    Give this stream a new id derived from its current state.  Used 
+    when a walker is copied, so that the two copies decorrelate.
+  */
+  void spawn()
+  {
+    uint64_t z=id+0x9E3779B97F4A7C15ULL*(block*4+pos+1);
+    z=(z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+    z=(z ^ (z >> 27))*0x94D049BB133111EBULL;
+    id=z ^ (z >> 31);
+    block=0;
+    pos=4;
+    iset=0;
+  }
+
+  //! uniform on (0,1)
+  double ulec()
+  {
+    if(pos==4) {
+      philox(block++, buf);
+      pos=0;
+    }
+    return (buf[pos++]+0.5)*2.3283064365386963e-10;
+  }
+
+  //! Gaussian distributed random number
+  double gasdev()
+  {
+    if (iset ==0)
+    {
+      doublevar v1, v2, r, fac;
+      do
+      {
+        v1=2.*ulec() -1.;
+        v2=2.*ulec() -1.;
+        r=v1*v1 + v2*v2;
+      }
+      while ( r >= 1. || r == 0.);
+      fac=sqrt(-2.*log(r)/r);
+      gset=v1*fac;
+      iset=1;
+      return v2*fac;
+    }
+    else
+    {
+      iset=0;
+      return gset;
+    }
+  }
+
+  void read(istream & is);
+  void write(ostream & os);
+  void mpiSend(int node);
+  void mpiReceive(int node);
+
+private:
+  void philox(uint64_t ctr, uint32_t * out)
+  {
+    uint32_t c0=uint32_t(ctr), c1=uint32_t(ctr >> 32);
+    uint32_t c2=uint32_t(id), c3=uint32_t(id >> 32);
+    uint32_t k0=key[0], k1=key[1];
+    for(int r=0; r< 10; r++) {
+      uint64_t p0=uint64_t(0xD2511F53)*c0;
+      uint64_t p1=uint64_t(0xCD9E8D57)*c2;
+      uint32_t n0=uint32_t(p1 >> 32)^c1^k0;
+      uint32_t n2=uint32_t(p0 >> 32)^c3^k1;
+      c1=uint32_t(p1);
+      c3=uint32_t(p0);
+      c0=n0;
+      c2=n2;
+      k0+=0x9E3779B9;
+      k1+=0xBB67AE85;
+    }
+    out[0]=c0; out[1]=c1; out[2]=c2; out[3]=c3;
+  }
+
+  uint32_t key[2];
+  uint64_t id;
+  uint64_t block; //!< next block of four numbers to generate
+  int pos;        //!< position in buf; 4 means empty
+  uint32_t buf[4];
+  int iset;
+  double gset;
+  int seeded;
+};
 
 
 /*!
@@ -32,6 +153,7 @@ class Random_generator
 public:
   Random_generator()
   {
+    stream=NULL;
     is1=12345;
     is2=56789;
     //Try to read in a true random number from 
@@ -82,6 +204,7 @@ public:
    */
   double ulec()
   {
+    if(stream) return stream->ulec();
     long int k,iz;
     k=is1/53668;
     is1=is1-k*53668;
@@ -107,7 +230,7 @@ public:
   */
   double gasdev()
   {
-
+    if(stream) return stream->gasdev();
     if (iset ==0)
     {
       doublevar v1, v2, r, fac;
@@ -132,11 +255,23 @@ public:
     }
   }
 
+  /*!
+    Draw from the given stream instead of the L'Ecuyer sequence until
+    this is called again with NULL.
+  */
+  void setStream(Random_stream * s) { 
+    stream=s;
+  }
+  Random_stream * getStream() { 
+    return stream;
+  }
+
 private:
   long int is1;
   long int is2;
   int iset;
   double gset;
+  Random_stream * stream;
 
 };
 
@@ -145,6 +280,11 @@ This is one of the few times that we actually
 _want_ a global variable...
 */
 extern Random_generator rng;
+#ifdef _OPENMP
+//Each thread carries its own stream; Dmc_method seeds the
+//non-master copies from the master stream before every parallel region.
+#pragma omp threadprivate(rng)
+#endif
 
 double unif();
 
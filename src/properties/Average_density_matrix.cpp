@@ -135,7 +135,11 @@ void Average_tbdm_basis::evaluate_obdm(Wavefunction_data * wfdata, Wavefunction
   avg.vals=0;
 
   Array2 <dcomplex> movals1(nmo,1);
-  Array1 <Wf_return> wfs(nelectrons);
+  Array2 <Wf_return> wfs;
+  Array2 <doublevar> testpos(npoints_eval,3);
+  for(int i=0; i< npoints_eval; i++) 
+    for(int d=0; d< 3; d++) testpos(i,d)=saved_r(i)(d);
+  wf->evalTestPositions(wfdata,sample,testpos,wfs);
 
   Wavefunction_storage * store;
   wf->generateStorage(store);
@@ -150,9 +154,6 @@ void Average_tbdm_basis::evaluate_obdm(Wavefunction_data * wfdata, Wavefunction
     */
     sample->setElectronPosNoNotify(0,oldpos);
 
-    Array1 <Wf_return> wf_eval;
-    wf->evalTestPos(saved_r(i),sample,wfs);
-
     //Testing the evalTestPos
     //for(int e=0; e< nelectrons; e++) { 
     //  Wf_return test_wf(wf->nfunc(),2);
@@ -163,7 +164,7 @@ void Average_tbdm_basis::evaluate_obdm(Wavefunction_data * wfdata, Wavefunction
     //  wf->getVal(wfdata,e,test_wf);
     //  sample->setElectronPos(e,oldpos);
     //  wf->restoreUpdate(sample,e,store);
-    //  cout << "e " << e << " test " << test_wf.amp(0,0) << " evalTestPos " << wfs(e).amp(0,0) << endl;
+    //  cout << "e " << e << " test " << test_wf.amp(0,0) << " evalTestPos " << wfs(i,e).amp(0,0) << endl;
     //}
 
     doublevar dist1=0;
@@ -176,8 +177,8 @@ void Average_tbdm_basis::evaluate_obdm(Wavefunction_data * wfdata, Wavefunction
     }
 
     for(int e=0; e< nelectrons; e++) { 
-      dcomplex psiratio_1b=exp(dcomplex(wfs(e).amp(0,0)-wfval_base.amp(0,0),
-            wfs(e).phase(0,0)-wfval_base.phase(0,0)));
+      dcomplex psiratio_1b=exp(dcomplex(wfs(i,e).amp(0,0)-wfval_base.amp(0,0),
+            wfs(i,e).phase(0,0)-wfval_base.phase(0,0)));
       /*!
 	psi(r_1,...,r',...,r_N)/psi(r_1,...,r_e,...,r_N), the ratio of the new with respect to the old if one change the position of the e-th electron from 
 	r_e to r'
@@ -180,7 +180,11 @@ void Average_ekt::evaluate_valence(Wavefunction_data * wfdata, Wavefunction * wf
   sys->calcKineticSeparated(wfdata, sample, wf, Kin); 
   sys->calcLocSeparated(sample, VLoc);
 
-  Array1 <Wf_return> wfs(nelectrons);
+  Array2 <Wf_return> wfs;
+  Array2 <doublevar> testpos(npoints_eval,3);
+  for(int i=0; i< npoints_eval; i++) 
+    for(int d=0; d< 3; d++) testpos(i,d)=saved_r(i)(d);
+  wf->evalTestPositions(wfdata,sample,testpos,wfs);
 
   Wavefunction_storage * store;
   wf->generateStorage(store);
@@ -197,8 +201,6 @@ void Average_ekt::evaluate_valence(Wavefunction_data * wfdata, Wavefunction * wf
 
     calcPseudoMo(sys, sample, psp, rand_num, pseudo_t);
     sample->setElectronPosNoNotify(0,oldpos);
-    Array1 <Wf_return> wf_eval;
-    wf->evalTestPos(saved_r(i),sample,wfs);
     sys->calcLocWithTestPos(sample, saved_r(i), Vtest);
 
     doublevar vtot = 0.0;
@@ -244,9 +246,9 @@ void Average_ekt::evaluate_valence(Wavefunction_data * wfdata, Wavefunction * wf
       dump.open("EKT_DUMP",ios::app);
     }
     for(int e=0; e< nelectrons; e++) {
-      dcomplex psiratio_1b=conj(exp(dcomplex(wfs(e).amp(0,0)
+      dcomplex psiratio_1b=conj(exp(dcomplex(wfs(i,e).amp(0,0)
                                              -wfval_base.amp(0,0),
-                                             wfs(e).phase(0,0)
+                                             wfs(i,e).phase(0,0)
                                              -wfval_base.phase(0,0))));
       int which_obdm=0;
       if(e >= nup) { which_obdm=1;  }
@@ -327,7 +329,11 @@ void Average_ekt::evaluate_obdm(Wavefunction_data * wfdata, Wavefunction * wf,
   //  avg.vals=0;
 
   Array2 <dcomplex> movals1(nmo,1);
-  Array1 <Wf_return> wfs(nelectrons);
+  Array2 <Wf_return> wfs;
+  Array2 <doublevar> testpos(npoints_eval,3);
+  for(int i=0; i< npoints_eval; i++) 
+    for(int d=0; d< 3; d++) testpos(i,d)=saved_r(i)(d);
+  wf->evalTestPositions(wfdata,sample,testpos,wfs);
 
   Wavefunction_storage * store;
   wf->generateStorage(store);
@@ -342,8 +348,6 @@ void Average_ekt::evaluate_obdm(Wavefunction_data * wfdata, Wavefunction * wf,
       */
     sample->setElectronPosNoNotify(0,oldpos);
 
-    Array1 <Wf_return> wf_eval;
-    wf->evalTestPos(saved_r(i),sample,wfs);
 
     //Testing the evalTestPos
     //for(int e=0; e< nelectrons; e++) { 
@@ -355,7 +359,7 @@ void Average_ekt::evaluate_obdm(Wavefunction_data * wfdata, Wavefunction * wf,
     //  wf->getVal(wfdata,e,test_wf);
     //  sample->setElectronPos(e,oldpos);
     //  wf->restoreUpdate(sample,e,store);
-    //  cout << "e " << e << " test " << test_wf.amp(0,0) << " evalTestPos " << wfs(e).amp(0,0) << endl;
+    //  cout << "e " << e << " test " << test_wf.amp(0,0) << " evalTestPos " << wfs(i,e).amp(0,0) << endl;
     //}
 
     doublevar dist1=0;
@@ -367,8 +371,8 @@ void Average_ekt::evaluate_obdm(Wavefunction_data * wfdata, Wavefunction * wf,
     }
 
     for(int e=0; e< nelectrons; e++) { 
-      dcomplex psiratio_1b=exp(dcomplex(wfs(e).amp(0,0)-wfval_base.amp(0,0),
-            wfs(e).phase(0,0)-wfval_base.phase(0,0)));
+      dcomplex psiratio_1b=exp(dcomplex(wfs(i,e).amp(0,0)-wfval_base.amp(0,0),
+            wfs(i,e).phase(0,0)-wfval_base.phase(0,0)));
       /*!
         psi(r_1,...,r',...,r_N)/psi(r_1,...,r_e,...,r_N), the ratio of the new with respect to the old if one change the position of the e-th electron from 
         r_e to r'
@@ -259,9 +259,12 @@ void Average_region_density_matrix::evaluate(Wavefunction_data * wfdata, Wavefun
     tot_n(base_region(e))++;
   }
   int nsample=saved_r.GetDim(0);
+  Array2 <doublevar> testpos(nsample,3);
+  for(int i=0; i < nsample; i++) 
+    for(int d=0; d< 3; d++) testpos(i,d)=saved_r(i)(d);
+  Array2 <Wf_return> wf_eval;
+  wf->evalTestPositions(wfdata,sample,testpos,wf_eval);
   for(int i=0; i < nsample; i++) { 
-    Array1 <Wf_return> wf_eval;
-    wf->evalTestPos(saved_r(i),sample,wf_eval);
 
 
     sample_tmp->setElectronPosNoNotify(0,saved_r(i));
@@ -269,8 +272,8 @@ void Average_region_density_matrix::evaluate(Wavefunction_data * wfdata, Wavefun
 
 
     for(int e=0; e< nelectrons; e++) { 
-      dcomplex psiratio=exp(dcomplex(wf_eval(e).amp(0,0)-wfval_base.amp(0,0),
-            wf_eval(e).phase(0,0)-wfval_base.phase(0,0)));
+      dcomplex psiratio=exp(dcomplex(wf_eval(i,e).amp(0,0)-wfval_base.amp(0,0),
+            wf_eval(i,e).phase(0,0)-wfval_base.phase(0,0)));
       int s=0;
       //if(e >=nup) s=1;
       
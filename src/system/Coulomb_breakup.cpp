@@ -0,0 +1,349 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Coulomb_breakup.h"
+#include "qmc_io.h"
+#include "MatrixAlgebra.h"
+
+//Quintic Hermite shape functions on [0,1], as polynomial coefficients.
+//H0 has unit value at u=0, H1 unit first derivative, and H2 unit second
+//derivative; all three and their first two derivatives vanish at u=1.
+static const doublevar hermite_poly[3][6]={
+  {1.0, 0.0, 0.0, -10.0, 15.0, -6.0},
+  {0.0, 1.0, 0.0, -6.0, 8.0, -3.0},
+  {0.0, 0.0, 0.5, -1.5, 1.5, -0.5}
+};
+
+static doublevar hermiteValue(int a, doublevar u) {
+  const doublevar * c=hermite_poly[a];
+  return c[0]+u*(c[1]+u*(c[2]+u*(c[3]+u*(c[4]+u*c[5]))));
+}
+
+//Gauss-Legendre points and weights on [-1,1]
+static void gaussLegendre(int n, Array1 <doublevar> & x, Array1 <doublevar> & w) {
+  x.Resize(n);
+  w.Resize(n);
+  for(int i=0; i< (n+1)/2; i++) {
+    doublevar z=cos(pi*(i+0.75)/(n+0.5));
+    doublevar dp=0;
+    for(int it=0; it < 100; it++) {
+      doublevar p1=1.0, p2=0.0;
+      for(int j=0; j< n; j++) {
+        doublevar p3=p2;
+        p2=p1;
+        p1=((2.0*j+1.0)*z*p2-j*p3)/(j+1);
+      }
+      dp=n*(z*p1-p2)/(z*z-1.0);
+      doublevar z1=z;
+      z=z1-p1/dp;
+      if(fabs(z-z1) < 1e-15) break;
+    }
+    x(i)=-z;
+    x(n-1-i)=z;
+    w(i)=w(n-1-i)=2.0/((1.0-z*z)*dp*dp);
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Coulomb_breakup::read(vector <string> & words) {
+  unsigned int pos=0;
+  readvalue(words, pos=0, nknots, "BREAKUP_KNOTS");
+  readvalue(words, pos=0, tolerance, "BREAKUP_TOLERANCE");
+  if(nknots < 2) error("BREAKUP_KNOTS must be at least 2");
+  if(tolerance <= 0) error("BREAKUP_TOLERANCE must be positive");
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  Values of all basis functions at r, indexed as knot*3+derivative.  Only
+  the six belonging to the two knots around r are nonzero.
+ */
+void Coulomb_breakup::basisValues(doublevar r, Array1 <doublevar> & h) {
+  h.Resize(3*(nknots+1));
+  h=0.0;
+  doublevar x=r*invdelta;
+  int i=int(x);
+  if(i >= nknots) i=nknots-1;
+  doublevar u=x-i;
+  doublevar scale[3]={1.0, delta, delta*delta};
+  doublevar rsign[3]={1.0, -1.0, 1.0};
+  for(int a=0; a< 3; a++) {
+    h(3*i+a)=scale[a]*hermiteValue(a,u);
+    h(3*(i+1)+a)=rsign[a]*scale[a]*hermiteValue(a,1.0-u);
+  }
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  Fit the free spline coefficients for a given kc, given the transforms
+  ck(basis,k) of the basis functions and the part bk(k) of the transform
+  of V_l that does not depend on them.  Returns the rms error of the pair
+  potential from leaving out k > kc.
+ */
+doublevar Coulomb_breakup::fit(doublevar kc, Array1 <doublevar> & kgrid,
+                               Array2 <doublevar> & ck, Array1 <doublevar> & bk,
+                               Array1 <doublevar> & t) {
+  int nk=kgrid.GetDim(0);
+  doublevar dk=kgrid(1)-kgrid(0);
+  int nfree=3*nknots;
+  //V_l is even, so its first derivative at the origin is zero
+  Array1 <int> freeidx;
+  freeidx.Resize(nfree-1);
+  int f=0;
+  for(int n=0; n< nfree; n++) if(n!=1) freeidx(f++)=n;
+  nfree=f;
+
+  Array2 <doublevar> A(nfree,nfree);
+  Array1 <doublevar> y(nfree);
+  A=0.0;
+  y=0.0;
+  int kstart=0;
+  while(kstart < nk && kgrid(kstart) < kc) kstart++;
+  for(int k=kstart; k< nk; k++) {
+    doublevar wk=kgrid(k)*kgrid(k);
+    for(int m=0; m< nfree; m++) {
+      doublevar cm=wk*ck(freeidx(m),k);
+      y(m)-=cm*bk(k);
+      for(int n=0; n<= m; n++) A(m,n)+=cm*ck(freeidx(n),k);
+    }
+  }
+  //scale to unit diagonal, which helps the conditioning a lot
+  Array1 <doublevar> scale(nfree);
+  for(int m=0; m< nfree; m++) scale(m)=1.0/sqrt(A(m,m));
+  for(int m=0; m< nfree; m++) {
+    y(m)*=scale(m);
+    for(int n=0; n<= m; n++) {
+      A(m,n)*=scale(m)*scale(n);
+      A(n,m)=A(m,n);
+    }
+  }
+
+  //Some combinations of the basis only change V_l below kc and are left
+  //undetermined by the fit, so solve by pseudo-inverse.
+  Array1 <doublevar> evals(nfree);
+  Array2 <doublevar> evecs(nfree,nfree);
+  EigenSystemSolverRealSymmetricMatrix(A,evals,evecs);
+  doublevar evalmax=evals(0);
+  for(int i=0; i< nfree; i++) if(evals(i) > evalmax) evalmax=evals(i);
+  Array1 <doublevar> sol(nfree);
+  sol=0.0;
+  for(int i=0; i< nfree; i++) {
+    if(evals(i) < 1e-15*evalmax) continue;
+    doublevar proj=0;
+    for(int m=0; m< nfree; m++) proj+=evecs(m,i)*y(m);
+    proj/=evals(i);
+    for(int m=0; m< nfree; m++) sol(m)+=proj*evecs(m,i);
+  }
+
+  for(int m=0; m< nfree; m++) sol(m)*=scale(m);
+  for(int m=0; m< nfree; m++) t(freeidx(m))=sol(m);
+  t(1)=0.0;
+
+  doublevar chi2=0;
+  for(int k=kstart; k< nk; k++) {
+    doublevar vk=bk(k);
+    for(int m=0; m< nfree; m++) vk+=sol(m)*ck(freeidx(m),k);
+    chi2+=kgrid(k)*kgrid(k)*vk*vk*dk;
+  }
+  //sum over k -> V/(2pi)^3 \int d^3k, with V_k=V_l(k)/V
+  return sqrt(chi2/(2*pi*pi*cellVolume));
+}
+
+//----------------------------------------------------------------------
+
+//Fourier transform of V_l, \f$ \int V_l(r) e^{-i{\bf k\cdot r}} d^3r \f$
+doublevar Coulomb_breakup::longRangeFourier(doublevar k) {
+  doublevar sum=4*pi*cos(k*rcut)/(k*k);
+  int nq=quad_r.GetDim(0);
+  for(int q=0; q< nq; q++) {
+    doublevar r=quad_r(q);
+    sum+=4*pi/k*quad_w(q)*r*sin(k*r)*longRange(r);
+  }
+  return sum;
+}
+
+//----------------------------------------------------------------------
+
+void Coulomb_breakup::setup(Array2 <doublevar> & latVec,
+                            Array2 <doublevar> & recipLatVec,
+                            doublevar cellVolume_, doublevar smallestheight,
+                            Array2 <doublevar> & gpoint,
+                            Array1 <doublevar> & gweight) {
+  const int ndim=3;
+  cellVolume=cellVolume_;
+  rcut=0.5*smallestheight;
+  delta=rcut/nknots;
+  invdelta=1.0/delta;
+
+  //-----------quadrature over [0,rcut], enough points per interval
+  //to follow sin(kr) up to kmax
+  const doublevar kmax=60.0/delta;
+  const int npi=int(kmax*delta/2)+10;
+  Array1 <doublevar> gx, gw;
+  gaussLegendre(npi,gx,gw);
+  int nq=nknots*npi;
+  quad_r.Resize(nq);
+  quad_w.Resize(nq);
+  for(int i=0; i< nknots; i++) {
+    for(int p=0; p< npi; p++) {
+      quad_r(i*npi+p)=delta*(i+0.5*(gx(p)+1.0));
+      quad_w(i*npi+p)=0.5*delta*gw(p);
+    }
+  }
+
+  //-----------transforms of the basis functions on a k grid
+  doublevar dk=0.1/rcut;
+  int nk=int(kmax/dk);
+  int nbasis=3*(nknots+1);
+  Array1 <doublevar> kgrid(nk);
+  for(int k=0; k< nk; k++) kgrid(k)=(k+0.5)*dk;
+  Array2 <doublevar> ck(nbasis,nk);
+  ck=0.0;
+  Array2 <doublevar> hq(nq,6);
+  Array1 <doublevar> h;
+  for(int q=0; q< nq; q++) {
+    basisValues(quad_r(q),h);
+    int i=q/npi;
+    for(int j=0; j< 6; j++) hq(q,j)=h(3*i+j);
+  }
+  for(int k=0; k< nk; k++) {
+    doublevar kk=kgrid(k);
+    for(int q=0; q< nq; q++) {
+      int i=q/npi;
+      doublevar fac=4*pi/kk*quad_w(q)*quad_r(q)*sin(kk*quad_r(q));
+      for(int j=0; j< 6; j++) ck(3*i+j,k)+=fac*hq(q,j);
+    }
+  }
+
+  //the last knot matches 1/r and its first two derivatives
+  Array1 <doublevar> t(nbasis);
+  t=0.0;
+  t(3*nknots)=1.0/rcut;
+  t(3*nknots+1)=-1.0/(rcut*rcut);
+  t(3*nknots+2)=2.0/(rcut*rcut*rcut);
+  Array1 <doublevar> bk(nk);
+  for(int k=0; k< nk; k++) {
+    bk(k)=4*pi*cos(kgrid(k)*rcut)/(kgrid(k)*kgrid(k));
+    for(int a=0; a< 3; a++) bk(k)+=t(3*nknots+a)*ck(3*nknots+a,k);
+  }
+
+  //-----------smallest kc that meets the tolerance
+  doublevar klo=1.0/rcut, khi=0.25*kmax;
+  chi=fit(khi,kgrid,ck,bk,t);
+  if(chi > tolerance) {
+    single_write(cout,"Warning: optimized breakup could not reach BREAKUP_TOLERANCE; "
+                 "error estimate ",chi,"\n");
+  }
+  else {
+    while(khi-klo > dk) {
+      doublevar kmid=0.5*(klo+khi);
+      if(fit(kmid,kgrid,ck,bk,t) > tolerance) klo=kmid;
+      else khi=kmid;
+    }
+    chi=fit(khi,kgrid,ck,bk,t);
+  }
+  kcut=khi;
+
+  tknot.Resize(nknots+1,3);
+  for(int j=0; j<= nknots; j++)
+    for(int a=0; a< 3; a++) tknot(j,a)=t(3*j+a);
+
+  //V_l on interval i as a polynomial in u=r/delta-i
+  poly.Resize(6*nknots);
+  poly=0.0;
+  doublevar scale[3]={1.0, delta, delta*delta};
+  doublevar rsign[3]={1.0, -1.0, 1.0};
+  for(int i=0; i< nknots; i++) {
+    for(int a=0; a< 3; a++) {
+      for(int p=0; p< 6; p++) {
+        poly(6*i+p)+=tknot(i,a)*scale[a]*hermite_poly[a][p];
+        //expand H_a(1-u) in powers of u
+        doublevar binom=1.0;
+        for(int m=0; m<= p; m++) {
+          if(m > 0) binom=binom*(p-m+1)/m;
+          doublevar c=binom*((m%2)?-1.0:1.0);
+          poly(6*i+m)+=tknot(i+1,a)*rsign[a]*scale[a]*hermite_poly[a][p]*c;
+        }
+      }
+    }
+  }
+
+  vl0=tknot(0,0);
+  vs_int=0;
+  for(int q=0; q< nq; q++)
+    vs_int+=quad_w(q)*quad_r(q)*(1.0-quad_r(q)*longRange(quad_r(q)));
+  vs_int*=4*pi/cellVolume;
+
+  //-----------reciprocal lattice vectors inside kcut; half of them, since
+  //the sums are over +/- g pairs
+  Array1 <int> gmax(ndim);
+  for(int i=0; i< ndim; i++) {
+    doublevar len=0;
+    for(int d=0; d< ndim; d++) len+=latVec(i,d)*latVec(i,d);
+    gmax(i)=int(kcut*sqrt(len)/(2*pi))+1;
+  }
+  int ngpoints=0;
+  for(int pass=0; pass < 2; pass++) {
+    if(pass==1) {
+      gpoint.Resize(ngpoints,3);
+      gweight.Resize(ngpoints);
+      ngpoints=0;
+    }
+    for(int ig=0; ig <= gmax(0); ig++) {
+      int jgmin=-gmax(1);
+      if(ig==0) jgmin=0;
+      for(int jg=jgmin; jg <= gmax(1); jg++) {
+        int kgmin=-gmax(2);
+        if(ig==0 && jg==0) kgmin=1;
+        for(int kg=kgmin; kg <= gmax(2); kg++) {
+          doublevar g[3];
+          doublevar gsqrd=0;
+          for(int d=0; d< ndim; d++) {
+            g[d]=2*pi*(ig*recipLatVec(0,d)+jg*recipLatVec(1,d)+kg*recipLatVec(2,d));
+            gsqrd+=g[d]*g[d];
+          }
+          if(gsqrd > kcut*kcut) continue;
+          if(pass==1) {
+            for(int d=0; d< ndim; d++) gpoint(ngpoints,d)=g[d];
+            gweight(ngpoints)=longRangeFourier(sqrt(gsqrd))/cellVolume;
+          }
+          ngpoints++;
+        }
+      }
+    }
+  }
+  single_write(cout,"Optimized breakup: rcut ",rcut," kcut ",kcut);
+  single_write(cout," error ",chi,"\n");
+}
+
+//----------------------------------------------------------------------
+
+int Coulomb_breakup::showinfo(ostream & os) {
+  os << "Optimized Coulomb breakup with " << nknots << " knots" << endl;
+  os << "rcut " << rcut << " kcut " << kcut << endl;
+  os << "estimated rms error of the pair potential " << chi
+     << " (tolerance " << tolerance << ")" << endl;
+  return 1;
+}
+
+//----------------------------------------------------------------------
@@ -0,0 +1,110 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef COULOMB_BREAKUP_H_INCLUDED
+#define COULOMB_BREAKUP_H_INCLUDED
+
+#include "Qmc_std.h"
+
+/*!
+\brief
+Optimized breakup of the periodic Coulomb interaction into
+\f$ 1/r = V_s(r) + V_l(r) \f$, following Natoli and Ceperley,
+J. Comput. Phys. 117, 171 (1995).
+
+\f$V_l\f$ is a piecewise quintic Hermite spline for \f$r<r_c\f$ and equal to
+\f$1/r\f$ beyond, so \f$V_s\f$ vanishes (with two derivatives) at
+\f$r_c\f$, which is half the smallest height of the cell.  Only the
+minimum image then contributes to the real-space sum.  The spline
+coefficients are fit to minimize the error from truncating the Fourier
+series of \f$V_l\f$ at \f$k_c\f$, and \f$k_c\f$ is the smallest one for
+which the rms error of the pair potential is below BREAKUP_TOLERANCE.
+
+Used by Periodic_system and HEG_system in place of the Ewald
+\f$erfc(\alpha r)/r\f$ split when OPTIMIZED_BREAKUP is given.
+*/
+class Coulomb_breakup {
+public:
+  Coulomb_breakup() {
+    nknots=15;
+    tolerance=1e-7;
+    rcut=0;
+    kcut=0;
+    chi=0;
+  }
+
+  /*!
+    Read BREAKUP_KNOTS and BREAKUP_TOLERANCE from the system section.
+   */
+  void read(vector <string> & words);
+
+  /*!
+    Fit the breakup for a cell and collect the reciprocal lattice vectors
+    inside \f$k_c\f$, one of each \f$\pm{\bf g}\f$ pair, with their weights
+    \f$V_l(|{\bf g}|)/V_{cell}\f$.
+   */
+  void setup(Array2 <doublevar> & latVec, Array2 <doublevar> & recipLatVec,
+             doublevar cellVolume, doublevar smallestheight,
+             Array2 <doublevar> & gpoint, Array1 <doublevar> & gweight);
+
+  //! \f$V_l(r)\f$ for r < rcut
+  doublevar longRange(doublevar r) {
+    doublevar x=r*invdelta;
+    int i=int(x);
+    if(i >= nknots) i=nknots-1;
+    doublevar u=x-i;
+    const doublevar * a=poly.v+6*i;
+    return a[0]+u*(a[1]+u*(a[2]+u*(a[3]+u*(a[4]+u*a[5]))));
+  }
+
+  //! \f$V_s(r)\f$, zero beyond rcut
+  doublevar shortRange(doublevar r) {
+    if(r >= rcut) return 0.0;
+    return 1.0/r-longRange(r);
+  }
+
+  //! \f$V_l(0)\f$; \f$2\alpha/\sqrt{\pi}\f$ for Ewald
+  doublevar longRangeZero() { return vl0; }
+
+  //! \f$\frac{1}{V_{cell}}\int V_s({\bf r}) d^3r\f$; \f$\pi/V_{cell}\alpha^2\f$ for Ewald
+  doublevar shortRangeIntegral() { return vs_int; }
+
+  int showinfo(ostream & os);
+
+private:
+  doublevar longRangeFourier(doublevar k);
+  doublevar fit(doublevar kc, Array1 <doublevar> & kgrid, Array2 <doublevar> & ck,
+                Array1 <doublevar> & bk, Array1 <doublevar> & t);
+  void basisValues(doublevar r, Array1 <doublevar> & h);
+
+  int nknots;          //!< number of spline intervals in [0,rcut]
+  doublevar tolerance; //!< target rms error of the pair potential
+  doublevar rcut, kcut;
+  doublevar delta, invdelta; //!< knot spacing
+  doublevar cellVolume;
+  doublevar chi;       //!< rms error estimate of the chosen fit
+  doublevar vl0, vs_int;
+  Array2 <doublevar> tknot; //!< (knot, derivative) value and derivatives of V_l at the knots
+  Array1 <doublevar> poly; //!< V_l as a quintic in u on each interval, 6 coefficients per interval
+  Array1 <doublevar> quad_r, quad_w; //!< quadrature over [0,rcut]
+};
+
+#endif //COULOMB_BREAKUP_H_INCLUDED
+//----------------------------------------------------------------------
@@ -0,0 +1,156 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef DISTANCE_TABLE_H_INCLUDED
+#define DISTANCE_TABLE_H_INCLUDED
+
+#include "Qmc_std.h"
+
+/*!
+  One row of a Distance_table: the distances from one particle to every
+  column particle, each component contiguous.  The vector components are
+  (row particle)-(column particle).
+ */
+struct Distance_row {
+  Distance_row() { r=r2=dx=dy=dz=NULL; n=0; }
+  const doublevar * r;
+  const doublevar * r2;
+  const doublevar * dx;
+  const doublevar * dy;
+  const doublevar * dz;
+  int n;
+
+  //! column j in the \f$ [r, r^2, x, y,z] \f$ form of getEEDist(); sign multiplies the vector
+  void get(const int j, Array1 <doublevar> & distance, doublevar sign=1.0) const {
+    assert(j < n);
+    distance(0)=r[j];
+    distance(1)=r2[j];
+    distance(2)=sign*dx[j];
+    distance(3)=sign*dy[j];
+    distance(4)=sign*dz[j];
+  }
+};
+
+
+/*!
+\brief
+Distances between two sets of particles as a structure of arrays.
+
+Each row (an electron) has its own buffer holding r, r^2, x, y and z,
+each contiguous over the columns, so a whole row can be read with a
+Distance_row and no function call per pair.
+
+saveRow() hands the row's buffer to a Sample_storage and gives the row the
+storage's buffer in exchange.  The next update then writes the proposed
+distances once into the fresh buffer; accepting the move costs nothing,
+and restoreRow() swaps the old buffer back.
+*/
+class Distance_table {
+public:
+  Distance_table() { nrow=ncol=stride=0; }
+
+  void init(int nrow_, int ncol_) {
+    nrow=nrow_;
+    ncol=ncol_;
+    stride=(ncol+3)/4*4;
+    rows.Resize(nrow);
+    for(int i=0; i< nrow; i++) {
+      rows(i).Resize(5*stride);
+      rows(i)=0.0;
+    }
+  }
+
+  int nrows() { return nrow; }
+  int ncols() { return ncol; }
+
+  doublevar * r(const int i) { return rows(i).v; }
+  doublevar * r2(const int i) { return rows(i).v+stride; }
+  //! d=0,1,2 for x, y, z
+  doublevar * vec(const int i, const int d) { return rows(i).v+(2+d)*stride; }
+
+  void getRow(const int i, Distance_row & row) {
+    const doublevar * p=rows(i).v;
+    row.r=p;
+    row.r2=p+stride;
+    row.dx=p+2*stride;
+    row.dy=p+3*stride;
+    row.dz=p+4*stride;
+    row.n=ncol;
+  }
+
+  void get(const int i, const int j, Array1 <doublevar> & distance) {
+    assert(distance.GetDim(0) >= 5);
+    const doublevar * p=rows(i).v+j;
+    for(int q=0; q< 5; q++)
+      distance(q)=p[q*stride];
+  }
+
+  //! Zero the entry of row i for column j
+  void clear(const int i, const int j) {
+    doublevar * p=rows(i).v+j;
+    for(int q=0; q< 5; q++)
+      p[q*stride]=0.0;
+  }
+
+  /*!
+    For a square table of one set of particles: copy row i into column i,
+    reversing the vectors, so that every row stays complete.
+   */
+  void fillColumn(const int i) {
+    const doublevar * p=rows(i).v;
+    for(int j=0; j< nrow; j++) {
+      if(j==i) continue;
+      doublevar * q=rows(j).v+i;
+      q[0]=p[j];
+      q[stride]=p[stride+j];
+      q[2*stride]=-p[2*stride+j];
+      q[3*stride]=-p[3*stride+j];
+      q[4*stride]=-p[4*stride+j];
+    }
+  }
+
+  //! Move row i into store; the row must be recomputed before it is read
+  void saveRow(const int i, Array1 <doublevar> & store) {
+    if(store.GetDim(0) != 5*stride)
+      store.Resize(5*stride);
+    swapBuffers(rows(i), store);
+  }
+
+  //! Undo saveRow().  Square tables also need fillColumn(i) afterwards.
+  void restoreRow(const int i, Array1 <doublevar> & store) {
+    assert(store.GetDim(0)==5*stride);
+    swapBuffers(rows(i), store);
+  }
+
+private:
+  static void swapBuffers(Array1 <doublevar> & a, Array1 <doublevar> & b) {
+    doublevar * v=a.v; a.v=b.v; b.v=v;
+    int s=a.size; a.size=b.size; b.size=s;
+    s=a.mSize; a.mSize=b.mSize; b.mSize=s;
+    bool own=a.b; a.b=b.b; b.b=own;
+  }
+
+  int nrow, ncol;
+  int stride; //!< ncol rounded up to a multiple of four
+  Array1 < Array1 <doublevar> > rows;
+};
+
+#endif //DISTANCE_TABLE_H_INCLUDED
+//----------------------------------------------------------------------
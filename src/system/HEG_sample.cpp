@@ -258,6 +258,9 @@ void HEG_sample::init(System * sys) {
     if ( parent->kpt(d) != intpart ) update_overall_sign=false;
   }
 
+  Array2 <doublevar> kpt;
+  if(parent->getStructureFactorKpoints(kpt))
+    rho.init(nelectrons, kpt);
 }
 
 
@@ -318,6 +321,21 @@ void HEG_sample::setElectronPos(const int e,
 }
 
 
+void HEG_sample::translatedPosition(const int e, const Array1 <doublevar> & trans,
+                                 Array1 <doublevar> & pos, doublevar & sign,
+                                 doublevar & phase) {
+  pos.Resize(3);
+  for(int d=0; d< 3; d++) 
+    pos(d)=elecpos(e,d)+trans(d);
+  Array1<int> nshift;
+  parent->enforcePbc(pos, nshift);
+  doublevar kdotr=0;
+  for(int d=0; d< 3; d++) 
+    kdotr+=parent->kpt(d)*nshift(d);
+  sign=update_overall_sign ? cos(pi*kdotr) : 1.0;
+  phase=-pi*kdotr;
+}
+
 void HEG_sample::translateElectron(const int e, const Array1 <doublevar> & trans) {
   Array1 <doublevar> temp(trans.GetDim(0));
   
@@ -74,6 +74,9 @@ public:
   */
   void setElectronPos(const int e,const Array1 <doublevar> & position);
   void translateElectron(const int e, const Array1 <doublevar> & trans);
+  void translatedPosition(const int e, const Array1 <doublevar> & trans,
+                          Array1 <doublevar> & pos, doublevar & sign,
+                          doublevar & phase);
   
   void getElectronPos(const int e, Array1 <doublevar> & R)
   {
@@ -147,6 +150,13 @@ public:
     }
   }
 
+  //! Only with the Ewald interaction, on its g-points
+  const Structure_factor * getStructureFactor(int n) { 
+    if(rho.nk==0) return NULL;
+    rho.update(elecpos, n);
+    return &rho;
+  }
+
   void rawOutput(ostream &);
   void rawInput(istream &);
 
@@ -179,6 +189,7 @@ private:
   bool update_overall_sign;
 
 
+  Structure_factor rho;    //!< on the Ewald g-points, if there are any
   HEG_system * parent;     //The System that created this object
 };
 
@@ -83,6 +83,7 @@ int HEG_system::showinfo(ostream & os)
   switch (eeModel) {
   case 1:
     os << "Ewald" << endl;
+    if(optimized_breakup) breakup.showinfo(os);
     break;
   case 2:
     os << "truncated Coulomb interaction, Fraser et al., PRB 53, 1814 (1994)"
@@ -239,6 +240,12 @@ int HEG_system::read(vector <string> & words,
   if ( eeModel==1 && ( !same_spin_int || !diff_spin_int ) )
     error("Spin-dependent Ewald interaction not supported.");
 
+  optimized_breakup=0;
+  if(eeModel==1 && haskeyword(words, pos=0, "OPTIMIZED_BREAKUP")) { 
+    optimized_breakup=1;
+    breakup.read(words);
+  }
+
   
 
   //-------------cross products
@@ -327,6 +334,18 @@ int HEG_system::setupEwald(Array2 <doublevar> & crossProduct) {
   }
   debug_write(cout, "elsu ", smallestheight,"\n");
 
+  if(optimized_breakup) { 
+    breakup.setup(latVec, recipLatVec, cellVolume, smallestheight, 
+                  gpoint, gweight);
+    sort_kpoints(gpoint, gweight);
+    ngpoints=gpoint.GetDim(0);
+    ewald_vl0=breakup.longRangeZero();
+    ewald_vs_int=breakup.shortRangeIntegral();
+    cout << "Reciprocal sum will use " << ngpoints << " g-points." << endl;
+    constEwald();
+    return 1;
+  }
+
   // We want only the simulation cell and its nearest neighbours
   // to contribute into the real-space part of Ewald sum; alpha
   // has to be chosen so that there are no contributions from distances
@@ -337,6 +356,8 @@ int HEG_system::setupEwald(Array2 <doublevar> & crossProduct) {
   // 5.0 chosen in PERIODIC system seems to be large enough; change
   // from 5.0 to 6.5 doubles the number of g-points 
   alpha=5.0/smallestheight;
+  ewald_vl0=2*alpha/sqrt(pi);
+  ewald_vs_int=pi/(cellVolume*alpha*alpha);
 
   debug_write(cout, "alpha ", alpha, "\n");
 
@@ -405,6 +426,7 @@ int HEG_system::setupEwald(Array2 <doublevar> & crossProduct) {
     }
     gweight(i)=gweighttemp(i);
   }
+  sort_kpoints(gpoint, gweight);
 
   constEwald();
 
@@ -605,6 +627,13 @@ doublevar HEG_system::calcLocGauss(Sample_point * sample)
 }
 
 
+//----------------------------------------------------------------------
+
+doublevar HEG_system::shortRange(doublevar r) { 
+  if(optimized_breakup) return breakup.shortRange(r);
+  return erfcm(alpha*r)/r;
+}
+
 //----------------------------------------------------------------------
 
 void HEG_system::constEwald() {
@@ -624,7 +653,7 @@ void HEG_system::constEwald() {
 	  pos=i*latVec(0,d)+j*latVec(1,d)+k*latVec(2,d);
 	  pos2+=pos*pos;
 	}
-	doublevar dxi=erfcm(alpha*sqrt(pos2))/sqrt(pos2);
+	doublevar dxi=shortRange(sqrt(pos2));
 	xi+=dxi;
       }
     }
@@ -632,12 +661,12 @@ void HEG_system::constEwald() {
   // half of the self-interaction belongs to the simulation cell and
   // half to the given periodic image
   xi/=2;  
-  xi-=alpha/sqrt(pi);
+  xi-=0.5*ewald_vl0;
 	
   cout << "correction in constEwald" << endl;
-  cout << xi << " instead of " << -alpha/sqrt(pi) << endl;
+  cout << xi << " instead of " << -0.5*ewald_vl0 << endl;
 
-  self_ee=-0.5*totnelectrons*totnelectrons*pi/(cellVolume*alpha*alpha)
+  self_ee=-0.5*totnelectrons*totnelectrons*ewald_vs_int
     +totnelectrons*xi;
 
   //Correct for the exchange-correlation false interaction with
@@ -670,6 +699,11 @@ doublevar HEG_system::ewaldElectron(Sample_point * sample) {
   for(int e1=0; e1< totnelectrons; e1++) {
     for(int e2 =e1+1; e2 < totnelectrons; e2++) {
       sample->getEEDist(e1,e2, eidist);
+      //the breakup's short-range part vanishes beyond the minimum image
+      if(optimized_breakup) { 
+        elecElec_real+=breakup.shortRange(eidist(0));
+        continue;
+      }
       for(int d=0; d< 3; d++) r1(d)=eidist(d+2);
 
       //----over  lattice vectors
@@ -691,21 +725,11 @@ doublevar HEG_system::ewaldElectron(Sample_point * sample) {
 
   //---------electron reciprocal part (this DOES include the self-interaction)
 
-  doublevar rdotg;
-  Array2 <doublevar> elecpos(totnelectrons, 3);
-  sample->getAllElectronPos(elecpos);
+  const Structure_factor * rho=sample->getStructureFactor(ngpoints);
+  assert(rho != NULL);
   doublevar elecElec_recip=0;
   for(int gpt=0; gpt < ngpoints; gpt++) {
-    doublevar sum_sin=0, sum_cos=0;
-    for(int e=0; e< totnelectrons; e++) {
-      rdotg=gpoint(gpt, 0)*elecpos(e,0)
-            +gpoint(gpt, 1)*elecpos(e,1)
-            +gpoint(gpt, 2)*elecpos(e,2);
-
-      sum_sin+=sin(rdotg);
-      sum_cos+=cos(rdotg);
-
-    }
+    doublevar sum_cos=rho->rho_cos(gpt), sum_sin=rho->rho_sin(gpt);
     // NOTE: 1/2 from \sum_{e != e'} is cancelled with the fact that
     // we use only one g-point from g,-g pair
     elecElec_recip+=(sum_cos*sum_cos + sum_sin*sum_sin)*gweight(gpt);
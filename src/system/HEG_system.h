@@ -25,6 +25,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "System.h"
 #include "Particle_set.h"
 #include "Pbc_enforcer.h"
+#include "Coulomb_breakup.h"
+#include "Structure_factor.h"
 class HEG_sample;
 
 /*!
@@ -36,7 +38,9 @@ Keyword: HEG
 
 There are two choices for Coulomb e-e interaction:
 \li Ewald \n
-       <tt>interaction { Ewald }</tt>
+       <tt>interaction { Ewald }</tt> \n
+     with OPTIMIZED_BREAKUP in the system section, the Ewald split is
+     replaced by the fitted one of Coulomb_breakup
 \li truncated Coulomb a.k.a. MPC [Fraser et al., PRB 53, 1814 (1994)] \n
        <tt>interaction { truncCoul }</tt>
   
@@ -118,6 +122,13 @@ public:
     kp=kpt;
   }
 
+  //! Only with the Ewald interaction
+  int getStructureFactorKpoints(Array2 <doublevar> & kpoints) {
+    if(eeModel!=1) return 0;
+    kpoints=gpoint;
+    return 1;
+  }
+
 
 private:
 
@@ -140,11 +151,15 @@ private:
   doublevar smallestheight;       //!< smallest distance that spans the cell
   doublevar cellVolume;           //!< Simulation cell volume
 
-  Array2 <doublevar> gpoint;      //!< A list of non-zero g points in the Ewald sum
+  Array2 <doublevar> gpoint;      //!< A list of non-zero g points in the Ewald sum, sorted by length
   Array1 <doublevar> gweight;
   //!< A list of the weights(\f$4\pi exp(|g|^2/4 \alpha^2) \over V_{cell}|g|^2\f$)
   int ngpoints;                   //!< number of k points in ewald sum
   doublevar alpha;                //!< the Ewald parameter
+  int optimized_breakup;          //!< use Coulomb_breakup instead of the Ewald split
+  Coulomb_breakup breakup;
+  doublevar ewald_vl0;            //!< long-range part of the interaction at r=0
+  doublevar ewald_vs_int;         //!< integral of the short-range part over the cell, divided by its volume
   doublevar self_ee;              //!< self electron-electron energy
   doublevar xc_correction;        //!< exchange-correlation correction
 
@@ -180,6 +195,11 @@ private:
    */
   void constEwald();
 
+  /*! \brief
+    real-space part of the interaction of two electrons
+   */
+  doublevar shortRange(doublevar r);
+
   /*! \brief
     electron-electron interaction (Ewald formula)
    */
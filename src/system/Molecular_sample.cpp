@@ -27,57 +27,36 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 void Molecular_sample::generateStorage(Sample_storage * & store)
 {
-  int nions=parent->ions.size();
   store=new Sample_storage;
-  store->iondist_temp.Resize(5,nions);
-  store->pointdist_temp.Resize(5,nelectrons);
   store->pos_temp.Resize(3);
 }
 
+/*!
+  Rather than copying the distances of e, swap its rows out to the 
+  storage.  They are recomputed for the new position on the next update,
+  and the old ones come back in restoreUpdate().
+ */
 void Molecular_sample::saveUpdate(int e, Sample_storage * store) {
-  //cout << "saveUpdate" << endl;
   getElectronPos(e, store->pos_temp);
-  int nions=parent->ions.size();
-  for(int d=0; d< 5; d++)
-  {
-    for(int i=0; i< nions; i++)
-    {
-      store->iondist_temp(d,i)=iondist(d,i,e);
-    }
-    for(int i=0; i<e; i++)
-    {
-      store->pointdist_temp(d,i)=pointdist(d,i,e);
-    }
-    for(int j=e; j < nelectrons; j++)
-    {
-      store->pointdist_temp(d,j)=pointdist(d,e,j);
-    }
-  }
+  store->eestale_temp=elecDistStale(e);
+  store->eistale_temp=ionDistStale(e);
+  pointdist.saveRow(e, store->eerow_temp);
+  iondist.saveRow(e, store->eirow_temp);
+  elecDistStale(e)=1;
+  ionDistStale(e)=1;
 }
 
 void Molecular_sample::restoreUpdate(int e, Sample_storage * store)
 {
-  //cout << "restoreUpdate" << endl;
   for(int i=0; i<3; i++)
   {
     elecpos(e,i)=store->pos_temp(i);
   }
-  int nions=parent->ions.size();
-  for(int d=0; d< 5; d++)
-  {
-    for(int i=0; i< nions; i++)
-    {
-      iondist(d,i,e)=store->iondist_temp(d,i);
-    }
-    for(int i=0; i<e; i++)
-    {
-      pointdist(d,i,e)=store->pointdist_temp(d,i);
-    }
-    for(int j=e; j < nelectrons; j++)
-    {
-      pointdist(d,e,j)=store->pointdist_temp(d,j);
-    }
-  }
+  pointdist.restoreRow(e, store->eerow_temp);
+  pointdist.fillColumn(e);
+  iondist.restoreRow(e, store->eirow_temp);
+  elecDistStale(e)=store->eestale_temp;
+  ionDistStale(e)=store->eistale_temp;
 }
 
 
@@ -85,88 +64,99 @@ void Molecular_sample::restoreUpdate(int e, Sample_storage * store)
 
 void Molecular_sample::updateEIDist()
 {
-  //cout << "updateEIDist" << endl;
   for(int e=0; e< nelectrons; e++)
   {
     if(ionDistStale(e))
     {
       ionDistStale(e)=0;
-      int nions=parent->ions.size();
-      for(int j=0; j<nions; j++)
-      {
-        iondist(1,j,e)=0;
-      }
-
-      for(int i=0; i<3; i++)
-      {
-        for(int j=0; j<nions; j++)
-        {
-          iondist(i+2,j,e)=elecpos(e,i)-parent->ions.r(i,j);
-          iondist(1,j,e)+=iondist(i+2, j, e) * iondist(i+2, j, e);
-        }
-      }
-
-      for(int j=0; j<nions; j++)
-      {
-        iondist(0,j, e)=sqrt(iondist(1,j, e));
-      }
+      ionRow(&elecpos(e,0), iondist, e);
     }
   }
-  //cout << "done" << endl;
 }
 
 
 /*!
-
+  Row e is computed in one pass and copied into column e.
  */
 void Molecular_sample::updateEEDist()
 {
-  //cout << "elecelecDistupdate" << endl;
   for(int e=0; e< nelectrons; e++)
   {
     if(elecDistStale(e)==1)
     {
       elecDistStale(e)=0;
+      electronRow(&elecpos(e,0), pointdist, e);
+      pointdist.fillColumn(e);
+    }
+  }
+}
 
-      for(int j=0; j<e; j++)
-      {
-        pointdist(1,j, e)=0;
-      }
-      for(int k=e+1; k<nelectrons; k++)
-      {
-        pointdist(1,e,k)=0;
-      }
 
-      for(int i=0; i<3; i++)
-      {
-        for(int j=0; j<e; j++)
-        {
-          pointdist(i+2,j, e)=elecpos(j,i)-elecpos(e,i);
-          //cout << "elecpos  " << j << "  " << i << "  "
-          //     << elecpos(j,i) << endl;
-          pointdist(1,j, e)+=pointdist(i+2, j, e) * pointdist(i+2, j, e);
-        }
-        for(int k=e+1; k<nelectrons; k++)
-        {
-          pointdist(i+2,e, k)=elecpos(e,i)-elecpos(k,i);
-          //cout << "elecpos " << k << " " << i << "  "
-          //     << elecpos(k,i) << "   " << pointdist(i+2,e,k) << endl;
-          pointdist(1,e, k)+=pointdist(i+2, e, k) * pointdist(i+2, e, k);
-        }
-      }
+void Molecular_sample::ionRow(const doublevar * x, Distance_table & table,
+                              const int i)
+{
+  int nions=parent->ions.size();
+  doublevar * r=table.r(i);
+  doublevar * r2=table.r2(i);
+  for(int j=0; j<nions; j++)
+  {
+    r2[j]=0;
+  }
 
-      for(int j=0; j<e; j++)
-      {
-        pointdist(0,j, e)=sqrt(pointdist(1,j, e));
-        //cout << j << "   " << e << "   " <<  pointdist(0,j,e) << endl;
-      }
-      for(int k=e+1; k<nelectrons; k++)
-      {
-        pointdist(0,e, k)=sqrt(pointdist(1,e, k));
-        //cout << e << "   " << k << "   " <<  pointdist(0,e,k) << endl;
-      }
+  for(int d=0; d<3; d++)
+  {
+    doublevar * v=table.vec(i,d);
+    for(int j=0; j<nions; j++)
+    {
+      v[j]=x[d]-parent->ions.r(d,j);
+      r2[j]+=v[j]*v[j];
+    }
+  }
+
+  for(int j=0; j<nions; j++)
+  {
+    r[j]=sqrt(r2[j]);
+  }
+}
+
+
+void Molecular_sample::electronRow(const doublevar * x, Distance_table & table,
+                                   const int i)
+{
+  doublevar * r=table.r(i);
+  doublevar * r2=table.r2(i);
+  for(int j=0; j<nelectrons; j++)
+  {
+    r2[j]=0;
+  }
+
+  for(int d=0; d<3; d++)
+  {
+    doublevar * v=table.vec(i,d);
+    for(int j=0; j<nelectrons; j++)
+    {
+      v[j]=x[d]-elecpos(j,d);
+      r2[j]+=v[j]*v[j];
     }
   }
+
+  for(int j=0; j<nelectrons; j++)
+  {
+    r[j]=sqrt(r2[j]);
+  }
+}
+
+
+void Molecular_sample::getVirtualRows(const int e, const Array1 <doublevar> & pos,
+                                      Distance_table & ee, Distance_table & ei)
+{
+  assert(pos.GetDim(0) >= 3);
+  int nions=parent->ions.size();
+  if(ee.nrows()!=1 || ee.ncols()!=nelectrons) ee.init(1,nelectrons);
+  if(ei.nrows()!=1 || ei.ncols()!=nions) ei.init(1,nions);
+  ionRow(pos.v, ei, 0);
+  electronRow(pos.v, ee, 0);
+  ee.clear(0,e);
 }
 
 
@@ -179,10 +169,8 @@ void Molecular_sample::init(System * sys) {
 
   elecpos.Resize(nelectrons, 3);
   elecpos=0.0;
-  iondist.Resize(5,nions,nelectrons);
-  iondist=0.0;
-  pointdist.Resize(5, nelectrons, nelectrons);
-  pointdist=0.0;
+  iondist.init(nelectrons,nions);
+  pointdist.init(nelectrons,nelectrons);
   elecDistStale.Resize(nelectrons);
   ionDistStale.Resize(nelectrons);
   elecDistStale=1;
@@ -342,7 +330,7 @@ void Molecular_sample::moveIon(const int ion, const Array1 <doublevar> & r)
 void Molecular_sample::rawOutput(ostream & os)
 {
   os << "Molecular_sample\n";
-  os << "numIons  " << iondist.GetDim(1) << endl;
+  os << "numIons  " << parent->ions.size() << endl;
   for(int i=0; i< parent->ions.size(); i++)
   {
     for(int d=0; d< 3; d++)
@@ -102,12 +102,8 @@ public:
 
   void getEIDist(const int e,const int ion, Array1 <doublevar> & distance)
   {
-    assert( distance.GetDim(0) >= 5 );
     assert( ! ionDistStale(e));
-    for(int i=0; i<5; i++)
-    {
-      distance(i)=iondist(i,ion,e);
-    }
+    iondist.get(e,ion,distance);
   }
 
   virtual int getEIDist_temp(const int e, int ion,
@@ -124,15 +120,24 @@ public:
 
   void getEEDist(const int e1,const int e2, Array1 <doublevar> & distance)
   {
-    //cout << "getEEDist" << endl;
-    assert(distance.GetDim(0) >= 5);
     assert( ! elecDistStale(e1));
     assert( e1 < e2 );
-    for(int i=0; i< 5; i++)
-    {
-      distance(i)=pointdist(i,e1,e2);
-    }
+    pointdist.get(e1,e2,distance);
+  }
+
+  void getEERow(const int e, Distance_row & row) { 
+    assert( ! elecDistStale(e));
+    pointdist.getRow(e,row);
+  }
+  void getEIRow(const int e, Distance_row & row) { 
+    assert( ! ionDistStale(e));
+    iondist.getRow(e,row);
+  }
+  void getECRow(const int e, Distance_row & row) { 
+    getEIRow(e,row);
   }
+  void getVirtualRows(const int e, const Array1 <doublevar> & pos,
+                      Distance_table & ee, Distance_table & ei);
 
   void rawOutput(ostream &);
   void rawInput(istream &);
@@ -147,11 +152,13 @@ private:
 
   Array2 <doublevar> elecpos; //electron positions
 
-  Array3 <doublevar> iondist;
+  Distance_table iondist;   //!< (electron, ion)
   Array1 <int> elecDistStale;
   Array1 <int> ionDistStale;
-  Array3 <doublevar> pointdist;  //this is an upper triangular matrix;
-                                 //the lower is currently wasted
+  Distance_table pointdist; //!< (electron, electron), kept as a full square
+  //! row i of table from the point x to the ions, or to the electrons
+  void ionRow(const doublevar * x, Distance_table & table, const int i);
+  void electronRow(const doublevar * x, Distance_table & table, const int i);
 
   Molecular_system * parent;
 
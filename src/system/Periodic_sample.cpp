@@ -27,50 +27,39 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 void Periodic_sample::generateStorage(Sample_storage * & store)
 {
-  int nions=parent->ions.size();
   store=new Sample_storage;
-  store->iondist_temp.Resize(nions,5);
-  store->pointdist_temp.Resize(nelectrons,5);
   store->pos_temp.Resize(3);
 }
 
+/*!
+  The rows of e are swapped out to the storage rather than copied; see
+  Distance_table.
+ */
 void Periodic_sample::saveUpdate(int e, Sample_storage * store)
 {
   getElectronPos(e, store->pos_temp);
-  int nions=parent->ions.size();
-  for(int d=0; d< 5; d++) {
-    for(int i=0; i< nions; i++)
-    {
-      store->iondist_temp(i,d)=iondist(i,e,d);
-    }
-    for(int i=0; i<e; i++)
-    {
-      store->pointdist_temp(i,d)=pointdist(i,e,d);
-    }
-    for(int j=e; j < nelectrons; j++)
-    {
-      store->pointdist_temp(j,d)=pointdist(e,j,d);
-    }
-  }
+  store->eestale_temp=elecDistStale(e);
+  store->eistale_temp=ionDistStale(e);
+  store->ecstale_temp=cenDistStale(e);
+  pointdist.saveRow(e, store->eerow_temp);
+  iondist.saveRow(e, store->eirow_temp);
+  cendist.saveRow(e, store->ecrow_temp);
+  elecDistStale(e)=1;
+  ionDistStale(e)=1;
+  cenDistStale(e)=1;
 }
 
 void Periodic_sample::restoreUpdate(int e, Sample_storage * store){
   for(int i=0; i<3; i++)
     elecpos(e,i)=store->pos_temp(i);
 
-  int nions=parent->ions.size();
-  for(int d=0; d< 5; d++)  {
-    for(int i=0; i< nions; i++)
-      iondist(i,e,d)=store->iondist_temp(i,d);
-
-    for(int i=0; i<e; i++)
-      pointdist(i,e,d)=store->pointdist_temp(i,d);
-
-    for(int j=e; j < nelectrons; j++)
-      pointdist(e,j,d)=store->pointdist_temp(j,d);
-  }
-  cenDistStale(e)=1; //Let's not save the center distances, but that means
-                     //we have to recalculate when we reject.
+  pointdist.restoreRow(e, store->eerow_temp);
+  pointdist.fillColumn(e);
+  iondist.restoreRow(e, store->eirow_temp);
+  cendist.restoreRow(e, store->ecrow_temp);
+  elecDistStale(e)=store->eestale_temp;
+  ionDistStale(e)=store->eistale_temp;
+  cenDistStale(e)=store->ecstale_temp;
 }
 
 
@@ -78,64 +67,81 @@ void Periodic_sample::restoreUpdate(int e, Sample_storage * store){
 
 
 void Periodic_sample::updateEIDist() {
-  //cout << "Periodic::updateEIDist" << endl;
-  //Array1 <doublevar> eivec(3);
   for(int e=0; e< nelectrons; e++) {
     if(ionDistStale(e)) {
       ionDistStale(e)=0;
-      int nions=parent->ions.size();
-
-      for(int ion=0; ion< nions; ion++) {
-        Array1 <doublevar> dr(3);
-        for(int d=0; d< 3; d++) dr(d)=elecpos(e,d)-parent->ions.r(d,ion);
-        doublevar dis=minimum_image(dr);
-        
-        for(int d=0; d< 3; d++) iondist(ion,e,d+2)=dr(d);
-        iondist(ion,e,1)=dis;
-        
-      }
-      for(int j=0; j<nions; j++)
-        iondist(j, e,0)=sqrt(iondist(j, e,1));
+      ionRow(&elecpos(e,0), iondist, e);
     }
   }
-
-  //cout << "done " << endl;
-
 }
 
 
 //----------------------------------------------------------------------
 
 /*!
-
+  Row e is computed in one pass and copied into column e.
  */
 void Periodic_sample::updateEEDist() {
-  const int ndim=3;
   for(int e=0; e< nelectrons; e++) {
     if(elecDistStale(e)==1) {
-
       elecDistStale(e)=0;
-      Array1 <doublevar> dr(3);
-      for(int j=0; j< e; j++) { 
-        for(int d=0; d< 3; d++) dr(d)=elecpos(j,d)-elecpos(e,d);
-        doublevar dist=minimum_image(dr);
-        for(int d=0; d< 3; d++) pointdist(j,e,d+2)=dr(d);
-        pointdist(j,e,1)=dist;
-        pointdist(j,e,0)=sqrt(dist);
-      }
-      for(int k=e+1; k < nelectrons; k++) { 
-        for(int d=0; d< 3; d++) dr(d)=elecpos(e,d)-elecpos(k,d);
-        doublevar dist=minimum_image(dr);
-        for(int d=0; d< 3; d++) pointdist(e,k,d+2)=dr(d);
-        pointdist(e,k,1)=dist;
-        pointdist(e,k,0)=sqrt(dist);
-      }
-      
+      electronRow(&elecpos(e,0), pointdist, e);
+      pointdist.fillColumn(e);
     }
   }
-  //cout << "done" << endl;
 }
 
+//----------------------------------------------------------------------
+
+void Periodic_sample::ionRow(const doublevar * pos, Distance_table & table,
+                             const int i) {
+  int nions=parent->ions.size();
+  doublevar dr[3];
+  doublevar * r=table.r(i);
+  doublevar * r2=table.r2(i);
+  doublevar * x=table.vec(i,0);
+  doublevar * y=table.vec(i,1);
+  doublevar * z=table.vec(i,2);
+  for(int ion=0; ion< nions; ion++) {
+    for(int d=0; d< 3; d++) dr[d]=pos[d]-parent->ions.r(d,ion);
+    r2[ion]=minimum_image(dr);
+    x[ion]=dr[0]; y[ion]=dr[1]; z[ion]=dr[2];
+  }
+  for(int j=0; j<nions; j++)
+    r[j]=sqrt(r2[j]);
+}
+
+//----------------------------------------------------------------------
+
+void Periodic_sample::electronRow(const doublevar * pos, Distance_table & table,
+                                  const int i) {
+  doublevar dr[3];
+  doublevar * r=table.r(i);
+  doublevar * r2=table.r2(i);
+  doublevar * x=table.vec(i,0);
+  doublevar * y=table.vec(i,1);
+  doublevar * z=table.vec(i,2);
+  for(int j=0; j< nelectrons; j++) { 
+    for(int d=0; d< 3; d++) dr[d]=pos[d]-elecpos(j,d);
+    r2[j]=minimum_image(dr);
+    x[j]=dr[0]; y[j]=dr[1]; z[j]=dr[2];
+  }
+  for(int j=0; j< nelectrons; j++) 
+    r[j]=sqrt(r2[j]);
+}
+
+//----------------------------------------------------------------------
+
+void Periodic_sample::getVirtualRows(const int e, const Array1 <doublevar> & pos,
+                                     Distance_table & ee, Distance_table & ei) {
+  assert(pos.GetDim(0) >= 3);
+  int nions=parent->ions.size();
+  if(ee.nrows()!=1 || ee.ncols()!=nelectrons) ee.init(1,nelectrons);
+  if(ei.nrows()!=1 || ei.ncols()!=nions) ei.init(1,nions);
+  ionRow(pos.v, ei, 0);
+  electronRow(pos.v, ee, 0);
+  ee.clear(0,e);
+}
 
 
 void Periodic_sample::minDist(Array1 <doublevar> pos1 , Array1 <doublevar> pos2, Array1<doublevar> &rmin) {
@@ -148,30 +154,28 @@ void Periodic_sample::minDist(Array1 <doublevar> pos1 , Array1 <doublevar> pos2,
 
 //----------------------------------------------------------------------
 void Periodic_sample::updateECDist() {
-  //cout << "periodic_sample::updateECDist() " << endl;
+  int ncenters=parent->centerpos.GetDim(0);
   for(int e=0; e< nelectrons; e++)  {
     if(cenDistStale(e)) {
       cenDistStale(e)=0;
-      int ncenters=parent->centerpos.GetDim(0);
+      doublevar * r=cendist.r(e);
+      doublevar * r2=cendist.r2(e);
       for(int j=0; j<ncenters; j++)
-      {
-        cendist(e,j,1)=0;
-      }
-
-      for(int i=0; i<3; i++)
-      {
-        for(int j=0; j<ncenters; j++)
-        {
-          cendist(e,j, i+2)=elecpos(e,i)-parent->centerpos(j,i);
-          cendist(e,j,1)+=cendist(e,j, i+2) * cendist(e,j, i+2);
+        r2[j]=0;
+
+      for(int i=0; i<3; i++) {
+        doublevar * v=cendist.vec(e,i);
+        doublevar x=elecpos(e,i);
+        for(int j=0; j<ncenters; j++) {
+          v[j]=x-parent->centerpos(j,i);
+          r2[j]+=v[j]*v[j];
         }
       }
 
       for(int j=0; j<ncenters; j++)
-        cendist(e,j,0)=sqrt(cendist(e,j,1));
+        r[j]=sqrt(r2[j]);
     }
   }
-  //cout << "done" << endl;
 }
 //----------------------------------------------------------------------
 #include "qmc_io.h"
@@ -184,11 +188,11 @@ void Periodic_sample::init(System * sys) {
   nelectrons=parent->nelectrons(0)+parent->nelectrons(1);
 
   elecpos.Resize(nelectrons, 3);
-  iondist.Resize(nions,nelectrons,5);
-  pointdist.Resize(nelectrons, nelectrons,5);
+  iondist.init(nelectrons,nions);
+  pointdist.init(nelectrons,nelectrons);
 
   int ncenters=parent->centerpos.GetDim(0);
-  cendist.Resize(nelectrons,ncenters, 5);
+  cendist.init(nelectrons,ncenters);
 
 
   elecDistStale.Resize(nelectrons);
@@ -197,6 +201,7 @@ void Periodic_sample::init(System * sys) {
   cenDistStale=1;
   elecDistStale=1;
   ionDistStale=1;
+  ewald_cache.rho.init(nelectrons, parent->gpoint);
 
   // update_overall_sign is false for complex-valued wavefunctions,
   // i.e., for non-integer k-points
@@ -256,7 +261,7 @@ void Periodic_sample::init(System * sys) {
 
 //----------------------------------------------------------------------
 
-doublevar Periodic_sample::minimum_image(Array1 <doublevar> & r) { 
+doublevar Periodic_sample::minimum_image(doublevar * r) { 
 
   doublevar height2=parent->smallestheight*parent->smallestheight*.25;
   int nlat=lattice_basis.GetDim(0);
@@ -270,7 +275,7 @@ doublevar Periodic_sample::minimum_image(Array1 <doublevar> & r) {
   for(int a=0; a < nlat; a++) { 
     tmpdis=0;
     for(int d=0; d < 3; d++) { 
-      tmpvec[d]=r(d)+lattice_basis(a,d);
+      tmpvec[d]=r[d]+lattice_basis(a,d);
       tmpdis+=tmpvec[d]*tmpvec[d];
     }
     if(tmpdis < dismin) { 
@@ -385,6 +390,21 @@ void Periodic_sample::setElectronPos(const int e,
 }
 
 
+void Periodic_sample::translatedPosition(const int e, const Array1 <doublevar> & trans,
+                                 Array1 <doublevar> & pos, doublevar & sign,
+                                 doublevar & phase) {
+  pos.Resize(3);
+  for(int d=0; d< 3; d++) 
+    pos(d)=elecpos(e,d)+trans(d);
+  Array1<int> nshift;
+  parent->enforcePbc(pos, nshift);
+  doublevar kdotr=0;
+  for(int d=0; d< 3; d++) 
+    kdotr+=parent->kpt(d)*nshift(d);
+  sign=update_overall_sign ? cos(pi*kdotr) : 1.0;
+  phase=-pi*kdotr;
+}
+
 void Periodic_sample::translateElectron(const int e, const Array1 <doublevar> & trans) {
   Array1 <doublevar> temp(trans.GetDim(0));
   
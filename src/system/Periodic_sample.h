@@ -76,6 +76,9 @@ public:
   void setElectronPosNoNotify(const int e, const Array1 <doublevar> & position);
 
   void translateElectron(const int e, const Array1 <doublevar> & trans);
+  void translatedPosition(const int e, const Array1 <doublevar> & trans,
+                          Array1 <doublevar> & pos, doublevar & sign,
+                          doublevar & phase);
   
   void getElectronPos(const int e, Array1 <doublevar> & R)
   {
@@ -120,33 +123,43 @@ public:
                  Array1 <doublevar> & distance)
   {
     assert(!cenDistStale(e));
-    assert(distance.GetDim(0) >=5);
-    for(int i=0; i< 5; i++)
-      distance(i)=cendist(e, cent, i);
+    cendist.get(e,cent,distance);
   }
 
   void getEIDist(const int e,const int ion, Array1 <doublevar> & distance)
   {
-    assert( distance.GetDim(0) >= 5 );
     assert( ! ionDistStale(e));
-    for(int i=0; i<5; i++)
-    {
-      distance(i)=iondist(ion,e,i);
-    }
+    iondist.get(e,ion,distance);
   }
   /*!
   Returns the vector pointing from e1 to e2.
   */
   void getEEDist(const int e1,const int e2, Array1 <doublevar> & distance)
   {
-    assert(distance.GetDim(0) >= 5);
     assert( ! elecDistStale(e1));
     assert( e1 < e2 );
-    for(int i=0; i< 5; i++)
-    {
-      distance(i)=pointdist(e1,e2,i);
-    }
+    pointdist.get(e1,e2,distance);
+  }
+
+  void getEERow(const int e, Distance_row & row) { 
+    assert( ! elecDistStale(e));
+    pointdist.getRow(e,row);
   }
+  void getEIRow(const int e, Distance_row & row) { 
+    assert( ! ionDistStale(e));
+    iondist.getRow(e,row);
+  }
+  void getECRow(const int e, Distance_row & row) { 
+    assert( ! cenDistStale(e));
+    cendist.getRow(e,row);
+  }
+  void getVirtualRows(const int e, const Array1 <doublevar> & pos,
+                      Distance_table & ee, Distance_table & ei);
+  const Structure_factor * getStructureFactor(int n) { 
+    ewald_cache.rho.update(elecpos, n);
+    return &ewald_cache.rho;
+  }
+
   void minDist(Array1 <doublevar> pos1, Array1 <doublevar> pos2, Array1 <doublevar> &rmin); 
   void rawOutput(ostream &);
   void rawInput(istream &);
@@ -163,22 +176,26 @@ public:
   doublevar overallSign() { return overall_sign; }
   doublevar overallPhase() { return overall_phase; }
 private:
+  friend class Periodic_system;
 
-
-  doublevar minimum_image(Array1 <doublevar> & r) ;
+  //! shift r to its nearest image and return its square length
+  doublevar minimum_image(doublevar * r);
+  doublevar minimum_image(Array1 <doublevar> & r) { return minimum_image(r.v); }
   
   int nelectrons;
 
   Array2 <doublevar> elecpos; //electron positions
 
-  Array3 <doublevar> cendist; //!< center distances
+  Distance_table cendist; //!< (electron, center)
   Array1 <int> cenDistStale;
 
-  Array3 <doublevar> iondist;
+  Distance_table iondist; //!< (electron, ion), minimum image
   Array1 <int> elecDistStale;
   Array1 <int> ionDistStale;
-  Array3 <doublevar> pointdist;  //this is an upper triangular matrix;
-  //the lower is currently wasted
+  Distance_table pointdist; //!< (electron, electron) minimum image, kept as a full square
+  //! row i of table from the point x to the ions, or to the electrons
+  void ionRow(const doublevar * x, Distance_table & table, const int i);
+  void electronRow(const doublevar * x, Distance_table & table, const int i);
   Array2 <doublevar> lattice_basis; //the basis we search over for interparticle distances
 
   doublevar overall_sign;
@@ -186,6 +203,7 @@ private:
   // false for complex-valued wavefunctions, i.e., for non-integer k-points
   bool update_overall_sign;
 
+  Periodic_ewald_cache ewald_cache; //!< maintained by Periodic_system
   Periodic_system * parent;     //The System that created this object
 };
 
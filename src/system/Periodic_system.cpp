@@ -70,6 +70,7 @@ int Periodic_system::showinfo(ostream & os)
   }
   os << "total number of points in reciprocal ewald sum: "
   << ngpoints << endl;
+  if(optimized_breakup) breakup.showinfo(os);
 
   os << "Self e-i " << self_ei << endl;
   os << "Self e-e " << self_ee << endl;
@@ -350,6 +351,56 @@ int Periodic_system::read(vector <string> & words,
   }
   debug_write(cout, "elsu ", smallestheight,"\n");
 
+  if(haskeyword(words, pos=0, "OPTIMIZED_BREAKUP")) { 
+    optimized_breakup=1;
+    breakup.read(words);
+    breakup.setup(latVec, recipLatVec, cellVolume, smallestheight, 
+                  gpoint, gweight);
+    sort_kpoints(gpoint, gweight);
+    ngpoints=gpoint.GetDim(0);
+    ewald_vl0=breakup.longRangeZero();
+    ewald_vs_int=breakup.shortRangeIntegral();
+    single_write(cout,"Ewald sum using ",ngpoints," reciprocal points\n");
+  }
+  else { 
+    optimized_breakup=0;
+    setupEwald(ewald_gmax);
+  }
+
+  //Resize the stored ion variables
+  ion_sin.Resize(ngpoints);
+  ion_cos.Resize(ngpoints);
+  constEwald();
+  ion_ewald=ewaldIon();
+
+  vector < vector <string> > pseudotext;
+  vector <string> pseudotexttmp;
+  if(readsection(words, pos, pseudotexttmp, "PSEUDO") != 0) {
+    error("pseudo section is now in the global space");
+  }
+  
+  ion_polarization.Resize(3);
+  ion_polarization=0.0;
+  Array1 <doublevar> ion_pos(3);
+  for(int at=0; at < natoms; at++) {
+    getIonPos(at, ion_pos);
+    for(int d=0; d< 3; d++) {
+      ion_polarization(d)+=ion_pos(d)*ions.charge(at) ;
+    }
+  }
+
+  return 1;
+}
+
+
+//----------------------------------------------------------------------
+
+/*!
+  The standard Ewald split, \f$erfc(\alpha r)/r\f$ in real space, with the
+  g-points searched out to ewald_gmax in each direction.
+ */
+void Periodic_system::setupEwald(int ewald_gmax) { 
+  const int ndim=3;
   alpha=5.0/smallestheight; //Heuristic?  Stolen from Lubos's code.
 
   debug_write(cout, "alpha ", alpha, "\n");
@@ -373,7 +424,7 @@ int Periodic_system::read(vector <string> & words,
                                        +kg*recipLatVec(2,i));
           gsqrd+=tmp*tmp;
         }
-        if(4.0 * pi*exp(-gsqrd/(4*alpha*alpha))
+        if(gsqrd > 1e-8 && 4.0 * pi*exp(-gsqrd/(4*alpha*alpha))
                                /(cellVolume*gsqrd) > 1e-10) ngpoints++;
       }
     }
@@ -393,28 +444,34 @@ int Periodic_system::read(vector <string> & words,
       int kgmin=-ewald_gmax;
       if(ig==0 && jg==0) kgmin=0;
       for(int kg=kgmin; kg <= ewald_gmax; kg++) {
+        doublevar g[3];
         for(int i=0; i< ndim; i++) {
-          gpoint(currgpt, i)=2*pi*(ig*recipLatVec(0,i)
-                                       +jg*recipLatVec(1,i)
-                                       +kg*recipLatVec(2,i));
+          g[i]=2*pi*(ig*recipLatVec(0,i)
+                     +jg*recipLatVec(1,i)
+                     +kg*recipLatVec(2,i));
         }
         //cout << "there" << endl;
         doublevar gsqrd=0; //|g|^2
         for(int i=0; i< ndim; i++) {
-          gsqrd+=gpoint(currgpt,i)*gpoint(currgpt,i);
+          gsqrd+=g[i]*g[i];
         }
 
         if(gsqrd > 1e-8) {
-          gweight(currgpt)=4.0 * pi*exp(-gsqrd/(4*alpha*alpha))
+          doublevar weight=4.0 * pi*exp(-gsqrd/(4*alpha*alpha))
                                /(cellVolume*gsqrd);
-          if(gweight(currgpt) > 1e-10) { //
+          if(weight > 1e-10) { //
+            for(int i=0; i< ndim; i++) gpoint(currgpt,i)=g[i];
+            gweight(currgpt)=weight;
             currgpt++;
           }
         }
       }
     }
   }
+  sort_kpoints(gpoint, gweight);
   single_write(cout,"Ewald sum using ",ngpoints," reciprocal points\n");
+  ewald_vl0=2*alpha/sqrt(pi);
+  ewald_vs_int=pi/(cellVolume*alpha*alpha);
   //Done finding the g-points.
   //---------------------------------------
 
@@ -433,32 +490,8 @@ int Periodic_system::read(vector <string> & words,
     gweight(i)=gweighttemp(i);
   }
 */
-  //Resize the stored ion variables
-  ion_sin.Resize(ngpoints);
-  ion_cos.Resize(ngpoints);
-  constEwald();
-  ion_ewald=ewaldIon();
-
-  vector < vector <string> > pseudotext;
-  vector <string> pseudotexttmp;
-  if(readsection(words, pos, pseudotexttmp, "PSEUDO") != 0) {
-    error("pseudo section is now in the global space");
-  }
-  
-  ion_polarization.Resize(3);
-  ion_polarization=0.0;
-  Array1 <doublevar> ion_pos(3);
-  for(int at=0; at < natoms; at++) {
-    getIonPos(at, ion_pos);
-    for(int d=0; d< 3; d++) {
-      ion_polarization(d)+=ion_pos(d)*ions.charge(at) ;
-    }
-  }
-
-  return 1;
 }
 
-
 //----------------------------------------------------------------------
 
 void Periodic_system::setIonPos(int ion, Array1 <doublevar> & r) {
@@ -609,8 +642,10 @@ void Periodic_system::calcLocSeparated(Sample_point * sample, Array1 <doublevar>
   //cout << " ewalde " << ewalde << " xc_correction " << xc_correction << endl;
   //we do not want the xc_correction in the total energy in order to compare 
   //to all other qmc codes, it is still printed out so can be added by hand 
+  Array1 <doublevar> ewalde_sep;
+  ewaldElectronSeparated(sample,ewalde_sep);
   for (int e=0; e<totnelectrons; e++) {
-    totalv(e) = self_e_single + ewalde_separated(e); 
+    totalv(e) = self_e_single + ewalde_sep(e); 
   }
     //  return ion_ewald+self_ii+self_ee+self_ei+ewalde; //+xc_correction;
 }
@@ -648,8 +683,8 @@ void Periodic_system::constEwald() {
     ionSum2+=ions.charge(ion)*ions.charge(ion);
   }
 
-  doublevar squareconst=-.5*(2*alpha/sqrt(pi)+pi/(cellVolume*alpha*alpha));
-  doublevar ijconst=-pi/(cellVolume*alpha*alpha);
+  doublevar squareconst=-.5*(ewald_vl0+ewald_vs_int);
+  doublevar ijconst=-ewald_vs_int;
   self_ii=ionIonSum*ijconst+ionSum2*squareconst;
   self_ei=ionElecSum*ijconst; // I guess this term is the charge+ and charge- background interactions
   self_ee=.5*elecElecSum*ijconst+elecSum2*squareconst;
@@ -706,7 +741,7 @@ doublevar Periodic_system::ewaldIon() {
             }
             doublevar r=sqrt(r2(0)*r2(0)+r2(1)*r2(1)+r2(2)*r2(2));
 
-            IonIon+=ions.charge(i)*ions.charge(j)*erfcm(alpha*r)/r;
+            IonIon+=ions.charge(i)*ions.charge(j)*shortRange(r);
 //            cout << "r " << r << "  ionion " << IonIon << " i " << i << " j " << j << endl;
           }
         }
@@ -754,6 +789,42 @@ doublevar Periodic_system::ewaldIon() {
 
 //----------------------------------------------------------------------
 
+doublevar Periodic_system::shortRange(doublevar r) { 
+  if(optimized_breakup) return breakup.shortRange(r);
+  return erfcm(alpha*r)/r;
+}
+
+/*!
+  Real-space part of the interaction of two unit charges separated by 
+  the minimum-image vector r.  The optimized breakup vanishes beyond half
+  the smallest cell height, so only the minimum image contributes; the 
+  Ewald split needs the neighboring cells as well.
+ */
+doublevar Periodic_system::shortRangeImages(const doublevar * r1) { 
+  if(optimized_breakup) 
+    return breakup.shortRange(sqrt(r1[0]*r1[0]+r1[1]*r1[1]+r1[2]*r1[2]));
+
+  const int nlatvec=1;
+  doublevar sum=0;
+  doublevar r2[3];
+  //----over  lattice vectors
+  for(int kk=-nlatvec; kk <=nlatvec; kk++) {
+    for(int jj=-nlatvec; jj <=nlatvec; jj++) {
+      for(int ii=-nlatvec; ii <=nlatvec; ii++) {
+        for(int d=0; d< 3; d++) {
+          r2[d]=r1[d]+kk*latVec(0,d)+jj*latVec(1,d)+ii*latVec(2,d);
+        }
+        doublevar r=sqrt(r2[0]*r2[0]+r2[1]*r2[1]+r2[2]*r2[2]);
+        sum+=erfcm(alpha*r)/r;
+      }
+    }
+  }
+  //----done lattice vectors
+  return sum;
+}
+
+//----------------------------------------------------------------------
+
 
 void Periodic_system::calcLocWithTestPos(Sample_point * sample, Array1 <doublevar> &tpos, Array1<doublevar> & Vtest) {
   sample->updateEEDist();
@@ -763,8 +834,7 @@ void Periodic_system::calcLocWithTestPos(Sample_point * sample, Array1 <doubleva
     cout <<"Warning, tpos is not in the cell" << endl; 
   }
   int nions=ions.size();
-  int nlatvec=1;
-  Array1 <doublevar> r1(3), r2(3), eidist(5), eedist(5);
+  Array1 <doublevar> r1(3), eidist(5), eedist(5);
   Vtest.Resize(totnelectrons+1);
   for (int e=0; e<totnelectrons; e++) {
     Vtest(e) = ijbg; 
@@ -784,25 +854,14 @@ void Periodic_system::calcLocWithTestPos(Sample_point * sample, Array1 <doubleva
     //for (int d=0; d<3; d++) {
     //  r1(d) = eidist(d+2); 
     //}
-    for(int kk=-nlatvec; kk <=nlatvec; kk++) {
-      for(int jj=-nlatvec; jj <=nlatvec; jj++) {
-	for(int ii=-nlatvec; ii <=nlatvec; ii++) {
-	  for(int d=0; d< 3; d++) {
-	    r2(d)=r1(d)+kk*latVec(0,d)+jj*latVec(1,d)+ii*latVec(2,d);
-	  }
-	  doublevar r=sqrt(r2(0)*r2(0)+r2(1)*r2(1)+r2(2)*r2(2));
-	  Vtest(totnelectrons) -= ions.charge(ion)*erfcm(alpha*r)/r;
-	  //            elecIon_real-=ions.charge(ion)*erfcm(alpha*r)/r;
-	}
-      }
-    }
-      //----done lattice vectors
+    Vtest(totnelectrons) -= ions.charge(ion)*shortRangeImages(r1.v);
   }
 
   //cout << "electron-electron " << endl;
   //-------------Electron-electron real part
   //sample->updateEEDist(); 
   
+  Periodic_ewald_cache & cache=updateEwald(sample);
   Array2 <doublevar> elecpos(totnelectrons, 3);
   sample->getAllElectronPos(elecpos);
   for(int e =0; e < totnelectrons; e++) {
@@ -810,19 +869,7 @@ void Periodic_system::calcLocWithTestPos(Sample_point * sample, Array1 <doubleva
     //for (int d=0; d<3; d++) r1(d)=eedist(d+2); 
     for (int d=0; d<3; d++) rion(d) = elecpos(e, d); 
     sample->minDist(tpos, rion, r1); 
-    //----over  lattice vectors
-    for(int kk=-nlatvec; kk <=nlatvec; kk++) {
-      for(int jj=-nlatvec; jj <=nlatvec; jj++) {
-	for(int ii=-nlatvec; ii <=nlatvec; ii++) {
-	  for(int d=0; d< 3; d++) {
-	    r2(d)=r1(d)+kk*latVec(0,d)+jj*latVec(1,d)+ii*latVec(2,d);
-	  }
-	  doublevar r=sqrt(r2(0)*r2(0)+r2(1)*r2(1)+r2(2)*r2(2));
-	  Vtest(e) += erfcm(alpha*r)/r;
-	}
-      }
-    }
-    //----done lattice vectors
+    Vtest(e) += shortRangeImages(r1.v);
   }
 
   //cout << "electron recip " << endl;
@@ -840,140 +887,129 @@ void Periodic_system::calcLocWithTestPos(Sample_point * sample, Array1 <doubleva
     doublevar test_cos = cos(rdotg);
     Vtest(totnelectrons) += 2.0*(-ion_cos(gpt)*test_cos - ion_sin(gpt)*test_sin + 0.5)*gweight(gpt);
     for(int e=0; e< totnelectrons; e++) {
-      rdotg=gpoint(gpt, 0)*elecpos(e,0)
-            +gpoint(gpt, 1)*elecpos(e,1)
-            +gpoint(gpt, 2)*elecpos(e,2);
-      Vtest(e) += 2.0*(test_cos*cos(rdotg) + test_sin*sin(rdotg))*gweight(gpt);
+      Vtest(e) += 2.0*(test_cos*cache.rho.cos_kr(e,gpt) 
+                       + test_sin*cache.rho.sin_kr(e,gpt))*gweight(gpt);
     }
   }
 }
 
 
-doublevar Periodic_system::ewaldElectron(Sample_point * sample) {
-  //cout << sample << endl;
+Periodic_ewald_cache & Periodic_system::updateEwald(Sample_point * sample) {
+  Periodic_sample * psample;
+  recast(sample,psample);
+  Periodic_ewald_cache & cache=psample->ewald_cache;
+  int nions=ions.size();
+  int ne=totnelectrons;
+  Array2 <doublevar> & elecpos=psample->elecpos;
+
+  if(!cache.valid) { 
+    cache.pos.Resize(ne,3);
+    cache.ionpos.Resize(nions,3);
+    cache.ee_real.Resize(ne,ne);
+    cache.ei_real.Resize(ne);
+    cache.moved.Resize(ne);
+  }
+
+  //---------reciprocal part: replace the moved electrons' terms in rho
+  cache.rho.update(elecpos, ngpoints);
+
+  int ions_moved=!cache.valid;
+  for(int ion=0; ion < nions; ion++) 
+    for(int d=0; d< 3; d++) 
+      if(cache.ionpos(ion,d)!=ions.r(d,ion)) ions_moved=1;
+
+  int nmoved=0;
+  for(int e=0; e< ne; e++) { 
+    cache.moved(e)=ions_moved;
+    for(int d=0; d< 3; d++) 
+      if(cache.pos(e,d)!=elecpos(e,d)) cache.moved(e)=1;
+    if(cache.moved(e)) nmoved++;
+  }
   sample->updateEEDist();
-  //cout << "updateEIDIST" << endl;
   sample->updateEIDist();
-  //cout << "done updatedist" << endl;
+  if(nmoved==0) return cache;
 
+  //---------real part, only for pairs that involve a moved electron
   Array1 <doublevar> eidist(5);
-  int nions=ions.size();
-  int nlatvec=1;
-  Array1 <doublevar> r1(3), r2(3);
-
-  //cout << "electron-ion " << endl;
-  //-------------Electron-ion real part
-  doublevar elecIon_real=0;
-  Array1<doublevar> elecIon_real_separated(totnelectrons); 
-  elecIon_real_separated = 0.0; 
-  for(int e=0; e< totnelectrons; e++) {
+  for(int e=0; e< ne; e++) {
+    if(!cache.moved(e)) continue;
+    doublevar ei=0;
     for(int ion=0; ion < nions; ion++) {
-
       sample->getEIDist(e,ion, eidist);
-      for(int d=0; d< 3; d++) r1(d)=eidist(d+2);
-
-      //----over  lattice vectors
-      for(int kk=-nlatvec; kk <=nlatvec; kk++) {
-        for(int jj=-nlatvec; jj <=nlatvec; jj++) {
-          for(int ii=-nlatvec; ii <=nlatvec; ii++) {
-            for(int d=0; d< 3; d++) {
-              r2(d)=r1(d)+kk*latVec(0,d)+jj*latVec(1,d)+ii*latVec(2,d);
-            }
-            doublevar r=sqrt(r2(0)*r2(0)+r2(1)*r2(1)+r2(2)*r2(2));
-	    elecIon_real_separated(e) -= ions.charge(ion)*erfcm(alpha*r)/r;
-            elecIon_real-=ions.charge(ion)*erfcm(alpha*r)/r;
-          }
-        }
-      }
-      //----done lattice vectors
+      ei-=ions.charge(ion)*shortRangeImages(eidist.v+2);
     }
+    cache.ei_real(e)=ei;
   }
-  //cout << "electron-electron " << endl;
-  //-------------Electron-electron real part
 
-  doublevar elecElec_real=0;
-  Array1 <doublevar> elecElec_real_separated(totnelectrons); 
-  elecElec_real_separated = 0.0; 
-  for(int e1=0; e1< totnelectrons; e1++) {
-    for(int e2 =e1+1; e2 < totnelectrons; e2++) {
+  for(int e1=0; e1< ne; e1++) {
+    for(int e2 =e1+1; e2 < ne; e2++) {
+      if(!cache.moved(e1) && !cache.moved(e2)) continue;
       sample->getEEDist(e1,e2, eidist);
-      for(int d=0; d< 3; d++) r1(d)=eidist(d+2);
-
-      //----over  lattice vectors
-      for(int kk=-nlatvec; kk <=nlatvec; kk++) {
-        for(int jj=-nlatvec; jj <=nlatvec; jj++) {
-          for(int ii=-nlatvec; ii <=nlatvec; ii++) {
-            for(int d=0; d< 3; d++) {
-              r2(d)=r1(d)+kk*latVec(0,d)+jj*latVec(1,d)+ii*latVec(2,d);
-            }
-            doublevar r=sqrt(r2(0)*r2(0)+r2(1)*r2(1)+r2(2)*r2(2));
-
-            elecElec_real+=erfcm(alpha*r)/r;
-	    elecElec_real_separated(e1) += erfcm(alpha*r)/r;
-	    elecElec_real_separated(e2) += erfcm(alpha*r)/r;
-          }
-        }
-      }
-      //----done lattice vectors
+      cache.ee_real(e1,e2)=shortRangeImages(eidist.v+2);
     }
   }
 
-  //cout << "electron recip " << endl;
+  cache.pos=elecpos;
+  for(int ion=0; ion < nions; ion++) 
+    for(int d=0; d< 3; d++) 
+      cache.ionpos(ion,d)=ions.r(d,ion);
+  cache.valid=1;
+  return cache;
+}
 
-  //---------electron reciprocal part
+//----------------------------------------------------------------------
 
+doublevar Periodic_system::ewaldElectron(Sample_point * sample) {
+  Periodic_ewald_cache & cache=updateEwald(sample);
+
+  doublevar elecIon_real=0;
+  for(int e=0; e< totnelectrons; e++) 
+    elecIon_real+=cache.ei_real(e);
+
+  doublevar elecElec_real=0;
+  for(int e1=0; e1< totnelectrons; e1++) 
+    for(int e2 =e1+1; e2 < totnelectrons; e2++) 
+      elecElec_real+=cache.ee_real(e1,e2);
 
-  doublevar rdotg;
-  Array2 <doublevar> elecpos(totnelectrons, 3);
-  sample->getAllElectronPos(elecpos);
   doublevar elecIon_recip=0, elecElec_recip=0;
-  Array1 <doublevar> elecIon_recip_separated(totnelectrons), 
-    elecElec_recip_separated(totnelectrons);
-  elecIon_recip_separated = 0.0; 
-  elecElec_recip_separated = 0.0; 
   for(int gpt=0; gpt < ngpoints; gpt++) {
-    doublevar sum_sin=0, sum_cos=0;
-    Array1<doublevar> sn(totnelectrons); 
-    Array1<doublevar> cs(totnelectrons); 
-    
-    for(int e=0; e< totnelectrons; e++) {
-      rdotg=gpoint(gpt, 0)*elecpos(e,0)
-            +gpoint(gpt, 1)*elecpos(e,1)
-            +gpoint(gpt, 2)*elecpos(e,2);
-      sn(e) = sin(rdotg); 
-      cs(e) = cos(rdotg);
-      sum_sin += sn(e); 
-      sum_cos += cs(e); 
-    }
+    doublevar sum_cos=cache.rho.rho_cos(gpt), sum_sin=cache.rho.rho_sin(gpt);
     elecIon_recip-=(ion_cos(gpt)*sum_cos + ion_sin(gpt)*sum_sin)*gweight(gpt);
     elecElec_recip+=(sum_cos*sum_cos + sum_sin*sum_sin)*gweight(gpt)/2;
-    for (int e=0; e<totnelectrons; e++) {
-      elecIon_recip_separated(e) -= (ion_cos(gpt)*cs(e) 
-				     + ion_sin(gpt)*sn(e))*gweight(gpt);
-      elecElec_recip_separated(e) += (sum_cos*cs(e) + sum_sin*sn(e)-0.5)*gweight(gpt);
-      // this term is essentially the contribution from 
-    }
   }
-
   elecIon_recip*=2;
   elecElec_recip*=2;
-  //cout << "done " << endl;
 
   //cout << "elecElec_real " << elecElec_real << endl;
   //cout << "elecIon_real " << elecIon_real << endl;
   //cout << "elecElec_recip " << elecElec_recip << endl;
   //cout << "elecIon_recip " << elecIon_recip << endl;
-  ewalde_separated.Resize(totnelectrons); 
-  doublevar cc; 
+  return elecElec_real + elecIon_real + elecElec_recip+elecIon_recip;
+}
+
+//----------------------------------------------------------------------
+
+void Periodic_system::ewaldElectronSeparated(Sample_point * sample, 
+                                             Array1 <doublevar> & ewalde_sep) {
+  Periodic_ewald_cache & cache=updateEwald(sample);
+  ewalde_sep.Resize(totnelectrons); 
   for (int e=0; e<totnelectrons; e++) {
-    ewalde_separated(e) = elecElec_real_separated(e) + elecIon_real_separated(e)
-         + 2.0*(elecIon_recip_separated(e) + elecElec_recip_separated(e)); 
-    //
-    //ewalde_separated(e) = elecElec_real_separated(e) 
-    //  + 2.0*(elecElec_recip_separated(e)); 
-        //noted that the elecElec_recip_separated term already removed the self interaction term; 
+    doublevar elecElec_real=0;
+    for(int j=0; j< e; j++) elecElec_real+=cache.ee_real(j,e);
+    for(int j=e+1; j< totnelectrons; j++) elecElec_real+=cache.ee_real(e,j);
+
+    doublevar elecIon_recip=0, elecElec_recip=0;
+    const doublevar * cs=cache.rho.cos_kr.v+e*ngpoints;
+    const doublevar * sn=cache.rho.sin_kr.v+e*ngpoints;
+    for(int gpt=0; gpt < ngpoints; gpt++) {
+      elecIon_recip-=(ion_cos(gpt)*cs[gpt] + ion_sin(gpt)*sn[gpt])*gweight(gpt);
+      //the -0.5 removes the self interaction
+      elecElec_recip+=(cache.rho.rho_cos(gpt)*cs[gpt] + cache.rho.rho_sin(gpt)*sn[gpt]-0.5)
+                      *gweight(gpt);
+    }
+    ewalde_sep(e) = elecElec_real + cache.ei_real(e)
+         + 2.0*(elecIon_recip + elecElec_recip); 
   }
-  return elecElec_real + elecIon_real + elecElec_recip+elecIon_recip;
 }
 
 //------------------------------------------------------------------------
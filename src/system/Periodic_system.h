@@ -26,8 +26,27 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Pseudopotential.h"
 #include "Particle_set.h"
 #include "Pbc_enforcer.h"
+#include "Coulomb_breakup.h"
+#include "Structure_factor.h"
 class Periodic_sample;
 
+/*!
+Ewald terms of one electron configuration.  Periodic_sample keeps one,
+and Periodic_system::updateEwald() only redoes the electrons whose 
+positions changed since the last evaluation, so moving one electron costs
+O(N_G) in reciprocal space and O(N) in real space.
+*/
+struct Periodic_ewald_cache { 
+  Periodic_ewald_cache() { valid=0; }
+  int valid;
+  Array2 <doublevar> pos;    //!< (e,d) where each electron was when its real-space terms were made
+  Array2 <doublevar> ionpos; //!< (ion,d) the ion positions used for ei_real
+  Structure_factor rho;      //!< on the g-points; the k-space Jastrow reads it too
+  Array2 <doublevar> ee_real; //!< (e1,e2) with e1 < e2: real-space electron-electron terms
+  Array1 <doublevar> ei_real; //!< (e) real-space electron-ion terms
+  Array1 <int> moved;
+};
+
 /*!
 \brief 
 Represents a periodic system. Keyword: PERIODIC
@@ -45,6 +64,11 @@ V=.5 \sum_{l}\sum_{i \ne j} q_i q_j \frac{erfc(\alpha |{\bf r_{ij}+l}|)}{r_{ij}}
 
 \f]
 
+With OPTIMIZED_BREAKUP, \f$erfc(\alpha r)/r\f$ and the Gaussian
+reciprocal weights are replaced by the fitted \f$V_s\f$ and \f$V_l\f$ of
+Coulomb_breakup, \f$2\alpha/\sqrt{\pi}\f$ by \f$V_l(0)\f$, and
+\f$\pi/V\alpha^2\f$ by \f$\frac{1}{V}\int V_s d^3r\f$.
+
 \todo
 Stop using Particle_set for the ion positions.  Use Pbc_enforcer instead of 
 having the member function.
@@ -112,6 +136,12 @@ public:
     displacements=center_displacement;
   }
 
+  virtual int getCenterPos(Array2 <doublevar> & pos) {
+    pos.Resize(centerpos.GetDim(0), 3);
+    pos=centerpos;
+    return 1;
+  }
+
   int getBounds(Array2 <doublevar> & latvec,Array1<doublevar>& origin) {
     latvec=latVec;
     origin=origin;
@@ -127,6 +157,11 @@ public:
     gvec=prim_recip_vec;
     return 1;
   }
+
+  int getStructureFactorKpoints(Array2 <doublevar> & kpt) { 
+    kpt=gpoint;
+    return 1;
+  }
     
   int getPrimLattice(Array2 <doublevar> & gvec) { 
     gvec=primlat;
@@ -169,7 +204,7 @@ private:
   Array2 <doublevar> normVec;  //!< normal vectors to the sides, pointing out
   Array2 <doublevar> corners; //!< the position of the corner by moving one lattice vector
 
-  Array2 <doublevar> gpoint; //!< A list of non-zero g points in the ewald sum
+  Array2 <doublevar> gpoint; //!< A list of non-zero g points in the ewald sum, sorted by length
   Array1 <doublevar> gweight;
   //!< A list of the weights(\f$4\pi exp(|g|^2/4 \alpha^2) \over V_{cell}|g|^2\f$)
 
@@ -181,6 +216,10 @@ private:
   int totnelectrons; //!< number of electrons
   doublevar smallestheight; //!< smallest distance that spans the cell
   doublevar alpha; //!< the ewald parameter
+  int optimized_breakup; //!< whether to use breakup instead of the Ewald split
+  Coulomb_breakup breakup;
+  doublevar ewald_vl0; //!< long-range part of the interaction at r=0
+  doublevar ewald_vs_int; //!< integral of the short-range part over the cell, divided by its volume
   doublevar cellVolume; //!< Simulation cell volume
 
   doublevar self_ii; //!< self ion-ion energy
@@ -188,24 +227,42 @@ private:
   doublevar self_ee; //!< self electron-electron energy
   doublevar xc_correction; //!<exchange-correlation correction
   //  Array1 <doublevar> self_ee_separated; 
-  Array1 <doublevar> ewalde_separated; 
   doublevar self_e_single; 
   doublevar self_e_single_test; 
   doublevar ijbg; 
+  /*!
+    Find alpha and the g-points for the Ewald split
+   */
+  void setupEwald(int ewald_gmax);
+
   /*!
     Set the constant ewald terms
    */
   void constEwald();
 
+  //! real-space part of the interaction of two unit charges
+  doublevar shortRange(doublevar r);
+  doublevar shortRangeImages(const doublevar * r);
+
   /*!
     Calculate the ion-ion interaction from the ions stored here.
    */
   doublevar ewaldIon();
 
+  /*!
+    Bring the sample's Ewald cache up to date with its electron positions.
+   */
+  Periodic_ewald_cache & updateEwald(Sample_point * sample);
+
   /*!
     electron-ion interaction and electron-electron interaction
    */
   doublevar ewaldElectron(Sample_point * sample);
+
+  /*!
+    ewaldElectron() split up by electron, for calcLocSeparated()
+   */
+  void ewaldElectronSeparated(Sample_point * sample, Array1 <doublevar> & ewalde_sep);
   doublevar minDistance(Array1 <doublevar> pos1, Array1 <doublevar> pos2, Array1 <doublevar> &rmin ); 
   Array1 <doublevar> ion_polarization;
 };
@@ -92,8 +92,10 @@ int Pseudopotential::initializeStatic(Wavefunction_data *wfdata,
   int natoms=sample->ionSize();
 
   Array1 <doublevar> ionpos(3), oldpos(3), olddist(5), newpos(3);
+  Distance_row eirow;
   Array1 <doublevar> staticvals(wfdata->valSize());
-  //Storage_container wfStore;
+  Storage_container & wfStore(thread_wfStore(qmc_thread_num()));
+  Array3 <doublevar> & integralpt(thread_integralpt(qmc_thread_num()));
   if(! wfStore.isInitialized())  {
     wfStore.initialize(sample, wf);
   }
@@ -104,7 +106,8 @@ int Pseudopotential::initializeStatic(Wavefunction_data *wfdata,
       for(int e=0; e < sample->electronSize(); e++) {
         sample->getElectronPos(e, oldpos);
         sample->updateEIDist();//kind of inefficient..
-        sample->getEIDist(e,at, olddist);
+        sample->getEIRow(e,eirow);
+        eirow.get(at,olddist);
 	
         //----------------------------------------
         //Start integral
@@ -145,6 +148,8 @@ void Pseudopotential::calcNonlocWithFile(Wavefunction_data * wfdata,
                                          Array1 <doublevar> & totalv,
                                          Pseudo_buffer & input)
 {
+  Storage_container & wfStore(thread_wfStore(qmc_thread_num()));
+  Array3 <doublevar> & integralpt(thread_integralpt(qmc_thread_num()));
   int natoms=sample->ionSize();
   int nwf=wf->nfunc();
 
@@ -152,6 +157,7 @@ void Pseudopotential::calcNonlocWithFile(Wavefunction_data * wfdata,
   assert(nelectrons == sample->electronSize());
 
   Array1 <doublevar> ionpos(3), oldpos(3), newpos(3);
+  Distance_row eirow;
   Array1 <doublevar> newdist(5), olddist(5);
   Wf_return val(nwf,2);
   Array1 <doublevar> staticval(wfdata->valSize());
@@ -172,7 +178,8 @@ void Pseudopotential::calcNonlocWithFile(Wavefunction_data * wfdata,
       for(int e=0; e < sample->electronSize(); e++) {
         sample->getElectronPos(e, oldpos);
         sample->updateEIDist();//kind of inefficient..
-        sample->getEIDist(e,at, olddist);
+        sample->getEIRow(e,eirow);
+        eirow.get(at,olddist);
 
         Array1 <doublevar>  nonlocal(nwf);
         nonlocal=0;
@@ -449,6 +456,8 @@ void Pseudopotential::calcPseudoSeparated(Wavefunction_data * wfdata,
 					  const Array1 <doublevar> & accept_var,
 					  Array2 <doublevar> & totalv)//, 
 {
+  Storage_container & wfStore(thread_wfStore(qmc_thread_num()));
+  Array3 <doublevar> & integralpt(thread_integralpt(qmc_thread_num()));
   int natoms=sample->ionSize();
   int nwf=wf->nfunc();
   assert(accept_var.GetDim(0) >= nTest());
@@ -456,6 +465,7 @@ void Pseudopotential::calcPseudoSeparated(Wavefunction_data * wfdata,
   assert(nelectrons == sample->electronSize());
 
   Array1 <doublevar> ionpos(3), oldpos(3), newpos(3);
+  Distance_row eirow;
   Array1 <doublevar> newdist(5), olddist(5);
   Wf_return val(nwf,2);
   
@@ -484,7 +494,8 @@ void Pseudopotential::calcPseudoSeparated(Wavefunction_data * wfdata,
 	//to do it.  If needed, we should add an interface to 
 	//Sample_point
 	sample->updateEIDist();
-	sample->getEIDist(e, at, olddist);
+	sample->getEIRow(e,eirow);
+	eirow.get(at,olddist);
 	nonlocal=0.0; 
 	
 	int spin=1;
@@ -603,6 +614,8 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
                                                  bool parm_derivatives, Array1 <doublevar> & parm_deriv
                                           )
 {
+  Storage_container & wfStore(thread_wfStore(qmc_thread_num()));
+  Array3 <doublevar> & integralpt(thread_integralpt(qmc_thread_num()));
   //Note: I left the derivative stuff commented out.
   //I don't know if it's even really correct, so beware.
 
@@ -615,6 +628,7 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
   assert(nelectrons == sample->electronSize());
 
   Array1 <doublevar> ionpos(3), oldpos(3), newpos(3);
+  Distance_row eirow;
   Array1 <doublevar> newdist(5), olddist(5);
   Wf_return val(nwf,2);
 
@@ -624,6 +638,9 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
 
   wf->updateVal(wfdata, sample);
   wfStore.initialize(sample, wf);
+  //The parameter derivatives need the wave function at each point, so 
+  //they still move the electron.
+  int use_virtual=wfdata->supports(virtual_moves) && !parm_derivatives;
   Parm_deriv_return base_deriv;
   if(parm_derivatives) { 
     parm_deriv.Resize(wfdata->nparms());
@@ -655,7 +672,8 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
         //to do it.  If needed, we should add an interface to 
         //Sample_point
         sample->updateEIDist();
-        sample->getEIDist(e,at, olddist);
+        sample->getEIRow(e,eirow);
+        eirow.get(at,olddist);
         nonlocal=0;
 
         int spin=1;
@@ -690,60 +708,98 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
       
 
         if(accept)  {
-          wfStore.saveUpdate(sample, wf, e);
           Wf_return  oldWfVal(nwf,2);
-          wf->getVal(wfdata, e,oldWfVal);
+          Array1 <Wf_return> testvals;
+          Array1 <doublevar> testsign, testphase;
+          if(use_virtual) { 
+            //Evaluate all the quadrature points at once, without moving
+            //the electron
+            wf->getVal(wfdata, e,oldWfVal);
+            Array2 <doublevar> testpos(aip(at),3);
+            Array1 <doublevar> movedpos(3);
+            testsign.Resize(aip(at));
+            testphase.Resize(aip(at));
+            for(int i=0; i< aip(at); i++) { 
+              for(int d=0; d < 3; d++) 
+                newpos(d)=integralpt(at,i,d)*olddist(0)-olddist(d+2);
+              sample->translatedPosition(e,newpos,movedpos,testsign(i),
+                                         testphase(i));
+              for(int d=0; d < 3; d++) 
+                testpos(i,d)=movedpos(d);
+            }
+            wf->evalVirtualMoves(wfdata, sample, e, testpos, testvals);
+          }
+          else { 
+            wfStore.saveUpdate(sample, wf, e);
+            wf->getVal(wfdata, e,oldWfVal);
+          }
 
           for(int i=0; i< aip(at); i++) {
-            sample->setElectronPos(e, oldpos);
-            doublevar base_sign=sample->overallSign();
-            doublevar base_phase=sample->overallPhase();
             //Make sure to move the electron relative to the nearest neighbor
             //in a periodic calculation(so subtract the distance rather than
             //adding to the ionic position).  This actually only matters 
             //when we're doing non-zero k-points.
             for(int d=0; d < 3; d++) 
               newpos(d)=integralpt(at,i,d)*olddist(0)-olddist(d+2);
+
+            doublevar sign_change, phase_change;
+            if(use_virtual) { 
+              //the new electron-ion vector is the quadrature point
+              rDotR(i)=0;
+              for(int d=0; d < 3; d++)
+                rDotR(i)+=integralpt(at,i,d)*olddist(d+2);
+              rDotR(i)/=olddist(0);
+              sign_change=testsign(i);
+              phase_change=testphase(i);
+            }
+            else { 
+              sample->setElectronPos(e, oldpos);
+              doublevar base_sign=sample->overallSign();
+              doublevar base_phase=sample->overallPhase();
 	    
-            //cout << "translation " << newpos(0) << "   " 
-             //   << newpos(1) << "   " << newpos(2) << endl;
+              //cout << "translation " << newpos(0) << "   " 
+               //   << newpos(1) << "   " << newpos(2) << endl;
             
-            sample->translateElectron(e, newpos);
-            sample->updateEIDist();
-            sample->getEIDist(e,at,newdist);
-            //cout << "ionpos " << ionpos(0) << " " << ionpos(1) << " " << ionpos(2) << endl;
-            //cout << "oldpos " << oldpos(0) << " " << oldpos(1) << " " << oldpos(2) << endl;
-            //cout << "newpos " << oldpos(0)+newpos(0) << " " << oldpos(1)+newpos(1) << 
-            //  " " << oldpos(2)+newpos(2) << endl;
-            //Array1 <doublevar> newpos_test(3);
-            //sample->getElectronPos(e,newpos_test);
-            //cout << "newpos_test " << newpos_test(0) << " " << newpos_test(1) << " "
-            //  << newpos_test(2) << endl;
-
-            //cout << "olddist " << olddist(0) << " newdist " << newdist(0) << endl;
-            //cout << "integralpt " << olddist(0)*integralpt(at,i,0) << " " << olddist(0)*integralpt(at,i,1) 
-            //  << " " << olddist(0)*integralpt(at,i,2) << endl;
-
-            rDotR(i)=0;
-            for(int d=0; d < 3; d++)
-              rDotR(i)+=newdist(d+2)*olddist(d+2);
-            doublevar new_sign=sample->overallSign();
-            doublevar new_phase=sample->overallPhase();
+              sample->translateElectron(e, newpos);
+              sample->updateEIDist();
+              sample->getEIDist(e,at,newdist);
+              //cout << "ionpos " << ionpos(0) << " " << ionpos(1) << " " << ionpos(2) << endl;
+              //cout << "oldpos " << oldpos(0) << " " << oldpos(1) << " " << oldpos(2) << endl;
+              //cout << "newpos " << oldpos(0)+newpos(0) << " " << oldpos(1)+newpos(1) << 
+              //  " " << oldpos(2)+newpos(2) << endl;
+              //Array1 <doublevar> newpos_test(3);
+              //sample->getElectronPos(e,newpos_test);
+              //cout << "newpos_test " << newpos_test(0) << " " << newpos_test(1) << " "
+              //  << newpos_test(2) << endl;
+
+              //cout << "olddist " << olddist(0) << " newdist " << newdist(0) << endl;
+              //cout << "integralpt " << olddist(0)*integralpt(at,i,0) << " " << olddist(0)*integralpt(at,i,1) 
+              //  << " " << olddist(0)*integralpt(at,i,2) << endl;
+
+              rDotR(i)=0;
+              for(int d=0; d < 3; d++)
+                rDotR(i)+=newdist(d+2)*olddist(d+2);
+              doublevar new_sign=sample->overallSign();
+              doublevar new_phase=sample->overallPhase();
             
-            rDotR(i)/=(newdist(0)*olddist(0));  //divide by the magnitudes
-            wf->updateVal(wfdata, sample);
-            wf->getVal(wfdata, e, val); 
+              rDotR(i)/=(newdist(0)*olddist(0));  //divide by the magnitudes
+              wf->updateVal(wfdata, sample);
+              wf->getVal(wfdata, e, val); 
+              sign_change=base_sign*new_sign;
+              phase_change=new_phase-base_phase;
+            }
+            Wf_return & newval=use_virtual ? testvals(i) : val;
             //----
             //cout << "signs " << base_sign << "  " << new_sign << endl;;
             for(int w=0; w< nwf; w++) {
-              integralpts(w,i)=exp(val.amp(w,0)-oldWfVal.amp(w,0))
+              integralpts(w,i)=exp(newval.amp(w,0)-oldWfVal.amp(w,0))
                 *integralweight(at, i);
-              if ( val.is_complex==1 ) {
-                integralpts(w,i)*=cos(val.phase(w,0)+new_phase
-                    -oldWfVal.phase(w,0)-base_phase);
+              if ( newval.is_complex==1 ) {
+                integralpts(w,i)*=cos(newval.phase(w,0)+phase_change
+                    -oldWfVal.phase(w,0));
               } else {
-                integralpts(w,i)*=val.sign(w)*oldWfVal.sign(w)
-                  *base_sign*new_sign;
+                integralpts(w,i)*=newval.sign(w)*oldWfVal.sign(w)
+                  *sign_change;
               }
             }
             
@@ -779,14 +835,14 @@ void Pseudopotential::calcNonlocWithAllvariables(Wavefunction_data * wfdata,
               }
               //------
             }
-            sample->setElectronPos(e, oldpos);
+            if(!use_virtual) sample->setElectronPos(e, oldpos);
           } 
 
           //--------------------
 
 
 
-          wfStore.restoreUpdate(sample, wf, e);
+          if(!use_virtual) wfStore.restoreUpdate(sample, wf, e);
         }
 
         //----------------------------------------------
@@ -834,6 +890,7 @@ void Pseudopotential::rotateQuadrature(Array1 <doublevar> & x,
                                        Array1 <doublevar> & y,
                                        Array1 <doublevar> & z)
 {
+  Array3 <doublevar> & integralpt(thread_integralpt(qmc_thread_num()));
 
 
   int natoms=aip.GetDim(0);
@@ -886,7 +943,6 @@ void Pseudopotential::read(vector <vector <string> > & pseudotext,
   //Get the atomic integration points
   aip.Resize(natoms);
   aip=6; //default value for atomic integration points
-  integralpt.Resize(natoms, maxaip, 3);
   integralpt_orig.Resize(natoms, maxaip, 3);
   integralweight.Resize(natoms, maxaip);
   addzeff.Resize(natoms);
@@ -963,14 +1019,19 @@ void Pseudopotential::read(vector <vector <string> > & pseudotext,
 
     for(int i=0; i< aip(at); i++)
     {
-      integralpt(at,i,0)=integralpt_orig(at, i, 0)=xpt(i);
-      integralpt(at,i,1)=integralpt_orig(at, i, 1)=ypt(i);
-      integralpt(at,i,2)=integralpt_orig(at, i, 2)=zpt(i);
+      integralpt_orig(at, i, 0)=xpt(i);
+      integralpt_orig(at, i, 1)=ypt(i);
+      integralpt_orig(at, i, 2)=zpt(i);
       integralweight(at, i)=weight(i);
     }
 
   }
 
+  thread_integralpt.Resize(qmc_max_threads());
+  for(int t=0; t< thread_integralpt.GetDim(0); t++)
+    thread_integralpt(t)=integralpt_orig;
+  thread_wfStore.Resize(qmc_max_threads());
+
 
   //allocate the storage
 
@@ -217,7 +217,7 @@ public:
 
   doublevar getIntegralPt(int at, int i, int d)
   {
-    return integralpt(at, i, d); 
+    return thread_integralpt(qmc_thread_num())(at, i, d); 
   }
   int getMaxAIP() {
     return maxaip; 
@@ -241,14 +241,14 @@ public:
   const int maxaip; //!< Maximum number of atomic integration points
   int nelectrons;
   Array1 <int> aip;
-  Array3 <doublevar> integralpt;
+  Array1 < Array3 <doublevar> > thread_integralpt; //!< rotated quadrature, one per thread
   Array3 <doublevar> integralpt_orig;
   Array2 <doublevar> integralweight;
   Array1 <doublevar> cutoff;
   vector <string> atomnames;
   Array1 <bool> addzeff; //!< whether or not to add Z_eff/r to the local function
   
-  Storage_container wfStore;
+  Array1 <Storage_container> thread_wfStore;
   
   Array2 <Basis_function *> radial_basis;
   
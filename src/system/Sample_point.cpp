@@ -32,6 +32,53 @@ int Sample_point::ndim() { return 3; }
 
 //----------------------------------------------------------------------
 
+void Sample_point::fillRow(Distance_row & row, int n) { 
+  row_scratch.Resize(5*n);
+  row.r=row_scratch.v;
+  row.r2=row_scratch.v+n;
+  row.dx=row_scratch.v+2*n;
+  row.dy=row_scratch.v+3*n;
+  row.dz=row_scratch.v+4*n;
+  row.n=n;
+}
+
+void Sample_point::getEERow(const int e, Distance_row & row) { 
+  int n=electronSize();
+  fillRow(row,n);
+  Array1 <doublevar> R(5);
+  for(int j=0; j< n; j++) { 
+    doublevar sign=1.0;
+    if(j < e) { getEEDist(j,e,R); sign=-1.0; } 
+    else if(j > e) getEEDist(e,j,R);
+    else R=0.0;
+    row_scratch(j)=R(0);
+    row_scratch(n+j)=R(1);
+    for(int d=0; d< 3; d++) row_scratch((2+d)*n+j)=sign*R(2+d);
+  }
+}
+
+void Sample_point::getEIRow(const int e, Distance_row & row) { 
+  int n=ionSize();
+  fillRow(row,n);
+  Array1 <doublevar> R(5);
+  for(int j=0; j< n; j++) { 
+    getEIDist(e,j,R);
+    for(int q=0; q< 5; q++) row_scratch(q*n+j)=R(q);
+  }
+}
+
+void Sample_point::getECRow(const int e, Distance_row & row) { 
+  int n=centerSize();
+  fillRow(row,n);
+  Array1 <doublevar> R(5);
+  for(int j=0; j< n; j++) { 
+    getECDist(e,j,R);
+    for(int q=0; q< 5; q++) row_scratch(q*n+j)=R(q);
+  }
+}
+
+//----------------------------------------------------------------------
+
 int read_config(string & last_read, istream & is, 
                 Sample_point * sample) {
   if(last_read=="CONFIGS") {
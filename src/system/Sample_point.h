@@ -23,9 +23,11 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define SAMPLE_POINT_H_INCLUDED
 
 #include "Qmc_std.h"
+#include "Distance_table.h"
 class Wavefunction;
 class Sample_storage;
 class System;
+struct Structure_factor;
 
 
 /*!
@@ -120,6 +122,22 @@ public:
   virtual doublevar overallPhase() {
     return 0.0;
   }
+
+  /*!
+    \brief
+    Where translateElectron(e,trans) would put electron e, and the change 
+    in overallSign() (as a factor) and overallPhase() (as a difference) 
+    that it would cause, without moving anything.
+   */
+  virtual void translatedPosition(const int e, const Array1 <doublevar> & trans,
+                                  Array1 <doublevar> & pos, doublevar & sign,
+                                  doublevar & phase) {
+    getElectronPos(e,pos);
+    for(int d=0; d< 3; d++) 
+      pos(d)+=trans(d);
+    sign=1.0;
+    phase=0.0;
+  }
   
   /*!
     \brief
@@ -219,6 +237,46 @@ public:
   virtual void getECDist(const int e, const int cent,
                          Array1 <doublevar> & distance)=0;
 
+  //Whole rows
+  /*!
+    \brief
+    All the distances of electron e at once.  Row j holds 
+    \f$ {\bf r}_e-{\bf r}_j \f$, so it matches getEEDist(e,j) for j > e 
+    and is getEEDist(j,e) with the vector reversed for j < e; entry e is zero.
+
+    The pointers stay valid until the next move, save or restore of any 
+    electron.  The default builds the row from getEEDist(), so 
+    implementations that keep a Distance_table should override these.
+   */
+  virtual void getEERow(const int e, Distance_row & row);
+
+  //! Like getEIDist() for all the ions at once
+  virtual void getEIRow(const int e, Distance_row & row);
+
+  //! Like getECDist() for all the centers at once
+  virtual void getECRow(const int e, Distance_row & row);
+
+  /*!
+    \brief
+    Row 0 of ee and of ei get what getEERow(e) and getEIRow(e) would give 
+    with electron e at pos, without moving it or touching the sample's 
+    own tables.  The tables are sized here when they need it, so a 
+    caller that keeps them doesn't allocate after the first call.
+   */
+  virtual void getVirtualRows(const int e, const Array1 <doublevar> & pos,
+                              Distance_table & ee, Distance_table & ei) {
+    error("getVirtualRows not implemented for this sample point");
+  }
+
+  /*!
+    \brief
+    The structure factor of the electrons on the k-points from 
+    System::getStructureFactorKpoints(), brought up to date with the 
+    electron positions for the first n of them.  NULL if the sample 
+    doesn't keep one.
+   */
+  virtual const Structure_factor * getStructureFactor(int n) { return NULL; }
+
 
   //I/O
 
@@ -244,6 +302,9 @@ public:
 
 protected:
   Wavefunction * wfObserver;
+private:
+  void fillRow(Distance_row & row, int n);
+  Array1 <doublevar> row_scratch; //!< for the default get*Row()
 };
 
 
@@ -262,6 +323,9 @@ private:
   Array2 <doublevar> iondist_temp;
   Array2 <doublevar> pointdist_temp;
   Array1 <doublevar> pos_temp;
+  //! buffers that Distance_table::saveRow() swaps the saved rows into
+  Array1 <doublevar> eerow_temp, eirow_temp, ecrow_temp;
+  int eestale_temp, eistale_temp, ecstale_temp;
 };
 
 
@@ -0,0 +1,129 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Structure_factor.h"
+#include <algorithm>
+
+void Structure_factor::init(int nelectrons, const Array2 <doublevar> & kpt) {
+  ne=nelectrons;
+  nk=kpt.GetDim(0);
+  kpoint.Resize(nk,3);
+  for(int k=0; k< nk; k++)
+    for(int d=0; d< 3; d++)
+      kpoint(k,d)=kpt(k,d);
+  //rho stays the sum of cos_kr and sin_kr, even before they're computed
+  cos_kr.Resize(ne,nk);
+  sin_kr.Resize(ne,nk);
+  cos_kr=0.0;
+  sin_kr=0.0;
+  rho_cos.Resize(nk);
+  rho_sin.Resize(nk);
+  rho_cos=0.0;
+  rho_sin=0.0;
+  pos.Resize(ne,3);
+  pos=0.0;
+  nfresh.Resize(ne);
+  nfresh=0;
+  nadded.Resize(nk);
+  nadded=0;
+}
+
+//----------------------------------------------------------------------
+
+void Structure_factor::update(const Array2 <doublevar> & newpos, int n) {
+  assert(n <= nk);
+  assert(newpos.GetDim(0)==ne);
+  int nchanged=0;
+  for(int e=0; e< ne; e++) {
+    const doublevar * r=newpos.v+3*e;
+    if(pos(e,0)!=r[0] || pos(e,1)!=r[1] || pos(e,2)!=r[2]) {
+      for(int d=0; d< 3; d++) pos(e,d)=r[d];
+      nfresh(e)=0;
+      nchanged++;
+    }
+    if(nfresh(e) >= n) continue;
+    doublevar * cs=cos_kr.v+e*nk;
+    doublevar * sn=sin_kr.v+e*nk;
+    for(int k=nfresh(e); k < n; k++) {
+      doublevar kdotr=kpoint(k,0)*r[0]+kpoint(k,1)*r[1]+kpoint(k,2)*r[2];
+      doublevar newcos=cos(kdotr), newsin=sin(kdotr);
+      rho_cos(k)+=newcos-cs[k];
+      rho_sin(k)+=newsin-sn[k];
+      cs[k]=newcos;
+      sn[k]=newsin;
+      nadded(k)++;
+    }
+    nfresh(e)=n;
+  }
+  //A whole new configuration, as when a walker is loaded into the sample:
+  //sum every k-point from scratch when it is next brought up to date, so
+  //the sums don't carry roundoff from whatever walker was here before.
+  if(nchanged==ne) {
+    for(int k=0; k< nk; k++) nadded(k)=ne+1;
+  }
+
+  //Sum from scratch every so often so that roundoff doesn't build up
+  for(int k=0; k< n; k++) {
+    if(nadded(k) <= ne) continue;
+    doublevar sum_cos=0, sum_sin=0;
+    for(int e=0; e< ne; e++) {
+      sum_cos+=cos_kr(e,k);
+      sum_sin+=sin_kr(e,k);
+    }
+    rho_cos(k)=sum_cos;
+    rho_sin(k)=sum_sin;
+    nadded(k)=0;
+  }
+}
+
+//----------------------------------------------------------------------
+
+struct Kpoint_length_order {
+  const Array1 <doublevar> * ksqrd;
+  bool operator()(int a, int b) const {
+    if((*ksqrd)(a)!=(*ksqrd)(b)) return (*ksqrd)(a) < (*ksqrd)(b);
+    return a < b;
+  }
+};
+
+void sort_kpoints(Array2 <doublevar> & kpt, Array1 <doublevar> & weight) {
+  int nk=kpt.GetDim(0);
+  assert(weight.GetDim(0)==nk);
+  Array1 <doublevar> ksqrd(nk);
+  vector <int> sorted(nk);
+  for(int k=0; k< nk; k++) {
+    ksqrd(k)=kpt(k,0)*kpt(k,0)+kpt(k,1)*kpt(k,1)+kpt(k,2)*kpt(k,2);
+    sorted[k]=k;
+  }
+  Kpoint_length_order cmp;
+  cmp.ksqrd=&ksqrd;
+  sort(sorted.begin(), sorted.end(), cmp);
+
+  Array2 <doublevar> oldkpt(nk,3);
+  Array1 <doublevar> oldweight(nk);
+  oldkpt=kpt;
+  oldweight=weight;
+  for(int k=0; k< nk; k++) {
+    for(int d=0; d< 3; d++) kpt(k,d)=oldkpt(sorted[k],d);
+    weight(k)=oldweight(sorted[k]);
+  }
+}
+
+//----------------------------------------------------------------------
@@ -0,0 +1,65 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef STRUCTURE_FACTOR_H_INCLUDED
+#define STRUCTURE_FACTOR_H_INCLUDED
+
+#include "Qmc_std.h"
+
+/*!
+\brief
+The Fourier components \f$ \rho_{\bf k}=\sum_e e^{i{\bf k \cdot r_e}} \f$
+of the electron density on a list of k-points, along with each
+electron's \f$ cos({\bf k \cdot r_e}) \f$ and sine.
+
+update() only redoes the electrons that moved since the last call, and
+only over the first n k-points, so moving one electron costs O(n).  The
+k-points are sorted by length (sort_kpoints()), so the Ewald sum can ask
+for all of them and the k-space Jastrow for the short ones, and both read
+the same sums.
+*/
+struct Structure_factor {
+  Structure_factor() { nk=ne=0; }
+
+  //! Use the k-points kpt(k,d) for ne electrons, with nothing computed yet
+  void init(int ne, const Array2 <doublevar> & kpt);
+
+  //! Bring the first n k-points up to date with the positions pos(e,d)
+  void update(const Array2 <doublevar> & pos, int n);
+
+  int nk, ne;
+  Array2 <doublevar> kpoint; //!< (k,d)
+  Array2 <doublevar> cos_kr, sin_kr; //!< (e,k)
+  Array1 <doublevar> rho_cos, rho_sin; //!< (k) sums of cos_kr and sin_kr over the electrons
+
+private:
+  Array2 <doublevar> pos; //!< (e,d) where each electron was at its last update
+  Array1 <int> nfresh;    //!< (e) its cos_kr and sin_kr are current for k < nfresh(e)
+  Array1 <int> nadded;    //!< (k) changes added to rho since it was summed from scratch
+};
+
+/*!
+  Sort the k-points kpt(k,d), along with their weights, by length.
+  Points of the same length keep their order.
+*/
+void sort_kpoints(Array2 <doublevar> & kpt, Array1 <doublevar> & weight);
+
+#endif //STRUCTURE_FACTOR_H_INCLUDED
+//--------------------------------------------------------------------------
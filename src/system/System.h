@@ -109,6 +109,16 @@ public:
     return 0;
   }
   
+  /*!
+    \brief
+    The k-points, sorted by length, of the structure factor that the 
+    samples keep (see Sample_point::getStructureFactor()).  Return 1 on
+    success and 0 if the samples don't keep one.
+  */
+  virtual int getStructureFactorKpoints(Array2 <doublevar> & kpt) { 
+    return 0;
+  }
+
   /*!
     \brief 
     Get a representative box for the simulation cell
@@ -153,6 +163,15 @@ public:
                                     Array1 <int> & ncenters_atom, 
                                     Array2 <int> & displacements)=0;
 
+  /*!
+    \brief
+    Positions (center, [x,y,z]) of the centers of getCenterLabels().
+    Returns 0 if the system doesn't keep them.
+   */
+  virtual int getCenterPos(Array2 <doublevar> & pos) {
+    return 0;
+  }
+
   virtual void makeCopy(System *& ptr)=0;
 
 };
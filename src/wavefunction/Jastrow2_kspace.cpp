@@ -0,0 +1,233 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Jastrow2_kspace.h"
+#include "Jastrow2_wf.h"
+#include "qmc_io.h"
+#include "System.h"
+
+//--------------------------------------------------------------------------
+
+void Jastrow_kspace_piece::set_up(vector <string> & words, System * sys) {
+  unsigned int pos=0;
+  Array2 <doublevar> kpt;
+  if(!sys->getStructureFactorKpoints(kpt))
+    error("KSPACE needs a PERIODIC system, or HEG with the Ewald interaction");
+  if(!readvalue(words, pos=0, kcut, "KCUT"))
+    error("Need KCUT in the KSPACE section");
+
+  //The k-points are sorted by length, so the ones we use come first
+  int ntot=kpt.GetDim(0);
+  nk=0;
+  while(nk < ntot) {
+    doublevar k2=kpt(nk,0)*kpt(nk,0)+kpt(nk,1)*kpt(nk,1)+kpt(nk,2)*kpt(nk,2);
+    if(sqrt(k2) > kcut*(1+1e-8)) break;
+    nk++;
+  }
+  if(nk==0)
+    error("There are no k-points inside KCUT=", kcut);
+  if(nk==ntot)
+    error("KCUT=", kcut, " goes beyond the g-points of the Ewald sum");
+
+  kpoint.Resize(nk,3);
+  ksqrd.Resize(nk);
+  kshell.Resize(nk);
+  vector <doublevar> lengths;
+  vector <int> counts;
+  for(int k=0; k< nk; k++) {
+    for(int d=0; d< 3; d++) kpoint(k,d)=kpt(k,d);
+    ksqrd(k)=kpt(k,0)*kpt(k,0)+kpt(k,1)*kpt(k,1)+kpt(k,2)*kpt(k,2);
+    doublevar len=sqrt(ksqrd(k));
+    if(lengths.size()==0 || len > lengths.back()*(1+1e-6)) {
+      lengths.push_back(len);
+      counts.push_back(0);
+    }
+    kshell(k)=lengths.size()-1;
+    counts.back()++;
+  }
+  nshell=lengths.size();
+  shell_k.Resize(nshell);
+  shell_count.Resize(nshell);
+  for(int s=0; s< nshell; s++) {
+    shell_k(s)=lengths[s];
+    shell_count(s)=counts[s];
+  }
+
+  //Shells past the end of COEFFICIENTS start at zero
+  parameters.Resize(nshell);
+  parameters=0.0;
+  vector <string> coefftxt;
+  if(readsection(words, pos=0, coefftxt, "COEFFICIENTS")) {
+    if(int(coefftxt.size()) > nshell)
+      error("KSPACE has ", coefftxt.size(), " coefficients, but only ",
+            nshell, " shells of k-points inside KCUT");
+    for(unsigned int s=0; s< coefftxt.size(); s++)
+      parameters(s)=atof(coefftxt[s].c_str());
+  }
+  freeze=haskeyword(words, pos=0, "FREEZE");
+
+  coeff.Resize(nk);
+  for(int k=0; k< nk; k++) coeff(k)=parameters(kshell(k));
+}
+
+//--------------------------------------------------------------------------
+
+int Jastrow_kspace_piece::writeinput(string & indent, ostream & os) {
+  os << indent << "KCUT " << kcut << endl;
+  if(freeze) os << indent << "FREEZE" << endl;
+  os << indent << "COEFFICIENTS { ";
+  for(int s=0; s< nshell; s++)
+    os << parameters(s) << "  ";
+  os << " } " << endl;
+  return 1;
+}
+
+//--------------------------------------------------------------------------
+
+int Jastrow_kspace_piece::showinfo(string & indent, ostream & os) {
+  os << indent << nk << " k-points in " << nshell << " shells inside kcut "
+     << kcut << endl;
+  os << indent << "|k|   number   coefficient" << endl;
+  for(int s=0; s< nshell; s++)
+    os << indent << shell_k(s) << "  " << shell_count(s) << "  "
+       << parameters(s) << endl;
+  return 1;
+}
+
+//--------------------------------------------------------------------------
+
+doublevar Jastrow_kspace_piece::value(const Structure_factor & sf) {
+  assert(sf.nk >= nk);
+  const doublevar * rc=sf.rho_cos.v;
+  const doublevar * rs=sf.rho_sin.v;
+  doublevar ne=sf.ne;
+  doublevar u=0;
+  for(int k=0; k< nk; k++)
+    u+=coeff(k)*(rc[k]*rc[k]+rs[k]*rs[k]-ne);
+  return u;
+}
+
+//--------------------------------------------------------------------------
+
+/*!
+With \f$ \rho_{\bf k}=C+iS \f$, the gradient with respect to electron e
+is \f$ \sum_{\bf k} 2a_k{\bf k}(S cos_e-C sin_e) \f$ and the Laplacian
+\f$ \sum_{\bf k} 2a_k k^2(1-C cos_e-S sin_e) \f$.
+*/
+void Jastrow_kspace_piece::updateLap(int e, const Structure_factor & sf,
+                                     Array1 <doublevar> & lap) {
+  assert(sf.nk >= nk);
+  const doublevar * cs=sf.cos_kr.v+e*sf.nk;
+  const doublevar * sn=sf.sin_kr.v+e*sf.nk;
+  const doublevar * rc=sf.rho_cos.v;
+  const doublevar * rs=sf.rho_sin.v;
+  doublevar gx=0, gy=0, gz=0, l=0;
+  for(int k=0; k< nk; k++) {
+    doublevar g=2*coeff(k)*(rs[k]*cs[k]-rc[k]*sn[k]);
+    gx+=g*kpoint(k,0);
+    gy+=g*kpoint(k,1);
+    gz+=g*kpoint(k,2);
+    l+=2*coeff(k)*ksqrd(k)*(1-rc[k]*cs[k]-rs[k]*sn[k]);
+  }
+  lap(1)+=gx;
+  lap(2)+=gy;
+  lap(3)+=gz;
+  lap(4)+=l;
+}
+
+//--------------------------------------------------------------------------
+
+void Jastrow_kspace_piece::phases(const Array1 <doublevar> & r,
+                                  doublevar * cs, doublevar * sn) {
+  for(int k=0; k< nk; k++) {
+    doublevar kdotr=kpoint(k,0)*r(0)+kpoint(k,1)*r(1)+kpoint(k,2)*r(2);
+    cs[k]=cos(kdotr);
+    sn[k]=sin(kdotr);
+  }
+}
+
+//--------------------------------------------------------------------------
+
+/*!
+With \f$ A=\rho_{\bf k}-e^{i{\bf k \cdot r_e}} \f$, the density of the
+others, \f$ |A+e^{i{\bf k \cdot r'}}|^2-|A+e^{i{\bf k \cdot r_e}}|^2
+=2 Re\left(A^*(e^{i{\bf k \cdot r'}}-e^{i{\bf k \cdot r_e}})\right) \f$.
+*/
+doublevar Jastrow_kspace_piece::moveDelta(int e, const Structure_factor & sf,
+                                          const doublevar * newcs,
+                                          const doublevar * newsn) {
+  assert(sf.nk >= nk);
+  const doublevar * cs=sf.cos_kr.v+e*sf.nk;
+  const doublevar * sn=sf.sin_kr.v+e*sf.nk;
+  const doublevar * rc=sf.rho_cos.v;
+  const doublevar * rs=sf.rho_sin.v;
+  doublevar du=0;
+  for(int k=0; k< nk; k++)
+    du+=coeff(k)*((rc[k]-cs[k])*(newcs[k]-cs[k])+(rs[k]-sn[k])*(newsn[k]-sn[k]));
+  return 2*du;
+}
+
+//--------------------------------------------------------------------------
+
+void Jastrow_kspace_piece::getParmDeriv(const Structure_factor & sf,
+                                        Parm_deriv_return & deriv) {
+  assert(sf.nk >= nk);
+  int ne=sf.ne;
+  //e's share of the value is the sum over the others of cos(k.r_ej), so
+  //the shares add up to |rho_k|^2-N
+  Array3 <doublevar> func(nshell,ne,5,0.0);
+  const doublevar * rc=sf.rho_cos.v;
+  const doublevar * rs=sf.rho_sin.v;
+  for(int e=0; e< ne; e++) {
+    const doublevar * cs=sf.cos_kr.v+e*sf.nk;
+    const doublevar * sn=sf.sin_kr.v+e*sf.nk;
+    for(int k=0; k< nk; k++) {
+      int s=kshell(k);
+      doublevar dot=rc[k]*cs[k]+rs[k]*sn[k];
+      doublevar g=2*(rs[k]*cs[k]-rc[k]*sn[k]);
+      func(s,e,0)+=dot-1;
+      for(int d=0; d< 3; d++) func(s,e,d+1)+=g*kpoint(k,d);
+      func(s,e,4)+=2*ksqrd(k)*(1-dot);
+    }
+  }
+  if(freeze) create_parm_deriv_frozen(func,parameters,deriv);
+  else create_parm_deriv(func,parameters,deriv);
+}
+
+//--------------------------------------------------------------------------
+
+void Jastrow_kspace_piece::getParms(Array1 <doublevar> & parms) {
+  if(freeze) {
+    parms.Resize(0);
+    return;
+  }
+  parms=parameters;
+}
+
+//--------------------------------------------------------------------------
+
+void Jastrow_kspace_piece::setParms(Array1 <doublevar> & parms) {
+  assert(parms.GetDim(0)==nparms());
+  if(freeze) return;
+  parameters=parms;
+  for(int k=0; k< nk; k++) coeff(k)=parameters(kshell(k));
+}
+
+//--------------------------------------------------------------------------
@@ -0,0 +1,93 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef JASTROW2_KSPACE_H_INCLUDED
+#define JASTROW2_KSPACE_H_INCLUDED
+#include "Qmc_std.h"
+#include "Structure_factor.h"
+
+class System;
+struct Parm_deriv_return;
+
+/*!
+\brief
+Reciprocal-space Jastrow term
+
+\f[
+U=\sum_{\bf k} a_{|{\bf k}|} \left( |\rho_{\bf k}|^2-N \right)
+ =2\sum_{i<j} \sum_{\bf k} a_{|{\bf k}|} cos({\bf k \cdot r_{ij}})
+\f]
+
+over the system's structure-factor k-points (one of each pair
+\f$ \pm{\bf k} \f$) with \f$ |{\bf k}| \f$ up to KCUT, with one
+coefficient for each shell of equal length.  Everything comes from the
+sample's Structure_factor, which the Ewald sum keeps too, so a move
+costs O(N_k).
+*/
+class Jastrow_kspace_piece {
+public:
+  Jastrow_kspace_piece():nk(0),nshell(0),freeze(0) { }
+
+  void set_up(vector <string> & words, System * sys);
+  int writeinput(string &, ostream &);
+  int showinfo(string & indent, ostream & os);
+
+  //! The number of the structure factor's k-points that are used
+  int nkpoints() { return nk; }
+
+  //! The value of the term
+  doublevar value(const Structure_factor & sf);
+
+  //! Add the gradient and Laplacian with respect to electron e to lap(1..4)
+  void updateLap(int e, const Structure_factor & sf, Array1 <doublevar> & lap);
+
+  //! \f$ cos({\bf k \cdot r}) \f$ and sine for the k-points, into cs and sn
+  void phases(const Array1 <doublevar> & r, doublevar * cs, doublevar * sn);
+
+  /*!
+    The change in value when electron e moves to a position with
+    phases() cs and sn
+  */
+  doublevar moveDelta(int e, const Structure_factor & sf,
+                      const doublevar * cs, const doublevar * sn);
+
+  void getParmDeriv(const Structure_factor & sf, Parm_deriv_return & deriv);
+
+  int nparms() { return freeze ? 0 : nshell; }
+  void getParms(Array1 <doublevar> & parms);
+  void setParms(Array1 <doublevar> & parms);
+
+private:
+  int nk;       //!< number of k-points inside kcut
+  int nshell;
+  doublevar kcut;
+  Array2 <doublevar> kpoint;     //!< (k,d)
+  Array1 <doublevar> ksqrd;      //!< (k)
+  Array1 <int> kshell;           //!< (k) which shell each k-point is in
+  Array1 <doublevar> shell_k;    //!< (shell) length of the k-points in it
+  Array1 <int> shell_count;      //!< (shell) number of k-points in it
+  Array1 <doublevar> parameters; //!< (shell)
+  Array1 <doublevar> coeff;      //!< (k) the parameter of each k-point
+  int freeze;
+};
+
+#endif //JASTROW2_KSPACE_H_INCLUDED
+
+//--------------------------------------------------------------------------
@@ -116,6 +116,16 @@ public:
   */
   int atom_kind(int at) { return parm_centers(at); }
 
+  /*!
+    The coefficients of the basis functions on atom at, so that the
+    term is \f$ \sum_i c_i f_i(r) \f$ around it.
+  */
+  void getAtomParms(int at, Array1 <doublevar> & c) {
+    int p=parm_centers(at);
+    c.Resize(_nparms(p));
+    for(int i=0; i< _nparms(p); i++) c(i)=unique_parameters(p,i);
+  }
+
   Jastrow_onebody_piece():freeze(0) { }
 private:
   Array2 <doublevar> unique_parameters;
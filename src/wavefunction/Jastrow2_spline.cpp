@@ -0,0 +1,76 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#include "Jastrow2_spline.h"
+
+void Jastrow_spline::setup(doublevar spacing, const Array1 <doublevar> & u,
+                           const Array1 <doublevar> & du) {
+  assert(u.GetDim(0)==du.GetDim(0) && u.GetDim(0) > 1);
+  nint=u.GetDim(0)-1;
+  h=spacing;
+  invh=1.0/h;
+  rcut=nint*h;
+  coeff.Resize(4*nint);
+  for(int i=0; i< nint; i++) {
+    doublevar slope=(u(i+1)-u(i))*invh;
+    coeff(4*i)=u(i);
+    coeff(4*i+1)=du(i);
+    coeff(4*i+2)=(3*slope-2*du(i)-du(i+1))*invh;
+    coeff(4*i+3)=(du(i)+du(i+1)-2*slope)*invh*invh;
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Jastrow_spline::val(int n, const doublevar * r, doublevar * u) const {
+  const doublevar * c=coeff.v;
+  const int last=nint-1;
+  for(int k=0; k< n; k++) {
+    doublevar inside= r[k] < rcut ? 1.0 : 0.0;
+    doublevar rc=min(r[k], rcut);
+    int i=min(int(rc*invh), last);
+    doublevar t=rc-i*h;
+    const doublevar * a=c+4*i;
+    u[k]=inside*(a[0]+t*(a[1]+t*(a[2]+t*a[3])));
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Jastrow_spline::lap(int n, const doublevar * r, doublevar * u,
+                         doublevar * g, doublevar * l) const {
+  const doublevar * c=coeff.v;
+  const int last=nint-1;
+  for(int k=0; k< n; k++) {
+    doublevar inside= r[k] < rcut ? 1.0 : 0.0;
+    doublevar rc=min(r[k], rcut);
+    int i=min(int(rc*invh), last);
+    doublevar t=rc-i*h;
+    const doublevar * a=c+4*i;
+    doublevar d=a[1]+t*(2*a[2]+3*t*a[3]);
+    doublevar d2=2*a[2]+6*t*a[3];
+    doublevar rinv=inside/max(r[k], 1e-12);
+    u[k]=inside*(a[0]+t*(a[1]+t*(a[2]+t*a[3])));
+    g[k]=d*rinv;
+    l[k]=inside*d2+2*d*rinv;
+  }
+}
+
+//----------------------------------------------------------------------
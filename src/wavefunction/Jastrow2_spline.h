@@ -0,0 +1,64 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+
+#ifndef JASTROW2_SPLINE_H_INCLUDED
+#define JASTROW2_SPLINE_H_INCLUDED
+
+#include "Qmc_std.h"
+
+/*!
+\brief
+A radial function u(r) tabulated as a cubic Hermite spline on a uniform
+grid, for the one- and two-body Jastrow terms.
+
+u is zero at and beyond the cutoff.  The evaluations go over a whole
+row of distances at once, with no branches, so that they vectorize.
+*/
+class Jastrow_spline {
+public:
+  Jastrow_spline() { nint=0; rcut=0; h=1; invh=1; }
+
+  /*!
+    Fit to the values u(k) and derivatives du(k) of the function at
+    r=k*spacing, k=0..n.  The cutoff is n*spacing.
+  */
+  void setup(doublevar spacing, const Array1 <doublevar> & u,
+             const Array1 <doublevar> & du);
+
+  doublevar cutoff() { return rcut; }
+
+  //! u[k]=u(r[k]) for k < n
+  void val(int n, const doublevar * r, doublevar * u) const;
+
+  /*!
+    u, \f$ \frac{1}{r}\frac{du}{dr} \f$, and \f$ \nabla^2 u \f$ at each
+    r[k], into u[k], g[k], and l[k] for k < n.
+  */
+  void lap(int n, const doublevar * r, doublevar * u, doublevar * g,
+           doublevar * l) const;
+
+private:
+  int nint;        //!< number of intervals
+  doublevar rcut, h, invh;
+  Array1 <doublevar> coeff; //!< polynomial of interval i in coeff(4*i+[0 1 2 3])
+};
+
+#endif //JASTROW2_SPLINE_H_INCLUDED
+//--------------------------------------------------------------------------
@@ -91,6 +91,12 @@ void Jastrow_threebody_piece::set_up(vector <string> & words,
 
   freeze=haskeyword(words, pos=0, "FREEZE");
 
+  maxeibasis=0;
+  for(int at=0; at< natoms; at++)
+    maxeibasis=max(maxeibasis, eibasis_max(at));
+  thread_w.Resize(qmc_max_threads());
+  for(int t=0; t< thread_w.GetDim(0); t++)
+    thread_w(t).Resize(maxeibasis*eebasis_max*5);
 }
 //--------------------------------------------------------------------------
 
@@ -135,7 +141,96 @@ int Jastrow_threebody_piece::showinfo(string & indent, ostream & os) {
 //--------------------------------------------------------------------------
 
 
-inline void eval_threebody_derivative(doublevar parm,
+void Jastrow_ei_neighbors::Resize(int nelectrons, int natoms) {
+  is_near.Resize(nelectrons, natoms);
+  near_list.Resize(natoms, nelectrons);
+  near_count.Resize(natoms);
+  is_near=0;
+  near_count=0;
+}
+
+//--------------------------------------------------------------------------
+
+int Jastrow_ei_neighbors::rowIsNear(const doublevar * a, int n) {
+  const doublevar tiny=1e-14;
+  int near=0;
+  for(int i=0; i< n; i++)
+    if(fabs(a[i]) > tiny) near=1;
+  return near;
+}
+
+//--------------------------------------------------------------------------
+
+void Jastrow_ei_neighbors::update(int e, const Array4 <doublevar> & eibasis) {
+  int natoms=near_count.GetDim(0);
+  int n=eibasis.GetDim(2)*eibasis.GetDim(3);
+  for(int at=0; at< natoms; at++) {
+    int near=rowIsNear(&eibasis(e,at,0,0), n);
+    if(near==is_near(e,at)) continue;
+    is_near(e,at)=near;
+    int * list=&near_list(at,0);
+    int & count=near_count(at);
+    if(near) {
+      int k=count++;
+      for(; k > 0 && list[k-1] > e; k--) list[k]=list[k-1];
+      list[k]=e;
+    }
+    else {
+      int k=0;
+      while(list[k]!=e) k++;
+      for(count--; k< count; k++) list[k]=list[k+1];
+    }
+  }
+}
+
+//--------------------------------------------------------------------------
+
+void threebody_pair_lap(int nq, int nm, const doublevar * w,
+                        const doublevar * aj, const doublevar * ee,
+                        doublevar sign, doublevar * lap0, doublevar * lap1) {
+  for(int m=0; m< nm; m++) {
+    //v=sum_q w(q,m) aj(q), with the derivatives of e in ve and of j in vj
+    doublevar v=0, ve[5]={0,0,0,0,0}, vj[5]={0,0,0,0,0};
+    for(int q=0; q< nq; q++) {
+      const doublevar * wq=w+(q*nm+m)*5;
+      const doublevar * a=aj+q*5;
+      v+=wq[0]*a[0];
+      for(int d=1; d< 5; d++) {
+        ve[d]+=wq[d]*a[0];
+        vj[d]+=wq[0]*a[d];
+      }
+    }
+    const doublevar * b=ee+m*5;
+    lap0[0]+=v*b[0];
+    doublevar dot_e=0, dot_j=0;
+    for(int d=1; d< 4; d++) {
+      lap0[d]+=ve[d]*b[0]-sign*v*b[d];
+      lap1[d]+=vj[d]*b[0]+sign*v*b[d];
+      dot_e+=ve[d]*b[d];
+      dot_j+=vj[d]*b[d];
+    }
+    lap0[4]+=v*b[4]+ve[4]*b[0]-2*sign*dot_e;
+    lap1[4]+=v*b[4]+vj[4]*b[0]+2*sign*dot_j;
+  }
+}
+
+//--------------------------------------------------------------------------
+
+doublevar threebody_pair_val(int nq, int nm, const doublevar * w,
+                             const doublevar * aj, const doublevar * ee) {
+  doublevar val=0;
+  for(int m=0; m< nm; m++) {
+    doublevar v=0;
+    for(int q=0; q< nq; q++)
+      v+=w[(q*nm+m)*5]*aj[q*5];
+    val+=v*ee[m*5];
+  }
+  return val;
+}
+
+//--------------------------------------------------------------------------
+
+void eval_threebody_derivative(doublevar parm,
     double * eiek, double * eiel, double * eijk, double * eijl, 
     double * ee, double sign,
     double * lap0, double * lap1) { 
@@ -404,6 +499,108 @@ void Jastrow_threebody_piece::updateVal(int e,
 }
 
 
+//-----------------------------------------------------------
+
+/*!
+  w(q,m,[val grad lap]) for atom at, from e's basis functions on it,
+  ae[5*k+d]=eibasis(e,at,k,d): each parameter a_klm adds
+  a_klm*eibasis(e,at,k) to w(l,m) and a_klm*eibasis(e,at,l) to w(k,m),
+  so that the term for electron j is sum_qm w(q,m)*eibasis(j,at,q)*eebasis(j,m).
+*/
+void Jastrow_threebody_piece::contractParms(int at, const doublevar * ae,
+                                            doublevar * w) {
+  int p=parm_centers(at);
+  int nm=eebasis_max;
+  for(int i=0; i< eibasis_max(at)*nm*5; i++) w[i]=0;
+  for(int i=0; i< _nparms(p); i++) {
+    doublevar parm=unique_parameters(p,i);
+    int k=klm(i,0), el=klm(i,1), m=klm(i,2);
+    doublevar * wl=w+(el*nm+m)*5, * wk=w+(k*nm+m)*5;
+    for(int d=0; d< 5; d++) {
+      wl[d]+=parm*ae[5*k+d];
+      wk[d]+=parm*ae[5*el+d];
+    }
+  }
+}
+
+//-----------------------------------------------------------
+
+void Jastrow_threebody_piece::updateLap(int e,
+                                        const Array4 <doublevar> & eibasis,
+                                        const Array3 <doublevar> & eebasis,
+                                        const Jastrow_ei_neighbors & near,
+                                        Array3 <doublevar> & lap) {
+  assert(lap.GetDim(2) >= 5);
+  assert(lap.GetDim(0) >=2);
+  assert(eibasis.GetDim(3)==5 && eebasis.GetDim(2)==5);
+  int natoms=parm_centers.GetDim(0);
+  doublevar * w=thread_w(qmc_thread_num()).v;
+
+  for(int at=0; at < natoms; at++) {
+    if(!near.isNear(e,at) || _nparms(parm_centers(at))==0) continue;
+    contractParms(at, &eibasis(e,at,0,0), w);
+    const int * list=near.nearList(at);
+    for(int jj=0; jj< near.nnear(at); jj++) {
+      int j=list[jj];
+      if(j==e) continue;
+      threebody_pair_lap(eibasis_max(at), eebasis_max, w,
+                         &eibasis(j,at,0,0), &eebasis(j,0,0),
+                         j < e ? 1.0 : -1.0, &lap(0,j,0), &lap(1,j,0));
+    }
+  }
+}
+
+//-----------------------------------------------------------
+
+void Jastrow_threebody_piece::updateVal(int e,
+                                        const Array4 <doublevar> & eibasis,
+                                        const Array3 <doublevar> & eebasis,
+                                        const Jastrow_ei_neighbors & near,
+                                        Array1 <doublevar> & updated_val) {
+  int natoms=parm_centers.GetDim(0);
+  doublevar * w=thread_w(qmc_thread_num()).v;
+
+  for(int at=0; at < natoms; at++) {
+    if(!near.isNear(e,at) || _nparms(parm_centers(at))==0) continue;
+    contractParms(at, &eibasis(e,at,0,0), w);
+    const int * list=near.nearList(at);
+    for(int jj=0; jj< near.nnear(at); jj++) {
+      int j=list[jj];
+      if(j==e) continue;
+      updated_val(j)+=threebody_pair_val(eibasis_max(at), eebasis_max, w,
+                                         &eibasis(j,at,0,0), &eebasis(j,0,0));
+    }
+  }
+}
+
+//-----------------------------------------------------------
+
+void Jastrow_threebody_piece::updateVal(int e,
+                                        const Array3 <doublevar> & eirow,
+                                        const Array4 <doublevar> & eibasis,
+                                        const Array3 <doublevar> & eebasis,
+                                        const Jastrow_ei_neighbors & near,
+                                        Array1 <doublevar> & updated_val) {
+  assert(eirow.GetDim(2)==5);
+  int natoms=parm_centers.GetDim(0);
+  int n=eirow.GetDim(1)*eirow.GetDim(2);
+  doublevar * w=thread_w(qmc_thread_num()).v;
+
+  for(int at=0; at < natoms; at++) {
+    const doublevar * ae=&eirow(at,0,0);
+    if(_nparms(parm_centers(at))==0 || !Jastrow_ei_neighbors::rowIsNear(ae,n)) 
+      continue;
+    contractParms(at, ae, w);
+    const int * list=near.nearList(at);
+    for(int jj=0; jj< near.nnear(at); jj++) {
+      int j=list[jj];
+      if(j==e) continue;
+      updated_val(j)+=threebody_pair_val(eibasis_max(at), eebasis_max, w,
+                                         &eibasis(j,at,0,0), &eebasis(j,0,0));
+    }
+  }
+}
+
 //-----------------------------------------------------------
 
 void Jastrow_threebody_piece::getParmDeriv(const Array3 <doublevar> & eibasis,
@@ -24,6 +24,57 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Array45.h"
 #include "Jastrow2_one.h"
 
+/*!
+\brief
+For each atom, the electrons inside the range of its electron-ion basis,
+in increasing order.  An electron's memberships are redone from its row
+of the basis each time that row is stored, so a move costs only the
+lists it enters or leaves.
+*/
+class Jastrow_ei_neighbors {
+public:
+  void Resize(int nelectrons, int natoms);
+
+  //! Redo electron e's memberships from eibasis(e,atom,function,[val grad lap])
+  void update(int e, const Array4 <doublevar> & eibasis);
+
+  int isNear(int e, int at) const { return is_near(e,at); }
+  //! Whether a row a[0..n-1] of the basis on one atom puts its electron near it
+  static int rowIsNear(const doublevar * a, int n);
+  int nnear(int at) const { return near_count(at); }
+  //! The near electrons of atom at, in increasing order
+  const int * nearList(int at) const { return near_list.v+at*near_list.GetDim(1); }
+
+private:
+  Array2 <int> is_near;    //!< (electron, atom)
+  Array2 <int> near_list;  //!< (atom, k)
+  Array1 <int> near_count; //!< (atom)
+};
+
+/*!
+  Add electron j's terms to lap0 (derivatives wrt e) and lap1 (wrt j),
+  given the sums w(q,m,[val grad lap]) of e's basis functions over the
+  parameters that pair them with j's function q and the ee function m.
+  aj is eibasis(j,atom,...) and ee is eebasis(j,...); sign is 1 if j < e.
+*/
+void threebody_pair_lap(int nq, int nm, const doublevar * w,
+                        const doublevar * aj, const doublevar * ee,
+                        doublevar sign, doublevar * lap0, doublevar * lap1);
+
+//! The value part of threebody_pair_lap()
+doublevar threebody_pair_val(int nq, int nm, const doublevar * w,
+                             const doublevar * aj, const doublevar * ee);
+
+/*!
+  Add the derivatives wrt one parameter (multiplied by parm) of the term
+  for the pair i<j to lap0 (wrt i) and lap1 (wrt j), from their basis
+  functions k and l on the atom and the ee function between them.
+*/
+void eval_threebody_derivative(doublevar parm,
+    double * eiek, double * eiel, double * eijk, double * eijl, 
+    double * ee, double sign,
+    double * lap0, double * lap1);
+
 /*!
 
 \brief 
@@ -72,6 +123,34 @@ public:
                  const Array3 <doublevar> & eebasis,
                  Array1 <doublevar> & updated_val);
 
+  /*!
+    The same as updateLap() and updateVal(), but going only over the
+    atoms that e is near and their near electrons.  e's parameter sums
+    are done once for each atom, so the cost for each pair doesn't
+    depend on the number of parameters.
+  */
+  void updateLap(int e,
+                 const Array4 <doublevar> & eionbasis,
+                 const Array3 <doublevar> & eebasis,
+                 const Jastrow_ei_neighbors & near,
+                 Array3 <doublevar> & lap);
+  void updateVal(int e,
+                 const Array4 <doublevar> & eionbasis,
+                 const Array3 <doublevar> & eebasis,
+                 const Jastrow_ei_neighbors & near,
+                 Array1 <doublevar> & updated_val);
+  /*!
+    updateVal() for e with the row eirow(atom,basis#,valgradlap) in
+    place of row e of eionbasis, which isn't read; for positions of e
+    that are only tried, so the stored rows and near lists stay as they are.
+  */
+  void updateVal(int e,
+                 const Array3 <doublevar> & eirow,
+                 const Array4 <doublevar> & eionbasis,
+                 const Array3 <doublevar> & eebasis,
+                 const Jastrow_ei_neighbors & near,
+                 Array1 <doublevar> & updated_val);
+
   void getParmDeriv(const Array3 <doublevar> & eionbasis, //i,at, basis
                     const Array3 <doublevar> & eebasis, // i,j,basis, with i<j
                     Parm_deriv_return & deriv);
@@ -102,10 +181,11 @@ public:
     return eebasis_max;
 		       
   }
-  Jastrow_threebody_piece():freeze(0),eebasis_max(0) { }
+  Jastrow_threebody_piece():freeze(0),eebasis_max(0),maxeibasis(0) { }
 private:
 
   int make_default_list();
+  void contractParms(int at, const doublevar * ae, doublevar * w);
 
   Array2 <doublevar> unique_parameters;
   Array1 <int> _nparms;        //!<Number of parameters in each row above
@@ -119,6 +199,8 @@ private:
 
   
   Array2 <int> klm; //!< which basis functions to use for each parameter in the list(parm#, klm);
+  int maxeibasis; //!< largest of eibasis_max
+  Array1 < Array1 <doublevar> > thread_w; //!< contractParms() sums, for each thread
 };
 
 
@@ -186,6 +186,13 @@ void Jastrow_threebody_piece_diffspin::set_up(vector <string> & words,
   freeze=haskeyword(words, pos=0, "FREEZE");
   nspin_up=sys->nelectrons(0);
   nelectrons=sys->nelectrons(0)+sys->nelectrons(1);
+
+  maxeibasis=0;
+  for(int at=0; at< natoms; at++)
+    maxeibasis=max(maxeibasis, eibasis_max(at));
+  thread_w.Resize(qmc_max_threads());
+  for(int t=0; t< thread_w.GetDim(0); t++)
+    thread_w(t).Resize(2*maxeibasis*eebasis_max*5);
   //cout <<"End Jastrow_threebody_piece_diffspin::set_up"<<endl;  
 
 }
@@ -386,6 +393,121 @@ void Jastrow_threebody_piece_diffspin::updateVal(int e,
 
 
 
+//-----------------------------------------------------------
+
+/*!
+  As Jastrow_threebody_piece::contractParms(), for the like (w) and the
+  unlike (w+size) coefficients.
+*/
+void Jastrow_threebody_piece_diffspin::contractParms(int at,
+                                   const doublevar * ae, doublevar * w) {
+  int p=parm_centers(at);
+  int nm=eebasis_max;
+  int size=eibasis_max(at)*nm*5;
+  for(int i=0; i< 2*size; i++) w[i]=0;
+  for(int s=0; s< 2; s++) {
+    doublevar * ws=w+s*size;
+    for(int i=0; i< _nparms(p); i++) {
+      doublevar parm=unique_parameters_spin(s)(p,i);
+      int k=klm(i,0), el=klm(i,1), m=klm(i,2);
+      doublevar * wl=ws+(el*nm+m)*5, * wk=ws+(k*nm+m)*5;
+      for(int d=0; d< 5; d++) {
+        wl[d]+=parm*ae[5*k+d];
+        wk[d]+=parm*ae[5*el+d];
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------
+
+void Jastrow_threebody_piece_diffspin::updateLap(int e,
+                                   const Array4 <doublevar> & eibasis,
+                                   const Array3 <doublevar> & eebasis,
+                                   const Jastrow_ei_neighbors & near,
+                                   Array3 <doublevar> & lap) {
+  assert(lap.GetDim(2) >= 5);
+  assert(lap.GetDim(0) >=2);
+  assert(eibasis.GetDim(3)==5 && eebasis.GetDim(2)==5);
+  int natoms=parm_centers.GetDim(0);
+  doublevar * w=thread_w(qmc_thread_num()).v;
+  int eup= e < nspin_up;
+
+  for(int at=0; at < natoms; at++) {
+    if(!near.isNear(e,at) || _nparms(parm_centers(at))==0) continue;
+    contractParms(at, &eibasis(e,at,0,0), w);
+    int size=eibasis_max(at)*eebasis_max*5;
+    const int * list=near.nearList(at);
+    for(int jj=0; jj< near.nnear(at); jj++) {
+      int j=list[jj];
+      if(j==e) continue;
+      int s=(j < nspin_up) != eup;
+      threebody_pair_lap(eibasis_max(at), eebasis_max, w+s*size,
+                         &eibasis(j,at,0,0), &eebasis(j,0,0),
+                         j < e ? 1.0 : -1.0, &lap(0,j,0), &lap(1,j,0));
+    }
+  }
+}
+
+//-----------------------------------------------------------
+
+void Jastrow_threebody_piece_diffspin::updateVal(int e,
+                                   const Array4 <doublevar> & eibasis,
+                                   const Array3 <doublevar> & eebasis,
+                                   const Jastrow_ei_neighbors & near,
+                                   Array1 <doublevar> & updated_val) {
+  int natoms=parm_centers.GetDim(0);
+  doublevar * w=thread_w(qmc_thread_num()).v;
+  int eup= e < nspin_up;
+
+  for(int at=0; at < natoms; at++) {
+    if(!near.isNear(e,at) || _nparms(parm_centers(at))==0) continue;
+    contractParms(at, &eibasis(e,at,0,0), w);
+    int size=eibasis_max(at)*eebasis_max*5;
+    const int * list=near.nearList(at);
+    for(int jj=0; jj< near.nnear(at); jj++) {
+      int j=list[jj];
+      if(j==e) continue;
+      int s=(j < nspin_up) != eup;
+      updated_val(j)+=threebody_pair_val(eibasis_max(at), eebasis_max,
+                                         w+s*size, &eibasis(j,at,0,0),
+                                         &eebasis(j,0,0));
+    }
+  }
+}
+
+//-----------------------------------------------------------
+
+void Jastrow_threebody_piece_diffspin::updateVal(int e,
+                                   const Array3 <doublevar> & eirow,
+                                   const Array4 <doublevar> & eibasis,
+                                   const Array3 <doublevar> & eebasis,
+                                   const Jastrow_ei_neighbors & near,
+                                   Array1 <doublevar> & updated_val) {
+  assert(eirow.GetDim(2)==5);
+  int natoms=parm_centers.GetDim(0);
+  int n=eirow.GetDim(1)*eirow.GetDim(2);
+  doublevar * w=thread_w(qmc_thread_num()).v;
+  int eup= e < nspin_up;
+
+  for(int at=0; at < natoms; at++) {
+    const doublevar * ae=&eirow(at,0,0);
+    if(_nparms(parm_centers(at))==0 || !Jastrow_ei_neighbors::rowIsNear(ae,n)) 
+      continue;
+    contractParms(at, ae, w);
+    int size=eibasis_max(at)*eebasis_max*5;
+    const int * list=near.nearList(at);
+    for(int jj=0; jj< near.nnear(at); jj++) {
+      int j=list[jj];
+      if(j==e) continue;
+      int s=(j < nspin_up) != eup;
+      updated_val(j)+=threebody_pair_val(eibasis_max(at), eebasis_max,
+                                         w+s*size, &eibasis(j,at,0,0),
+                                         &eebasis(j,0,0));
+    }
+  }
+}
+
 //--------------------------------------------------------------------------
 //start: added for ei back-flow
 void Jastrow_threebody_piece_diffspin::updateVal_E_I(int e,
@@ -576,6 +698,73 @@ void Jastrow_threebody_piece_diffspin::getParmDeriv(const Array3 <doublevar> & e
 
 //-----------------------------------------------------------
 
+/*!
+As Jastrow_threebody_piece::getParmDeriv(), except that each pair goes to
+the like- or unlike-spin copy of the parameter.
+*/
+void Jastrow_threebody_piece_diffspin::getParmDeriv(const Array4 <doublevar> & eibasis,
+                                        const Array4 <doublevar> & eebasis,
+                                       Parm_deriv_return & deriv) {
+  int natoms=parm_centers.GetDim(0);
+  int nelectrons=eebasis.GetDim(0);
+  //All the parameters, even when frozen, for the gradient of the value
+  int np=0;
+  for(int s=0; s< unique_parameters_spin.GetSize(); s++) 
+    for(int i=0; i< unique_parameters_spin(s).GetDim(0); i++) 
+      np+=_nparms(i);
+  Array1 <doublevar> coeff(np);
+  for(int s=0; s< unique_parameters_spin.GetSize(); s++) 
+    for(int i=0; i< unique_parameters_spin(s).GetDim(0); i++) 
+      for(int j=0; j< _nparms(i); j++) 
+        coeff(linear_parms(s)(i,j))=unique_parameters_spin(s)(i,j);
+
+  int ee_s1=eebasis.GetDim(1)*eebasis.GetDim(2)*eebasis.GetDim(3);
+  int ee_s2=eebasis.GetDim(2)*eebasis.GetDim(3);
+  int ee_s3=eebasis.GetDim(3);
+  int ei_s1=eibasis.GetDim(1)*eibasis.GetDim(2)*eibasis.GetDim(3);
+  int ei_s2=eibasis.GetDim(2)*eibasis.GetDim(3);
+  int ei_s3=eibasis.GetDim(3);
+
+  doublevar lap1[5];
+  doublevar lap2[5];
+  Array3 <doublevar> func(np,nelectrons,5,0.0);
+  for(int at=0; at < natoms; at++) {
+    int p=parm_centers(at);
+    for(int ind=0; ind< _nparms(p); ind++) {
+      int k=klm(ind,0), el=klm(ind,1), m=klm(ind,2);
+      for(int i=0; i< nelectrons; i++) { 
+        for(int j=i+1; j< nelectrons; j++) {
+          int s=(j < nspin_up) != (i < nspin_up);
+          int thisindex=linear_parms(s)(p,ind);
+          for(int d=0; d< 5; d++) { 
+            lap1[d]=0.0;
+            lap2[d]=0.0;
+          }
+          eval_threebody_derivative(1.0,
+              eibasis.v+ i*ei_s1 + at*ei_s2 + k *ei_s3,
+              eibasis.v+ i*ei_s1 + at*ei_s2 + el*ei_s3,
+              eibasis.v+ j*ei_s1 + at*ei_s2 + k *ei_s3,
+              eibasis.v+ j*ei_s1 + at*ei_s2 + el*ei_s3,
+              eebasis.v+ i*ee_s1 + j *ee_s2 + m *ee_s3,
+              -1.0,
+              lap1,
+              lap2);
+          func(thisindex,i,0)+=lap1[0];
+          for(int d=1; d< 5; d++) { 
+            func(thisindex,i,d)+=lap1[d];
+            func(thisindex,j,d)+=lap2[d];
+          }
+        }
+      }
+    }
+  }
+
+  if(freeze) create_parm_deriv_frozen(func,coeff,deriv);
+  else create_parm_deriv(func,coeff,deriv);
+}
+
+//-----------------------------------------------------------
+
 int Jastrow_threebody_piece_diffspin::nparms() {
   int tot=0;
   int nsec;
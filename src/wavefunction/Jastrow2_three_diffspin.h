@@ -23,6 +23,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Qmc_std.h"
 #include "Array45.h"
 #include "Jastrow2_one.h"
+#include "Jastrow2_three.h"
 
 /*!
 
@@ -71,9 +72,31 @@ public:
                  const Array3 <doublevar> & eebasis,
                  Array1 <doublevar> & updated_val);
 
+  //! See Jastrow_threebody_piece::updateLap(..., near, lap)
+  void updateLap(int e,
+                 const Array4 <doublevar> & eionbasis,
+                 const Array3 <doublevar> & eebasis,
+                 const Jastrow_ei_neighbors & near,
+                 Array3 <doublevar> & lap);
+  void updateVal(int e,
+                 const Array4 <doublevar> & eionbasis,
+                 const Array3 <doublevar> & eebasis,
+                 const Jastrow_ei_neighbors & near,
+                 Array1 <doublevar> & updated_val);
+  //! See Jastrow_threebody_piece::updateVal(e, eirow, ...)
+  void updateVal(int e,
+                 const Array3 <doublevar> & eirow,
+                 const Array4 <doublevar> & eionbasis,
+                 const Array3 <doublevar> & eebasis,
+                 const Jastrow_ei_neighbors & near,
+                 Array1 <doublevar> & updated_val);
+
   void getParmDeriv(const Array3 <doublevar> & eionbasis, //i,at, basis
                     const Array3 <doublevar> & eebasis, // i,j,basis, with i<j
                     Parm_deriv_return & deriv);
+  void getParmDeriv(const Array4 <doublevar> & eibasis, //i,at,basis,valgradlap
+                    const Array4 <doublevar> & eebasis, //i,j,basis,valgradlap, i<j
+                    Parm_deriv_return & deriv);
 
 
   //start: added for ei back-flow
@@ -112,11 +135,12 @@ public:
     return eebasis_max;
 		       
   }
-  Jastrow_threebody_piece_diffspin():freeze(0),eebasis_max(0) {}
+  Jastrow_threebody_piece_diffspin():freeze(0),eebasis_max(0),maxeibasis(0) {}
   
 private:
 
   int make_default_list();
+  void contractParms(int at, const doublevar * ae, doublevar * w);
 
   //Array2 <doublevar> unique_parameters;
   Array1 < Array2 <doublevar> > unique_parameters_spin;
@@ -133,6 +157,8 @@ private:
   
   
   Array2 <int> klm; //!< which basis functions to use for each parameter in the list(parm#, klm);
+  int maxeibasis; //!< largest of eibasis_max
+  Array1 < Array1 <doublevar> > thread_w; //!< contractParms() sums, for each thread
 };
 
 
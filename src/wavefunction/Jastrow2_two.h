@@ -100,6 +100,19 @@ public:
   /*! Number of basis functions we need */
   virtual int nbasis_needed() { return parameters.GetDim(0); }
 
+  /*! Number of distinct pair functions: 1, or 2 for like and unlike spins */
+  virtual int nspinChannels() { return 1; }
+
+  /*!
+    The coefficients of the basis functions in channel s, so that the
+    pair function is \f$ \sum_p c_p f_p(r) \f$.  s is
+    0 for like spins and 1 for unlike ones.
+  */
+  virtual void getChannelParms(int s, Array1 <doublevar> & c) {
+    c.Resize(parameters.GetDim(0));
+    for(int p=0; p< parameters.GetDim(0); p++) c(p)=parameters(p);
+  }
+
 
   virtual void updateLap(int e,
                  const Array3 <doublevar> & eebasis,
@@ -149,6 +162,11 @@ public:
 
   /*! Number of basis functions we need */
   virtual int nbasis_needed() { return spin_parms.GetDim(1); }
+  virtual int nspinChannels() { return 2; }
+  virtual void getChannelParms(int s, Array1 <doublevar> & c) {
+    c.Resize(spin_parms.GetDim(1));
+    for(int p=0; p< spin_parms.GetDim(1); p++) c(p)=spin_parms(s,p);
+  }
   virtual void getParms(Array1 <doublevar> & parms);
   virtual void setParms(Array1 <doublevar> & parms);
 
@@ -23,6 +23,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "System.h"
 #include "Sample_point.h"
 
+#ifndef NDEBUG
+long int spline_eibasis_rows=0;
+#endif
+
 //######################################################################
 
 
@@ -234,8 +238,28 @@ void Jastrow_group::set_up(vector <string> & words, System * sys) {
       error("Can only have one of THREEBODY_SPIN or THREEBODY");
     three_body_diffspin.set_up(threebodysec_diffspin, sys);
   } 
+  has_kspace=0;
+  vector <string> kspacesec;
+  if(readsection(words, pos=0, kspacesec, "KSPACE")) { 
+    has_kspace=1;
+    kspace.set_up(kspacesec, sys);
+  }
 
   check_consistency();
+
+  thread_R.Resize(qmc_max_threads());
+  thread_lap.Resize(qmc_max_threads());
+  for(int t=0; t< thread_R.GetDim(0); t++) {
+    thread_R(t).Resize(5);
+    thread_lap(t).Resize(max(maxeibasis, maxeebasis), 5);
+  }
+
+  use_spline=haskeyword(words, pos=0, "SPLINE");
+  if(!readvalue(words, pos=0, spline_spacing, "SPLINE_SPACING"))
+    spline_spacing=0.01;
+  if(spline_spacing <= 0)
+    error("SPLINE_SPACING must be positive");
+  updateTables();
 }
 
 //----------------------------------------------------------------------
@@ -307,20 +331,34 @@ int Jastrow_group::check_consistency() {
 
 void Jastrow_group::updateEIBasis(int e, Sample_point * sample,
                                   Array3 <doublevar> & eisave) {
+  assert(sample->ionSize() == nbasis_at.GetDim(0));
+  sample->updateEIDist();
+  Distance_row row;
+  sample->getEIRow(e,row);
+  updateEIBasis(row, eisave);
+}
+
+//----------------------------------------------------------------------
+
+void Jastrow_group::updateEIBasis(const Distance_row & row,
+                                  Array3 <doublevar> & eisave) {
   //cout << "updateEIBasis" << endl;
   int natoms=nbasis_at.GetDim(0);
+#ifndef NDEBUG
+  if(spline_one_body && !has_three_body && !has_three_body_diffspin)
+    spline_eibasis_rows++;
+#endif
 
-  assert(sample->ionSize() == natoms);
+  assert(row.n == natoms);
   assert(atom2basis.GetDim(0)==natoms);
 
-  Array1 <doublevar> R(5);
-  Array2 <doublevar> lap(maxeibasis, 5);
-  sample->updateEIDist();
+  Array1 <doublevar> & R=thread_R(qmc_thread_num());
+  Array2 <doublevar> & lap=thread_lap(qmc_thread_num());
 
   int b; //basis
 
   for(int at=0; at < natoms; at++) {
-     sample->getEIDist(e,at, R);
+     row.get(at, R);
      int counter=0;
      //eisave(at,counter,0)=1;
      //for(int d=1; d< 5; d++) 
@@ -344,13 +382,22 @@ void Jastrow_group::updateEIBasis(int e, Sample_point * sample,
 
 void Jastrow_group::updateEEBasis(int e, Sample_point * sample,
                                   Array3 <doublevar> & eesave) {
+  sample->updateEEDist();
+  Distance_row row;
+  sample->getEERow(e,row);
+  updateEEBasis(e, row, eesave);
+}
+
+//----------------------------------------------------------------------
+
+void Jastrow_group::updateEEBasis(int e, const Distance_row & row,
+                                  Array3 <doublevar> & eesave) {
   //cout << "updateEEBasis" << endl;
-  Array1 <doublevar> R(5);
-  Array2 <doublevar> lap(maxeebasis, 5);
+  Array1 <doublevar> & R=thread_R(qmc_thread_num());
+  Array2 <doublevar> & lap=thread_lap(qmc_thread_num());
 
   int neebasis=eebasis.GetDim(0);
   int counter=0;
-  sample->updateEEDist();
 
   //for(int i=0; i< nelectrons; i++) { 
   //  eesave(i,counter,0)=1;
@@ -366,8 +413,8 @@ void Jastrow_group::updateEEBasis(int e, Sample_point * sample,
     }
 
     for(int i=0; i< e; i++) {
-      sample->getEEDist(i,e,R);
-      if(R(0) < cutoff) {
+      if(row.r[i] < cutoff) {
+        row.get(i,R,-1.0);
         eebasis(b)->calcLap(R,lap);
         for(int n=0; n< nfunc_eeb(b); n++) {
           for(int d=0; d< 5; d++) {
@@ -385,8 +432,8 @@ void Jastrow_group::updateEEBasis(int e, Sample_point * sample,
       }
     }
     for(int j=e+1; j< nelectrons; j++) {
-      sample->getEEDist(e,j,R);
-      if(R(0) < cutoff) { 
+      if(row.r[j] < cutoff) { 
+        row.get(j,R);
         eebasis(b)->calcLap(R,lap);
         for(int n=0; n< nfunc_eeb(b); n++) {
           for(int d=0; d< 5; d++) { 
@@ -410,6 +457,387 @@ void Jastrow_group::updateEEBasis(int e, Sample_point * sample,
 
 //----------------------------------------------------------------------
 
+/*!
+  Tabulate \f$ u(r)=\sum_i c_i f_i(r) \f$, where f_i are the functions
+  of the basis objects in basis, in order.  Returns 0 if the functions
+  with coefficients aren't all radial with a finite cutoff.
+*/
+int tabulate_radial(vector <Basis_function *> & basis,
+                    const Array1 <doublevar> & c,
+                    doublevar spacing, Jastrow_spline & spline) {
+  const int maxintervals=100000;
+  int nc=c.GetDim(0);
+  int nobj=0, nf=0, maxf=1;
+  doublevar rcut=0;
+  Array1 <doublevar> objcut(basis.size());
+  for(unsigned int b=0; b< basis.size() && nf < nc; b++) {
+    if(!basis[b]->isRadial()) return 0;
+    objcut(b)=0;
+    for(int n=0; n< basis[b]->nfunc(); n++)
+      objcut(b)=max(objcut(b), basis[b]->cutoff(n));
+    if(objcut(b) > maxintervals*spacing) return 0;
+    rcut=max(rcut, objcut(b));
+    nf+=basis[b]->nfunc();
+    maxf=max(maxf, basis[b]->nfunc());
+    nobj++;
+  }
+
+  int nint=max(int(ceil(rcut/spacing)), 1);
+  doublevar h= rcut > 0 ? rcut/nint : spacing;
+  Array1 <doublevar> u(nint+1), du(nint+1), R(5);
+  Array2 <doublevar> lap(maxf, 5);
+  for(int k=0; k<= nint; k++) {
+    //The last knot is just inside the cutoff, so that a function
+    //that is cut off sharply is followed all the way to it.
+    doublevar r= k==nint ? rcut*(1-1e-12) : k*h;
+    r=max(r, 1e-8*h);
+    R(0)=r; R(1)=r*r; R(2)=r; R(3)=0; R(4)=0;
+    u(k)=0;
+    du(k)=0;
+    int f=0;
+    for(int b=0; b< nobj; b++) {
+      int nfunc=basis[b]->nfunc();
+      if(r < objcut(b)) {
+        basis[b]->calcLap(R, lap);
+        for(int n=0; n< nfunc && f+n < nc; n++) {
+          u(k)+=c(f+n)*lap(n,0);
+          du(k)+=c(f+n)*lap(n,1);
+        }
+      }
+      f+=nfunc;
+    }
+  }
+  spline.setup(h, u, du);
+  return 1;
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  Set up the row kernels with the current parameters: the two-body
+  coefficients by spin channel, and if SPLINE is set, the tables of the
+  one- and two-body terms.  A term whose basis can't be tabulated is
+  left to the basis functions.
+*/
+void Jastrow_group::updateTables() {
+  int natoms=atomnames.size();
+  Array1 <doublevar> c;
+
+  radial_two_body=0;
+  if(has_two_body) {
+    int nchannels=two_body->nspinChannels();
+    int np=two_body->nbasis_needed();
+    ee_coeff.Resize(nchannels, np);
+    for(int s=0; s< nchannels; s++) {
+      two_body->getChannelParms(s, c);
+      for(int p=0; p< np; p++) ee_coeff(s,p)=c(p);
+    }
+    int neebasis=eebasis.GetDim(0);
+    eebasis_cutoff.Resize(neebasis);
+    radial_two_body=1;
+    int nf=0;
+    for(int b=0; b< neebasis; b++) {
+      eebasis_cutoff(b)=0;
+      for(int n=0; n< nfunc_eeb(b); n++)
+        eebasis_cutoff(b)=max(eebasis_cutoff(b), eebasis(b)->cutoff(n));
+      if(nf < np && !eebasis(b)->isRadial()) radial_two_body=0;
+      nf+=nfunc_eeb(b);
+    }
+    thread_partners.Resize(qmc_max_threads());
+    thread_eerow.Resize(qmc_max_threads());
+    for(int t=0; t< thread_partners.GetDim(0); t++) {
+      thread_partners(t).Resize(nelectrons);
+      thread_eerow(t).Resize((4+3*maxeebasis)*nelectrons);
+    }
+  }
+
+  spline_one_body=spline_two_body=0;
+  if(!use_spline) return;
+
+  if(has_one_body) {
+    int nkinds=0;
+    for(int at=0; at< natoms; at++)
+      nkinds=max(nkinds, one_body.atom_kind(at)+1);
+    Array1 <int> nkind_atoms(nkinds);
+    nkind_atoms=0;
+    for(int at=0; at< natoms; at++)
+      if(one_body.atom_kind(at) >= 0) nkind_atoms(one_body.atom_kind(at))++;
+    kind_atoms.Resize(nkinds);
+    for(int k=0; k< nkinds; k++) kind_atoms(k).Resize(nkind_atoms(k));
+    nkind_atoms=0;
+    for(int at=0; at< natoms; at++) {
+      int k=one_body.atom_kind(at);
+      if(k >= 0) kind_atoms(k)(nkind_atoms(k)++)=at;
+    }
+
+    ei_spline.Resize(nkinds);
+    spline_one_body=1;
+    for(int k=0; k< nkinds; k++) {
+      if(nkind_atoms(k)==0) continue;
+      int at=kind_atoms(k)(0);
+      vector <Basis_function *> basis;
+      for(int n=0; n< nbasis_at(at); n++)
+        basis.push_back(eibasis(atom2basis(at,n)));
+      one_body.getAtomParms(at, c);
+      if(!tabulate_radial(basis, c, spline_spacing, ei_spline(k)))
+        spline_one_body=0;
+    }
+    if(!spline_one_body)
+      single_write(cout, "Jastrow: the one-body basis can't be tabulated; "
+                   "not using SPLINE for it\n");
+  }
+
+  if(has_two_body) {
+    vector <Basis_function *> basis;
+    for(int b=0; b< eebasis.GetDim(0); b++) basis.push_back(eebasis(b));
+    int nchannels=two_body->nspinChannels();
+    ee_spline.Resize(nchannels);
+    spline_two_body=1;
+    for(int s=0; s< nchannels; s++) {
+      two_body->getChannelParms(s, c);
+      if(!tabulate_radial(basis, c, spline_spacing, ee_spline(s)))
+        spline_two_body=0;
+    }
+    if(!spline_two_body)
+      single_write(cout, "Jastrow: the two-body basis can't be tabulated; "
+                   "not using SPLINE for it\n");
+  }
+
+  int nscratch=max(max(nelectrons, natoms), 1);
+  thread_spline.Resize(qmc_max_threads());
+  for(int t=0; t< thread_spline.GetDim(0); t++)
+    thread_spline(t).Resize(4, nscratch);
+}
+
+//----------------------------------------------------------------------
+
+void Jastrow_group::oneBodySplineVal(int e, Sample_point * sample,
+                                     doublevar & val) {
+  sample->updateEIDist();
+  Distance_row row;
+  sample->getEIRow(e,row);
+  oneBodySplineVal(row, val);
+}
+
+//----------------------------------------------------------------------
+
+void Jastrow_group::oneBodySplineVal(const Distance_row & row,
+                                     doublevar & val) {
+  Array2 <doublevar> & scratch=thread_spline(qmc_thread_num());
+  doublevar * r=&scratch(0,0), * u=&scratch(1,0);
+  for(int k=0; k< ei_spline.GetDim(0); k++) {
+    int n=kind_atoms(k).GetDim(0);
+    const int * atoms=kind_atoms(k).v;
+    for(int a=0; a< n; a++) r[a]=row.r[atoms[a]];
+    ei_spline(k).val(n, r, u);
+    for(int a=0; a< n; a++) val+=u[a];
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Jastrow_group::oneBodySplineLap(int e, Sample_point * sample,
+                                     Array1 <doublevar> & lap,
+                                     Array3 <doublevar> * ion_lap) {
+  sample->updateEIDist();
+  Distance_row row;
+  sample->getEIRow(e,row);
+  Array2 <doublevar> & scratch=thread_spline(qmc_thread_num());
+  doublevar * r=&scratch(0,0), * u=&scratch(1,0);
+  doublevar * g=&scratch(2,0), * l=&scratch(3,0);
+  for(int k=0; k< ei_spline.GetDim(0); k++) {
+    int n=kind_atoms(k).GetDim(0);
+    const int * atoms=kind_atoms(k).v;
+    for(int a=0; a< n; a++) r[a]=row.r[atoms[a]];
+    ei_spline(k).lap(n, r, u, g, l);
+    for(int a=0; a< n; a++) {
+      int at=atoms[a];
+      lap(0)+=u[a];
+      lap(1)+=g[a]*row.dx[at];
+      lap(2)+=g[a]*row.dy[at];
+      lap(3)+=g[a]*row.dz[at];
+      lap(4)+=l[a];
+    }
+    if(ion_lap) {
+      for(int a=0; a< n; a++) {
+        int at=atoms[a];
+        (*ion_lap)(e,at,0)+=u[a];
+        (*ion_lap)(e,at,1)+=g[a]*row.dx[at];
+        (*ion_lap)(e,at,2)+=g[a]*row.dy[at];
+        (*ion_lap)(e,at,3)+=g[a]*row.dz[at];
+        (*ion_lap)(e,at,4)+=l[a];
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+/*!
+  The partners j != e of electron e closer than cutoff, in order, into
+  idx and r.  Returns their number; nlow of them are below e, and nup
+  below nspin_up.
+*/
+int partners_in_range(int e, int nelectrons, int nspin_up,
+                      const Distance_row & row, doublevar cutoff,
+                      int * idx, doublevar * r, int & nlow, int & nup) {
+  int m=0;
+  for(int j=0; j< e; j++) {
+    idx[m]=j;
+    r[m]=row.r[j];
+    m+= row.r[j] < cutoff;
+  }
+  nlow=m;
+  for(int j=e+1; j< nelectrons; j++) {
+    idx[m]=j;
+    r[m]=row.r[j];
+    m+= row.r[j] < cutoff;
+  }
+  nup=0;
+  while(nup < m && idx[nup] < nspin_up) nup++;
+  return m;
+}
+
+//----------------------------------------------------------------------
+
+void Jastrow_group::twoBodyRowVal(int e, Sample_point * sample,
+                                  Array1 <doublevar> & val) {
+  sample->updateEEDist();
+  Distance_row row;
+  sample->getEERow(e,row);
+  twoBodyRowVal(e, row, val);
+}
+
+//----------------------------------------------------------------------
+
+void Jastrow_group::twoBodyRowVal(int e, const Distance_row & row,
+                                  Array1 <doublevar> & val) {
+  //channel 1 is the spin opposite to e
+  int eup= e < n_spin_up;
+  int nchannels= spline_two_body ? ee_spline.GetDim(0) : ee_coeff.GetDim(0);
+  int s_up= nchannels > 1 ? !eup : 0;
+  int s_down= nchannels > 1 ? eup : 0;
+
+  if(spline_two_body) {
+    doublevar * u=&thread_spline(qmc_thread_num())(1,0);
+    ee_spline(s_up).val(n_spin_up, row.r, u);
+    ee_spline(s_down).val(nelectrons-n_spin_up, row.r+n_spin_up, u+n_spin_up);
+    for(int i=0; i< e; i++) val(i)+=u[i];
+    for(int j=e+1; j< nelectrons; j++) val(j)+=u[j];
+    return;
+  }
+
+  int t=qmc_thread_num();
+  int * idx=thread_partners(t).v;
+  doublevar * r=thread_eerow(t).v, * u=r+nelectrons, * f=r+4*nelectrons;
+  int np=ee_coeff.GetDim(1);
+  int counter=0;
+  for(int b=0; b< eebasis.GetDim(0) && counter < np; b++) {
+    int nlow, nup;
+    int m=partners_in_range(e, nelectrons, n_spin_up, row, eebasis_cutoff(b),
+                            idx, r, nlow, nup);
+    int nf=min(nfunc_eeb(b), np-counter);
+    eebasis(b)->calcRadialVal(m, r, f);
+    for(int k=0; k< m; k++) u[k]=0;
+    for(int i=0; i< nf; i++) {
+      const doublevar * fi=f+i*m;
+      doublevar c=ee_coeff(s_up, counter+i);
+      for(int k=0; k< nup; k++) u[k]+=c*fi[k];
+      c=ee_coeff(s_down, counter+i);
+      for(int k=nup; k< m; k++) u[k]+=c*fi[k];
+    }
+    for(int k=0; k< m; k++) val(idx[k])+=u[k];
+    counter+=nfunc_eeb(b);
+  }
+}
+
+//----------------------------------------------------------------------
+
+void Jastrow_group::twoBodyRowLap(int e, Sample_point * sample,
+                                  Array2 <doublevar> & lap) {
+  sample->updateEEDist();
+  Distance_row row;
+  sample->getEERow(e,row);
+  int eup= e < n_spin_up;
+  int nchannels= spline_two_body ? ee_spline.GetDim(0) : ee_coeff.GetDim(0);
+  int s_up= nchannels > 1 ? !eup : 0;
+  int s_down= nchannels > 1 ? eup : 0;
+
+  if(spline_two_body) {
+    Array2 <doublevar> & scratch=thread_spline(qmc_thread_num());
+    doublevar * u=&scratch(1,0), * g=&scratch(2,0), * l=&scratch(3,0);
+    int nup=n_spin_up;
+    ee_spline(s_up).lap(nup, row.r, u, g, l);
+    ee_spline(s_down).lap(nelectrons-nup, row.r+nup, u+nup, g+nup, l+nup);
+    //as in updateEEBasis(), the pairs (i,e) with i < e take -(x,y,z)
+    for(int i=0; i< e; i++) {
+      lap(i,0)+=u[i];
+      lap(i,1)-=g[i]*row.dx[i];
+      lap(i,2)-=g[i]*row.dy[i];
+      lap(i,3)-=g[i]*row.dz[i];
+      lap(i,4)+=l[i];
+    }
+    for(int j=e+1; j< nelectrons; j++) {
+      lap(j,0)+=u[j];
+      lap(j,1)+=g[j]*row.dx[j];
+      lap(j,2)+=g[j]*row.dy[j];
+      lap(j,3)+=g[j]*row.dz[j];
+      lap(j,4)+=l[j];
+    }
+    return;
+  }
+
+  int t=qmc_thread_num();
+  int * idx=thread_partners(t).v;
+  doublevar * r=thread_eerow(t).v;
+  doublevar * u=r+nelectrons, * g=r+2*nelectrons, * l=r+3*nelectrons;
+  doublevar * f=r+4*nelectrons;
+  int np=ee_coeff.GetDim(1);
+  int counter=0;
+  for(int b=0; b< eebasis.GetDim(0) && counter < np; b++) {
+    int nlow, nup;
+    int m=partners_in_range(e, nelectrons, n_spin_up, row, eebasis_cutoff(b),
+                            idx, r, nlow, nup);
+    int nf=min(nfunc_eeb(b), np-counter);
+    eebasis(b)->calcRadialLap(m, r, f);
+    for(int k=0; k< m; k++) u[k]=g[k]=l[k]=0;
+    for(int i=0; i< nf; i++) {
+      const doublevar * fv=f+3*i*m, * fg=fv+m, * fl=fv+2*m;
+      doublevar c=ee_coeff(s_up, counter+i);
+      for(int k=0; k< nup; k++) {
+        u[k]+=c*fv[k];
+        g[k]+=c*fg[k];
+        l[k]+=c*fl[k];
+      }
+      c=ee_coeff(s_down, counter+i);
+      for(int k=nup; k< m; k++) {
+        u[k]+=c*fv[k];
+        g[k]+=c*fg[k];
+        l[k]+=c*fl[k];
+      }
+    }
+    for(int k=0; k< nlow; k++) {
+      int i=idx[k];
+      lap(i,0)+=u[k];
+      lap(i,1)-=g[k]*row.dx[i];
+      lap(i,2)-=g[k]*row.dy[i];
+      lap(i,3)-=g[k]*row.dz[i];
+      lap(i,4)+=l[k];
+    }
+    for(int k=nlow; k< m; k++) {
+      int j=idx[k];
+      lap(j,0)+=u[k];
+      lap(j,1)+=g[k]*row.dx[j];
+      lap(j,2)+=g[k]*row.dy[j];
+      lap(j,3)+=g[k]*row.dz[j];
+      lap(j,4)+=l[k];
+    }
+    counter+=nfunc_eeb(b);
+  }
+}
+
+//----------------------------------------------------------------------
+
 
 int Jastrow_group::writeinput(string & indent, ostream & os) {
   string indent2=indent+"  ";
@@ -417,6 +845,10 @@ int Jastrow_group::writeinput(string & indent, ostream & os) {
   if(optimize_basis) {
     os << indent << "OPTIMIZEBASIS" << endl;
   }
+  if(use_spline) {
+    os << indent << "SPLINE" << endl;
+    os << indent << "SPLINE_SPACING " << spline_spacing << endl;
+  }
 
   if(has_one_body) {
     os << indent << "ONEBODY { " << endl;
@@ -442,6 +874,11 @@ int Jastrow_group::writeinput(string & indent, ostream & os) {
     three_body_diffspin.writeinput(indent2, os);
     os << indent << "}\n";
   }
+  if(has_kspace) { 
+    os << indent << "KSPACE { " << endl;
+    kspace.writeinput(indent2, os);
+    os << indent << "}\n";
+  }
   
   for(int b=0; b< eibasis.GetDim(0); b++) {
     os << indent << "EIBASIS { " << endl;
@@ -465,6 +902,13 @@ int Jastrow_group::showinfo(string & indent, ostream & os) {
   if(optimize_basis) {
     os << indent << "Basis optimization turned on" << endl;
   }
+  if(spline_one_body || spline_two_body) {
+    os << indent << "Tabulating the";
+    if(spline_one_body) os << " one-body";
+    if(spline_one_body && spline_two_body) os << " and";
+    if(spline_two_body) os << " two-body";
+    os << " terms with spacing " << spline_spacing << endl;
+  }
 
   if(has_one_body) {
     os << indent << "One-body terms " << endl;
@@ -491,6 +935,11 @@ int Jastrow_group::showinfo(string & indent, ostream & os) {
     three_body_diffspin.showinfo(indent2, os);
     os << endl;
   }
+  if(has_kspace) { 
+    os << indent << "k-space terms " << endl;
+    kspace.showinfo(indent2, os);
+    os << endl;
+  }
   
   if(has_one_body || has_three_body || has_three_body_diffspin)
     os << indent << "Electron-ion basis" << endl;
@@ -524,6 +973,8 @@ int Jastrow_group::nparms() {
     tot+=three_body.nparms();
   if(has_three_body_diffspin)
     tot+=three_body_diffspin.nparms();
+  if(has_kspace)
+    tot+=kspace.nparms();
     
   if(optimize_basis) {
     for(int b=0; b< eibasis.GetDim(0); b++)
@@ -557,12 +1008,15 @@ void Jastrow_group::getVarParms(Array1 <doublevar> & parms) {
 
   parms.Resize(nparms());
   Array1 <doublevar> one_parms, two_parms, three_parms, three_parms_diffspin;
+  Array1 <doublevar> kspace_parms;
   one_body.getParms(one_parms);
   if(has_two_body)
     two_body->getParms(two_parms);
 
   three_body.getParms(three_parms);
   three_body_diffspin.getParms(three_parms_diffspin);
+  if(has_kspace)
+    kspace.getParms(kspace_parms);
 
   int counter=0;
   for(int i=0; i< one_parms.GetDim(0); i++)
@@ -577,6 +1031,9 @@ void Jastrow_group::getVarParms(Array1 <doublevar> & parms) {
   for(int i=0; i< three_parms_diffspin.GetDim(0); i++)
     parms(counter++)=three_parms_diffspin(i);
 
+  for(int i=0; i< kspace_parms.GetDim(0); i++)
+    parms(counter++)=kspace_parms(i);
+
   if(optimize_basis) {
     Array1 <doublevar> basisparms;
     for(int b=0; b<eibasis.GetDim(0); b++) {
@@ -626,6 +1083,13 @@ void Jastrow_group::setVarParms(Array1 <doublevar> & parms) {
     three_parms_diffspin(i)=parms(counter++);
   three_body_diffspin.setParms(three_parms_diffspin);  
 
+  if(has_kspace) { 
+    Array1 <doublevar> kspace_parms(kspace.nparms());
+    for(int i=0; i< kspace_parms.GetDim(0); i++)
+      kspace_parms(i)=parms(counter++);
+    kspace.setParms(kspace_parms);
+  }
+
   
   if(optimize_basis) {
     Array1 <doublevar> basisparms;
@@ -647,7 +1111,7 @@ void Jastrow_group::setVarParms(Array1 <doublevar> & parms) {
     }
   }
 
-
+  updateTables();
 }
 //----------------------------------------------------------------------
 
@@ -747,6 +1211,9 @@ int Jastrow2_wf_data::supports(wf_support_type support) {
       }
     }
     return 1;
+  case move_proposal:
+  case virtual_moves:
+    return 1;
   default:
     return 0;
   }
@@ -935,13 +1402,44 @@ void Jastrow2_wf::init(Wavefunction_data * wfdata) {
 
 
   
+  //Only the three-body terms read the saved basis; the other groups'
+  //arrays are left empty.
   eibasis_save.Resize(ngroups);
+  ei_near.Resize(ngroups);
   for(int g=0; g< ngroups; g++) {
-    //if(parent->group(g).hasThreeBody()||parent->group(g).hasThreeBodySpin())
-    eibasis_save(g).Resize(nelectrons, parent->natoms, maxeibasis, 5);
+    if(parent->group(g).hasThreeBody()||parent->group(g).hasThreeBodySpin()) { 
+      eibasis_save(g).Resize(nelectrons, parent->natoms, maxeibasis, 5);
+      ei_near(g).Resize(nelectrons, parent->natoms);
+    }
   }
 
+  work_eibasis.Resize(parent->natoms, maxeibasis, 5);
+  work_eebasis.Resize(nelectrons, maxeebasis, 5);
+  work_val.Resize(nelectrons);
+  work_ei.Resize(5);
+  work_ee.Resize(nelectrons, 5);
+  work_eei.Resize(2, nelectrons, 5);
+  virtual_pos.Resize(3);
+  proposal_ei.Resize(5);
+  proposal_ee.Resize(nelectrons,5);
+  proposal_eei.Resize(2,nelectrons,5);
+  proposal_eibasis.Resize(ngroups);
+  for(int g=0; g< ngroups; g++) { 
+    if(eibasis_save(g).GetDim(0))
+      proposal_eibasis(g).Resize(parent->natoms, maxeibasis, 5);
+  }
 
+  nkspace=0;
+  for(int g=0; g< ngroups; g++) {
+    if(parent->group(g).hasKspace() 
+       && nkspace < parent->group(g).kspace.nkpoints())
+      nkspace=parent->group(g).kspace.nkpoints();
+  }
+  kspace_sf=NULL;
+  u_kspace=0;
+  proposal_kspace=0;
+  work_klap.Resize(5);
+  work_kphase.Resize(2, max(nkspace,1));
 
 }
 
@@ -958,7 +1456,8 @@ void Jastrow2_wf::updateVal(Wavefunction_data * wfdata, Sample_point * sample){
   }
 
   int ngroups=parent->group.GetDim(0);
-  Array3 <doublevar> eibasis(parent->natoms, maxeibasis ,5);
+  Array3 <doublevar> & eibasis=work_eibasis;
+  Array3 <doublevar> & eebasis=work_eebasis;
   
   bool has3b=false;
   for(int g=0; g< ngroups; g++) 
@@ -970,13 +1469,11 @@ void Jastrow2_wf::updateVal(Wavefunction_data * wfdata, Sample_point * sample){
     if(electronIsStaleVal(e)) {
 
 
-      Array1 <doublevar> newval_ee(nelectrons);
+      Array1 <doublevar> & newval_ee=work_val;
       doublevar newval_ei;
       newval_ee=0;
       newval_ei=0;
 
-      Array3 <doublevar> eebasis(nelectrons, maxeebasis, 5);
-
       doublevar old_eval=0;
       for(int i=0; i< e; i++)
         old_eval+=two_body_save(i,e,0);
@@ -994,10 +1491,19 @@ void Jastrow2_wf::updateVal(Wavefunction_data * wfdata, Sample_point * sample){
 
 
       for(int g=0; g< ngroups; g++) {
-        if(parent->group(g).hasOneBody()) 
+        int threebody=parent->group(g).hasThreeBody() || parent->group(g).hasThreeBodySpin();
+        if(parent->group(g).splineOneBody()) { 
+          if(keep_ion_dependent) { 
+            Array1 <doublevar> & lap=work_ei;
+            lap=0;
+            parent->group(g).oneBodySplineLap(e, sample, lap, &one_body_ion);
+            newval_ei+=lap(0);
+          }
+          else 
+            parent->group(g).oneBodySplineVal(e, sample, newval_ei);
+        }
+        else if(parent->group(g).hasOneBody()) { 
           parent->group(g).updateEIBasis(e,sample,eibasis);
-
-        if(parent->group(g).hasOneBody()) { 
           parent->group(g).one_body.updateVal(e, eibasis,newval_ei);
           if(keep_ion_dependent) { 
             //cout << "updating " << endl;
@@ -1006,19 +1512,22 @@ void Jastrow2_wf::updateVal(Wavefunction_data * wfdata, Sample_point * sample){
         }
         
 
-        if(parent->group(g).hasTwoBody() || parent->group(g).hasThreeBody() || parent->group(g).hasThreeBodySpin())
+        if((parent->group(g).hasTwoBody() && !parent->group(g).rowTwoBody())
+           || threebody)
           parent->group(g).updateEEBasis(e,sample, eebasis);
         
-        if(parent->group(g).hasTwoBody())
+        if(parent->group(g).rowTwoBody())
+          parent->group(g).twoBodyRowVal(e, sample, newval_ee);
+        else if(parent->group(g).hasTwoBody())
           parent->group(g).two_body->updateVal(e,eebasis, newval_ee);
 
 
         if(parent->group(g).hasThreeBody()) 
           parent->group(g).three_body.updateVal(e,eibasis_save(g), 
-              eebasis, newval_ee);
+              eebasis, ei_near(g), newval_ee);
         if(parent->group(g).hasThreeBodySpin()) 
           parent->group(g).three_body_diffspin.updateVal(e,eibasis_save(g), 
-              eebasis, newval_ee);
+              eebasis, ei_near(g), newval_ee);
 
 
       }
@@ -1043,33 +1552,95 @@ void Jastrow2_wf::updateVal(Wavefunction_data * wfdata, Sample_point * sample){
     }
   }
 
-
+  updateKspace(sample);
 }
 //----------------------------------------------------------
 
 void Jastrow2_wf::update_eibasis_save(Wavefunction_data * wfdata, Sample_point * sample) { 
   int ngroups=parent->group.GetDim(0);
-  Array3 <doublevar> eibasis(parent->natoms, maxeibasis ,5);
+  Array3 <doublevar> & eibasis=work_eibasis;
 
   for(int g=0; g< ngroups; g++) { 
-   // if(parent->group(g).hasThreeBody()|| parent->group(g).hasThreeBodySpin()) { 
+    if(parent->group(g).hasThreeBody()|| parent->group(g).hasThreeBodySpin()) { 
       for(int e=0; e< nelectrons; e++) {
         if(electronIsStaleLap(e)) { 
           parent->group(g).updateEIBasis(e,sample,eibasis);
-          for(int i=0; i< parent->natoms; i++) {
-            for(int j=0; j< maxeibasis; j++) {
-              for(int d=0; d< 5; d++) {
-                eibasis_save(g)(e,i,j,d)=eibasis(i,j,d);
-              }
-            }
-          }
+          storeEIRow(g,e,eibasis);
         }
-   //   }
+      }
     }
   }
   
 }
 
+//----------------------------------------------------------
+
+/*!
+Store electron e's row of the electron-ion basis for group g, keeping the
+group's near lists for the three-body terms in step with it.
+*/
+void Jastrow2_wf::storeEIRow(int g, int e, const Array3 <doublevar> & eibasis) {
+  Array4 <doublevar> & save=eibasis_save(g);
+  for(int i=0; i< save.GetDim(1); i++)
+    for(int j=0; j< save.GetDim(2); j++)
+      for(int d=0; d< save.GetDim(3); d++)
+        save(e,i,j,d)=eibasis(i,j,d);
+  if(parent->group(g).hasThreeBody() || parent->group(g).hasThreeBodySpin())
+    ei_near(g).update(e,save);
+}
+
+//----------------------------------------------------------
+
+/*!
+The k-space terms keep nothing per electron: the sample's structure
+factor has it all, so we only bring it up to date and keep the total.
+*/
+void Jastrow2_wf::updateKspace(Sample_point * sample) {
+  if(nkspace==0) return;
+  kspace_sf=sample->getStructureFactor(nkspace);
+  if(kspace_sf==NULL)
+    error("The KSPACE Jastrow needs the structure factor of the sample");
+  u_kspace=0;
+  int ngroups=parent->group.GetDim(0);
+  for(int g=0; g< ngroups; g++) {
+    if(parent->group(g).hasKspace())
+      u_kspace+=parent->group(g).kspace.value(*kspace_sf);
+  }
+}
+
+//----------------------------------------------------------
+
+/*!
+The groups all use the start of the same sorted k-point list, so the one
+with the most k-points gives the phases for all of them.
+*/
+void Jastrow2_wf::kspacePhases(const Array1 <doublevar> & r) {
+  int ngroups=parent->group.GetDim(0);
+  for(int g=0; g< ngroups; g++) {
+    if(parent->group(g).hasKspace() 
+       && parent->group(g).kspace.nkpoints()==nkspace) {
+      parent->group(g).kspace.phases(r, work_kphase.v, 
+                                     work_kphase.v+work_kphase.GetDim(1));
+      return;
+    }
+  }
+}
+
+//----------------------------------------------------------
+
+void Jastrow2_wf::kspaceLap(int e, Array1 <doublevar> & lap) {
+  lap=0.0;
+  if(nkspace==0) return;
+  assert(kspace_sf != NULL);
+  int ngroups=parent->group.GetDim(0);
+  for(int g=0; g< ngroups; g++) {
+    if(parent->group(g).hasKspace())
+      parent->group(g).kspace.updateLap(e, *kspace_sf, lap);
+  }
+}
+
+//----------------------------------------------------------
+
 void Jastrow2_wf::updateLap(Wavefunction_data * wfdata, Sample_point * sample){
   //cout << "Jastrow2_wf::updateLap " << endl;
   if(updateEverythingLap) {
@@ -1077,169 +1648,245 @@ void Jastrow2_wf::updateLap(Wavefunction_data * wfdata, Sample_point * sample){
     updateEverythingLap=0;
   }
 
-  int ngroups=parent->group.GetDim(0);
-  Array3 <doublevar> eibasis(parent->natoms, maxeibasis ,5);
   update_eibasis_save(wfdata,sample);
 
+  Array1 <doublevar> & newlap_ei=work_ei;
+  Array2 <doublevar> & newlap_ee=work_ee;
+  Array3 <doublevar> & newlap_eei=work_eei;
   for(int e=0; e < nelectrons; e++) {
     if(electronIsStaleLap(e)) {
-      //Array3 <doublevar> eibasis(parent->natoms, maxeibasis ,5);
-      Array3 <doublevar> eebasis(nelectrons, maxeebasis, 5);
+      calcLapRow(e,sample,newlap_ei,newlap_ee,newlap_eei);
+      storeLapRow(e,newlap_ei,newlap_ee,newlap_eei);
+      electronIsStaleLap(e)=0;
+    }
+  }
 
-      Array1 <doublevar> newlap_ei(5);
-      newlap_ei=0;
-      Array2 <doublevar> newlap_ee(nelectrons, 5);
-      newlap_ee=0;
-      
-      Array3 <doublevar> newlap_eei(2,nelectrons,5,0.0);
+  //for(int i=0; i< nelectrons; i++) {
+  //  for(int j=i+1; j< nelectrons; j++) {
+  //    cout << "pair " << i << "   " << j
+  //         << " driftion " << two_body_save(i,j,4) << endl;
+  //  }
+  //}
 
-      newlap_eei=0;
+  electronIsStaleVal=0;
+  updateEverythingVal=0;
+  updateKspace(sample);
+  //cout << "Jastrow2_wf::updateLap done" << endl;
 
+}
+
+//----------------------------------------------------------
+
+/*!
+Evaluate the one-body and pair terms for electron e at its current
+position.  The three-body terms use eibasis_save, so it must be up
+to date for all the other electrons.
+*/
+void Jastrow2_wf::calcLapRow(int e, Sample_point * sample,
+                             Array1 <doublevar> & newlap_ei,
+                             Array2 <doublevar> & newlap_ee,
+                             Array3 <doublevar> & newlap_eei) { 
+  int ngroups=parent->group.GetDim(0);
+  Array3 <doublevar> & eibasis=work_eibasis;
+  Array3 <doublevar> & eebasis=work_eebasis;
+
+  newlap_ei=0;
+  newlap_ee=0;
+  newlap_eei=0;
+
+  if(keep_ion_dependent) { 
+    for(int a=0; a< parent->natoms; a++) { 
+      for(int d=0; d< 5; d++)
+        one_body_ion(e,a,d)=0;
+    }
+  }
+
+  for(int g=0; g< ngroups; g++) {
+    int threebody=parent->group(g).hasThreeBody() || parent->group(g).hasThreeBodySpin();
+    if((parent->group(g).hasOneBody() && !parent->group(g).splineOneBody())
+        || threebody)
+      parent->group(g).updateEIBasis(e,sample,eibasis);
+
+    if(parent->group(g).splineOneBody()) {
+      parent->group(g).oneBodySplineLap(e, sample, newlap_ei,
+          keep_ion_dependent ? &one_body_ion : NULL);
+    }
+    else if(parent->group(g).hasOneBody()) {
+      parent->group(g).one_body.updateLap(e, eibasis,newlap_ei);
       if(keep_ion_dependent) { 
-        for(int a=0; a< parent->natoms; a++) { 
-          for(int d=0; d< 5; d++)
-            one_body_ion(e,a,d)=0;
-        }
+        parent->group(g).one_body.updateLap_ion(e, eibasis,one_body_ion);
       }
+    }
 
 
-      doublevar old_eval=0;
-      for(int i=0; i< e; i++)
-        old_eval+=two_body_save(i,e,0);
-      for(int j=e+1; j< nelectrons; j++)
-        old_eval+=two_body_save(e,j,0);
+    if((parent->group(g).hasTwoBody() && !parent->group(g).rowTwoBody())
+        || threebody)
+      parent->group(g).updateEEBasis(e,sample, eebasis);
+    
+    if(parent->group(g).rowTwoBody())
+      parent->group(g).twoBodyRowLap(e, sample, newlap_ee);
+    else if(parent->group(g).hasTwoBody())
+      parent->group(g).two_body->updateLap(e,eebasis, newlap_ee);
 
-      for(int g=0; g< ngroups; g++) {
-        if(parent->group(g).hasOneBody() || parent->group(g).hasThreeBody()
-            || parent->group(g).hasThreeBodySpin() )
-          parent->group(g).updateEIBasis(e,sample,eibasis);
+      
+    if(threebody) 
+      storeEIRow(g,e,eibasis);
+    if(parent->group(g).hasThreeBody()) 
+      parent->group(g).three_body.updateLap(e,eibasis_save(g),eebasis,
+                                            ei_near(g),newlap_eei);
+    if(parent->group(g).hasThreeBodySpin()) 
+      parent->group(g).three_body_diffspin.updateLap(e,eibasis_save(g),eebasis,
+                                                     ei_near(g),newlap_eei);
 
-        if(parent->group(g).hasOneBody()) {
-          parent->group(g).one_body.updateLap(e, eibasis,newlap_ei);
-          if(keep_ion_dependent) { 
-            parent->group(g).one_body.updateLap_ion(e, eibasis,one_body_ion);
-          }
-        }
+  }
+}
 
+//----------------------------------------------------------
 
-        if(parent->group(g).hasTwoBody() || parent->group(g).hasThreeBody() 
-            || parent->group(g).hasThreeBodySpin())
-          parent->group(g).updateEEBasis(e,sample, eebasis);
-        
-        if(parent->group(g).hasTwoBody())
-          parent->group(g).two_body->updateLap(e,eebasis, newlap_ee);
-
-          
-        if(parent->group(g).hasThreeBody()) { 
-          for(int i=0; i< parent->natoms; i++) {
-            for(int j=0; j< maxeibasis; j++) {
-              for(int d=0; d< 5; d++) {
-                eibasis_save(g)(e,i,j,d)=eibasis(i,j,d);
-              }
-            }
-          }
-          parent->group(g).three_body.updateLap(e,eibasis_save(g),eebasis,newlap_eei);
-        }
+void Jastrow2_wf::storeLapRow(int e, Array1 <doublevar> & newlap_ei,
+                              Array2 <doublevar> & newlap_ee,
+                              Array3 <doublevar> & newlap_eei) { 
+  doublevar old_eval=0;
+  for(int i=0; i< e; i++)
+    old_eval+=two_body_save(i,e,0);
+  for(int j=e+1; j< nelectrons; j++)
+    old_eval+=two_body_save(e,j,0);
 
-        if(parent->group(g).hasThreeBodySpin()) { 
-          for(int i=0; i< parent->natoms; i++) {
-            for(int j=0; j< maxeibasis; j++) {
-              for(int d=0; d< 5; d++) {
-                eibasis_save(g)(e,i,j,d)=eibasis(i,j,d);
-              }
-            }
-          }
-          parent->group(g).three_body_diffspin.updateLap(e,eibasis_save(g),eebasis,newlap_eei);
-        }
+  for(int d=0; d< 5; d++)
+    one_body_save(e,d)=newlap_ei(d);
+  
 
-      }
+  for(int i=0; i< e; i++) {
+    for(int d=0; d< 5; d++) 
+      two_body_save(i,e,d)=newlap_ee(i,d);
 
+    two_body_save(i,e,0)+=newlap_eei(0,i,0);
+    for(int d=1; d < 5; d++) 
+      two_body_save(i,e,d)+=newlap_eei(1,i,d);
+    
+  }
+  for(int i=0; i< e; i++) {
+   for(int d=1; d< 4; d++)
+      two_body_save(e,i,d)= -newlap_ee(i,d);
+    two_body_save(e,i,4)=newlap_ee(i,4);
+    
+    for(int d=1; d< 5; d++) 
+      two_body_save(e,i,d)+=newlap_eei(0,i,d);
+  }
 
-      for(int d=0; d< 5; d++)
-        one_body_save(e,d)=newlap_ei(d);
+  for(int j=e+1; j< nelectrons; j++) {
+    for(int d=0; d< 5; d++) 
+      two_body_save(e,j,d)=newlap_ee(j,d);
       
+    two_body_save(e,j,0)+=newlap_eei(0,j,0);
+    
+    for(int d=1; d< 5; d++) 
+      two_body_save(e,j,d)+=newlap_eei(0,j,d);
+    
+    
+  }
+  for(int j=e+1; j< nelectrons; j++) {
+    for(int d=1; d< 4; d++)
+      two_body_save(j,e,d)= -newlap_ee(j,d);
+    two_body_save(j,e,4)=newlap_ee(j,4);
+    
+    for(int d=1; d< 5; d++) 
+      two_body_save(j,e,d)+=newlap_eei(1,j,d);
 
-      for(int i=0; i< e; i++) {
-        for(int d=0; d< 5; d++) 
-          two_body_save(i,e,d)=newlap_ee(i,d);
+  }
+  
 
-        two_body_save(i,e,0)+=newlap_eei(0,i,0);
-        for(int d=1; d < 5; d++) 
-          two_body_save(i,e,d)+=newlap_eei(1,i,d);
-        
-      }
-      for(int i=0; i< e; i++) {
-       for(int d=1; d< 4; d++)
-          two_body_save(e,i,d)= -newlap_ee(i,d);
-        two_body_save(e,i,4)=newlap_ee(i,4);
-        
-        for(int d=1; d< 5; d++) 
-          two_body_save(e,i,d)+=newlap_eei(0,i,d);
-      }
+  doublevar new_eval=0;
+  for(int i=0; i< e; i++)
+    new_eval+=two_body_save(i,e,0);
+  for(int j=e+1; j< nelectrons; j++)
+    new_eval+=two_body_save(e,j,0);
 
-      for(int j=e+1; j< nelectrons; j++) {
-        for(int d=0; d< 5; d++) 
-          two_body_save(e,j,d)=newlap_ee(j,d);
-          
-        two_body_save(e,j,0)+=newlap_eei(0,j,0);
-        
-        for(int d=1; d< 5; d++) 
-          two_body_save(e,j,d)+=newlap_eei(0,j,d);
-        
-        
-      }
-      for(int j=e+1; j< nelectrons; j++) {
-        for(int d=1; d< 4; d++)
-          two_body_save(j,e,d)= -newlap_ee(j,d);
-        two_body_save(j,e,4)=newlap_ee(j,4);
-        
-        for(int d=1; d< 5; d++) 
-          two_body_save(j,e,d)+=newlap_eei(1,j,d);
+  u_twobody+=new_eval-old_eval;
+}
 
-      }
-      
+//----------------------------------------------------------
 
-      doublevar new_eval=0;
-      for(int i=0; i< e; i++)
-        new_eval+=two_body_save(i,e,0);
-      for(int j=e+1; j< nelectrons; j++)
-        new_eval+=two_body_save(e,j,0);
+void Jastrow2_wf::proposeMove(Wavefunction_data * wfdata, Sample_point * sample,
+                              int e, Wf_return & lap) { 
+  assert(!updateEverythingLap && !keep_ion_dependent);
+  int ngroups=parent->group.GetDim(0);
+  //Only e is stale, so update_eibasis_save() just moves its row.  Keep
+  //the old one for rejectMove().
+  for(int g=0; g< ngroups; g++) {
+    if(eibasis_save(g).GetDim(0)==0) continue;
+    for(int i=0; i< parent->natoms; i++) 
+      for(int j=0; j< maxeibasis; j++) 
+        for(int d=0; d< 5; d++) 
+          proposal_eibasis(g)(i,j,d)=eibasis_save(g)(e,i,j,d);
+  }
+  update_eibasis_save(wfdata,sample);
 
-      u_twobody+=new_eval-old_eval;
+  calcLapRow(e,sample,proposal_ei,proposal_ee,proposal_eei);
 
-      
-      /*
-      for(int d=0; d< 1; d++) { 
-        cout << "updated two_body_save: " << d << endl;
-        for(int i=0; i < nelectrons; i++) {
-          for(int j=0; j< nelectrons; j++) {
-            cout << two_body_save(i,j,d) << "  ";
-          }
-          cout << endl;
-        }
-      }
-      
-      
+  //Same as getLap() after storeLapRow(), without storing
+  lap.amp=0;
+  lap.phase=0;
+  doublevar old_eval=0, new_eval=0;
+  for(int i=0; i< nelectrons; i++) { 
+    if(i==e) continue;
+    old_eval+= i < e ? two_body_save(i,e,0) : two_body_save(e,i,0);
+    new_eval+=proposal_ee(i,0)+proposal_eei(0,i,0);
+  }
+  doublevar u=0;
+  for(int i=0; i< nelectrons; i++) 
+    u+= i==e ? proposal_ei(0) : one_body_save(i,0);
+  u+=u_twobody+(new_eval-old_eval);
+  //The sample has already moved e, so the structure factor is the proposal's
+  proposal_kspace=0;
+  if(nkspace) { 
+    updateKspace(sample);
+    proposal_kspace=u_kspace;
+  }
+  kspaceLap(e,work_klap);
+  u+=proposal_kspace;
+  lap.amp(0,0)=u;
+  lap.cvals(0,0)=u;
 
-      cout << "u " << u_twobody << "  new_eval " << new_eval << "  old_eval " << old_eval << endl;
-      */
-      
-      electronIsStaleLap(e)=0;
+  doublevar dotproduct=0;
+  for(int d=1; d< 4; d++) {
+    lap.amp(0,d)+=proposal_ei(d)+work_klap(d);
+    for(int i=0; i< nelectrons; i++) {
+      if(i < e) lap.amp(0,d)+= -proposal_ee(i,d)+proposal_eei(0,i,d);
+      else if(i > e) lap.amp(0,d)+=proposal_ee(i,d)+proposal_eei(0,i,d);
     }
+    dotproduct+=lap.amp(0,d)*lap.amp(0,d);
+  }
+  for(int i=0; i< nelectrons; i++) {
+    if(i!=e) lap.amp(0,4)+=proposal_ee(i,4)+proposal_eei(0,i,4);
   }
+  lap.amp(0,4)+=proposal_ei(4)+work_klap(4)+dotproduct;
 
-  //for(int i=0; i< nelectrons; i++) {
-  //  for(int j=i+1; j< nelectrons; j++) {
-  //    cout << "pair " << i << "   " << j
-  //         << " driftion " << two_body_save(i,j,4) << endl;
-  //  }
-  //}
+  for(int i=1; i< 5; i++) 
+    lap.cvals(0,i)=lap.amp(0,i);
+}
 
-  electronIsStaleVal=0;
-  updateEverythingVal=0;
-  //cout << "Jastrow2_wf::updateLap done" << endl;
+//----------------------------------------------------------
 
+void Jastrow2_wf::acceptMove(Wavefunction_data * wfdata, Sample_point * sample,
+                             int e) { 
+  storeLapRow(e,proposal_ei,proposal_ee,proposal_eei);
+  u_kspace=proposal_kspace;
+  electronIsStaleVal(e)=0;
+  electronIsStaleLap(e)=0;
 }
+
+//----------------------------------------------------------
+
+void Jastrow2_wf::rejectMove(Wavefunction_data * wfdata, Sample_point * sample,
+                             int e) { 
+  for(int g=0; g< proposal_eibasis.GetDim(0); g++) 
+    storeEIRow(g,e,proposal_eibasis(g));
+  updateKspace(sample);
+  electronIsStaleVal(e)=0;
+  electronIsStaleLap(e)=0;
+}
+
 //----------------------------------------------------------
 void Jastrow2_wf::updateForceBias(Wavefunction_data * wfdata,
                                   Sample_point * sample){
@@ -1257,7 +1904,7 @@ void Jastrow2_wf::getVal(Wavefunction_data * wfdata,
     u+=one_body_save(i,0);
   }
 
-  u+=u_twobody;
+  u+=u_twobody+u_kspace;
 
   val.amp(0, 0)=u;
   val.cvals(0,0)=u;
@@ -1282,11 +1929,12 @@ void Jastrow2_wf::getLap(Wavefunction_data * wfdata, int e,
   lap.phase=0;
 
   getVal(wfdata, e, lap);
+  kspaceLap(e,work_klap);
   doublevar dotproduct=0;
 
 
   for(int d=1; d< 4; d++) {
-    lap.amp(0, d)+=one_body_save(e,d);
+    lap.amp(0, d)+=one_body_save(e,d)+work_klap(d);
     for(int i=0; i< nelectrons; i++) {
       lap.amp(0,d)+=two_body_save(e,i,d);
       
@@ -1297,7 +1945,7 @@ void Jastrow2_wf::getLap(Wavefunction_data * wfdata, int e,
   for(int i=0; i< nelectrons; i++) {
     lap.amp(0,4)+=two_body_save(e,i,4);
   }
-  lap.amp(0,4)+=one_body_save(e,4)+dotproduct;
+  lap.amp(0,4)+=one_body_save(e,4)+work_klap(4)+dotproduct;
 
   for(int i=1; i< 5; i++) 
     lap.cvals(0,i)=lap.amp(0,i);
@@ -1400,15 +2048,8 @@ void Jastrow2_wf::restoreUpdate(Sample_point * sample, int e, Wavefunction_stora
     }
   }
   
-  for(int g=0; g< eibasis_save.GetDim(0); g++) {
-    for(int at=0; at < eibasis_save(g).GetDim(1); at++) {
-      for(int i=0; i < eibasis_save(g).GetDim(2); i++) {
-        for(int d=0; d < eibasis_save(g).GetDim(3); d++) {
-          eibasis_save(g)(e,at,i,d)=j2store->eibasis(g)(at,i,d);
-        }
-      }
-    }
-  }
+  for(int g=0; g< eibasis_save.GetDim(0); g++) 
+    storeEIRow(g,e,j2store->eibasis(g));
 
 
   doublevar new_eval=0;
@@ -1418,6 +2059,7 @@ void Jastrow2_wf::restoreUpdate(Sample_point * sample, int e, Wavefunction_stora
     new_eval+=two_body_save(e,j,0);
 
    u_twobody+=new_eval-old_eval;
+   updateKspace(sample);
 
 }
 
@@ -1491,15 +2133,8 @@ void Jastrow2_wf::restoreUpdate(Sample_point * sample, int e1, int e2, Wavefunct
   for(int j=e2+1; j< nelectrons; j++)
     old_eval+=two_body_save(e2,j,0);
   
-  for(int g=0; g< eibasis_save.GetDim(0); g++) {
-    for(int at=0; at < eibasis_save(g).GetDim(1); at++) {
-      for(int i=0; i < eibasis_save(g).GetDim(2); i++) {
-        for(int d=0; d < eibasis_save(g).GetDim(3); d++) {
-          eibasis_save(g)(e2,at,i,d)=j2store->eibasis_2(g)(at,i,d);
-        }
-      }
-    }
-  }
+  for(int g=0; g< eibasis_save.GetDim(0); g++) 
+    storeEIRow(g,e2,j2store->eibasis_2(g));
 
   for(int d=0; d< 5; d++) 
     one_body_save(e2,d)=j2store->one_body_part_2(d);
@@ -1526,15 +2161,8 @@ void Jastrow2_wf::restoreUpdate(Sample_point * sample, int e1, int e2, Wavefunct
   u_twobody += new_eval-old_eval;
 
 
-  for(int g=0; g< eibasis_save.GetDim(0); g++) {
-    for(int at=0; at < eibasis_save(g).GetDim(1); at++) {
-      for(int i=0; i < eibasis_save(g).GetDim(2); i++) {
-        for(int d=0; d < eibasis_save(g).GetDim(3); d++) {
-          eibasis_save(g)(e1,at,i,d)=j2store->eibasis(g)(at,i,d);
-        }
-      }
-    }
-  }
+  for(int g=0; g< eibasis_save.GetDim(0); g++) 
+    storeEIRow(g,e1,j2store->eibasis(g));
 
   old_eval=0;
   for(int i=0; i< e1; i++)
@@ -1567,6 +2195,7 @@ void Jastrow2_wf::restoreUpdate(Sample_point * sample, int e1, int e2, Wavefunct
     new_eval+=two_body_save(e1,j,0);
 
   u_twobody+=new_eval-old_eval;
+  updateKspace(sample);
 	
 }
 //----------------------------------------------------------
@@ -1630,7 +2259,21 @@ int Jastrow2_wf::getParmDeriv(Wavefunction_data *wfdata , Sample_point * sample,
   for(int g=0; g< ng; g++) {
     if(parent->group(g).hasOneBody()) { 
       Parm_deriv_return tmp_parm;
-      parent->group(g).one_body.getParmDeriv(eibasis_save(g),tmp_parm);
+      if(eibasis_save(g).GetDim(0)) 
+        parent->group(g).one_body.getParmDeriv(eibasis_save(g),tmp_parm);
+      else { 
+        //Nothing keeps this group's basis between moves, so evaluate it here
+        Array4 <doublevar> eibasis(nelectrons, parent->natoms, maxeibasis, 5);
+        Array3 <doublevar> & row=work_eibasis;
+        for(int e=0; e< nelectrons; e++) { 
+          parent->group(g).updateEIBasis(e,sample,row);
+          for(int i=0; i< parent->natoms; i++) 
+            for(int j=0; j< maxeibasis; j++) 
+              for(int d=0; d< 5; d++) 
+                eibasis(e,i,j,d)=row(i,j,d);
+        }
+        parent->group(g).one_body.getParmDeriv(eibasis,tmp_parm);
+      }
       extend_parm_deriv(parm_deriv,tmp_parm);
     }
 
@@ -1658,6 +2301,19 @@ int Jastrow2_wf::getParmDeriv(Wavefunction_data *wfdata , Sample_point * sample,
       extend_parm_deriv(parm_deriv,tmp_parm);
     }
 
+    if(parent->group(g).hasThreeBodySpin()) { 
+      Parm_deriv_return tmp_parm;
+      parent->group(g).three_body_diffspin.getParmDeriv(eibasis_save(g),eetotal,tmp_parm);
+      extend_parm_deriv(parm_deriv,tmp_parm);
+    }
+
+    if(parent->group(g).hasKspace()) { 
+      Parm_deriv_return tmp_parm;
+      int nk=parent->group(g).kspace.nkpoints();
+      parent->group(g).kspace.getParmDeriv(*sample->getStructureFactor(nk),tmp_parm);
+      extend_parm_deriv(parm_deriv,tmp_parm);
+    }
+
     //retparm=tmp_parm;
     /*
     Array3 <doublevar> eionbasis(nelectrons,parent->natoms, maxeibasis,5); //for 3-body terms
@@ -1958,136 +2614,237 @@ void Jastrow2_wf::plot1DInternals(Array1 <doublevar> & xdata,
 
 }
 
+//--------------------------------------------------------------------------
+/*!
+Only the terms involving e change, so for each position we evaluate e's 
+basis functions and its one-body and pair values as in updateVal(), and 
+add the difference to the saved total.  e's distances at the position come
+from the sample's getVirtualRows() and its basis row goes straight to the 
+three-body terms, so neither the sample nor the saved rows are touched.
+*/
+void Jastrow2_wf::evalVirtualMoves(Wavefunction_data * wfdata, Sample_point * sample,
+    int e, Array2 <doublevar> & pos, Array1 <Wf_return> & vals) { 
+  updateVal(wfdata,sample);
+  int npts=pos.GetDim(0);
+  int ngroups=parent->group.GetDim(0);
+  vals.Resize(npts);
+
+  doublevar u_one=0;
+  for(int i=0; i< nelectrons; i++) u_one+=one_body_save(i,0);
+  doublevar old_eval=0;
+  for(int i=0; i< e; i++) old_eval+=two_body_save(i,e,0);
+  for(int j=e+1; j< nelectrons; j++) old_eval+=two_body_save(e,j,0);
+
+  Array3 <doublevar> & eibasis=work_eibasis;
+  Array3 <doublevar> & eebasis=work_eebasis;
+  Array1 <doublevar> & newval_ee=work_val;
+  doublevar * kcos=work_kphase.v;
+  doublevar * ksin=work_kphase.v+work_kphase.GetDim(1);
+  Distance_row eirow, eerow;
+  for(int p=0; p< npts; p++) { 
+    for(int d=0; d< 3; d++) virtual_pos(d)=pos(p,d);
+    sample->getVirtualRows(e,virtual_pos,virtual_ee,virtual_ei);
+    virtual_ei.getRow(0,eirow);
+    virtual_ee.getRow(0,eerow);
+    doublevar newval_ei=0;
+    newval_ee=0;
+    for(int g=0; g< ngroups; g++) {
+      int threebody=parent->group(g).hasThreeBody() || parent->group(g).hasThreeBodySpin();
+      int spline1=parent->group(g).splineOneBody();
+      int row2=parent->group(g).rowTwoBody();
+      if((parent->group(g).hasOneBody() && !spline1) || threebody) 
+        parent->group(g).updateEIBasis(eirow,eibasis);
+      if(spline1)
+        parent->group(g).oneBodySplineVal(eirow, newval_ei);
+      else if(parent->group(g).hasOneBody()) 
+        parent->group(g).one_body.updateVal(e, eibasis,newval_ei);
+      if((parent->group(g).hasTwoBody() && !row2) || threebody)
+        parent->group(g).updateEEBasis(e,eerow, eebasis);
+      if(row2)
+        parent->group(g).twoBodyRowVal(e, eerow, newval_ee);
+      else if(parent->group(g).hasTwoBody())
+        parent->group(g).two_body->updateVal(e,eebasis, newval_ee);
+      if(parent->group(g).hasThreeBody()) 
+        parent->group(g).three_body.updateVal(e,eibasis,eibasis_save(g), 
+            eebasis, ei_near(g), newval_ee);
+      if(parent->group(g).hasThreeBodySpin()) 
+        parent->group(g).three_body_diffspin.updateVal(e,eibasis,eibasis_save(g), 
+            eebasis, ei_near(g), newval_ee);
+    }
+    doublevar new_eval=0;
+    for(int i=0; i< e; i++) new_eval+=newval_ee(i);
+    for(int j=e+1; j< nelectrons; j++) new_eval+=newval_ee(j);
+    doublevar u=u_one+u_twobody+new_eval-old_eval+newval_ei-one_body_save(e,0);
+    u+=u_kspace;
+    if(nkspace) { 
+      kspacePhases(virtual_pos);
+      for(int g=0; g< ngroups; g++) { 
+        if(parent->group(g).hasKspace()) 
+          u+=parent->group(g).kspace.moveDelta(e,*kspace_sf,kcos,ksin);
+      }
+    }
+    vals(p).Resize(1,1);
+    vals(p).amp(0,0)=u;
+    vals(p).phase(0,0)=0;
+    vals(p).cvals(0,0)=u;
+  }
+}
+
 //--------------------------------------------------------------------------
 void Jastrow2_wf::evalTestPos(Array1 <doublevar> & pos, Sample_point * sample,
     Array1 <Wf_return> & wf) { 
-
+  Array2 <doublevar> onepos(1,3);
+  for(int d=0; d< 3; d++) onepos(0,d)=pos(d);
+  Array2 <Wf_return> wfs;
+  evalTestPositions(parent,sample,onepos,wfs);
   wf.Resize(nelectrons);
-  /*
-  Wavefunction_storage * store=NULL;
-  generateStorage(store);
-  Array1 <doublevar> oldpos(3);
-
-  for(int e=0; e< nelectrons; e++) { 
-    wf(e).Resize(1,2);
-    saveUpdate(sample,e,store);
-    sample->getElectronPos(e,oldpos);
-    sample->setElectronPosNoNotify(e,pos);
-    electronIsStaleLap(e)=1; electronIsStaleVal(e)=1;
-    updateVal(parent,sample);
-    getVal(parent,e,wf(e));
-    restoreUpdate(sample,e,store);
-    sample->setElectronPosNoNotify(e,oldpos);
-  }
-
-  delete  store;
-  */
-
-  Array1 <doublevar> oldpos(3);
-  sample->getElectronPos(0,oldpos);
-  sample->setElectronPosNoNotify(0,pos);
+  for(int e=0; e< nelectrons; e++) wf(e)=wfs(0,e);
+}
+
+//--------------------------------------------------------------------------
+/*!
+The total Jastrow and each electron's current two-body sum don't depend 
+on the test position, so they are done once.  For each position the basis 
+functions are evaluated with two electrons per spin channel, which gives 
+the new two-body row against every electron.
+*/
+void Jastrow2_wf::evalTestPositions(Wavefunction_data * wfdata, Sample_point * sample,
+    Array2 <doublevar> & pos, Array2 <Wf_return> & wf) { 
+  int npts=pos.GetDim(0);
   int ngroups=parent->group.GetDim(0);
+  int nup=parent->nup;
+  wf.Resize(npts,nelectrons);
+
+  doublevar u_one=0; 
+  for(int i=0; i< nelectrons; i++) u_one+=one_body_save(i,0);
+  Array1 <doublevar> old_eval(nelectrons);
+  old_eval=0.0;
+  for(int i=0; i< nelectrons; i++) { 
+    for(int j=i+1; j< nelectrons; j++) { 
+      old_eval(i)+=two_body_save(i,j,0);
+      old_eval(j)+=two_body_save(i,j,0);
+    }
+  }
+
   Array1 <Array3 <doublevar> > eibasis(ngroups);
   Array1 <Array3 <doublevar> > eebasis(ngroups);
   for(int g=0; g< ngroups; g++) { 
     eibasis(g).Resize(parent->natoms, maxeibasis ,5);
     eebasis(g).Resize(nelectrons,maxeebasis,5);
-    parent->group(g).updateEIBasis(0,sample,eibasis(g));
-    parent->group(g).updateEEBasis(0,sample,eebasis(g));
   }
-  sample->setElectronPosNoNotify(0,oldpos);
-
-  //We have to also get the eebasis for the test with electron 0.
-  //Doing this in a somewhat inefficient way
-  sample->getElectronPos(1,oldpos);
-  sample->setElectronPosNoNotify(1,pos);
-  for(int g=0; g< ngroups;g++) { 
-    //Using the fact that updateEEBasis(e,..) doesn't touch element e
-    parent->group(g).updateEEBasis(1,sample,eebasis(g));
-  }
-  sample->setElectronPosNoNotify(1,oldpos);
-    
-
-  //We've now calculated the basis functions for all the electrons and can 
-  //get the wave function values
-  //Again doing two electrons per spin channel, slightly inefficient, but the scaling is 
-  //still fine.
-  //One could save some time by separating out the spin-dependent and spin-independent
-  //parts at the cost of code complexity, but so far it doesn't seem to be a 
-  //limiting factor for the RDM's
-
-  Array1 <Array1 <doublevar> > newval_ee(2); //one for each spin channel
   Array3 <doublevar> eibasis_tmp(parent->natoms,maxeibasis,5);
-  doublevar u_one=0; 
-  for(int i=0; i< nelectrons; i++) u_one+=one_body_save(i,0);
-  doublevar newval_ei;
-  int nup=parent->nup;
-  for(int s=0; s< 2; s++) { 
-    newval_ee(s).Resize(nelectrons);
-    newval_ee(s)=0.0;
-    int ne_spin;
-    if(s==0) ne_spin=min(2,nup);
-    else ne_spin=min(nup+2,nelectrons);
-    for(int e=s*nup; e< ne_spin;e++) { 
-      newval_ei=0;
-      for(int e1=0; e1 < nelectrons; e1++) if(e1!=e) newval_ee(s)(e1)=0;
+  Array1 <Array1 <doublevar> > newval_ee(2); //one for each spin channel
+  for(int s=0; s< 2; s++) newval_ee(s).Resize(nelectrons);
+  Array1 <doublevar> newval_ei(2), ee_total(2);
+  Array1 <doublevar> oldpos(3), newpos(3);
+  //The positions are all still the original ones here
+  if(nkspace) updateKspace(sample);
+  doublevar * kcos=work_kphase.v;
+  doublevar * ksin=work_kphase.v+work_kphase.GetDim(1);
+  int any_spline=0;
+  Array1 <int> need_eibasis(ngroups), need_eebasis(ngroups);
+  for(int g=0; g< ngroups; g++) { 
+    int threebody=parent->group(g).hasThreeBody() || parent->group(g).hasThreeBodySpin();
+    if(parent->group(g).splineOneBody() || parent->group(g).rowTwoBody())
+      any_spline=1;
+    need_eibasis(g)=(parent->group(g).hasOneBody() && !parent->group(g).splineOneBody())
+                    || threebody;
+    need_eebasis(g)=!parent->group(g).rowTwoBody() || threebody;
+  }
+
+  for(int p=0; p< npts; p++) { 
+    for(int d=0; d< 3; d++) newpos(d)=pos(p,d);
+    if(nkspace) kspacePhases(newpos);
+    sample->getElectronPos(0,oldpos);
+    sample->setElectronPosNoNotify(0,newpos);
+    for(int g=0; g< ngroups; g++) { 
+      if(need_eibasis(g))
+        parent->group(g).updateEIBasis(0,sample,eibasis(g));
+      if(need_eebasis(g))
+        parent->group(g).updateEEBasis(0,sample,eebasis(g));
+    }
+    sample->setElectronPosNoNotify(0,oldpos);
 
+    //We have to also get the eebasis for the test with electron 0.
+    if(nelectrons > 1) { 
+      sample->getElectronPos(1,oldpos);
+      sample->setElectronPosNoNotify(1,newpos);
       for(int g=0; g< ngroups;g++) { 
-        if(parent->group(g).hasOneBody()) { 
-          parent->group(g).one_body.updateVal(e,eibasis(g),newval_ei);
+        //Using the fact that updateEEBasis(e,..) doesn't touch element e
+        if(need_eebasis(g))
+          parent->group(g).updateEEBasis(1,sample,eebasis(g));
+      }
+      sample->setElectronPosNoNotify(1,oldpos);
+    }
+
+    for(int s=0; s< 2; s++) { 
+      newval_ee(s)=0.0;
+      newval_ei(s)=0.0;
+      int ne_spin;
+      if(s==0) ne_spin=min(2,nup);
+      else ne_spin=min(nup+2,nelectrons);
+      for(int e=s*nup; e< ne_spin;e++) { 
+        newval_ei(s)=0;
+        for(int e1=0; e1 < nelectrons; e1++) if(e1!=e) newval_ee(s)(e1)=0;
+
+        //The tabulated terms are evaluated with e itself at the test position
+        if(any_spline) { 
+          sample->getElectronPos(e,oldpos);
+          sample->setElectronPosNoNotify(e,newpos);
         }
-        if(parent->group(g).hasTwoBody()) 
-          parent->group(g).two_body->updateVal(e,eebasis(g),newval_ee(s));
-
-        //Here we have to do some shifting around of values
-        if(parent->group(g).hasThreeBody() || parent->group(g).hasThreeBodySpin()) {  
-          for(int i=0; i< parent->natoms; i++) { 
-            for(int j=0; j< maxeibasis; j++) { 
-              for(int d=0; d< 5; d++) { 
-                eibasis_tmp(i,j,d)=eibasis_save(g)(e,i,j,d);
-                eibasis_save(g)(e,i,j,d)=eibasis(g)(i,j,d);
-              }
-            }
+        for(int g=0; g< ngroups;g++) { 
+          if(parent->group(g).splineOneBody()) 
+            parent->group(g).oneBodySplineVal(e,sample,newval_ei(s));
+          else if(parent->group(g).hasOneBody()) { 
+            parent->group(g).one_body.updateVal(e,eibasis(g),newval_ei(s));
           }
-          if(parent->group(g).hasThreeBody()) 
-            parent->group(g).three_body.updateVal(e,eibasis_save(g), 
-                eebasis(g), newval_ee(s));
-          if(parent->group(g).hasThreeBodySpin()) 
-            parent->group(g).three_body_diffspin.updateVal(e,eibasis_save(g), 
-                eebasis(g), newval_ee(s));
-          for(int i=0; i< parent->natoms; i++) { 
-            for(int j=0; j< maxeibasis; j++) { 
-              for(int d=0; d< 5; d++) { 
-                eibasis_save(g)(e,i,j,d)=eibasis_tmp(i,j,d);
+          if(parent->group(g).rowTwoBody()) 
+            parent->group(g).twoBodyRowVal(e,sample,newval_ee(s));
+          else if(parent->group(g).hasTwoBody()) 
+            parent->group(g).two_body->updateVal(e,eebasis(g),newval_ee(s));
+
+          //Here we have to do some shifting around of values
+          if(parent->group(g).hasThreeBody() || parent->group(g).hasThreeBodySpin()) {  
+            for(int i=0; i< parent->natoms; i++) { 
+              for(int j=0; j< maxeibasis; j++) { 
+                for(int d=0; d< 5; d++) { 
+                  eibasis_tmp(i,j,d)=eibasis_save(g)(e,i,j,d);
+                }
               }
             }
+            storeEIRow(g,e,eibasis(g));
+            if(parent->group(g).hasThreeBody()) 
+              parent->group(g).three_body.updateVal(e,eibasis_save(g), 
+                  eebasis(g), ei_near(g), newval_ee(s));
+            if(parent->group(g).hasThreeBodySpin()) 
+              parent->group(g).three_body_diffspin.updateVal(e,eibasis_save(g), 
+                  eebasis(g), ei_near(g), newval_ee(s));
+            storeEIRow(g,e,eibasis_tmp);
           }
-
         }
-        //----
+        if(any_spline) 
+          sample->setElectronPosNoNotify(e,oldpos);
+      }
+      ee_total(s)=0;
+      for(int i=0; i< nelectrons; i++) ee_total(s)+=newval_ee(s)(i);
+    }
 
+    //the wave function for each of the electrons going to the test position
+    for(int e=0; e< nelectrons; e++) { 
+      int s= e < nup ? 0:1;
+      doublevar new_eval=ee_total(s)-newval_ee(s)(e);
+      doublevar u=u_twobody+u_one+u_kspace //original
+        +new_eval-old_eval(e)+newval_ei(s)-one_body_save(e,0);//updates
+      for(int g=0; g< ngroups && nkspace; g++) { 
+        if(parent->group(g).hasKspace()) 
+          u+=parent->group(g).kspace.moveDelta(e,*kspace_sf,kcos,ksin);
       }
+      wf(p,e).Resize(1,1);
+      wf(p,e).amp(0,0)=u;
+      wf(p,e).phase(0,0)=0;
+      wf(p,e).cvals(0,0)=u;
     }
   }
-  //Here we calculate the wave function for each of the electrons going to the 
-  //test position
-  for(int e=0; e< nelectrons; e++) { 
-    int s=0;
-    if( e >= nup ) s=1;
-    wf(e).Resize(1,1);
-    
-    doublevar old_eval=0,new_eval=0;
-    for(int i=0; i< e; i++) old_eval+=two_body_save(i,e,0);
-    for(int j=e+1; j< nelectrons; j++) old_eval+=two_body_save(e,j,0);
-    for(int i=0; i< e; i++) new_eval+=newval_ee(s)(i);
-    for(int j=e+1; j< nelectrons; j++) new_eval+=newval_ee(s)(j);
-    doublevar u=u_twobody+u_one //original
-      +new_eval-old_eval+newval_ei-one_body_save(e,0);//updates
-    wf(e).amp(0,0)=u;
-    wf(e).phase(0,0)=0;
-    wf(e).cvals(0,0)=u;
-  }
-  
 }
 //--------------------------------------------------------------------------
 void create_parm_deriv(const Array3 <doublevar> & func,
@@ -27,6 +27,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "Jastrow2_two.h"
 #include "Jastrow2_three.h"
 #include "Jastrow2_three_diffspin.h"
+#include "Jastrow2_spline.h"
+#include "Jastrow2_kspace.h"
 
 #include "Wavefunction.h"
 #include "Wavefunction_data.h"
@@ -34,6 +36,15 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 //######################################################################
 
+#ifndef NDEBUG
+//! Rows of electron-ion basis functions evaluated for groups that have
+//! them all in SPLINE tables.  Only debug builds keep count, one per
+//! thread; the updates should leave it alone (see Test_method).
+extern long int spline_eibasis_rows;
+#ifdef _OPENMP
+#pragma omp threadprivate(spline_eibasis_rows)
+#endif
+#endif
 
 /*!
 
@@ -43,8 +54,11 @@ public:
   Jastrow_group() {
     has_one_body=0;
     has_two_body=0;
+    has_kspace=0;
     two_body=NULL;
-
+    use_spline=0;
+    spline_one_body=spline_two_body=0;
+    radial_two_body=0;
   }
 
   ~Jastrow_group() {
@@ -63,6 +77,9 @@ public:
   void set_up(vector <string> & words, System * sys);
   void updateEIBasis(int e, Sample_point * sample, Array3 <doublevar> & );
   void updateEEBasis(int e, Sample_point * sample, Array3 <doublevar> & );
+  //! From a row of distances, as from Sample_point::getVirtualRows()
+  void updateEIBasis(const Distance_row & row, Array3 <doublevar> & );
+  void updateEEBasis(int e, const Distance_row & row, Array3 <doublevar> & );
 
   int maxEIBasis() { return maxbasis_on_center; }
   int nEEBasis() { return n_eebasis; }
@@ -71,11 +88,43 @@ public:
   int hasTwoBody() { return has_two_body; }
   int hasThreeBody() { return has_three_body; } 
   int hasThreeBodySpin() { return has_three_body_diffspin; } 
+  int hasKspace() { return has_kspace; }
   int optimizeBasis() { return optimize_basis; }
+
+  /*!
+    Whether the one-body term is evaluated from the splines (SPLINE)
+    instead of the basis functions.  The parameter derivatives always
+    use the basis functions.
+  */
+  int splineOneBody() { return spline_one_body; }
+  /*!
+    Whether the two-body term is evaluated over the whole row of
+    distances by twoBodyRowVal() and twoBodyRowLap(), from the splines
+    or from radial basis functions, instead of from updateEEBasis().
+    The three-body terms still need updateEEBasis(), so without the
+    splines there is no gain in that case.
+  */
+  int rowTwoBody() { return spline_two_body || (radial_two_body && !has_three_body
+                                               && !has_three_body_diffspin); }
+  //! The one-body value of electron e, added to val
+  void oneBodySplineVal(int e, Sample_point * sample, doublevar & val);
+  void oneBodySplineVal(const Distance_row & row, doublevar & val);
+  /*!
+    The one-body value, gradient, and Laplacian of electron e, added to
+    lap(valgradlap); if ion_lap isn't NULL, also added to (*ion_lap)(e,ion,valgradlap)
+  */
+  void oneBodySplineLap(int e, Sample_point * sample, Array1 <doublevar> & lap,
+                        Array3 <doublevar> * ion_lap);
+  //! The two-body values of the pairs with e, added to val(electron)
+  void twoBodyRowVal(int e, Sample_point * sample, Array1 <doublevar> & val);
+  void twoBodyRowVal(int e, const Distance_row & row, Array1 <doublevar> & val);
+  //! As Jastrow_twobody_piece::updateLap(), with lap(electron,valgradlap)
+  void twoBodyRowLap(int e, Sample_point * sample, Array2 <doublevar> & lap);
   Jastrow_onebody_piece one_body;
   Jastrow_twobody_piece * two_body;
   Jastrow_threebody_piece three_body;
   Jastrow_threebody_piece_diffspin three_body_diffspin;
+  Jastrow_kspace_piece kspace;
 
   int writeinput(string &, ostream &);
   int showinfo(string &, ostream &);
@@ -91,12 +140,14 @@ public:
 
 private:
   int check_consistency();
+  void updateTables();
   vector <string> atomnames;
   
   int has_one_body;
   int has_two_body;
   int has_three_body;
   int has_three_body_diffspin;
+  int has_kspace;
   int optimize_basis;
   int have_diffspin;
   //Stuff to handle the electron-ion basis
@@ -120,6 +171,28 @@ private:
   int nelectrons;
   int n_spin_up;
 
+  //Tabulated one- and two-body terms
+  int use_spline;
+  doublevar spline_spacing;
+  int spline_one_body, spline_two_body;
+  Array1 <Jastrow_spline> ei_spline; //!< one-body term for each kind of atom
+  Array1 < Array1 <int> > kind_atoms; //!< the atoms of each kind
+  Array1 <Jastrow_spline> ee_spline; //!< pair function for each spin channel
+  //!Scratch for each thread: (r, u, g, l) over the electrons or atoms
+  Array1 < Array2 <doublevar> > thread_spline;
+
+  //!updateEIBasis() and updateEEBasis() scratch for each thread
+  Array1 < Array1 <doublevar> > thread_R;
+  Array1 < Array2 <doublevar> > thread_lap;
+
+  //Two-body row kernel with the basis functions
+  int radial_two_body; //!< all the EE basis functions with coefficients are radial
+  Array2 <doublevar> ee_coeff; //!< (spin channel, function) coefficients of the two-body term
+  Array1 <doublevar> eebasis_cutoff; //!< cutoff of each EE basis object
+  //!Scratch for each thread: the partners in range, and their distances,
+  //!sums, and basis values
+  Array1 < Array1 <int> > thread_partners;
+  Array1 < Array1 <doublevar> > thread_eerow;
 };
 
 //######################################################################
@@ -197,6 +270,10 @@ public:
 
   virtual void getDensity(Wavefunction_data *,int,  Array2 <doublevar> &);
   virtual void evalTestPos(Array1 <doublevar> & pos, Sample_point * sample,Array1 <Wf_return> & wf);
+  virtual void evalTestPositions(Wavefunction_data *, Sample_point *,
+                                 Array2 <doublevar> & pos, Array2 <Wf_return> & wf);
+  virtual void evalVirtualMoves(Wavefunction_data *, Sample_point *, int e,
+                                Array2 <doublevar> & pos, Array1 <Wf_return> & vals);
   
 
 
@@ -207,6 +284,10 @@ public:
   virtual void saveUpdate(Sample_point *, int e1, int e2, Wavefunction_storage *);
   virtual void restoreUpdate(Sample_point *, int e1, int e2, Wavefunction_storage *);
 
+  virtual void proposeMove(Wavefunction_data *, Sample_point *, int e, Wf_return &);
+  virtual void acceptMove(Wavefunction_data *, Sample_point *, int e);
+  virtual void rejectMove(Wavefunction_data *, Sample_point *, int e);
+
   virtual void storeParmIndVal(Wavefunction_data *, Sample_point *,
                                int, Array1 <doublevar> & );
   virtual void getParmDepVal(Wavefunction_data *,
@@ -281,9 +362,48 @@ private:
 
   Array1 <  Array4 <doublevar> > eibasis_save; 
   //!< first array is group, 4d array is (electron, ion, basis#, valgradlap)
+  Array1 <Jastrow_ei_neighbors> ei_near;
+  //!< (group) the electrons near each ion, for the three-body terms
+  void storeEIRow(int g, int e, const Array3 <doublevar> & eibasis);
+
+  void calcLapRow(int e, Sample_point * sample, Array1 <doublevar> & newlap_ei,
+                  Array2 <doublevar> & newlap_ee, Array3 <doublevar> & newlap_eei);
+  void storeLapRow(int e, Array1 <doublevar> & newlap_ei,
+                   Array2 <doublevar> & newlap_ee, Array3 <doublevar> & newlap_eei);
+
+  //Workspaces for updateVal(), updateLap(), and calcLapRow(), sized in
+  //init() so that the updates don't allocate
+  Array3 <doublevar> work_eibasis; //!< (ion, basis#, valgradlap)
+  Array3 <doublevar> work_eebasis; //!< (electron, basis#, valgradlap)
+  Array1 <doublevar> work_val;
+  Array1 <doublevar> work_ei;
+  Array2 <doublevar> work_ee;
+  Array3 <doublevar> work_eei;
+  //! e's distances at a position of evalVirtualMoves(), in row 0 of each
+  Distance_table virtual_ee, virtual_ei;
+  Array1 <doublevar> virtual_pos;
+
+  //Terms for a proposed move, as from calcLapRow
+  Array1 <doublevar> proposal_ei;
+  Array2 <doublevar> proposal_ee;
+  Array3 <doublevar> proposal_eei;
+  Array1 < Array3 <doublevar> > proposal_eibasis;
+  //!< rows of eibasis_save before the proposal (group)(ion, basis#, valgradlap)
   
 
 
+  //The k-space terms, which are read straight from the sample's
+  //Structure_factor, so they're kept only as a total
+  int nkspace; //!< largest number of k-points used by a group; 0 if none
+  const Structure_factor * kspace_sf; //!< as of the last update
+  doublevar u_kspace; //!< total value of the k-space terms
+  doublevar proposal_kspace; //!< u_kspace for a proposed move
+  Array1 <doublevar> work_klap; //!< (valgradlap)
+  Array2 <doublevar> work_kphase; //!< ([cos sin], k)
+  void updateKspace(Sample_point * sample);
+  void kspacePhases(const Array1 <doublevar> & r);
+  void kspaceLap(int e, Array1 <doublevar> & lap);
+
   //These are for backflow, which needs per-ion information
   int keep_ion_dependent;
   Array3 <doublevar> one_body_ion;
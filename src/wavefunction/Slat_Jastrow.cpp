@@ -122,6 +122,28 @@ void Slat_Jastrow::getVal(Wavefunction_data * wfdata,
 }
 
 
+void Slat_Jastrow::evalVirtualMoves(Wavefunction_data * wfdata, Sample_point * sample,
+    int e, Array2 <doublevar> & pos, Array1 <Wf_return> & vals) { 
+  Slat_Jastrow_data * dataptr;
+  recast(wfdata, dataptr);
+  Array1 <Wf_return> slat_val,jast_val;
+  slater_wf->evalVirtualMoves(dataptr->slater,sample,e,pos,slat_val);
+  jastrow_wf->evalVirtualMoves(dataptr->jastrow,sample,e,pos,jast_val);
+  int n=pos.GetDim(0);
+  vals.Resize(n);
+  for(int i=0; i< n; i++) { 
+    vals(i).Resize(nfunc_,2);
+    if ( slat_val(i).is_complex==1 || jast_val(i).is_complex==1 )
+      vals(i).is_complex=1;
+    for(int j=0; j< nfunc_; j++) { 
+      //a Jastrow factor has a single function, common to all of them
+      int jj=j < jast_val(i).amp.GetDim(0) ? j : 0;
+      vals(i).phase(j,0)=slat_val(i).phase(j,0)+jast_val(i).phase(jj,0); 
+      vals(i).amp(j,0)=slat_val(i).amp(j,0)+jast_val(i).amp(jj,0);
+    }
+  }
+}
+
 void Slat_Jastrow::evalTestPos(Array1 <doublevar> & pos, Sample_point * sample,Array1 <Wf_return> & wf) {
   Array1 <Wf_return> slat_val,jast_val;
   slater_wf->evalTestPos(pos,sample,slat_val);
@@ -144,6 +166,33 @@ void Slat_Jastrow::evalTestPos(Array1 <doublevar> & pos, Sample_point * sample,A
 
 
 
+void Slat_Jastrow::evalTestPositions(Wavefunction_data * wfdata, Sample_point * sample,
+    Array2 <doublevar> & pos, Array2 <Wf_return> & wf) { 
+  Slat_Jastrow_data * dataptr;
+  recast(wfdata, dataptr);
+  Array2 <Wf_return> slat_val,jast_val;
+  slater_wf->evalTestPositions(dataptr->slater,sample,pos,slat_val);
+  jastrow_wf->evalTestPositions(dataptr->jastrow,sample,pos,jast_val);
+  int npts=slat_val.GetDim(0);
+  int n=slat_val.GetDim(1);
+  wf.Resize(npts,n);
+  for(int p=0; p< npts; p++) { 
+    for(int i=0; i< n; i++) { 
+      Wf_return & sv=slat_val(p,i);
+      Wf_return & jv=jast_val(p,i);
+      wf(p,i).Resize(nfunc_,2);
+      if ( sv.is_complex==1 || jv.is_complex==1 )
+        wf(p,i).is_complex=1;
+      for(int j=0; j< nfunc_; j++) { 
+        int jj=j < jv.amp.GetDim(0) ? j : 0;
+        wf(p,i).phase(j,0)=sv.phase(j,0)+jv.phase(jj,0); 
+        wf(p,i).amp(j,0)=sv.amp(j,0)+jv.amp(jj,0);  //add the logarithm
+      }
+    }
+  }
+}
+
+
 void Slat_Jastrow::getSymmetricVal(Wavefunction_data * wfdata,
 			     int e, Wf_return & val){
 
@@ -496,7 +545,13 @@ void Slat_Jastrow::getLap(Wavefunction_data * wfdata, int e,
 
   slater_wf->getLap(dataptr->slater, e, slat_lap);
   jastrow_wf->getLap(dataptr->jastrow, e, jast_lap);
+  multiplyLap(slat_lap,jast_lap,lap);
+}
+
+//----------------------------------------------------------------------
 
+void Slat_Jastrow::multiplyLap(Wf_return & slat_lap, Wf_return & jast_lap, 
+                               Wf_return & lap) { 
   if ( slat_lap.is_complex==1 || jast_lap.is_complex==1 )
     lap.is_complex=1;
 
@@ -528,6 +583,49 @@ void Slat_Jastrow::getLap(Wavefunction_data * wfdata, int e,
 }
 
 
+//----------------------------------------------------------------------
+
+void Slat_Jastrow::proposeMove(Wavefunction_data * wfdata, Sample_point * sample,
+                               int e, Wf_return & lap) { 
+  Slat_Jastrow_data * dataptr;
+  recast(wfdata, dataptr);
+  Wf_return slat_lap(nfunc_,5);
+  Wf_return jast_lap(nfunc_,5);
+  slater_wf->proposeMove(dataptr->slater, sample, e, slat_lap);
+  jastrow_wf->proposeMove(dataptr->jastrow, sample, e, jast_lap);
+  multiplyLap(slat_lap,jast_lap,lap);
+}
+
+void Slat_Jastrow::acceptMove(Wavefunction_data * wfdata, Sample_point * sample, int e) { 
+  Slat_Jastrow_data * dataptr;
+  recast(wfdata, dataptr);
+  slater_wf->acceptMove(dataptr->slater, sample, e);
+  jastrow_wf->acceptMove(dataptr->jastrow, sample, e);
+}
+
+void Slat_Jastrow::rejectMove(Wavefunction_data * wfdata, Sample_point * sample, int e) { 
+  Slat_Jastrow_data * dataptr;
+  recast(wfdata, dataptr);
+  slater_wf->rejectMove(dataptr->slater, sample, e);
+  jastrow_wf->rejectMove(dataptr->jastrow, sample, e);
+}
+
+void Slat_Jastrow::prepareCrowdMove(Wavefunction_data * wfdata, Array1 <Wavefunction *> & wfs,
+                                    Array1 <Sample_point *> & samples, int e) { 
+  Slat_Jastrow_data * dataptr;
+  recast(wfdata, dataptr);
+  int nw=wfs.GetDim(0);
+  Array1 <Wavefunction *> slat(nw), jast(nw);
+  for(int w=0; w< nw; w++) { 
+    Slat_Jastrow * other;
+    recast(wfs(w), other);
+    slat(w)=other->slater_wf;
+    jast(w)=other->jastrow_wf;
+  }
+  slater_wf->prepareCrowdMove(dataptr->slater, slat, samples, e);
+  jastrow_wf->prepareCrowdMove(dataptr->jastrow, jast, samples, e);
+}
+
 //----------------------------------------------------------------------
 
 void Slat_Jastrow::updateVal(Wavefunction_data * wfdata, Sample_point * sample)
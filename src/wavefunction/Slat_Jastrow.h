@@ -87,6 +87,10 @@ public:
 
   virtual void getDensity(Wavefunction_data *,int,  Array2 <doublevar> &);
   virtual void evalTestPos(Array1 <doublevar> & pos, Sample_point * sample,Array1 <Wf_return> & wf);
+  virtual void evalTestPositions(Wavefunction_data *, Sample_point *,
+                                 Array2 <doublevar> & pos, Array2 <Wf_return> & wf);
+  virtual void evalVirtualMoves(Wavefunction_data *, Sample_point *, int e,
+                                Array2 <doublevar> & pos, Array1 <Wf_return> & vals);
   
 
   virtual void generateStorage(Wavefunction_storage * & wfstore);
@@ -97,6 +101,12 @@ public:
   virtual void saveUpdate(Sample_point *, int e1, int e2, Wavefunction_storage *);
   virtual void restoreUpdate(Sample_point *, int e1, int e2, Wavefunction_storage *);
 
+  virtual void proposeMove(Wavefunction_data *, Sample_point *, int e, Wf_return &);
+  virtual void acceptMove(Wavefunction_data *, Sample_point *, int e);
+  virtual void rejectMove(Wavefunction_data *, Sample_point *, int e);
+  virtual void prepareCrowdMove(Wavefunction_data *, Array1 <Wavefunction *> & wfs,
+                                Array1 <Sample_point *> & samples, int e);
+
   virtual void storeParmIndVal(Wavefunction_data *, Sample_point *,
                                int, Array1 <doublevar> & );
   virtual void getParmDepVal(Wavefunction_data *,
@@ -119,6 +129,7 @@ public:
 			       string );
 
 private:
+  void multiplyLap(Wf_return & slat_lap, Wf_return & jast_lap, Wf_return & lap);
   friend class Slat_Jastrow_data;
   Wavefunction * slater_wf;
   Wavefunction * jastrow_wf;
@@ -28,6 +28,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "MatrixAlgebra.h"
 #include "MO_matrix.h"
 #include "clark_updates.h"
+#include "delayed_updates.h"
 class Wavefunction_data;
 class Slat_wf_data;
 class System;
@@ -51,6 +52,13 @@ private:
  
   Array3 < Array2 <T> > inverse_temp;
   Array3 <log_value<T> > detVal_temp;
+  
+  //for delayed updates, only the pending columns are saved
+  Array3 < Delayed_update <T> > delay_temp;
+  int delay_generation;
+
+  Array1 <int> nonzero_temp; //!< the nonzero orbitals of the saved electron
+  int nnonzero_temp;
 
 };
 
@@ -67,7 +75,10 @@ template <class T> class Slat_wf : public  Wavefunction
 public:
 
   Slat_wf()
-  {}
+  { proposal_store=NULL; crowd_prefetched=-1; }
+
+  ~Slat_wf()
+  { if(proposal_store) delete proposal_store; }
 
 
   virtual int nfunc() {
@@ -83,6 +94,10 @@ public:
   virtual void getVal(Wavefunction_data *, int, Wf_return &);
   virtual void getLap(Wavefunction_data *, int, Wf_return &);
   virtual void evalTestPos(Array1 <doublevar> & pos, Sample_point *, Array1 <Wf_return> & wf);
+  virtual void evalTestPositions(Wavefunction_data *, Sample_point *,
+                                 Array2 <doublevar> & pos, Array2 <Wf_return> & wf);
+  virtual void evalVirtualMoves(Wavefunction_data *, Sample_point *, int e,
+                                Array2 <doublevar> & pos, Array1 <Wf_return> & vals);
   virtual void getDensity(Wavefunction_data *,int, Array2 <doublevar> &);
 
   virtual void saveUpdate(Sample_point *, int e, Wavefunction_storage *);
@@ -91,6 +106,12 @@ public:
   // Added by Matous
   virtual void saveUpdate(Sample_point *, int e1, int e2, Wavefunction_storage *);
   virtual void restoreUpdate(Sample_point *, int e1, int e2, Wavefunction_storage *);
+
+  virtual void proposeMove(Wavefunction_data *, Sample_point *, int e, Wf_return &);
+  virtual void acceptMove(Wavefunction_data *, Sample_point *, int e);
+  virtual void rejectMove(Wavefunction_data *, Sample_point *, int e);
+  virtual void prepareCrowdMove(Wavefunction_data *, Array1 <Wavefunction *> & wfs,
+                                Array1 <Sample_point *> & samples, int e);
   
   virtual void storeParmIndVal(Wavefunction_data *, Sample_point *,
                                int, Array1 <doublevar> & );
@@ -120,14 +141,28 @@ private:
   void save_for_static();
 
   void updateInverse(Slat_wf_data *, int e);
+  void inverseRow(int f, int det, int s, int e, Array1 <T> & row); 
+  //!< row e (within spin s) of the inverse, including any delayed updates
+  void flushDelayed(int s);
+  void recalcInverse(int s);
   int updateValNoInverse(Slat_wf_data *, int e); 
   //!< update the value, but not the inverse.  Returns 0 if the determinant is zero and updates aren't possible
+  int sparseRow(int e) { 
+    return nnonzero(e) >= 0 && !parent->use_clark_updates;
+  }
+  //!< whether the row of electron e can be treated as sparse
+  T sparseDot(int f, int det, int s, const Array1 <int> & nz, int nnz,
+              const T * orb, int stride, const T * invrow);
+  //!< sum over the columns of (f,det,s) of orb[orbital*stride]*invrow[column], for the nnz orbitals in nz
+  int sparseColumns(int f, int det, int s, int e);
+  //!< the columns of (f,det,s) in which electron e's row is nonzero, into sparse_cols
   
   void calcVal(Slat_wf_data *, Sample_point *);
   void updateVal(Slat_wf_data *, Sample_point *, int);
   void calcLap(Slat_wf_data *, Sample_point *);
   void updateLap(Slat_wf_data *, Sample_point *, int);
   void getDetLap(int e, Array3<log_value <T> > & vals );
+  void sumDetLap(Array3<log_value <T> > & detvals, Array2 <log_value <T> > & vals);
   
 
   Array1 <int> electronIsStaleVal;
@@ -152,6 +187,27 @@ private:
   Array3 < Array2 <T> > inverse;
   //!<inverse of the value part of the mo_values array transposed
 
+  int delayed; //!< whether we're delaying the inverse updates
+  Array3 < Delayed_update <T> > delay; //!< pending columns for each inverse
+  int delay_generation; //!< counts the changes to inverse while delaying
+  Array2 <T> invrows; //!< rows of the inverse for getDetLap
+
+  //Sparse rows, when the MO matrix knows which orbitals are nonzero
+  Array1 < Array1 <int> > nonzero; //!< the orbitals that can be nonzero for each electron
+  Array1 <int> nnonzero; //!< how many there are, or -1 if any orbital can be
+  Array1 <int> proposed_nonzero; //!< the same for proposedMoVal
+  int proposed_nnonzero;
+  Array3 < Array1 <int> > orbital_column; 
+  //!< (f,det,s)(orbital): the column of the orbital in the determinant, or -1
+  Array1 <int> sparse_cols; //!< scratch for sparseColumns()
+  Array1 <T> sparse_work; //!< scratch for InverseUpdateColumnSparse()
+
+  //Move proposals
+  Array2 <T> proposedMoVal; //!< (mo, [val grad lap]) at the trial position
+  int proposal_saved; //!< whether the proposal fell back to a full update
+  Wavefunction_storage * proposal_store; //!< the state before a fallback update
+  int crowd_prefetched; //!< electron whose proposedMoVal prepareCrowdMove() filled, or -1
+
   Array3 <log_value<T> > detVal; //function #, determinant #, spin
 
   //Variables for a static(electrons not moving) calculation
@@ -214,6 +270,8 @@ inline void Slat_wf<T>::generateStorage(Wavefunction_storage * & wfstore)
 
   store->detVal_temp.Resize(nfunc_, ndet, 2);
   store->inverse_temp.Resize(nfunc_, ndet, 2);
+  store->nonzero_temp.Resize(nmo);
+  store->nnonzero_temp=-1;
   for(int i=0; i< nfunc_; i++)
   {
     for(int det=0; det < ndet; det++)
@@ -226,6 +284,13 @@ inline void Slat_wf<T>::generateStorage(Wavefunction_storage * & wfstore)
       }
     }
   }
+  if(delayed) { 
+    store->delay_temp.Resize(nfunc_, ndet, 2);
+    for(int i=0; i< nfunc_; i++) 
+      for(int det=0; det < ndet; det++) 
+        for(int s=0; s< 2; s++) 
+          store->delay_temp(i,det,s).init(parent->delay_depth,nelectrons(s));
+  }
 }
 
 
@@ -273,6 +338,38 @@ template <class T> inline void Slat_wf<T>::init(Wavefunction_data * wfdata,
   }
 
 
+  nonzero.Resize(tote);
+  nnonzero.Resize(tote);
+  for(int e=0; e< tote; e++) nonzero(e).Resize(nmo);
+  nnonzero=-1;
+  proposed_nonzero.Resize(nmo);
+  proposed_nnonzero=-1;
+  sparse_cols.Resize(max(nelectrons(0),nelectrons(1)));
+  orbital_column.Resize(nfunc_, ndet, 2);
+  for(int f=0; f< nfunc_; f++) {
+    for(int det=0; det < ndet; det++) {
+      for(int s=0; s<2; s++) {
+        Array1 <int> & column(orbital_column(f,det,s));
+        column.Resize(nmo);
+        column=-1;
+        for(int i=0; i< nelectrons(s); i++) 
+          column(dataptr->occupation(f,det,s)(i))=i;
+      }
+    }
+  }
+
+  delayed=dataptr->delay_depth > 1;
+  delay_generation=0;
+  proposedMoVal.Resize(nmo,5);
+  proposal_saved=0;
+  if(delayed) { 
+    delay.Resize(nfunc_, ndet, 2);
+    for(int i=0; i< nfunc_; i++) 
+      for(int det=0; det < ndet; det++) 
+        for(int s=0; s< 2; s++) 
+          delay(i,det,s).init(dataptr->delay_depth, nelectrons(s));
+  }
+
   electronIsStaleVal.Resize(tote);
   electronIsStaleLap.Resize(tote);
 
@@ -298,6 +395,7 @@ regular update functions will not work in this case.
 */
 template<class T> inline void Slat_wf<T>::notify(change_type change, int num)
 {
+  crowd_prefetched=-1;
   switch(change)
   {
   case electron_move:
@@ -391,13 +489,27 @@ template<class T>inline void Slat_wf<T>::saveUpdate(Sample_point * sample, int e
     int ndet_save=ndet;
     if(parent->use_clark_updates) ndet_save=1;
     for(int f=0; f< nfunc_; f++) {
-      for(int det=0; det<ndet_save; det++) {
-        store->inverse_temp(f,det,s)=inverse(f,det,s);
+      if(delayed) { 
+        //make room for this move, so the inverse itself won't change
+        //until it's accepted.
+        for(int det=0; det< ndet; det++) { 
+          if(delay(f,det,s).full()) { 
+            delay(f,det,s).flush(inverse(f,det,s));
+            delay_generation++;
+          }
+          store->delay_temp(f,det,s).copyState(delay(f,det,s));
+        }
+      }
+      else { 
+        for(int det=0; det<ndet_save; det++) {
+          store->inverse_temp(f,det,s)=inverse(f,det,s);
+        }
       }
       for(int det=0; det < ndet; det++) { 
         store->detVal_temp(f,det,s)=detVal(f,det,s);
       }
     }
+    store->delay_generation=delay_generation;
 
 
     int norb=moVal.GetDim(2);
@@ -406,6 +518,9 @@ template<class T>inline void Slat_wf<T>::saveUpdate(Sample_point * sample, int e
         store->moVal_temp(d,i)=moVal(d,e,i);
       }
     }
+    store->nnonzero_temp=nnonzero(e);
+    for(int k=0; k< nnonzero(e); k++) 
+      store->nonzero_temp(k)=nonzero(e)(k);
   }
 
 
@@ -428,17 +543,32 @@ template<class T>inline void Slat_wf<T>::restoreUpdate(Sample_point * sample, in
         moVal(j,e,i)=store->moVal_temp(j,i);
       }
     }
+    nnonzero(e)=store->nnonzero_temp;
+    for(int k=0; k< nnonzero(e); k++) 
+      nonzero(e)(k)=store->nonzero_temp(k);
     int ndet_save=ndet;
     if(parent->use_clark_updates) ndet_save=1;
     
     for(int f=0; f< nfunc_; f++) {
-      for(int det=0; det < ndet_save; det++) {
-        inverse(f,det,s)=store->inverse_temp(f,det,s);
+      if(delayed) { 
+        if(store->delay_generation==delay_generation) {
+          for(int det=0; det < ndet; det++) 
+            delay(f,det,s).copyState(store->delay_temp(f,det,s));
+        }
+      }
+      else { 
+        for(int det=0; det < ndet_save; det++) {
+          inverse(f,det,s)=store->inverse_temp(f,det,s);
+        }
       }
       for(int det=0; det < ndet; det++) { 
         detVal(f,det,s)=store->detVal_temp(f,det,s);
       }
     }
+    //The inverse was changed after the save (rare), so the saved
+    //columns don't apply any more.  Start over from the orbitals.
+    if(delayed && store->delay_generation!=delay_generation) 
+      recalcInverse(s);
     //It seems to be faster to update the inverse than to save it and
     //recover it.  However, it complicates the implementation too much.
     //For now, we'll disable it.
@@ -470,6 +600,10 @@ template <class T>inline void Slat_wf<T>::saveUpdate(Sample_point * sample, int
     }
     
     int s1=spin(e1), s2=spin(e2);
+    if(delayed) { 
+      flushDelayed(s1);
+      flushDelayed(s2);
+    }
 
     for(int f=0; f< nfunc_; f++) {
       for(int det=0; det<ndet; det++) {
@@ -518,6 +652,9 @@ template<class T> inline void Slat_wf<T>::restoreUpdate(Sample_point * sample, i
         moVal(j,e2,i)=store->moVal_temp_2(j,i);
       }
     }
+    //only one list of nonzero orbitals is saved, so use the dense rows
+    nnonzero(e1)=-1;
+    nnonzero(e2)=-1;
     for(int f=0; f< nfunc_; f++) {
       for(int det=0; det < ndet; det++) {
 	      if ( s1 == s2 ) {
@@ -530,8 +667,13 @@ template<class T> inline void Slat_wf<T>::restoreUpdate(Sample_point * sample, i
 		      detVal(f,det,s1)=store->detVal_temp(f,det,s1);
 		      detVal(f,det,s2)=store->detVal_temp(f,det,s2);
 	      }
+	      if(delayed) { 
+	        delay(f,det,s1).clear();
+	        delay(f,det,s2).clear();
+	      }
       }
     }
+    if(delayed) delay_generation++;
 
     electronIsStaleVal(e1)=0;
     electronIsStaleLap(e1)=0;
@@ -697,6 +839,10 @@ template <> inline int Slat_wf<doublevar>::getParmDeriv(Wavefunction_data *  wfd
     updateInverse(parent, lastValUpdate);
     inverseStale=0;
   }
+  if(delayed) { 
+    flushDelayed(0);
+    flushDelayed(1);
+  }
   
   //int nparms_full=parent->nparms();
   int nparms_start=derivatives.nparms_start;
@@ -1008,6 +1154,10 @@ template <class T>inline void Slat_wf<T>::updateInverse(Slat_wf_data * dataptr,
 
         detVal(f,det,s)=
           TransposeInverseMatrix(allmos,inverse(f,det,s), nelectrons(s));
+        if(delayed) { 
+          delay(f,det,s).clear();
+          delay_generation++;
+        }
 #ifdef SUPERDEBUG
         cout << "Slat_wf::updateInverse: near-zero determinant " 
           << " f " << f << " det " << det << " new det " << detVal(f,det,s).logval
@@ -1021,9 +1171,28 @@ template <class T>inline void Slat_wf<T>::updateInverse(Slat_wf_data * dataptr,
         for(int i = 0; i < nelectrons(s); i++) {
           modet(i)=moVal(0,e,dataptr->occupation(f,det,s)(i));
         }
-        T ratio=1./InverseUpdateColumn(inverse(f,det,s),
-            modet, dataptr->rede(e),
-            nelectrons(s));
+        T ratio;
+        if(delayed) { 
+          Delayed_update<T> & d=delay(f,det,s);
+          int c=dataptr->rede(e);
+          if(d.slot(c) < 0 && d.full()) { 
+            d.flush(inverse(f,det,s));
+            delay_generation++;
+          }
+          ratio=d.ratio(inverse(f,det,s),c,modet);
+          d.accept(inverse(f,det,s),c,modet);
+        }
+        else if(sparseRow(e)) { 
+          int ncols=sparseColumns(f,det,s,e);
+          ratio=1./InverseUpdateColumnSparse(inverse(f,det,s),
+              modet, sparse_cols, ncols, dataptr->rede(e),
+              nelectrons(s), sparse_work);
+        }
+        else { 
+          ratio=1./InverseUpdateColumn(inverse(f,det,s),
+              modet, dataptr->rede(e),
+              nelectrons(s));
+        }
 
         detVal(f,det, s)=ratio*detVal(f,det, s);
       }
@@ -1051,6 +1220,77 @@ template <class T>inline void Slat_wf<T>::updateInverse(Slat_wf_data * dataptr,
 
 //------------------------------------------------------------------------
 
+template <class T> inline T Slat_wf<T>::sparseDot(int f, int det, int s, 
+    const Array1 <int> & nz, int nnz, const T * orb, int stride, 
+    const T * invrow) { 
+  const Array1 <int> & column(orbital_column(f,det,s));
+  T sum=T(0.0);
+  for(int k=0; k< nnz; k++) { 
+    int c=column(nz(k));
+    if(c >= 0) sum+=orb[nz(k)*stride]*invrow[c];
+  }
+  return sum;
+}
+
+template <class T> inline int Slat_wf<T>::sparseColumns(int f, int det, 
+    int s, int e) { 
+  const Array1 <int> & column(orbital_column(f,det,s));
+  int ncols=0;
+  for(int k=0; k< nnonzero(e); k++) { 
+    int c=column(nonzero(e)(k));
+    if(c >= 0) sparse_cols(ncols++)=c;
+  }
+  return ncols;
+}
+
+//------------------------------------------------------------------------
+
+template <class T> inline void Slat_wf<T>::inverseRow(int f, int det, int s, int e, 
+                                                    Array1 <T> & row) { 
+  if(delayed) { 
+    delay(f,det,s).currentRow(inverse(f,det,s),e,row);
+  }
+  else { 
+    row.Resize(nelectrons(s));
+    for(int j=0; j< nelectrons(s); j++) row(j)=inverse(f,det,s)(e,j);
+  }
+}
+
+//------------------------------------------------------------------------
+
+template <class T> inline void Slat_wf<T>::flushDelayed(int s) { 
+  for(int f=0; f< nfunc_; f++) { 
+    for(int det=0; det< ndet; det++) { 
+      if(delay(f,det,s).pending()) { 
+        delay(f,det,s).flush(inverse(f,det,s));
+        delay_generation++;
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+
+template <class T> inline void Slat_wf<T>::recalcInverse(int s) { 
+  int n=nelectrons(s);
+  if(n==0) return;
+  Array2 <T> allmos(n,n);
+  for(int f=0; f< nfunc_; f++) { 
+    for(int det=0; det< ndet; det++) { 
+      for(int e=0; e< n; e++) {
+        int curre=s*nelectrons(0)+e;
+        for(int i=0; i< n; i++) 
+          allmos(e,i)=moVal(0,curre, parent->occupation(f,det,s)(i));
+      }
+      TransposeInverseMatrix(allmos,inverse(f,det,s),n);
+      if(delayed) delay(f,det,s).clear();
+    }
+  }
+  delay_generation++;
+}
+
+//------------------------------------------------------------------------
+
 template <class T> inline int Slat_wf<T>::updateValNoInverse(Slat_wf_data * dataptr, int e) { 
   int maxmatsize=max(nelectrons(0),nelectrons(1));
   Array1 <T> modet(maxmatsize);
@@ -1073,9 +1313,16 @@ template <class T> inline int Slat_wf<T>::updateValNoInverse(Slat_wf_data * data
       }
       
       
-      T ratio=1./InverseGetNewRatio(inverse(f,det,s),
-                                            modet, dataptr->rede(e),
-                                            nelectrons(s));
+      T ratio;
+      if(delayed) 
+        ratio=delay(f,det,s).ratio(inverse(f,det,s),dataptr->rede(e),modet);
+      else if(sparseRow(e)) 
+        ratio=sparseDot(f,det,s,nonzero(e),nnonzero(e),&moVal(0,e,0),1,
+                        &inverse(f,det,s)(dataptr->rede(e),0));
+      else 
+        ratio=1./InverseGetNewRatio(inverse(f,det,s),
+                                    modet, dataptr->rede(e),
+                                    nelectrons(s));
 #ifdef SUPERDEBUG
       T tmpratio=InverseGetNewRatio(inverse(f,det,s),
                                             modet, dataptr->rede(e),
@@ -1115,6 +1362,7 @@ template <class T> inline void Slat_wf<T>::updateVal( Slat_wf_data * dataptr, Sa
   //update all the mo's that we will be using.
   molecorb->updateVal(sample, e, s,
                               updatedMoVal);
+  nnonzero(e)=molecorb->nonzeroOrbitals(nonzero(e));
 
   for(int i=0; i< updatedMoVal.GetDim(0); i++)
     moVal(0,e,i)=updatedMoVal(i,0);
@@ -1240,6 +1488,7 @@ template <class T> inline void Slat_wf<T>::calcLap(Slat_wf_data * dataptr, Sampl
     //cout << "mo_updatelap " << endl;
     molecorb->updateLap(sample, e, s,
                                 updatedMoVal);
+    nnonzero(e)=molecorb->nonzeroOrbitals(nonzero(e));
     //cout << "done " << endl;
     for(int d=0; d< 5; d++)  {
       for(int i=0; i< updatedMoVal.GetDim(0); i++) {
@@ -1281,9 +1530,11 @@ template <class T> inline void Slat_wf<T>::calcLap(Slat_wf_data * dataptr, Sampl
 #endif
         //if(f==0 && det==0 && s==0) matout << "determinant " << detVal(f,det,s) 
          //   << " should be " << modet(0,0)*modet(1,1)-modet(0,1)*modet(1,0) << endl;
+        if(delayed) delay(f,det,s).clear();
       }
     }
   }
+  if(delayed) delay_generation++;
   //cout << "done " << endl;
 }
 
@@ -1323,14 +1574,31 @@ template <class T> void Slat_wf<T>::getDetLap(int e, Array3<log_value <T> > &  v
     }
     log_value<T> totval=sum(detvals);
     
+    if(delayed) { 
+      Array1 <T> row;
+      invrows.Resize(ndet,nelectrons(s));
+      for(int det=0; det < ndet; det++) { 
+        inverseRow(f,det,s,parent->rede(e),row);
+        for(int j=0; j<nelectrons(s); j++) invrows(det,j)=row(j);
+      }
+    }
+    
     Array1 <log_value <T> > detgrads(ndet);
     for(int i=1; i< 5; i++) {
       if(!parent->use_clark_updates) {   //Sherman-Morrison updates
         for(int det=0; det < ndet; det++) {
           T temp=0;
-          for(int j=0; j<nelectrons(s); j++) {
-            temp+=moVal(i , e, parent->occupation(f,det,s)(j) )
-              *inverse(f,det,s)(parent->rede(e), j);
+          const T * invrow=delayed ? &invrows(det,0) 
+            : &inverse(f,det,s)(parent->rede(e),0);
+          if(sparseRow(e)) { 
+            temp=sparseDot(f,det,s,nonzero(e),nnonzero(e),&moVal(i,e,0),1,
+                           invrow);
+          }
+          else { 
+            for(int j=0; j<nelectrons(s); j++) {
+              temp+=moVal(i , e, parent->occupation(f,det,s)(j) )
+                *invrow[j];
+            }
           }
           detgrads(det)=temp; 
           detgrads(det)*=detVal(f,det,s);
@@ -1395,19 +1663,7 @@ template <class T> void Slat_wf<T>::getLap(Wavefunction_data * wfdata,
     recast(wfdata, dataptr);
     Array3 <log_value<T> > detvals;
     getDetLap(e,detvals);
-    Array1 <log_value<T> > tempsum(ndet);
-    for(int f=0; f< nfunc_; f++) {
-      for(int i=0; i< 5; i++) { 
-        for(int d=0;d < ndet; d++) { 
-          tempsum(d)=parent->detwt(d)*detvals(f,d,i);
-        }
-        vals(f,i)=sum(tempsum);
-      }
-      log_value<T> inv=vals(f,0);
-      inv.logval*=-1;
-      for(int i=1; i< 5; i++) vals(f,i)*=inv;
-    }
-      
+    sumDetLap(detvals,vals);
   }
   
   lap.setVals(vals);
@@ -1416,6 +1672,25 @@ template <class T> void Slat_wf<T>::getLap(Wavefunction_data * wfdata,
 
 //-------------------------------------------------------------------------
 
+//Weighted sum over determinants, normalizing the derivatives by the value
+template <class T> inline void Slat_wf<T>::sumDetLap(Array3<log_value <T> > & detvals, 
+                                                   Array2 <log_value <T> > & vals) { 
+  Array1 <log_value<T> > tempsum(ndet);
+  for(int f=0; f< nfunc_; f++) {
+    for(int i=0; i< 5; i++) { 
+      for(int d=0;d < ndet; d++) { 
+        tempsum(d)=parent->detwt(d)*detvals(f,d,i);
+      }
+      vals(f,i)=sum(tempsum);
+    }
+    log_value<T> inv=vals(f,0);
+    inv.logval*=-1;
+    for(int i=1; i< 5; i++) vals(f,i)*=inv;
+  }
+}
+
+//-------------------------------------------------------------------------
+
 /*!
 */
 template <class T> inline void Slat_wf<T>::updateLap(Slat_wf_data * dataptr,
@@ -1439,6 +1714,7 @@ template <class T> inline void Slat_wf<T>::updateLap(Slat_wf_data * dataptr,
 
   //update all the mo's that we will be using.
   molecorb->updateLap(sample,e,s,updatedMoVal);
+  nnonzero(e)=molecorb->nonzeroOrbitals(nonzero(e));
 
   for(int d=0; d< 5; d++)
     for(int i=0; i< updatedMoVal.GetDim(0); i++)
@@ -1449,6 +1725,216 @@ template <class T> inline void Slat_wf<T>::updateLap(Slat_wf_data * dataptr,
 
 //-------------------------------------------------------------------------
 
+/*!
+The new orbitals only enter through row rede(e) of the inverse, so the
+ratio and derivatives of each determinant are dot products with the
+current row; nothing is copied and the inverse is only touched if the
+move is accepted.
+*/
+template <class T> inline void Slat_wf<T>::proposeMove(Wavefunction_data * wfdata,
+    Sample_point * sample, int e, Wf_return & lap) { 
+  assert(!staticSample && !updateEverythingLap);
+  if(inverseStale) { 
+    detVal=lastDetVal;
+    updateInverse(parent, lastValUpdate);
+    inverseStale=0;
+  }
+  int s=spin(e);
+  int opp=parent->opspin(e);
+  int prefetched=(crowd_prefetched==e);
+  crowd_prefetched=-1;
+
+  //A zero determinant can't be updated by ratios, so do it the old way
+  proposal_saved=0;
+  for(int f=0; f< nfunc_; f++) { 
+    for(int det=0; det< ndet; det++) { 
+      if(real_qw(detVal(f,det,s).logval) < -1e200) proposal_saved=1;
+    }
+  }
+  if(proposal_saved) { 
+    if(!proposal_store) generateStorage(proposal_store);
+    saveUpdate(sample,e,proposal_store);
+    updateLap(wfdata,sample);
+    getLap(wfdata,e,lap);
+    return;
+  }
+
+  if(!prefetched) { 
+    sample->updateEIDist();
+    molecorb->updateLap(sample,e,s,proposedMoVal);
+    proposed_nnonzero=molecorb->nonzeroOrbitals(proposed_nonzero);
+  }
+  else proposed_nnonzero=-1;
+
+  Array3 <log_value<T> > detvals(nfunc_,ndet,5);
+  Array1 <T> row;
+  for(int f=0; f< nfunc_; f++) { 
+    for(int det=0; det< ndet; det++) { 
+      inverseRow(f,det,s,parent->rede(e),row);
+      //With the old row of the inverse, these are the new determinant
+      //and its derivatives, divided by the old determinant.
+      for(int i=0; i< 5; i++) { 
+        T temp=0;
+        if(proposed_nnonzero >= 0) 
+          temp=sparseDot(f,det,s,proposed_nonzero,proposed_nnonzero,
+                         &proposedMoVal(0,i),proposedMoVal.GetDim(1),row.v);
+        else { 
+          for(int j=0; j< nelectrons(s); j++) 
+            temp+=proposedMoVal(parent->occupation(f,det,s)(j),i)*row(j);
+        }
+        detvals(f,det,i)=temp;
+        detvals(f,det,i)*=detVal(f,det,s);
+        detvals(f,det,i)*=detVal(f,det,opp);
+      }
+    }
+  }
+  Array2 <log_value <T> > vals(nfunc_,5);
+  sumDetLap(detvals,vals);
+  lap.setVals(vals);
+}
+
+//-------------------------------------------------------------------------
+
+template <class T> inline void Slat_wf<T>::acceptMove(Wavefunction_data * wfdata,
+    Sample_point * sample, int e) { 
+  if(!proposal_saved) { 
+    for(int d=0; d< 5; d++)
+      for(int i=0; i< proposedMoVal.GetDim(0); i++)
+        moVal(d,e,i)=proposedMoVal(i,d);
+    nnonzero(e)=proposed_nnonzero;
+    for(int k=0; k< proposed_nnonzero; k++) 
+      nonzero(e)(k)=proposed_nonzero(k);
+    updateInverse(parent,e);
+  }
+  proposal_saved=0;
+  electronIsStaleVal(e)=0;
+  electronIsStaleLap(e)=0;
+}
+
+//-------------------------------------------------------------------------
+
+template <class T> inline void Slat_wf<T>::rejectMove(Wavefunction_data * wfdata,
+    Sample_point * sample, int e) { 
+  if(proposal_saved) 
+    restoreUpdate(sample,e,proposal_store);
+  proposal_saved=0;
+  electronIsStaleVal(e)=0;
+  electronIsStaleLap(e)=0;
+}
+
+//-------------------------------------------------------------------------
+
+/*!
+Fill proposedMoVal of every wave function in the crowd with one 
+updateLapCrowd() call; their proposeMove() then only does the ratios.
+*/
+template <class T> inline void Slat_wf<T>::prepareCrowdMove(Wavefunction_data * wfdata,
+    Array1 <Wavefunction *> & wfs, Array1 <Sample_point *> & samples, int e) { 
+  if(staticSample) return;
+  int nw=wfs.GetDim(0);
+  Array1 <Array2 <T> *> movals(nw);
+  for(int w=0; w< nw; w++) { 
+    Slat_wf<T> * other;
+    recast(wfs(w), other);
+    movals(w)=&other->proposedMoVal;
+  }
+  molecorb->updateLapCrowd(samples, e, spin(e), movals);
+  for(int w=0; w< nw; w++) { 
+    Slat_wf<T> * other;
+    recast(wfs(w), other);
+    other->crowd_prefetched=e;
+  }
+}
+
+//-------------------------------------------------------------------------
+
+/*!
+All the positions share one row of each inverse, so after evaluating the 
+orbitals at every position the ratios are a single matrix-vector product 
+per determinant.
+*/
+template <class T> inline void Slat_wf<T>::evalVirtualMoves(Wavefunction_data * wfdata,
+    Sample_point * sample, int e, Array2 <doublevar> & pos, Array1 <Wf_return> & vals) { 
+  int npts=pos.GetDim(0);
+  vals.Resize(npts);
+  for(int i=0; i< npts; i++) vals(i).Resize(nfunc_,1);
+
+  //the electrons don't move in a static calculation
+  if(staticSample==1 && parent->optimize_mo==0) { 
+    for(int i=0; i< npts; i++) getVal(wfdata,e,vals(i));
+    return;
+  }
+
+  updateVal(wfdata,sample);
+  if(inverseStale) { 
+    inverseStale=0;
+    detVal=lastDetVal;
+    updateInverse(parent, lastValUpdate);
+  }
+
+  int s=spin(e);
+  int opp=parent->opspin(e);
+  int n=nelectrons(s);
+  Array1 <doublevar> oldpos(ndim), newpos(ndim);
+  Array2 <T> onemo(nmo,1);
+  Array2 <T> & movals=work1;
+  movals.Resize(npts,nmo);
+  sample->getElectronPos(e,oldpos);
+  for(int i=0; i< npts; i++) { 
+    for(int d=0; d< ndim; d++) newpos(d)=pos(i,d);
+    sample->setElectronPosNoNotify(e,newpos);
+    sample->updateEIDist();
+    molecorb->updateVal(sample,e,s,onemo);
+    for(int j=0; j< nmo; j++) movals(i,j)=onemo(j,0);
+  }
+  sample->setElectronPosNoNotify(e,oldpos);
+  sample->updateEIDist();
+
+  Array2 <log_value<T> > newdet(ndet,npts);
+  Array1 <log_value<T> > detvals(ndet);
+  Array2 <log_value<T> > tot(npts,nfunc_);
+  Array1 <T> row;
+  for(int f=0; f< nfunc_; f++) { 
+    for(int det=0; det< ndet; det++) { 
+      if(real_qw(detVal(f,det,s).logval) < -1e200) { 
+        //no ratio from a singular matrix; start over like updateInverse()
+        Array2 <T> allmos(n,n), tmpinv(n,n);
+        for(int e1=0; e1< n; e1++) {
+          int curre=s*nelectrons(0)+e1;
+          for(int j=0; j< n; j++) 
+            allmos(e1,j)=moVal(0,curre,parent->occupation(f,det,s)(j));
+        }
+        for(int i=0; i< npts; i++) { 
+          for(int j=0; j< n; j++) 
+            allmos(parent->rede(e),j)=movals(i,parent->occupation(f,det,s)(j));
+          newdet(det,i)=TransposeInverseMatrix(allmos,tmpinv,n);
+        }
+      }
+      else { 
+        inverseRow(f,det,s,parent->rede(e),row);
+        for(int i=0; i< npts; i++) { 
+          T ratio=0;
+          for(int j=0; j< n; j++) 
+            ratio+=movals(i,parent->occupation(f,det,s)(j))*row(j);
+          newdet(det,i)=ratio*detVal(f,det,s);
+        }
+      }
+    }
+    for(int i=0; i< npts; i++) { 
+      for(int det=0; det< ndet; det++) 
+        detvals(det)=parent->detwt(det)*newdet(det,i)*detVal(f,det,opp);
+      tot(i,f)=sum(detvals);
+    }
+  }
+  Array2 <log_value<T> > v(nfunc_,1);
+  for(int i=0; i< npts; i++) { 
+    for(int f=0; f< nfunc_; f++) v(f,0)=tot(i,f);
+    vals(i).setVals(v);
+  }
+}
+
+//-------------------------------------------------------------------------
+
 template <class T> inline void Slat_wf<T>::evalTestPos(Array1 <doublevar> & pos, 
     Sample_point * sample, Array1 <Wf_return> & wf) {
   
@@ -1488,9 +1974,13 @@ template <class T> inline void Slat_wf<T>::evalTestPos(Array1 <doublevar> & pos,
         for(int i = 0; i < nelectrons(s); i++) {
           modet(i)=movals(s)(parent->occupation(f,det,s)(i),0);
         }
-        T ratio=1./InverseGetNewRatio(inverse(f,det,s),
-            modet, parent->rede(e),
-            nelectrons(s));
+        T ratio;
+        if(delayed) 
+          ratio=delay(f,det,s).ratio(inverse(f,det,s),parent->rede(e),modet);
+        else 
+          ratio=1./InverseGetNewRatio(inverse(f,det,s),
+              modet, parent->rede(e),
+              nelectrons(s));
         new_detVals(det)=parent->detwt(det)*detVal(f,det,s);
         new_detVals(det)*=ratio;
         new_detVals(det)*=detVal(f,det,opps);
@@ -1533,6 +2023,109 @@ template <class T> inline void Slat_wf<T>::evalTestPos(Array1 <doublevar> & pos,
 }
 
 
+//----------------------------------------------------------------------
+
+/*!
+Moving electron k of spin s to position i changes the determinant by 
+M(i,:).A^{-1}(k,:), where M holds the occupied orbitals at the positions.
+The ratios for all positions and electrons are then one matrix-matrix 
+product per determinant.
+*/
+template <class T> inline void Slat_wf<T>::evalTestPositions(Wavefunction_data * wfdata,
+    Sample_point * sample, Array2 <doublevar> & pos, Array2 <Wf_return> & wf) {
+  int npts=pos.GetDim(0);
+  int tote=sample->electronSize();
+  if(parent->use_clark_updates) { 
+    Array1 <doublevar> onepos(ndim);
+    Array1 <Wf_return> onewf;
+    wf.Resize(npts,tote);
+    for(int i=0; i< npts; i++) { 
+      for(int d=0; d< ndim; d++) onepos(d)=pos(i,d);
+      evalTestPos(onepos,sample,onewf);
+      for(int e=0; e< tote; e++) wf(i,e)=onewf(e);
+    }
+    return;
+  }
+
+  if(inverseStale) { 
+    inverseStale=0;
+    detVal=lastDetVal;
+    updateInverse(parent, lastValUpdate);
+  }
+
+  int nspin=2;
+  Array1 <Array2 <T> > movals(nspin);
+  Array2 <T> onemo(nmo,1);
+  Array1 <doublevar> oldpos(ndim), newpos(ndim);
+  for(int s=0; s< nspin; s++) movals(s).Resize(npts,nmo);
+  sample->getElectronPos(0,oldpos);
+  for(int i=0; i< npts; i++) { 
+    for(int d=0; d< ndim; d++) newpos(d)=pos(i,d);
+    sample->setElectronPosNoNotify(0,newpos);
+    sample->updateEIDist();
+    for(int s=0; s< nspin; s++) { 
+      molecorb->updateVal(sample,0,s,onemo);
+      for(int j=0; j< nmo; j++) movals(s)(i,j)=onemo(j,0);
+    }
+  }
+  sample->setElectronPosNoNotify(0,oldpos);
+  sample->updateEIDist();
+
+  Array3 <log_value<T> > tot(npts,tote,nfunc_);
+  Array3 <log_value<T> > newdet(ndet,npts,tote);
+  Array1 <log_value<T> > detvals(ndet);
+  Array2 <T> occmo, ainv;
+  Array1 <T> row;
+  for(int f=0; f< nfunc_; f++) { 
+    for(int s=0; s< nspin; s++) { 
+      int n=nelectrons(s);
+      if(n==0) continue;
+      int opps= s==0?1:0;
+      int estart=s*nelectrons(0);
+      occmo.Resize(npts,n);
+      ainv.Resize(n,n);
+      for(int det=0; det< ndet; det++) { 
+        for(int i=0; i< npts; i++) 
+          for(int j=0; j< n; j++) 
+            occmo(i,j)=movals(s)(i,parent->occupation(f,det,s)(j));
+        for(int k=0; k< n; k++) { 
+          inverseRow(f,det,s,k,row);
+          for(int j=0; j< n; j++) ainv(k,j)=row(j);
+        }
+        log_value<T> base=parent->detwt(det)*detVal(f,det,s);
+        base*=detVal(f,det,opps);
+        for(int i=0; i< npts; i++) { 
+          const T * m=occmo.v+i*n;
+          for(int k=0; k< n; k++) { 
+            const T * a=ainv.v+k*n;
+            T ratio=T(0.0);
+            for(int j=0; j< n; j++) ratio+=m[j]*a[j];
+            newdet(det,i,estart+k)=base;
+            newdet(det,i,estart+k)*=ratio;
+          }
+        }
+      }
+      for(int i=0; i< npts; i++) { 
+        for(int k=0; k< n; k++) { 
+          for(int det=0; det< ndet; det++) detvals(det)=newdet(det,i,estart+k);
+          tot(i,estart+k,f)=sum(detvals);
+        }
+      }
+    }
+  }
+
+  wf.Resize(npts,tote);
+  Array2 <log_value<T> > vals(nfunc_,1);
+  for(int i=0; i< npts; i++) { 
+    for(int e=0; e< tote; e++) { 
+      wf(i,e).Resize(nfunc_,1);
+      for(int f=0; f< nfunc_; f++) vals(f,0)=tot(i,e,f);
+      wf(i,e).setVals(vals);
+    }
+  }
+}
+
+
 //----------------------------------------------------------------------
 #endif //SLAT_WF_H_INCLUDED
 //--------------------------------------------------------------------------
@@ -315,6 +315,13 @@ void Slat_wf_data::read(vector <string> & words, unsigned int & pos,
     use_clark_updates=false;
   }
 
+  delay_depth=1;
+  readvalue(words,pos=startpos,delay_depth,"DELAY_UPDATES");
+  if(delay_depth < 1) 
+    error("DELAY_UPDATES must be at least 1");
+  if(delay_depth > 1 && use_clark_updates) 
+    error("DELAY_UPDATES only works with SHERMAN_MORRISON_UPDATES");
+
 
 
   //molecorb->buildLists(totoccupation);
@@ -333,6 +340,9 @@ int Slat_wf_data::supports(wf_support_type support) {
       return 1;
     case parameter_derivatives:
       return 1;
+    case move_proposal:
+    case virtual_moves:
+      return !use_clark_updates;
     default:
       return 0;
   }
@@ -425,6 +435,8 @@ int Slat_wf_data::showinfo(ostream & os)
     os << "Using fast updates for multideterminants.  Reference: \n";
     os << "Clark, Morales, McMinis, Kim, and Scuseria. J. Chem. Phys. 135 244105 (2011)\n";
   }
+  if(delay_depth > 1) 
+    os << "Delaying inverse updates by " << delay_depth << " moves\n";
 
   for(int f=0; f< nfunc; f++) {
     if(nfunc > 1)
@@ -478,6 +490,8 @@ int Slat_wf_data::writeinput(string & indent, ostream & os) {
     os << indent << "CLARK_UPDATES" << endl;
   else 
     os << indent << "SHERMAN_MORRISON_UPDATES" << endl;
+  if(delay_depth > 1)
+    os << indent << "DELAY_UPDATES " << delay_depth << endl;
   if(!sort)
     os << indent << "NOSORT" << endl;
 
@@ -70,7 +70,7 @@ class Slat_wf_data : public Wavefunction_data
 {
 public:
 
-  Slat_wf_data():molecorb(NULL) {}
+  Slat_wf_data():molecorb(NULL) { delay_depth=1; }
 
   ~Slat_wf_data()
   {
@@ -161,6 +161,7 @@ private:
   MO_matrix * molecorb;
   int use_complexmo;
   bool use_clark_updates; //!<Use Bryan Clark's updates.
+  int delay_depth; //!< number of accepted moves to collect before updating the inverse
   Excitation_list excitations;
   Complex_MO_matrix * cmolecorb;
 
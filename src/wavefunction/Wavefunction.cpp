@@ -358,6 +358,32 @@ void Wavefunction::getForceBias(Wavefunction_data * wfdata, int e,
 
 //----------------------------------------------------------------------
 
+void Wavefunction::evalTestPositions(Wavefunction_data * wfdata, 
+    Sample_point * sample, Array2 <doublevar> & pos, Array2 <Wf_return> & wf) { 
+  int npts=pos.GetDim(0);
+  int nelectrons=sample->electronSize();
+  wf.Resize(npts,nelectrons);
+  Storage_container store;
+  store.initialize(sample,this);
+  Array1 <doublevar> oldpos(3), newpos(3);
+  for(int e=0; e< nelectrons; e++) { 
+    store.saveUpdate(sample,this,e);
+    sample->getElectronPos(e,oldpos);
+    for(int i=0; i< npts; i++) { 
+      for(int d=0; d< 3; d++) newpos(d)=pos(i,d);
+      sample->setElectronPosNoNotify(e,newpos);
+      notify(electron_move,e);
+      updateVal(wfdata,sample);
+      wf(i,e).Resize(nfunc(),2);
+      getVal(wfdata,e,wf(i,e));
+    }
+    sample->setElectronPosNoNotify(e,oldpos);
+    store.restoreUpdate(sample,this,e);
+  }
+}
+
+//----------------------------------------------------------------------
+
 
 
 int deallocate(Wavefunction * & wfptr)
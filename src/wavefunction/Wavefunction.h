@@ -259,6 +259,34 @@ public:
     error("evalTestPos() not implemented for this wave function");
   }
 
+  /*!
+    \brief
+    evalTestPos() for many positions at once: wf(i,e) is the value with 
+    electron e moved to pos(i,:).  The wave function must be up to date.
+
+    The default moves each electron through the positions with full 
+    updates and restores it, so it works for any wave function.
+  */
+  virtual void evalTestPositions(Wavefunction_data *, Sample_point *,
+                                 Array2 <doublevar> & pos, Array2 <Wf_return> & wf);
+
+  /*!
+    \brief
+    Evaluate the wave function values obtained by moving electron e to each of 
+    the positions pos(i,:).  
+
+    The wave function state is unchanged and so is the Sample_point when
+    this returns: the Slater determinants move e without notification and
+    put it back, and the Jastrow only reads e's distances at each position
+    from Sample_point::getVirtualRows().  This avoids a full updateVal() per
+    position.  The wave function must be up to date (updateVal()).  Only
+    available if the data object supports(virtual_moves).
+  */
+  virtual void evalVirtualMoves(Wavefunction_data *, Sample_point *, int e,
+                                Array2 <doublevar> & pos, Array1 <Wf_return> & vals) { 
+    error("evalVirtualMoves() not implemented for this wave function");
+  }
+
   /*!
     \brief
     Calculate the derivatives with respect to the parameters of
@@ -323,6 +351,49 @@ public:
   virtual void restoreUpdate(Sample_point *, int e1, int e2, Wavefunction_storage *)
   {error("This Wavefunction object doesn't have two electron storage");}
 
+  /*!
+    \brief
+    Evaluate a trial move of electron e without changing the saved state.
+
+    The electron has already been moved in the Sample_point, and
+    everything else must be up to date (call updateLap() before moving).
+    lap is filled as updateLap() followed by getLap() would do.  Follow
+    with acceptMove() to keep the move, or put the electron back and call
+    rejectMove().  Only available if the data object supports(move_proposal).
+   */
+  virtual void proposeMove(Wavefunction_data *, Sample_point *, int e, Wf_return & lap)
+  {error("This Wavefunction object doesn't support move proposals");}
+
+  /*!
+    \brief
+    Make the last proposeMove() the current state.
+   */
+  virtual void acceptMove(Wavefunction_data *, Sample_point *, int e)
+  {error("This Wavefunction object doesn't support move proposals");}
+
+  /*!
+    \brief
+    Forget the last proposeMove().  The electron must already be back
+    where it was.
+   */
+  virtual void rejectMove(Wavefunction_data *, Sample_point *, int e)
+  {error("This Wavefunction object doesn't support move proposals");}
+
+  /*!
+    \brief
+    Share work between the proposeMove() calls of a crowd of walkers.
+
+    Called on one wave function of the crowd after electron e of every 
+    samples(w) has been moved and before any wfs(w)->proposeMove().  All
+    the wave functions must have been generated by wfdata.  Slat_wf uses 
+    it to evaluate the orbitals of the whole crowd at once.  The default 
+    does nothing.
+   */
+  virtual void prepareCrowdMove(Wavefunction_data * wfdata, 
+                                Array1 <Wavefunction *> & wfs,
+                                Array1 <Sample_point *> & samples, int e)
+  { }
+
 
   /*!
     \brief
@@ -441,6 +512,11 @@ public:
     sample->restoreUpdate(e, sampStore);
     wf->restoreUpdate(sample, e, wfStore);
   }
+  //!only save the electron position, for use with Wavefunction::proposeMove()
+  void saveUpdate(Sample_point * sample, int e)
+  {
+    sample->saveUpdate(e, sampStore);
+  }
   void restoreUpdate(Sample_point * sample, int e)
   {
     sample->restoreUpdate(e, sampStore);
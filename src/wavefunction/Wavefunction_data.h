@@ -27,7 +27,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 
 
-enum wf_support_type { laplacian_update, density, parameter_derivatives };
+enum wf_support_type { laplacian_update, density, parameter_derivatives, move_proposal,
+                       virtual_moves };
 
 /*!
 \brief
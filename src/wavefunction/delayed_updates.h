@@ -0,0 +1,283 @@
+/*
+
+Copyright (C) 2007 Lucas K. Wagner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*/
+#ifndef DELAYED_UPDATES_H_INCLUDED
+#define DELAYED_UPDATES_H_INCLUDED
+#include "Qmc_std.h"
+
+/*!
+Delayed (rank-k) updates of an inverse Slater matrix.  a1 is the inverse
+of a matrix A whose column c holds the orbitals of electron c, in the
+same convention as InverseUpdateColumn().  Instead of updating a1 after
+every accepted move, we keep the new columns U and their positions C, so
+that the current inverse is the Woodbury form
+\f[ A_{new}^{-1} = A^{-1} - (A^{-1}U - E) S^{-1} E^T A^{-1}, \qquad S=E^TA^{-1}U \f]
+Rows of the current inverse cost O(nk), and flush() applies all k
+columns to a1 at once as two matrix-matrix products.
+Reference: McDaniel, Kent, Reboredo, et al. J. Chem. Phys. 147, 174107 (2017).
+*/
+template <class T> class Delayed_update {
+public:
+  Delayed_update() { depth=0; n=0; k=0; }
+
+  void init(int depth_, int n_) {
+    depth=depth_;
+    n=n_;
+    k=0;
+    cols.Resize(depth);
+    U.Resize(depth,n);
+    S.Resize(depth,depth);
+    Sinv.Resize(depth,depth);
+    b.Resize(depth);
+    x.Resize(depth);
+  }
+
+  //! copy only the pending columns; used to save and restore a move
+  void copyState(const Delayed_update & o) {
+    k=o.k;
+    for(int j=0; j< k; j++) {
+      cols(j)=o.cols(j);
+      for(int l=0; l< n; l++) U(j,l)=o.U(j,l);
+      for(int i=0; i< k; i++) {
+        S(i,j)=o.S(i,j);
+        Sinv(i,j)=o.Sinv(i,j);
+      }
+    }
+  }
+
+  int pending() { return k; }
+  int full() { return k==depth; }
+  void clear() { k=0; }
+
+  //! position of column c in the pending list, or -1
+  int slot(int c) {
+    for(int j=0; j< k; j++) if(cols(j)==c) return j;
+    return -1;
+  }
+
+  //! row c of the current inverse
+  void currentRow(const Array2 <T> & a1, int c, Array1 <T> & row);
+
+  //! det(A with column c replaced by u)/det(A), A being the current matrix
+  T ratio(const Array2 <T> & a1, int c, const Array1 <T> & u);
+
+  /*!
+    Replace column c by u.  If c isn't already pending, the caller
+    must make sure there is room (flush() when full()).
+  */
+  void accept(const Array2 <T> & a1, int c, const Array1 <T> & u);
+
+  //! apply the pending columns to a1 and start over
+  void flush(Array2 <T> & a1);
+
+private:
+  void prepareRow(const Array2 <T> & a1, int c);
+  void invertS();
+
+  int depth, n, k;
+  Array1 <int> cols;     //!< C: which columns have been replaced
+  Array2 <T> U;          //!< (pending, n) the new columns
+  Array2 <T> S, Sinv;    //!< S(i,j)=a1(C_i,:).U_j
+  Array1 <T> b, x;       //!< work vectors
+  Array2 <T> B, W;       //!< work for flush()
+};
+
+//----------------------------------------------------------------------
+
+//x = (a1(c,:) U - e_c) S^{-1}, so that row c of the current inverse
+//is a1(c,:) - x a1(C,:)
+template <class T> inline void Delayed_update<T>::prepareRow(const Array2 <T> & a1, int c) {
+  const T * arow=a1.v+c*a1.GetDim(1);
+  for(int j=0; j< k; j++) {
+    const T * u=U.v+j*U.GetDim(1);
+    T dot=T(0.0);
+    for(int l=0; l< n; l++) dot+=arow[l]*u[l];
+    b(j)=dot;
+  }
+  int m=slot(c);
+  if(m >=0) b(m)-=T(1.0);
+  for(int i=0; i< k; i++) {
+    T sum=T(0.0);
+    for(int j=0; j< k; j++) sum+=b(j)*Sinv(j,i);
+    x(i)=sum;
+  }
+}
+
+//----------------------------------------------------------------------
+
+template <class T> inline void Delayed_update<T>::currentRow(const Array2 <T> & a1, int c,
+                                                            Array1 <T> & row) {
+  row.Resize(n);
+  for(int l=0; l< n; l++) row(l)=a1(c,l);
+  if(k==0) return;
+  prepareRow(a1,c);
+  for(int i=0; i< k; i++) {
+    const T * r=a1.v+cols(i)*a1.GetDim(1);
+    T xi=x(i);
+    for(int l=0; l< n; l++) row(l)-=xi*r[l];
+  }
+}
+
+//----------------------------------------------------------------------
+
+template <class T> inline T Delayed_update<T>::ratio(const Array2 <T> & a1, int c,
+                                                    const Array1 <T> & u) {
+  T f=T(0.0);
+  for(int l=0; l< n; l++) f+=a1(c,l)*u(l);
+  if(k==0) return f;
+  prepareRow(a1,c);
+  for(int i=0; i< k; i++) {
+    const T * r=a1.v+cols(i)*a1.GetDim(1);
+    T dot=T(0.0);
+    for(int l=0; l< n; l++) dot+=r[l]*u(l);
+    f-=x(i)*dot;
+  }
+  return f;
+}
+
+//----------------------------------------------------------------------
+
+template <class T> inline void Delayed_update<T>::accept(const Array2 <T> & a1, int c,
+                                                        const Array1 <T> & u) {
+  int m=slot(c);
+  if(m < 0) {
+    assert(k < depth);
+    m=k++;
+    cols(m)=c;
+    for(int l=0; l< n; l++) U(m,l)=u(l);
+    const T * arow=a1.v+c*a1.GetDim(1);
+    for(int j=0; j< k; j++) {
+      T dot=T(0.0);
+      for(int l=0; l< n; l++) dot+=arow[l]*U(j,l);
+      S(m,j)=dot;
+    }
+  }
+  else {
+    for(int l=0; l< n; l++) U(m,l)=u(l);
+  }
+  for(int i=0; i< k; i++) {
+    const T * r=a1.v+cols(i)*a1.GetDim(1);
+    T dot=T(0.0);
+    for(int l=0; l< n; l++) dot+=r[l]*u(l);
+    S(i,m)=dot;
+  }
+  invertS();
+}
+
+//----------------------------------------------------------------------
+
+//Gauss-Jordan with partial pivoting; k is small, so this is cheap
+//compared to the O(nk) work in accept().
+template <class T> inline void Delayed_update<T>::invertS() {
+  Array2 <T> & tmp=W;
+  tmp.Resize(k,k);
+  for(int i=0; i< k; i++) {
+    for(int j=0; j< k; j++) {
+      tmp(i,j)=S(i,j);
+      Sinv(i,j)=T(0.0);
+    }
+    Sinv(i,i)=T(1.0);
+  }
+  for(int col=0; col< k; col++) {
+    int piv=col;
+    for(int i=col+1; i< k; i++)
+      if(abs(tmp(i,col)) > abs(tmp(piv,col))) piv=i;
+    if(piv!=col) {
+      for(int j=0; j< k; j++) {
+        exchange(tmp(col,j),tmp(piv,j));
+        exchange(Sinv(col,j),Sinv(piv,j));
+      }
+    }
+    T d=T(1.0)/tmp(col,col);
+    for(int j=0; j< k; j++) {
+      tmp(col,j)*=d;
+      Sinv(col,j)*=d;
+    }
+    for(int i=0; i< k; i++) {
+      if(i==col) continue;
+      T f=tmp(i,col);
+      for(int j=0; j< k; j++) {
+        tmp(i,j)-=f*tmp(col,j);
+        Sinv(i,j)-=f*Sinv(col,j);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+
+template <class T> inline void Delayed_update<T>::flush(Array2 <T> & a1) {
+  if(k==0) return;
+  int lda=a1.GetDim(1);
+  //B = a1 U^T - E
+  B.Resize(n,k);
+  for(int i=0; i< n; i++) {
+    const T * arow=a1.v+i*lda;
+    for(int j=0; j< k; j++) {
+      const T * u=U.v+j*U.GetDim(1);
+      T dot=T(0.0);
+      for(int l=0; l< n; l++) dot+=arow[l]*u[l];
+      B(i,j)=dot;
+    }
+  }
+  for(int j=0; j< k; j++) B(cols(j),j)-=T(1.0);
+  //W = S^{-1} a1(C,:)
+  W.Resize(k,n);
+  for(int i=0; i< k; i++) {
+    for(int l=0; l< n; l++) W(i,l)=T(0.0);
+    for(int j=0; j< k; j++) {
+      T s=Sinv(i,j);
+      const T * r=a1.v+cols(j)*lda;
+      for(int l=0; l< n; l++) W(i,l)+=s*r[l];
+    }
+  }
+  //a1 -= B W
+  for(int i=0; i< n; i++) {
+    T * arow=a1.v+i*lda;
+    for(int j=0; j< k; j++) {
+      T bij=B(i,j);
+      const T * w=W.v+j*n;
+      for(int l=0; l< n; l++) arow[l]-=bij*w[l];
+    }
+  }
+  k=0;
+}
+
+#ifdef USE_BLAS
+template <> inline void Delayed_update<doublevar>::flush(Array2 <doublevar> & a1) {
+  if(k==0) return;
+  int lda=a1.GetDim(1);
+  B.Resize(n,k);
+  cblas_dgemm(CblasRowMajor,CblasNoTrans,CblasTrans,n,k,n,
+              1.0,a1.v,lda,U.v,U.GetDim(1),0.0,B.v,k);
+  for(int j=0; j< k; j++) B(cols(j),j)-=1.0;
+  W.Resize(k,n);
+  Array2 <doublevar> R(k,n);
+  for(int j=0; j< k; j++)
+    for(int l=0; l< n; l++) R(j,l)=a1(cols(j),l);
+  cblas_dgemm(CblasRowMajor,CblasNoTrans,CblasNoTrans,k,n,k,
+              1.0,Sinv.v,Sinv.GetDim(1),R.v,n,0.0,W.v,n);
+  cblas_dgemm(CblasRowMajor,CblasNoTrans,CblasNoTrans,n,n,k,
+              -1.0,B.v,k,W.v,n,1.0,a1.v,lda);
+  k=0;
+}
+#endif
+
+#endif //DELAYED_UPDATES_H_INCLUDED
+//----------------------------------------------------------------------